@@ -0,0 +1,154 @@
+#include "core/core.h"
+#include "core/timer.h"
+
+#include "graphics/framegraph/framegraph.h"
+
+#include <stdio.h>
+
+// Compiles large generated framegraphs to time the scheduler on its own, nothing here touches the GPU
+// Every layer reads from the layers before it, and some passes write images nothing reads so they get culled
+
+#define BENCH_ITERATIONS 20
+
+typedef struct {
+    u32 numLayers;
+    u32 passesPerLayer;
+    u32 maxInputs;
+    u32 deadEvery; // Every nth pass writes an image that nothing reads
+} bench_graph_config;
+
+u32 bench_random(u32* state) {
+    *state = *state * 1664525u + 1013904223u;
+    return *state >> 8;
+}
+
+char* bench_name(const char* prefix, u32 index) {
+    char* name = malloc(32);
+    snprintf(name, 32, "%s%u", prefix, index);
+    return name;
+}
+
+// Image names are copied by the framegraph, pass names aren't so they're handed back to be freed afterwards
+framegraph_framegraph* bench_build_graph(bench_graph_config graph, char*** names, u32* numNames) {
+    framegraph_config config;
+    CLEAR_MEMORY(&config);
+    config.width = 1920;
+    config.height = 1080;
+    config.framesInFlight = 2;
+    framegraph_framegraph* framegraph = framegraph_create(config);
+
+    u32 numPasses = graph.numLayers * graph.passesPerLayer;
+    *numNames = numPasses;
+    *names = malloc(sizeof(char*) * (*numNames));
+    framegraph_image_handle* images = malloc(sizeof(framegraph_image_handle) * numPasses);
+
+    framegraph_image_handle backbuffer = framegraph_add_image(framegraph, FRAMEGRAPH_BACKBUFFER, VK_FORMAT_B8G8R8A8_UNORM, false);
+    for (u32 i = 0; i < numPasses; i++) {
+        char imageName[32];
+        snprintf(imageName, sizeof(imageName), "image%u", i);
+        images[i] = framegraph_add_image(framegraph, imageName, VK_FORMAT_R16G16B16A16_SFLOAT, false);
+        (*names)[i] = bench_name("pass", i);
+    }
+
+    // Copied when each pass is declared, so one array does for all of them
+    framegraph_image_handle* inputs = malloc(sizeof(framegraph_image_handle) * (graph.maxInputs + graph.passesPerLayer));
+    u32 seed = 12345;
+    for (u32 layer = 0; layer < graph.numLayers; layer++) {
+        for (u32 slot = 0; slot < graph.passesPerLayer; slot++) {
+            u32 index = layer * graph.passesPerLayer + slot;
+            bool last = index == numPasses - 1;
+
+            framegraph_pass_config pass;
+            CLEAR_MEMORY(&pass);
+            pass.name = (*names)[index];
+            pass.numOutputs = 1;
+            pass.outputs = last ? &backbuffer : &images[index];
+            pass.inputs = inputs;
+
+            // Dead passes only read, so nothing downstream ever picks up their output
+            if (layer > 0) {
+                u32 numInputs = 1 + bench_random(&seed) % graph.maxInputs;
+                for (u32 i = 0; i < numInputs; i++) {
+                    // Mostly the layer just before, with the odd long edge back to an earlier one
+                    u32 source = bench_random(&seed) % 4 == 0
+                        ? bench_random(&seed) % (layer * graph.passesPerLayer)
+                        : (layer - 1) * graph.passesPerLayer + bench_random(&seed) % graph.passesPerLayer;
+                    if (graph.deadEvery > 0 && source % graph.deadEvery == 0) continue;
+                    inputs[pass.numInputs++] = images[source];
+                }
+            }
+            // The final pass pulls in the whole last layer so most of the graph stays live
+            if (last) {
+                for (u32 i = 1; i < graph.passesPerLayer; i++) {
+                    u32 source = index - i;
+                    if (graph.deadEvery > 0 && source % graph.deadEvery == 0) continue;
+                    inputs[pass.numInputs++] = images[source];
+                }
+            }
+            framegraph_add_pass(framegraph, pass);
+        }
+    }
+    free(inputs);
+    free(images);
+    return framegraph;
+}
+
+// Every pass has to come after the writers of what it reads, and nothing should be scheduled twice
+bool bench_validate(framegraph_framegraph* framegraph) {
+    u32* position = malloc(sizeof(u32) * framegraph->numPasses);
+    for (u32 i = 0; i < framegraph->numPasses; i++) {
+        position[i] = UINT32_MAX;
+    }
+    bool valid = framegraph->numOrderedPasses + framegraph->numCulledPasses == framegraph->numPasses;
+    for (u32 i = 0; i < framegraph->numOrderedPasses; i++) {
+        u32 index = framegraph->orderedPasses[i]->index;
+        if (position[index] != UINT32_MAX) valid = false;
+        position[index] = i;
+    }
+    for (u32 i = 0; i < framegraph->numOrderedPasses; i++) {
+        framegraph_pass* pass = framegraph->orderedPasses[i];
+        for (u32 j = 0; j < pass->numReadImages; j++) {
+            framegraph_pass* writer = pass->readImages[j]->write;
+            if (writer != NULL && writer != pass && position[writer->index] >= i) valid = false;
+        }
+    }
+    free(position);
+    return valid;
+}
+
+void bench_run(bench_graph_config graph) {
+    char** names;
+    u32 numNames;
+    double start = timer_now();
+    framegraph_framegraph* framegraph = bench_build_graph(graph, &names, &numNames);
+    double declareTime = timer_now() - start;
+
+    start = timer_now();
+    for (u32 i = 0; i < BENCH_ITERATIONS; i++) {
+        framegraph_compile(framegraph);
+    }
+    double compileTime = (timer_now() - start) / BENCH_ITERATIONS;
+
+    printf("%6u passes: declare %8.2f ms, compile %8.1f us, %u scheduled, %u culled, %s\n",
+        framegraph->numPasses, declareTime * 1000.0, compileTime * 1000000.0,
+        framegraph->numOrderedPasses, framegraph->numCulledPasses, bench_validate(framegraph) ? "valid" : "INVALID");
+
+    framegraph_destroy(framegraph);
+    for (u32 i = 0; i < numNames; i++) {
+        free(names[i]);
+    }
+    free(names);
+}
+
+int main() {
+    bench_graph_config graphs[] = {
+        { 16, 8, 3, 7 },
+        { 64, 16, 3, 7 },
+        { 128, 32, 4, 5 },
+        { 256, 32, 4, 5 },
+    };
+    for (u32 i = 0; i < sizeof(graphs) / sizeof(graphs[0]); i++) {
+        bench_run(graphs[i]);
+    }
+    return 0;
+}
\ No newline at end of file
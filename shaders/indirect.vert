@@ -0,0 +1,37 @@
+#version 450
+
+layout(set = 0, binding = 0) uniform GlobalData {
+    mat4 view;
+    mat4 proj;
+} global;
+
+struct Instance {
+    vec4 sphere;
+    uint firstIndex;
+    uint indexCount;
+    int vertexOffset;
+    uint material;
+    uint bucket;
+    uint commandBase;
+    uint padding[2];
+};
+
+// The culling pass writes each draw's instance index into firstInstance
+layout(std430, set = 0, binding = 1) readonly buffer Instances {
+    Instance instances[];
+};
+
+layout(location = 0) in vec3 inPosition;
+layout(location = 1) in vec3 inNormal;
+layout(location = 2) in vec2 inColorUV;
+
+layout(location = 0) out vec2 fragColorUV;
+layout(location = 1) out vec3 fragPosition;
+layout(location = 2) flat out uint fragMaterial;
+
+void main() {
+    gl_Position = global.proj * global.view * vec4(inPosition, 1.0);
+    fragColorUV = inColorUV;
+    fragPosition = gl_Position.xyz;
+    fragMaterial = instances[gl_InstanceIndex].material;
+}
\ No newline at end of file
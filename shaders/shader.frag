@@ -1,19 +1,49 @@
 #version 450
+#extension GL_EXT_nonuniform_qualifier : require
+
+// 0 = opaque, 1 = mask, 2 = blend, matching model_material_variant
+layout(constant_id = 0) const uint ALPHA_MODE = 0;
+layout(constant_id = 1) const float ALPHA_CUTOFF = 0.5;
+layout(constant_id = 2) const bool HAS_BASE_COLOR_TEXTURE = true;
 
 layout(location = 0) out vec4 accum;
 layout(location = 1) out float reveal;
 
-layout (set = 1, binding = 0) uniform Material {
+struct Material {
     vec4 baseColorFactor;
-} material;
+    uint baseColorTexture;
+    uint baseColorSampler;
+};
+
+layout (set = 1, binding = 0) uniform texture2D textures[];
+layout (set = 1, binding = 1) uniform sampler samplers[];
+layout (std430, set = 1, binding = 2) readonly buffer Materials {
+    Material materials[];
+} materialBuffers[];
 
-layout (set = 1, binding = 1) uniform sampler2D baseColorTexture;
+// The material comes in from the vertex shader, which gets it from the push constants or the instance buffer
+layout (push_constant) uniform DrawConstants {
+    uint materialBuffer;
+    uint material;
+} draw;
 
 layout(location = 0) in vec2 fragColorUV;
 layout(location = 1) in vec3 fragPosition;
+layout(location = 2) flat in uint fragMaterial;
 
 void main() {
-    vec4 color = material.baseColorFactor * texture(baseColorTexture, fragColorUV);
+    Material material = materialBuffers[draw.materialBuffer].materials[fragMaterial];
+    vec4 color = material.baseColorFactor;
+    if (HAS_BASE_COLOR_TEXTURE) {
+        color *= texture(sampler2D(textures[nonuniformEXT(material.baseColorTexture)], samplers[nonuniformEXT(material.baseColorSampler)]), fragColorUV);
+    }
+
+    if (ALPHA_MODE == 1) {
+        if (color.a < ALPHA_CUTOFF) discard;
+        color.a = 1.0;
+    } else if (ALPHA_MODE == 0) {
+        color.a = 1.0;
+    }
 
     float weight = 
       max(min(1.0, max(max(color.r, color.g), color.b) * color.a), color.a) *
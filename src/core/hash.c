@@ -0,0 +1,26 @@
+#include "hash.h"
+
+#define FNV_PRIME 0x100000001b3ull
+
+u64 hash_bytes(const void* data, u64 size, u64 seed) {
+    const u8* bytes = (const u8*)data;
+    u64 hash = seed;
+    for (u64 i = 0; i < size; i++) {
+        hash ^= bytes[i];
+        hash *= FNV_PRIME;
+    }
+    return hash;
+}
+
+u64 hash_u64(u64 value, u64 seed) {
+    return hash_bytes(&value, sizeof(u64), seed);
+}
+
+u64 hash_string(const char* string, u64 seed) {
+    u64 hash = seed;
+    for (const u8* c = (const u8*)string; *c != '\0'; c++) {
+        hash ^= *c;
+        hash *= FNV_PRIME;
+    }
+    return hash;
+}
\ No newline at end of file
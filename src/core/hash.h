@@ -0,0 +1,10 @@
+#pragma once
+
+#include "types.h"
+
+#define HASH_SEED 0xcbf29ce484222325ull
+
+// FNV-1a, chained through the seed so several fields can be folded into one key
+u64 hash_bytes(const void* data, u64 size, u64 seed);
+u64 hash_u64(u64 value, u64 seed);
+u64 hash_string(const char* string, u64 seed);
\ No newline at end of file
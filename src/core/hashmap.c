@@ -0,0 +1,113 @@
+#include "hashmap.h"
+
+#define HASHMAP_MIN_CAPACITY 16
+
+u32 hashmap_round_capacity(u32 capacity) {
+    u32 rounded = HASHMAP_MIN_CAPACITY;
+    while (rounded < capacity) rounded <<= 1;
+    return rounded;
+}
+
+hashmap* hashmap_create(u32 capacity) {
+    hashmap* map = malloc(sizeof(hashmap));
+    CLEAR_MEMORY(map);
+    map->capacity = hashmap_round_capacity(capacity);
+    map->entries = malloc(sizeof(hashmap_entry) * map->capacity);
+    CLEAR_MEMORY_ARRAY(map->entries, map->capacity);
+
+    return map;
+}
+
+void hashmap_destroy(hashmap* map) {
+    free(map->entries);
+    free(map);
+}
+
+hashmap_entry* hashmap_find(hashmap* map, u64 key) {
+    u32 mask = map->capacity - 1;
+    for (u32 i = (u32)(key ^ (key >> 32)) & mask;; i = (i + 1) & mask) {
+        hashmap_entry* entry = &map->entries[i];
+        if (entry->state == HASHMAP_ENTRY_EMPTY) return NULL;
+        if (entry->state == HASHMAP_ENTRY_OCCUPIED && entry->key == key) return entry;
+    }
+}
+
+void hashmap_insert(hashmap* map, u64 key, void* value) {
+    u32 mask = map->capacity - 1;
+    for (u32 i = (u32)(key ^ (key >> 32)) & mask;; i = (i + 1) & mask) {
+        hashmap_entry* entry = &map->entries[i];
+        if (entry->state != HASHMAP_ENTRY_OCCUPIED) {
+            if (entry->state == HASHMAP_ENTRY_REMOVED) map->numRemoved--;
+            entry->key = key;
+            entry->value = value;
+            entry->state = HASHMAP_ENTRY_OCCUPIED;
+            map->count++;
+            return;
+        }
+    }
+}
+
+void hashmap_resize(hashmap* map, u32 capacity) {
+    u32 oldCapacity = map->capacity;
+    hashmap_entry* oldEntries = map->entries;
+
+    map->capacity = capacity;
+    map->count = 0;
+    map->numRemoved = 0;
+    map->entries = malloc(sizeof(hashmap_entry) * capacity);
+    CLEAR_MEMORY_ARRAY(map->entries, capacity);
+
+    for (u32 i = 0; i < oldCapacity; i++) {
+        if (oldEntries[i].state == HASHMAP_ENTRY_OCCUPIED) {
+            hashmap_insert(map, oldEntries[i].key, oldEntries[i].value);
+        }
+    }
+    free(oldEntries);
+}
+
+void* hashmap_get(hashmap* map, u64 key) {
+    hashmap_entry* entry = hashmap_find(map, key);
+    return entry != NULL ? entry->value : NULL;
+}
+
+void hashmap_set(hashmap* map, u64 key, void* value) {
+    hashmap_entry* entry = hashmap_find(map, key);
+    if (entry != NULL) {
+        entry->value = value;
+        return;
+    }
+
+    // Removed entries still lengthen probe chains so they count towards the load factor
+    if ((map->count + map->numRemoved + 1) * 4 > map->capacity * 3) {
+        hashmap_resize(map, (map->count + 1) * 2 > map->capacity ? map->capacity * 2 : map->capacity);
+    }
+    hashmap_insert(map, key, value);
+}
+
+void hashmap_remove(hashmap* map, u64 key) {
+    hashmap_entry* entry = hashmap_find(map, key);
+    if (entry == NULL) return;
+
+    entry->state = HASHMAP_ENTRY_REMOVED;
+    entry->value = NULL;
+    map->count--;
+    map->numRemoved++;
+}
+
+void hashmap_clear(hashmap* map) {
+    CLEAR_MEMORY_ARRAY(map->entries, map->capacity);
+    map->count = 0;
+    map->numRemoved = 0;
+}
+
+bool hashmap_next(hashmap* map, u32* iterator, u64* key, void** value) {
+    while (*iterator < map->capacity) {
+        hashmap_entry* entry = &map->entries[(*iterator)++];
+        if (entry->state == HASHMAP_ENTRY_OCCUPIED) {
+            if (key != NULL) *key = entry->key;
+            if (value != NULL) *value = entry->value;
+            return true;
+        }
+    }
+    return false;
+}
\ No newline at end of file
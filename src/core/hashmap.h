@@ -0,0 +1,34 @@
+#pragma once
+
+#include "core.h"
+
+typedef enum {
+    HASHMAP_ENTRY_EMPTY,
+    HASHMAP_ENTRY_OCCUPIED,
+    HASHMAP_ENTRY_REMOVED
+} hashmap_entry_state;
+
+typedef struct {
+    u64 key;
+    void* value;
+    hashmap_entry_state state;
+} hashmap_entry;
+
+// Open addressing map from pre-hashed 64 bit keys to pointers, callers own the values
+typedef struct {
+    u32 capacity;
+    u32 count;
+    u32 numRemoved;
+    hashmap_entry* entries;
+} hashmap;
+
+hashmap* hashmap_create(u32 capacity);
+void hashmap_destroy(hashmap* map);
+
+void* hashmap_get(hashmap* map, u64 key);
+void hashmap_set(hashmap* map, u64 key, void* value);
+void hashmap_remove(hashmap* map, u64 key);
+void hashmap_clear(hashmap* map);
+
+// Iterate with a zeroed iterator until this returns false, the map must not be modified while iterating
+bool hashmap_next(hashmap* map, u32* iterator, u64* key, void** value);
\ No newline at end of file
@@ -0,0 +1,126 @@
+#include "jobs.h"
+
+void job_pool_worker(void* data) {
+    job_pool* pool = (job_pool*)data;
+
+    mutex_lock(pool->lock);
+    while (true) {
+        while (pool->head == pool->numJobs && !pool->stopping) {
+            condition_wait(pool->available, pool->lock);
+        }
+        if (pool->head == pool->numJobs) break;
+
+        job next = pool->jobs[pool->head++];
+        if (pool->head == pool->numJobs) {
+            pool->head = 0;
+            pool->numJobs = 0;
+        }
+        pool->numActive++;
+        mutex_unlock(pool->lock);
+
+        next.fn(next.data);
+        if (next.group) {
+            mutex_lock(next.group->lock);
+            next.group->numPending--;
+            if (next.group->numPending == 0) {
+                condition_broadcast(next.group->done);
+            }
+            mutex_unlock(next.group->lock);
+        }
+
+        mutex_lock(pool->lock);
+        pool->numActive--;
+        if (pool->numActive == 0 && pool->head == pool->numJobs) {
+            condition_broadcast(pool->idle);
+        }
+    }
+    mutex_unlock(pool->lock);
+}
+
+job_pool* job_pool_create(u32 numThreads) {
+    job_pool* pool = malloc(sizeof(job_pool));
+    CLEAR_MEMORY(pool);
+    pool->lock = mutex_create();
+    pool->available = condition_create();
+    pool->idle = condition_create();
+    pool->jobs = malloc(0);
+
+    pool->numThreads = numThreads > 0 ? numThreads : 1;
+    pool->threads = malloc(sizeof(thread*) * pool->numThreads);
+    for (u32 i = 0; i < pool->numThreads; i++) {
+        pool->threads[i] = thread_create(job_pool_worker, pool);
+    }
+
+    return pool;
+}
+
+void job_pool_destroy(job_pool* pool) {
+    mutex_lock(pool->lock);
+    pool->stopping = true;
+    condition_broadcast(pool->available);
+    mutex_unlock(pool->lock);
+
+    for (u32 i = 0; i < pool->numThreads; i++) {
+        thread_join(pool->threads[i]);
+    }
+
+    free(pool->threads);
+    free(pool->jobs);
+    condition_destroy(pool->available);
+    condition_destroy(pool->idle);
+    mutex_destroy(pool->lock);
+    free(pool);
+}
+
+void submit_job(job_pool* pool, job_fn fn, void* data, job_group* group) {
+    mutex_lock(pool->lock);
+    pool->numJobs++;
+    pool->jobs = realloc(pool->jobs, sizeof(job) * pool->numJobs);
+    pool->jobs[pool->numJobs - 1].fn = fn;
+    pool->jobs[pool->numJobs - 1].data = data;
+    pool->jobs[pool->numJobs - 1].group = group;
+    condition_signal(pool->available);
+    mutex_unlock(pool->lock);
+}
+
+void job_pool_submit(job_pool* pool, job_fn fn, void* data) {
+    submit_job(pool, fn, data, NULL);
+}
+
+void job_pool_wait(job_pool* pool) {
+    mutex_lock(pool->lock);
+    while (pool->numActive != 0 || pool->head != pool->numJobs) {
+        condition_wait(pool->idle, pool->lock);
+    }
+    mutex_unlock(pool->lock);
+}
+
+job_group* job_group_create() {
+    job_group* group = malloc(sizeof(job_group));
+    CLEAR_MEMORY(group);
+    group->lock = mutex_create();
+    group->done = condition_create();
+    return group;
+}
+
+void job_group_destroy(job_group* group) {
+    job_group_wait(group);
+    condition_destroy(group->done);
+    mutex_destroy(group->lock);
+    free(group);
+}
+
+void job_group_submit(job_group* group, job_pool* pool, job_fn fn, void* data) {
+    mutex_lock(group->lock);
+    group->numPending++;
+    mutex_unlock(group->lock);
+    submit_job(pool, fn, data, group);
+}
+
+void job_group_wait(job_group* group) {
+    mutex_lock(group->lock);
+    while (group->numPending != 0) {
+        condition_wait(group->done, group->lock);
+    }
+    mutex_unlock(group->lock);
+}
\ No newline at end of file
@@ -0,0 +1,47 @@
+#pragma once
+
+#include "core.h"
+#include "thread.h"
+
+typedef void (*job_fn)(void* data);
+
+// Lets a submitter wait on just its own jobs rather than everything queued on the pool
+typedef struct {
+    mutex* lock;
+    condition* done;
+    u32 numPending;
+} job_group;
+
+typedef struct {
+    job_fn fn;
+    void* data;
+    job_group* group;
+} job;
+
+// Fixed set of worker threads pulling from one FIFO queue
+typedef struct {
+    u32 numThreads;
+    thread** threads;
+
+    mutex* lock;
+    condition* available;
+    condition* idle;
+
+    u32 head;
+    u32 numJobs;
+    job* jobs;
+    u32 numActive;
+    bool stopping;
+} job_pool;
+
+job_pool* job_pool_create(u32 numThreads);
+// Runs everything still queued before the workers exit
+void job_pool_destroy(job_pool* pool);
+
+void job_pool_submit(job_pool* pool, job_fn fn, void* data);
+void job_pool_wait(job_pool* pool);
+
+job_group* job_group_create();
+void job_group_destroy(job_group* group);
+void job_group_submit(job_group* group, job_pool* pool, job_fn fn, void* data);
+void job_group_wait(job_group* group);
\ No newline at end of file
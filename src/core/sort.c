@@ -0,0 +1,46 @@
+#include "sort.h"
+
+#include "core.h"
+
+void radix_sort_u64(u32 count, u64* keys, u32* values, u64* tempKeys, u32* tempValues) {
+    u64* srcKeys = keys;
+    u32* srcValues = values;
+    u64* dstKeys = tempKeys;
+    u32* dstValues = tempValues;
+
+    for (u32 shift = 0; shift < 64; shift += 8) {
+        u32 counts[256];
+        CLEAR_MEMORY_ARRAY(counts, 256);
+        for (u32 i = 0; i < count; i++) {
+            counts[(srcKeys[i] >> shift) & 0xFF]++;
+        }
+
+        // Draw keys mostly differ in a few fields, a byte that is the same everywhere doesn't need a pass
+        if (count == 0 || counts[(srcKeys[0] >> shift) & 0xFF] == count) continue;
+
+        u32 offset = 0;
+        for (u32 i = 0; i < 256; i++) {
+            u32 bucket = counts[i];
+            counts[i] = offset;
+            offset += bucket;
+        }
+
+        for (u32 i = 0; i < count; i++) {
+            u32 index = counts[(srcKeys[i] >> shift) & 0xFF]++;
+            dstKeys[index] = srcKeys[i];
+            dstValues[index] = srcValues[i];
+        }
+
+        u64* swapKeys = srcKeys;
+        srcKeys = dstKeys;
+        dstKeys = swapKeys;
+        u32* swapValues = srcValues;
+        srcValues = dstValues;
+        dstValues = swapValues;
+    }
+
+    if (srcKeys != keys) {
+        memcpy(keys, srcKeys, sizeof(u64) * count);
+        memcpy(values, srcValues, sizeof(u32) * count);
+    }
+}
\ No newline at end of file
@@ -0,0 +1,7 @@
+#pragma once
+
+#include "types.h"
+
+// Stable LSD radix sort over the keys a byte at a time, each value moves with its key
+// The temporary arrays need as many elements as there are keys, the sorted result always ends up back in keys and values
+void radix_sort_u64(u32 count, u64* keys, u32* values, u64* tempKeys, u32* tempValues);
\ No newline at end of file
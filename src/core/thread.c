@@ -0,0 +1,199 @@
+#include "thread.h"
+
+#ifdef _WIN32
+#include <windows.h>
+
+typedef struct thread_t {
+    HANDLE handle;
+    thread_fn fn;
+    void* data;
+} thread;
+
+typedef struct mutex_t {
+    CRITICAL_SECTION section;
+} mutex;
+
+typedef struct condition_t {
+    CONDITION_VARIABLE variable;
+} condition;
+
+DWORD WINAPI thread_entry(LPVOID param) {
+    thread* t = (thread*)param;
+    t->fn(t->data);
+    return 0;
+}
+
+thread* thread_create(thread_fn fn, void* data) {
+    thread* t = malloc(sizeof(thread));
+    t->fn = fn;
+    t->data = data;
+    t->handle = CreateThread(NULL, 0, thread_entry, t, 0, NULL);
+    if (t->handle == NULL) {
+        FATAL("Thread creation failed with error code: %d", (i32)GetLastError());
+    }
+    return t;
+}
+
+void thread_join(thread* t) {
+    WaitForSingleObject(t->handle, INFINITE);
+    CloseHandle(t->handle);
+    free(t);
+}
+
+u32 thread_hardware_concurrency() {
+    SYSTEM_INFO info;
+    GetSystemInfo(&info);
+    return info.dwNumberOfProcessors;
+}
+
+mutex* mutex_create() {
+    mutex* m = malloc(sizeof(mutex));
+    InitializeCriticalSection(&m->section);
+    return m;
+}
+
+void mutex_destroy(mutex* m) {
+    DeleteCriticalSection(&m->section);
+    free(m);
+}
+
+void mutex_lock(mutex* m) {
+    EnterCriticalSection(&m->section);
+}
+
+void mutex_unlock(mutex* m) {
+    LeaveCriticalSection(&m->section);
+}
+
+condition* condition_create() {
+    condition* c = malloc(sizeof(condition));
+    InitializeConditionVariable(&c->variable);
+    return c;
+}
+
+void condition_destroy(condition* c) {
+    free(c);
+}
+
+void condition_wait(condition* c, mutex* m) {
+    SleepConditionVariableCS(&c->variable, &m->section, INFINITE);
+}
+
+void condition_signal(condition* c) {
+    WakeConditionVariable(&c->variable);
+}
+
+void condition_broadcast(condition* c) {
+    WakeAllConditionVariable(&c->variable);
+}
+
+i32 atomic_load_i32(volatile i32* value) {
+    return InterlockedCompareExchange((volatile LONG*)value, 0, 0);
+}
+
+void atomic_store_i32(volatile i32* value, i32 newValue) {
+    InterlockedExchange((volatile LONG*)value, newValue);
+}
+
+i32 atomic_add_i32(volatile i32* value, i32 amount) {
+    return InterlockedExchangeAdd((volatile LONG*)value, amount) + amount;
+}
+#else
+#include <pthread.h>
+#include <unistd.h>
+
+typedef struct thread_t {
+    pthread_t handle;
+    thread_fn fn;
+    void* data;
+} thread;
+
+typedef struct mutex_t {
+    pthread_mutex_t mutex;
+} mutex;
+
+typedef struct condition_t {
+    pthread_cond_t cond;
+} condition;
+
+void* thread_entry(void* param) {
+    thread* t = (thread*)param;
+    t->fn(t->data);
+    return NULL;
+}
+
+thread* thread_create(thread_fn fn, void* data) {
+    thread* t = malloc(sizeof(thread));
+    t->fn = fn;
+    t->data = data;
+    i32 result = pthread_create(&t->handle, NULL, thread_entry, t);
+    if (result != 0) {
+        FATAL("Thread creation failed with error code: %d", result);
+    }
+    return t;
+}
+
+void thread_join(thread* t) {
+    pthread_join(t->handle, NULL);
+    free(t);
+}
+
+u32 thread_hardware_concurrency() {
+    long count = sysconf(_SC_NPROCESSORS_ONLN);
+    return count > 0 ? (u32)count : 1;
+}
+
+mutex* mutex_create() {
+    mutex* m = malloc(sizeof(mutex));
+    pthread_mutex_init(&m->mutex, NULL);
+    return m;
+}
+
+void mutex_destroy(mutex* m) {
+    pthread_mutex_destroy(&m->mutex);
+    free(m);
+}
+
+void mutex_lock(mutex* m) {
+    pthread_mutex_lock(&m->mutex);
+}
+
+void mutex_unlock(mutex* m) {
+    pthread_mutex_unlock(&m->mutex);
+}
+
+condition* condition_create() {
+    condition* c = malloc(sizeof(condition));
+    pthread_cond_init(&c->cond, NULL);
+    return c;
+}
+
+void condition_destroy(condition* c) {
+    pthread_cond_destroy(&c->cond);
+    free(c);
+}
+
+void condition_wait(condition* c, mutex* m) {
+    pthread_cond_wait(&c->cond, &m->mutex);
+}
+
+void condition_signal(condition* c) {
+    pthread_cond_signal(&c->cond);
+}
+
+void condition_broadcast(condition* c) {
+    pthread_cond_broadcast(&c->cond);
+}
+
+i32 atomic_load_i32(volatile i32* value) {
+    return __atomic_load_n(value, __ATOMIC_SEQ_CST);
+}
+
+void atomic_store_i32(volatile i32* value, i32 newValue) {
+    __atomic_store_n(value, newValue, __ATOMIC_SEQ_CST);
+}
+
+i32 atomic_add_i32(volatile i32* value, i32 amount) {
+    return __atomic_add_fetch(value, amount, __ATOMIC_SEQ_CST);
+}
+#endif
\ No newline at end of file
@@ -0,0 +1,29 @@
+#pragma once
+
+#include "core.h"
+
+typedef struct thread_t thread;
+typedef struct mutex_t mutex;
+typedef struct condition_t condition;
+
+typedef void (*thread_fn)(void* data);
+
+thread* thread_create(thread_fn fn, void* data);
+void thread_join(thread* t);
+u32 thread_hardware_concurrency();
+
+mutex* mutex_create();
+void mutex_destroy(mutex* m);
+void mutex_lock(mutex* m);
+void mutex_unlock(mutex* m);
+
+condition* condition_create();
+void condition_destroy(condition* c);
+void condition_wait(condition* c, mutex* m);
+void condition_signal(condition* c);
+void condition_broadcast(condition* c);
+
+// Sequentially consistent, for flags and counters shared with worker threads
+i32 atomic_load_i32(volatile i32* value);
+void atomic_store_i32(volatile i32* value, i32 newValue);
+i32 atomic_add_i32(volatile i32* value, i32 amount);
\ No newline at end of file
@@ -0,0 +1,6 @@
+#pragma once
+
+#include "types.h"
+
+// Seconds on a monotonic clock, only meaningful relative to another call
+double timer_now();
\ No newline at end of file
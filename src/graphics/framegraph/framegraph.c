@@ -1,154 +1,2074 @@
 #include "framegraph.h"
 
+#include "core/hash.h"
+
+#include "cJSON.h"
+
 framegraph_framegraph* framegraph_create(framegraph_config config) {
     framegraph_framegraph* framegraph = malloc(sizeof(framegraph_framegraph));
     CLEAR_MEMORY(framegraph);
     framegraph->config = config;
+    framegraph->images = malloc(0);
+    framegraph->imageNames = hashmap_create(0);
+    framegraph->passes = malloc(0);
+    framegraph->links = malloc(0);
+    framegraph->recordGroup = job_group_create();
+    framegraph->recordJobs = malloc(0);
+    framegraph->recordBuffers = malloc(0);
 
     return framegraph;
 }
 
+void free_barrier_batch(framegraph_barrier_batch* batch) {
+    free(batch->barriers);
+    free(batch->images);
+    CLEAR_MEMORY(batch);
+}
+
+// Frees everything framegraph_update built from the declaration, leaving the declaration itself to be compiled again
+void release_compiled_framegraph(framegraph_framegraph* framegraph) {
+    // A compile still running on a worker may be reading one of the renderpasses
+    if (framegraph->ctx) {
+        vulkan_pso_cache_wait(framegraph->ctx->psos);
+    }
+
+    for (u32 i = 0; i < framegraph->numPasses; i++) {
+        framegraph_pass* pass = framegraph->passes[i];
+        for (u32 j = 0; j < pass->numFramebuffers; j++) {
+            vulkan_framebuffer_destroy(pass->framebuffers[j]);
+        }
+        free(pass->framebuffers);
+        pass->numFramebuffers = 0;
+        pass->framebuffers = NULL;
+        for (u32 j = 0; j < pass->numDescriptorLayouts; j++) {
+            vulkan_descriptor_set_layout_destroy(pass->descriptorLayouts[j]);
+        }
+        free(pass->descriptorLayouts);
+        pass->numDescriptorLayouts = 0;
+        pass->descriptorLayouts = NULL;
+        free(pass->psos);
+        free(pass->fallbacks);
+        free(pass->pipelines);
+        pass->numPsos = 0;
+        pass->psos = NULL;
+        pass->fallbacks = NULL;
+        pass->pipelines = NULL;
+        // Merged passes only borrow the render pass of the pass they were merged into
+        if (pass->renderpass && pass->subpass == 0) {
+            vulkan_renderpass_destroy(pass->renderpass);
+        }
+        pass->renderpass = NULL;
+        free(pass->rendering.colorAttachments);
+        free(pass->rendering.colorImages);
+        free(pass->rendering.formats.colorFormats);
+        CLEAR_MEMORY(&pass->rendering);
+        pass->dynamicRendering = false;
+        pass->owner = NULL;
+        pass->subpass = 0;
+        free_barrier_batch(&pass->barriers);
+    }
+    for (u32 i = 0; i < framegraph->numImages; i++) {
+        if (framegraph->images[i]->image) {
+            vulkan_image_destroy(framegraph->images[i]->image);
+            framegraph->images[i]->image = NULL;
+        }
+        framegraph->images[i]->tileOnly = false;
+        framegraph->images[i]->storage = false;
+        framegraph->images[i]->asyncQueue = false;
+    }
+    for (u32 i = 0; i < framegraph->numSplitBarriers; i++) {
+        framegraph_split_barrier* split = &framegraph->splitBarriers[i];
+        for (u32 j = 0; j < split->numEvents; j++) {
+            vkDestroyEvent(framegraph->ctx->device->device, split->events[j], NULL);
+        }
+        free(split->events);
+        free_barrier_batch(&split->batch);
+    }
+    free(framegraph->splitBarriers);
+    framegraph->numSplitBarriers = 0;
+    framegraph->splitBarriers = NULL;
+    free_barrier_batch(&framegraph->finalBarriers);
+
+    for (u32 i = 0; i < framegraph->numSubmissions; i++) {
+        free_barrier_batch(&framegraph->submissions[i].acquires);
+        free_barrier_batch(&framegraph->submissions[i].releases);
+    }
+    free(framegraph->submissions);
+    framegraph->numSubmissions = 0;
+    framegraph->submissions = NULL;
+    for (u32 i = 0; i < FRAMEGRAPH_QUEUE_COUNT; i++) {
+        if (framegraph->timelines[i] != VK_NULL_HANDLE) {
+            vkDestroySemaphore(framegraph->ctx->device->device, framegraph->timelines[i], NULL);
+            framegraph->timelines[i] = VK_NULL_HANDLE;
+        }
+        framegraph->numQueueSubmissions[i] = 0;
+        framegraph->timelineValues[i] = 0;
+    }
+
+    free(framegraph->orderedPasses);
+    framegraph->numOrderedPasses = 0;
+    framegraph->orderedPasses = NULL;
+    framegraph->numMergedPasses = 0;
+    framegraph->compiled = false;
+}
+
 void framegraph_destroy(framegraph_framegraph* framegraph) {
+    release_compiled_framegraph(framegraph);
+    if (framegraph->transientPool) {
+        framegraph_transient_pool_destroy(framegraph->transientPool);
+    }
+    if (framegraph->profiler) {
+        framegraph_profiler_destroy(framegraph->profiler);
+    }
+
+    for (u32 i = 0; i < framegraph->numPasses; i++) {
+        free(framegraph->passes[i]->handles);
+        free(framegraph->passes[i]);
+    }
     for (u32 i = 0; i < framegraph->numImages; i++) {
+        free(framegraph->images[i]->name);
         free(framegraph->images[i]);
     }
-    free(framegraph->images);
     free(framegraph->passes);
+    free(framegraph->links);
+    free(framegraph->images);
+    hashmap_destroy(framegraph->imageNames);
+    job_group_destroy(framegraph->recordGroup);
+    free(framegraph->recordJobs);
+    free(framegraph->recordBuffers);
     free(framegraph);
 }
 
-void framegraph_add_image(framegraph_framegraph* framegraph, const char* name, VkFormat format, bool multisampled) {
+void framegraph_set_config(framegraph_framegraph* framegraph, framegraph_config config) {
+    framegraph->config = config;
+}
+
+void framegraph_invalidate(framegraph_framegraph* framegraph) {
+    framegraph->compiled = false;
+}
+
+framegraph_image_handle framegraph_add_image(framegraph_framegraph* framegraph, const char* name, VkFormat format, bool multisampled) {
+    u64 key = hash_string(name, HASH_SEED);
+    framegraph_image* existing = hashmap_get(framegraph->imageNames, key);
+    if (existing != NULL) {
+        if (strcmp(existing->name, name) == 0) {
+            FATAL("Image %s has already been declared", name);
+        } else {
+            FATAL("Image names %s and %s hash the same, one of them has to be renamed", existing->name, name);
+        }
+        return FRAMEGRAPH_NO_IMAGE;
+    }
+
     framegraph_image* image = malloc(sizeof(framegraph_image));
     CLEAR_MEMORY(image);
     image->framegraph = framegraph;
-    image->name = name;
-    image->width = framegraph->config.width;
-    image->height = framegraph->config.height;
+    image->name = malloc(strlen(name) + 1);
+    strcpy(image->name, name);
     image->format = format;
     image->multisampled = multisampled;
 
-    framegraph->images[framegraph->numImages] = image;
     framegraph->numImages++;
+    framegraph->images = realloc(framegraph->images, sizeof(framegraph_image*) * framegraph->numImages);
+    framegraph->images[framegraph->numImages - 1] = image;
+    image->handle = framegraph->numImages;
+    hashmap_set(framegraph->imageNames, key, image);
+    if (strcmp(name, FRAMEGRAPH_BACKBUFFER) == 0) {
+        framegraph->backbuffer = image->handle;
+    }
+
+    return image->handle;
 }
 
-framegraph_image* get_image_from_name(framegraph_framegraph* framegraph, const char* name) {
-    for (u32 i = 0; i < framegraph->numImages; i++) {
-        if (strcmp(name, framegraph->images[i]->name) == 0) return framegraph->images[i];
+framegraph_image_handle framegraph_find_image(framegraph_framegraph* framegraph, const char* name) {
+    framegraph_image* image = hashmap_get(framegraph->imageNames, hash_string(name, HASH_SEED));
+    return image != NULL && strcmp(image->name, name) == 0 ? image->handle : FRAMEGRAPH_NO_IMAGE;
+}
+
+framegraph_image* framegraph_get_image(framegraph_framegraph* framegraph, framegraph_image_handle handle) {
+    if (handle == FRAMEGRAPH_NO_IMAGE || handle > framegraph->numImages) return NULL;
+    return framegraph->images[handle - 1];
+}
+
+void framegraph_export_image(framegraph_framegraph* framegraph, framegraph_image_handle handle) {
+    framegraph_image* image = framegraph_get_image(framegraph, handle);
+    if (image == NULL) {
+        FATAL("Invalid image handle: %d", handle);
+        return;
+    }
+    image->exported = true;
+}
+
+void add_pass_link(framegraph_framegraph* framegraph, framegraph_image* image) {
+    if (framegraph->numLinks == framegraph->linkCapacity) {
+        framegraph->linkCapacity = framegraph->linkCapacity > 0 ? framegraph->linkCapacity * 2 : 64;
+        framegraph->links = realloc(framegraph->links, sizeof(framegraph_image*) * framegraph->linkCapacity);
+    }
+    framegraph->links[framegraph->numLinks++] = image;
+}
+
+framegraph_image* get_pass_link_image(framegraph_framegraph* framegraph, framegraph_image_handle handle) {
+    framegraph_image* image = framegraph_get_image(framegraph, handle);
+    if (image == NULL && handle != FRAMEGRAPH_NO_IMAGE) {
+        FATAL("Invalid image handle: %d", handle);
+    }
+    return image;
+}
+
+// Appends the images the pass reads and then the ones it writes to the links, the compile builds its dependency graph from these
+// Depth and resolve images are written by the first pass using them and read by any after it
+void link_pass(framegraph_framegraph* framegraph, framegraph_pass* pass) {
+    framegraph_image* shared[2] = { get_pass_link_image(framegraph, pass->config.depth), get_pass_link_image(framegraph, pass->config.resolve) };
+
+    // Writes are claimed first, so whether the pass reads its depth and resolve images is known before any links are added
+    for (u32 i = 0; i < pass->config.numOutputs; i++) {
+        framegraph_image* output = get_pass_link_image(framegraph, pass->config.outputs[i]);
+        if (output == NULL) continue;
+        if (output->write != NULL) {
+            FATAL("Image %s has already been written to", output->name);
+            continue;
+        }
+        output->write = pass;
+    }
+    for (u32 i = 0; i < 2; i++) {
+        if (shared[i] != NULL && shared[i]->write == NULL) shared[i]->write = pass;
+    }
+
+    pass->firstLink = framegraph->numLinks;
+    pass->numReadImages = 0;
+    pass->numWriteImages = 0;
+    for (u32 i = 0; i < pass->config.numInputs; i++) {
+        framegraph_image* input = get_pass_link_image(framegraph, pass->config.inputs[i]);
+        if (input == NULL) continue;
+        add_pass_link(framegraph, input);
+        pass->numReadImages++;
+    }
+    for (u32 i = 0; i < 2; i++) {
+        if (shared[i] == NULL || shared[i]->write == pass) continue;
+        add_pass_link(framegraph, shared[i]);
+        pass->numReadImages++;
+    }
+    for (u32 i = 0; i < pass->config.numOutputs; i++) {
+        framegraph_image* output = framegraph_get_image(framegraph, pass->config.outputs[i]);
+        if (output == NULL || output->write != pass) continue;
+        add_pass_link(framegraph, output);
+        pass->numWriteImages++;
+    }
+    for (u32 i = 0; i < 2; i++) {
+        if (shared[i] == NULL || shared[i]->write != pass) continue;
+        add_pass_link(framegraph, shared[i]);
+        pass->numWriteImages++;
+    }
+}
+
+// Points every pass at its links, which only stop moving once the declaration stops changing
+void resolve_pass_links(framegraph_framegraph* framegraph) {
+    for (u32 i = 0; i < framegraph->numPasses; i++) {
+        framegraph_pass* pass = framegraph->passes[i];
+        pass->readImages = framegraph->links + pass->firstLink;
+        pass->writeImages = pass->readImages + pass->numReadImages;
     }
+}
 
-    return NULL;
+// Takes a copy of the config's handles so the caller's arrays don't have to outlive the declaration
+void copy_pass_config(framegraph_pass* pass, framegraph_pass_config config) {
+    // The config may be the pass's own, so its handles are copied before the old ones are freed
+    framegraph_image_handle* handles = malloc(sizeof(framegraph_image_handle) * (config.numInputs + config.numOutputs));
+    if (config.numInputs > 0) {
+        memcpy(handles, config.inputs, sizeof(framegraph_image_handle) * config.numInputs);
+    }
+    if (config.numOutputs > 0) {
+        memcpy(handles + config.numInputs, config.outputs, sizeof(framegraph_image_handle) * config.numOutputs);
+    }
+    free(pass->handles);
+    pass->handles = handles;
+    pass->config = config;
+    pass->config.inputs = pass->handles;
+    pass->config.outputs = pass->handles + config.numInputs;
 }
 
-void framegraph_add_pass(framegraph_framegraph* framegraph, framegraph_pass_config config) {
+framegraph_pass* framegraph_add_pass(framegraph_framegraph* framegraph, framegraph_pass_config config) {
     framegraph_pass* pass = malloc(sizeof(framegraph_pass));
     CLEAR_MEMORY(pass);
 
     pass->framegraph = framegraph;
-    pass->config = config;
+    copy_pass_config(pass, config);
+    pass->index = framegraph->numPasses;
+    link_pass(framegraph, pass);
 
-    for (u32 i = 0; i < pass->config.numInputs; i++) {
-        framegraph_image* input = get_image_from_name(framegraph, pass->config.inputs[i]);
-        if (input == NULL) {
-            FATAL("Invalid image name: %s", pass->config.inputs[i]);
+    framegraph->numPasses++;
+    framegraph->passes = realloc(framegraph->passes, sizeof(framegraph_pass*) * framegraph->numPasses);
+    framegraph->passes[framegraph->numPasses - 1] = pass;
+
+    return pass;
+}
+
+void framegraph_set_pass_config(framegraph_pass* pass, framegraph_pass_config config) {
+    framegraph_framegraph* framegraph = pass->framegraph;
+    copy_pass_config(pass, config);
+
+    // Timings from the old config would mix with the new ones, a merged pass is measured under the pass it was merged into
+    if (framegraph->profiler) {
+        framegraph_profiler_reset_history(framegraph->profiler, pass->index);
+        if (pass->owner) {
+            framegraph_profiler_reset_history(framegraph->profiler, pass->owner->index);
         }
-        input->reads[input->numReads] = pass;
-        input->numReads++;
     }
-    for (u32 i = 0; i < pass->config.numOutputs; i++) {
-        framegraph_image* output = get_image_from_name(framegraph, pass->config.outputs[i]);
-        if (output->write != NULL) {
-            FATAL("Image %s has already been written to", output->name);
-            return;
-        } 
-        output->write = pass;
+
+    // Links are kept in declaration order, so they're rebuilt for every pass rather than patched
+    for (u32 i = 0; i < framegraph->numImages; i++) {
+        framegraph->images[i]->write = NULL;
+    }
+    framegraph->numLinks = 0;
+    for (u32 i = 0; i < framegraph->numPasses; i++) {
+        link_pass(framegraph, framegraph->passes[i]);
     }
+}
 
-    if (pass->config.depth) {
-        framegraph_image* depth = get_image_from_name(framegraph, pass->config.depth);
-        if (depth->write == NULL) {
-            depth->write = pass;
-        } else {
-            depth->reads[depth->numReads] = pass;
-            depth->numReads++;
+vulkan_pipeline* framegraph_pass_get_pipeline(framegraph_pass* pass, u32 variant) {
+    if (variant >= pass->numPsos) {
+        FATAL("Pass has %d pipeline variants, can't get variant %d", pass->numPsos, variant);
+        return NULL;
+    }
+    return pass->pipelines[variant];
+}
+
+bool framegraph_is_backbuffer(framegraph_image* image);
+
+#define FRAMEGRAPH_SCHEDULE_CLASSES 3
+
+bool framegraph_pass_is_async(framegraph_pass* pass) {
+    return pass->config.compute && pass->config.asyncCompute;
+}
+
+// Async compute starts as early as it can, and graphics work that doesn't need its results goes ahead of work that does, so the two overlap
+u32 get_schedule_class(framegraph_pass* pass) {
+    if (framegraph_pass_is_async(pass)) return 0;
+    for (u32 i = 0; i < pass->numReadImages; i++) {
+        framegraph_pass* writer = pass->readImages[i]->write;
+        if (writer != NULL && framegraph_pass_is_async(writer)) return 2;
+    }
+    return 1;
+}
+
+// A pass depends on whichever pass first wrote each image it reads
+// Passes are kept if they lead to the backbuffer or an exported image, then ordered with Kahn's algorithm so every pass comes after what it depends on
+// Linear in the number of passes and image uses, nothing in here looks anything up by name
+void framegraph_compile(framegraph_framegraph* framegraph) {
+    resolve_pass_links(framegraph);
+
+    u32 numPasses = framegraph->numPasses;
+    bool* live = malloc(sizeof(bool) * (numPasses > 0 ? numPasses : 1));
+    u32* stack = malloc(sizeof(u32) * (numPasses > 0 ? numPasses : 1));
+    CLEAR_MEMORY_ARRAY(live, numPasses);
+
+    u32 numStack = 0;
+    for (u32 i = 0; i < numPasses; i++) {
+        framegraph_pass* pass = framegraph->passes[i];
+        for (u32 j = 0; j < pass->numWriteImages; j++) {
+            framegraph_image* image = pass->writeImages[j];
+            if (!live[i] && (image->exported || framegraph_is_backbuffer(image))) {
+                live[i] = true;
+                stack[numStack++] = i;
+            }
         }
     }
+    if (numStack == 0) {
+        FATAL("There needs to be a pass that writes to the backbuffer or an exported image");
+    }
 
-    if (pass->config.resolve) {
-        framegraph_image* resolve = get_image_from_name(framegraph, pass->config.resolve);
-        if (resolve->write == NULL) {
-            resolve->write = pass;
-        } else {
-            resolve->reads[resolve->numReads] = pass;
-            resolve->numReads++;
+    // Walks back through the writers of everything a live pass reads
+    u32 numLive = numStack;
+    while (numStack > 0) {
+        framegraph_pass* pass = framegraph->passes[stack[--numStack]];
+        for (u32 j = 0; j < pass->numReadImages; j++) {
+            framegraph_pass* writer = pass->readImages[j]->write;
+            if (writer == NULL || writer == pass || live[writer->index]) continue;
+            live[writer->index] = true;
+            stack[numStack++] = writer->index;
+            numLive++;
         }
     }
 
-    framegraph->passes[framegraph->numPasses] = pass;
-    framegraph->numPasses++;
+    // Dependents of each pass packed into one array, offsets[i] is where pass i's start
+    u32* inDegree = malloc(sizeof(u32) * (numPasses + 1));
+    u32* offsets = malloc(sizeof(u32) * (numPasses + 1));
+    CLEAR_MEMORY_ARRAY(inDegree, numPasses + 1);
+    CLEAR_MEMORY_ARRAY(offsets, numPasses + 1);
+    u32 numEdges = 0;
+    for (u32 i = 0; i < numPasses; i++) {
+        if (!live[i]) continue;
+        framegraph_pass* pass = framegraph->passes[i];
+        for (u32 j = 0; j < pass->numReadImages; j++) {
+            framegraph_pass* writer = pass->readImages[j]->write;
+            if (writer == NULL || writer == pass) continue;
+            offsets[writer->index + 1]++;
+            inDegree[i]++;
+            numEdges++;
+        }
+    }
+    for (u32 i = 0; i < numPasses; i++) {
+        offsets[i + 1] += offsets[i];
+    }
+    u32* dependents = malloc(sizeof(u32) * (numEdges > 0 ? numEdges : 1));
+    u32* cursors = malloc(sizeof(u32) * (numPasses > 0 ? numPasses : 1));
+    memcpy(cursors, offsets, sizeof(u32) * numPasses);
+    for (u32 i = 0; i < numPasses; i++) {
+        if (!live[i]) continue;
+        framegraph_pass* pass = framegraph->passes[i];
+        for (u32 j = 0; j < pass->numReadImages; j++) {
+            framegraph_pass* writer = pass->readImages[j]->write;
+            if (writer == NULL || writer == pass) continue;
+            dependents[cursors[writer->index]++] = i;
+        }
+    }
+
+    // Ready passes are taken in declaration order within their class, so independent passes keep the order they were added in
+    free(framegraph->orderedPasses);
+    framegraph->orderedPasses = malloc(sizeof(framegraph_pass*) * (numLive > 0 ? numLive : 1));
+    framegraph->numOrderedPasses = 0;
+    u32* ready = malloc(sizeof(u32) * FRAMEGRAPH_SCHEDULE_CLASSES * (numPasses > 0 ? numPasses : 1));
+    u32 heads[FRAMEGRAPH_SCHEDULE_CLASSES] = { 0 };
+    u32 tails[FRAMEGRAPH_SCHEDULE_CLASSES] = { 0 };
+    for (u32 i = 0; i < numPasses; i++) {
+        if (!live[i] || inDegree[i] != 0) continue;
+        u32 class = get_schedule_class(framegraph->passes[i]);
+        ready[class * numPasses + tails[class]++] = i;
+    }
+    while (true) {
+        u32 class = 0;
+        while (class < FRAMEGRAPH_SCHEDULE_CLASSES && heads[class] == tails[class]) class++;
+        if (class == FRAMEGRAPH_SCHEDULE_CLASSES) break;
+
+        u32 index = ready[class * numPasses + heads[class]++];
+        framegraph->orderedPasses[framegraph->numOrderedPasses++] = framegraph->passes[index];
+        for (u32 j = offsets[index]; j < offsets[index + 1]; j++) {
+            if (--inDegree[dependents[j]] != 0) continue;
+            u32 dependentClass = get_schedule_class(framegraph->passes[dependents[j]]);
+            ready[dependentClass * numPasses + tails[dependentClass]++] = dependents[j];
+        }
+    }
+    free(ready);
+    if (framegraph->numOrderedPasses != numLive) {
+        FATAL("Framegraph has a dependency cycle, %d of its %d live passes couldn't be ordered", numLive - framegraph->numOrderedPasses, numLive);
+    }
+    framegraph->numCulledPasses = numPasses - numLive;
+
+    free(cursors);
+    free(dependents);
+    free(offsets);
+    free(inDegree);
+    free(stack);
+    free(live);
+}
+
+const char* get_pass_name(framegraph_pass* pass) {
+    return pass->config.name ? pass->config.name : "unnamed";
+}
+
+void framegraph_log_schedule(framegraph_framegraph* framegraph) {
+    INFO("Framegraph schedule: %d passes, %d culled", framegraph->numOrderedPasses, framegraph->numCulledPasses);
+    for (u32 i = 0; i < framegraph->numOrderedPasses; i++) {
+        framegraph_pass* pass = framegraph->orderedPasses[i];
+        INFO("  %d: %s (declared %d, reads %d images, writes %d)", i, get_pass_name(pass), pass->index, pass->numReadImages, pass->numWriteImages);
+    }
+
+    // Culled passes are the ones not in the schedule, so they're found by marking the scheduled ones
+    bool* scheduled = malloc(sizeof(bool) * (framegraph->numPasses > 0 ? framegraph->numPasses : 1));
+    CLEAR_MEMORY_ARRAY(scheduled, framegraph->numPasses);
+    for (u32 i = 0; i < framegraph->numOrderedPasses; i++) {
+        scheduled[framegraph->orderedPasses[i]->index] = true;
+    }
+    for (u32 i = 0; i < framegraph->numPasses; i++) {
+        if (!scheduled[i]) {
+            INFO("  culled: %s (declared %d), nothing reaches the backbuffer or an exported image from it", get_pass_name(framegraph->passes[i]), i);
+        }
+    }
+    free(scheduled);
+}
+
+bool framegraph_is_backbuffer(framegraph_image* image) {
+    return image->handle == image->framegraph->backbuffer;
+}
+
+void get_framegraph_image_info(framegraph_image* image, VkImageUsageFlags* usage, VkImageAspectFlags* aspects, VkSampleCountFlagBits* samples) {
+    bool isDepth = image->format == VK_FORMAT_D32_SFLOAT;
+    *usage = isDepth ? VK_IMAGE_USAGE_DEPTH_STENCIL_ATTACHMENT_BIT : (VK_IMAGE_USAGE_COLOR_ATTACHMENT_BIT | VK_IMAGE_USAGE_SAMPLED_BIT);
+    *usage |= VK_IMAGE_USAGE_INPUT_ATTACHMENT_BIT;
+    if (image->storage) {
+        *usage |= VK_IMAGE_USAGE_STORAGE_BIT;
+    }
+    // Transient images can't be sampled, nothing outside the render pass sees a tile only image anyway
+    if (image->tileOnly) {
+        *usage = (*usage & ~VK_IMAGE_USAGE_SAMPLED_BIT) | VK_IMAGE_USAGE_TRANSIENT_ATTACHMENT_BIT;
+    }
+    *aspects = isDepth ? VK_IMAGE_ASPECT_DEPTH_BIT : VK_IMAGE_ASPECT_COLOR_BIT;
+    *samples = image->multisampled ? (VkSampleCountFlagBits)image->framegraph->config.maxSamples : VK_SAMPLE_COUNT_1_BIT;
+}
+
+u32 get_queue_family(framegraph_framegraph* framegraph, framegraph_queue queue) {
+    vulkan_physical_device_queues* queues = &framegraph->ctx->physical->queues;
+    return queue == FRAMEGRAPH_QUEUE_COMPUTE ? queues->computeIndex : queues->graphicsIndex;
+}
+
+// Async compute passes go on the compute queue when there is one, passes touching the backbuffer stay on graphics since only it presents
+void assign_pass_queues(framegraph_framegraph* framegraph, vulkan_context* ctx) {
+    u32 numDemoted = 0;
+    for (u32 i = 0; i < framegraph->numOrderedPasses; i++) {
+        framegraph_pass* pass = framegraph->orderedPasses[i];
+        pass->queue = FRAMEGRAPH_QUEUE_GRAPHICS;
+        for (u32 j = 0; pass->config.compute && j < pass->numWriteImages; j++) {
+            pass->writeImages[j]->storage = true;
+        }
+        if (!framegraph_pass_is_async(pass)) continue;
+
+        bool usesBackbuffer = false;
+        for (u32 j = 0; j < pass->numReadImages + pass->numWriteImages; j++) {
+            framegraph_image* image = j < pass->numReadImages ? pass->readImages[j] : pass->writeImages[j - pass->numReadImages];
+            if (framegraph_is_backbuffer(image)) usesBackbuffer = true;
+        }
+        if (!ctx->physical->queues.asyncCompute || usesBackbuffer) {
+            numDemoted++;
+            continue;
+        }
+
+        pass->queue = FRAMEGRAPH_QUEUE_COMPUTE;
+        for (u32 j = 0; j < pass->numReadImages + pass->numWriteImages; j++) {
+            framegraph_image* image = j < pass->numReadImages ? pass->readImages[j] : pass->writeImages[j - pass->numReadImages];
+            image->asyncQueue = true;
+        }
+    }
+    if (numDemoted > 0) {
+        INFO("Framegraph runs %d async compute passes on the graphics queue, %s", numDemoted, ctx->physical->queues.asyncCompute ? "they use the backbuffer" : "the device has no separate compute family");
+    }
+}
+
+// Splits the ordered passes wherever the queue changes, the scheduler already grouped each queue's passes as much as dependencies allow
+void build_submissions(framegraph_framegraph* framegraph) {
+    framegraph->numSubmissions = 0;
+    framegraph->submissions = malloc(sizeof(framegraph_submission) * (framegraph->numOrderedPasses + 1));
+    for (u32 i = 0; i < framegraph->numOrderedPasses; i++) {
+        framegraph_pass* pass = framegraph->orderedPasses[i];
+        if (framegraph->numSubmissions == 0 || framegraph->submissions[framegraph->numSubmissions - 1].queue != pass->queue) {
+            framegraph_submission* submission = &framegraph->submissions[framegraph->numSubmissions++];
+            CLEAR_MEMORY(submission);
+            submission->queue = pass->queue;
+            submission->firstPass = i;
+            submission->queueIndex = framegraph->numQueueSubmissions[pass->queue]++;
+            submission->waitSubmission = UINT32_MAX;
+        }
+        framegraph->submissions[framegraph->numSubmissions - 1].numPasses++;
+        pass->submission = framegraph->numSubmissions - 1;
+    }
+
+    // Presenting and the frame's fence hang off the last submission, which has to be a graphics one
+    if (framegraph->numSubmissions == 0 || framegraph->submissions[framegraph->numSubmissions - 1].queue != FRAMEGRAPH_QUEUE_GRAPHICS) {
+        framegraph_submission* submission = &framegraph->submissions[framegraph->numSubmissions++];
+        CLEAR_MEMORY(submission);
+        submission->queue = FRAMEGRAPH_QUEUE_GRAPHICS;
+        submission->firstPass = framegraph->numOrderedPasses;
+        submission->queueIndex = framegraph->numQueueSubmissions[FRAMEGRAPH_QUEUE_GRAPHICS]++;
+        submission->waitSubmission = UINT32_MAX;
+    }
+}
+
+void create_queue_timelines(framegraph_framegraph* framegraph, vulkan_context* ctx) {
+    if (framegraph->numSubmissions < 2) return;
+
+    VkSemaphoreTypeCreateInfo typeInfo;
+    CLEAR_MEMORY(&typeInfo);
+    typeInfo.sType = VK_STRUCTURE_TYPE_SEMAPHORE_TYPE_CREATE_INFO;
+    typeInfo.semaphoreType = VK_SEMAPHORE_TYPE_TIMELINE;
+    typeInfo.initialValue = 0;
+
+    VkSemaphoreCreateInfo createInfo;
+    CLEAR_MEMORY(&createInfo);
+    createInfo.sType = VK_STRUCTURE_TYPE_SEMAPHORE_CREATE_INFO;
+    createInfo.pNext = &typeInfo;
+    for (u32 i = 0; i < FRAMEGRAPH_QUEUE_COUNT; i++) {
+        VkResult result = vkCreateSemaphore(ctx->device->device, &createInfo, NULL, &framegraph->timelines[i]);
+        if (result != VK_SUCCESS) {
+            FATAL("Vulkan timeline semaphore creation failed with error code: %d", result);
+        }
+        framegraph->timelineValues[i] = 0;
+    }
+}
+
+void mark_image_use(framegraph_image* image, u32 passIndex) {
+    if (image->firstUse == UINT32_MAX || passIndex < image->firstUse) image->firstUse = passIndex;
+    if (image->lastUse == UINT32_MAX || passIndex > image->lastUse) image->lastUse = passIndex;
+}
+
+void compute_image_lifetimes(framegraph_framegraph* framegraph) {
+    for (u32 i = 0; i < framegraph->numImages; i++) {
+        framegraph->images[i]->firstUse = UINT32_MAX;
+        framegraph->images[i]->lastUse = UINT32_MAX;
+    }
+
+    for (u32 i = 0; i < framegraph->numOrderedPasses; i++) {
+        framegraph_pass* pass = framegraph->orderedPasses[i];
+        for (u32 j = 0; j < pass->numReadImages; j++) {
+            mark_image_use(pass->readImages[j], i);
+        }
+        for (u32 j = 0; j < pass->numWriteImages; j++) {
+            mark_image_use(pass->writeImages[j], i);
+        }
+    }
 }
 
-void flatten_passes(framegraph_pass* pass, size_t* numPasses, framegraph_pass** passes) {
+// Bound through a descriptor rather than as an attachment, which keeps the image out of a render pass it is written in
+bool framegraph_pass_binds_image(framegraph_pass* pass, framegraph_image* image) {
+    if (pass->config.compute) {
+        for (u32 i = 0; i < pass->numReadImages; i++) {
+            if (pass->readImages[i] == image) return true;
+        }
+        for (u32 i = 0; i < pass->numWriteImages; i++) {
+            if (pass->writeImages[i] == image) return true;
+        }
+        return false;
+    }
+    if (pass->config.attachmentInputs) return false;
     for (u32 i = 0; i < pass->config.numInputs; i++) {
-        framegraph_image* input = get_image_from_name(pass->framegraph, pass->config.inputs[i]);
-        passes = realloc(passes, sizeof(framegraph_pass*) * (*numPasses));
-        passes[*numPasses++] = input->write;
-        flatten_passes(input->write, numPasses, passes);
+        if (pass->config.inputs[i] == image->handle) return true;
     }
+    return false;
 }
 
-framegraph_pass** get_pass_list(framegraph_framegraph* framegraph) {
-    framegraph_pass** passesWithDuplicatesReversed = malloc(sizeof(framegraph_pass*));
-    framegraph_pass* lastPass = NULL;
-    for (u32 i = 0; i < framegraph->numPasses; i++) {
-        if (framegraph->passes[i]->config.resolve && strcmp("backbuffer", framegraph->passes[i]->config.resolve) == 0) {
-            lastPass = framegraph->passes[i];
-            break;
+void get_framegraph_image_extent(framegraph_image* image, vulkan_context* ctx, u32* width, u32* height) {
+    *width = framegraph_is_backbuffer(image) ? ctx->swapchain->extent.width : image->width;
+    *height = framegraph_is_backbuffer(image) ? ctx->swapchain->extent.height : image->height;
+}
+
+// A pass can become the next subpass of the render pass before it if it only reads what that render pass wrote, at the same pixel and the same size
+bool can_merge_pass(framegraph_framegraph* framegraph, u32 passIndex, vulkan_context* ctx) {
+    framegraph_pass* pass = framegraph->orderedPasses[passIndex];
+    framegraph_pass* owner = framegraph->orderedPasses[passIndex - 1]->owner;
+    if (!pass->config.attachmentInputs || pass->config.numInputs == 0 || pass->config.prepareFn || owner->numWriteImages == 0) return false;
+    if (pass->config.compute || owner->config.compute) return false;
+
+    u32 width;
+    u32 height;
+    get_framegraph_image_extent(owner->writeImages[0], ctx, &width, &height);
+    for (u32 i = 0; i < pass->numReadImages + pass->numWriteImages; i++) {
+        framegraph_image* image = i < pass->numReadImages ? pass->readImages[i] : pass->writeImages[i - pass->numReadImages];
+        if (i < pass->numReadImages && (image->write == NULL || image->write->owner != owner)) return false;
+
+        u32 imageWidth;
+        u32 imageHeight;
+        get_framegraph_image_extent(image, ctx, &imageWidth, &imageHeight);
+        if (imageWidth != width || imageHeight != height) return false;
+
+        // Every use inside one render pass has to be an attachment, so the subpasses can move it between layouts
+        for (u32 j = passIndex - pass->subpass; j < passIndex; j++) {
+            if (framegraph_pass_binds_image(framegraph->orderedPasses[j], image)) return false;
+        }
+    }
+    return true;
+}
+
+// Merges runs of passes into multi subpass render passes, then marks the images that never leave one as tile only
+void merge_passes(framegraph_framegraph* framegraph, vulkan_context* ctx) {
+    framegraph->numMergedPasses = 0;
+    for (u32 i = 0; i < framegraph->numOrderedPasses; i++) {
+        framegraph_pass* pass = framegraph->orderedPasses[i];
+        pass->owner = pass;
+        pass->subpass = 0;
+        if (i == 0) continue;
+
+        // Set before checking so the walk over the earlier subpasses knows where the render pass starts
+        framegraph_pass* previous = framegraph->orderedPasses[i - 1];
+        pass->subpass = previous->subpass + 1;
+        if (can_merge_pass(framegraph, i, ctx)) {
+            pass->owner = previous->owner;
+            framegraph->numMergedPasses++;
+        } else {
+            pass->subpass = 0;
+        }
+    }
+
+    u32 numTileOnly = 0;
+    for (u32 i = 0; i < framegraph->numImages; i++) {
+        framegraph_image* image = framegraph->images[i];
+        image->tileOnly = false;
+        if (framegraph_is_backbuffer(image) || image->exported || image->firstUse == UINT32_MAX) continue;
+        if (framegraph->orderedPasses[image->firstUse]->owner != framegraph->orderedPasses[image->lastUse]->owner) continue;
+
+        image->tileOnly = true;
+        for (u32 j = image->firstUse; j <= image->lastUse; j++) {
+            if (framegraph_pass_binds_image(framegraph->orderedPasses[j], image)) image->tileOnly = false;
+        }
+        if (image->tileOnly) numTileOnly++;
+    }
+    INFO("Framegraph merged %d passes into earlier render passes, %d images stay in tile memory", framegraph->numMergedPasses, numTileOnly);
+}
+
+bool framegraph_images_share_memory(framegraph_image* a, framegraph_image* b) {
+    return a->block == b->block && a->offset < b->offset + b->requirements.size && b->offset < a->offset + a->requirements.size;
+}
+
+bool framegraph_images_overlap(framegraph_image* a, framegraph_image* b) {
+    bool lifetimes = a->asyncQueue || b->asyncQueue || (a->firstUse <= b->lastUse && b->firstUse <= a->lastUse);
+    return lifetimes && framegraph_images_share_memory(a, b);
+}
+
+// Largest first, each image goes at the lowest offset that doesn't overlap an image placed in the block that is alive at the same time
+// Picks the compatible block it grows least, so images that are never alive together end up on top of each other
+void place_transient_images(framegraph_framegraph* framegraph, vulkan_context* ctx) {
+    u32 numTransients = 0;
+    framegraph_image** transients = malloc(sizeof(framegraph_image*) * framegraph->numImages);
+    for (u32 i = 0; i < framegraph->numImages; i++) {
+        framegraph_image* image = framegraph->images[i];
+        if (framegraph_is_backbuffer(image) || image->firstUse == UINT32_MAX) continue;
+
+        VkImageUsageFlags usage;
+        VkImageAspectFlags aspects;
+        VkSampleCountFlagBits samples;
+        get_framegraph_image_info(image, &usage, &aspects, &samples);
+        image->requirements = vulkan_image_get_memory_requirements(ctx, image->format, usage, image->width, image->height, samples);
+        transients[numTransients++] = image;
+    }
+
+    for (u32 i = 1; i < numTransients; i++) {
+        framegraph_image* image = transients[i];
+        u32 j = i;
+        while (j > 0 && transients[j - 1]->requirements.size < image->requirements.size) {
+            transients[j] = transients[j - 1];
+            j--;
+        }
+        transients[j] = image;
+    }
+
+    u32 numBlocks = 0;
+    VkMemoryRequirements* blocks = malloc(sizeof(VkMemoryRequirements) * (numTransients > 0 ? numTransients : 1));
+    bool* lazyBlocks = malloc(sizeof(bool) * (numTransients > 0 ? numTransients : 1));
+    framegraph_memory_stats* stats = &framegraph->memoryStats;
+    CLEAR_MEMORY(stats);
+    for (u32 i = 0; i < numTransients; i++) {
+        framegraph_image* image = transients[i];
+        stats->unaliasedSize += image->requirements.size;
+
+        u32 bestBlock = numBlocks;
+        u64 bestOffset = 0;
+        u64 bestGrowth = UINT64_MAX;
+        for (u32 b = 0; b < numBlocks; b++) {
+            if (!(blocks[b].memoryTypeBits & image->requirements.memoryTypeBits)) continue;
+
+            // Bumped past every conflict until there are none left, each bump only moves forward so this terminates
+            image->block = b;
+            image->offset = 0;
+            bool moved = true;
+            while (moved) {
+                moved = false;
+                for (u32 j = 0; j < i; j++) {
+                    if (!framegraph_images_overlap(image, transients[j])) continue;
+                    u64 end = transients[j]->offset + transients[j]->requirements.size;
+                    image->offset = (end + image->requirements.alignment - 1) / image->requirements.alignment * image->requirements.alignment;
+                    moved = true;
+                }
+            }
+
+            u64 end = image->offset + image->requirements.size;
+            u64 growth = end > blocks[b].size ? end - blocks[b].size : 0;
+            if (growth < bestGrowth) {
+                bestBlock = b;
+                bestOffset = image->offset;
+                bestGrowth = growth;
+            }
+        }
+
+        image->block = bestBlock;
+        image->offset = bestOffset;
+        if (bestBlock == numBlocks) {
+            lazyBlocks[numBlocks] = image->tileOnly;
+            blocks[numBlocks++] = image->requirements;
+            continue;
         }
+        lazyBlocks[bestBlock] &= image->tileOnly;
+        VkMemoryRequirements* block = &blocks[bestBlock];
+        if (image->offset + image->requirements.size > block->size) block->size = image->offset + image->requirements.size;
+        if (image->requirements.alignment > block->alignment) block->alignment = image->requirements.alignment;
+        block->memoryTypeBits &= image->requirements.memoryTypeBits;
+    }
+
+    framegraph_transient_pool_begin(framegraph->transientPool);
+    VmaAllocation* allocations = malloc(sizeof(VmaAllocation) * (numBlocks > 0 ? numBlocks : 1));
+    for (u32 i = 0; i < numBlocks; i++) {
+        allocations[i] = framegraph_transient_pool_claim(framegraph->transientPool, &blocks[i], lazyBlocks[i]);
+        stats->aliasedSize += blocks[i].size;
     }
-    if (lastPass == NULL) {
-        FATAL("There needs to be a pass that resolves to backbuffer");
+    framegraph_transient_pool_trim(framegraph->transientPool);
+    stats->numBlocks = numBlocks;
+
+    for (u32 i = 0; i < numTransients; i++) {
+        framegraph_image* image = transients[i];
+        VkImageUsageFlags usage;
+        VkImageAspectFlags aspects;
+        VkSampleCountFlagBits samples;
+        get_framegraph_image_info(image, &usage, &aspects, &samples);
+        image->image = vulkan_image_create_aliased(ctx, image->format, usage, image->width, image->height, aspects, samples, allocations[image->block], image->offset);
     }
-    passesWithDuplicatesReversed[0] = lastPass;
 
-    size_t numPassesWithDuplicates = 1;
-    flatten_passes(lastPass, &numPassesWithDuplicates, passesWithDuplicatesReversed);
+    u64 saved = stats->unaliasedSize - stats->aliasedSize;
+    INFO("Framegraph transient images take %llu bytes in %d blocks instead of %llu, aliasing saved %llu bytes (%.1f%%)",
+        (unsigned long long)stats->aliasedSize, stats->numBlocks, (unsigned long long)stats->unaliasedSize, (unsigned long long)saved,
+        stats->unaliasedSize > 0 ? 100.0 * (double)saved / (double)stats->unaliasedSize : 0.0);
+
+    free(allocations);
+    free(lazyBlocks);
+    free(blocks);
+    free(transients);
+}
+
+// Each image is one attachment of the render pass however many subpasses use it, described by its first use and left in the layout of its last
+u32 add_group_attachment(vulkan_renderpass_builder* builder, u32* numAttachments, framegraph_image*** attachments, framegraph_pass* pass, framegraph_image* image, VkAttachmentDescription* description) {
+    for (u32 i = 0; i < *numAttachments; i++) {
+        if ((*attachments)[i] != image) continue;
+        builder->attachments[i].finalLayout = description->finalLayout;
+        return i;
+    }
 
-    framegraph_pass** passesWithDuplicates = malloc(sizeof(framegraph_pass*) * numPassesWithDuplicates);
-    for (u32 i = 0; i < numPassesWithDuplicates; i++) {
-        passesWithDuplicates[numPassesWithDuplicates - (i + 1)] = passesWithDuplicatesReversed[i];
+    // Contents the render pass didn't write itself have to be loaded, only the first writer of an image can clear it
+    if (image->write != pass) {
+        description->loadOp = VK_ATTACHMENT_LOAD_OP_LOAD;
     }
+    description->storeOp = image->tileOnly ? VK_ATTACHMENT_STORE_OP_DONT_CARE : VK_ATTACHMENT_STORE_OP_STORE;
+    description->initialLayout = description->finalLayout;
+
+    (*numAttachments)++;
+    *attachments = realloc(*attachments, sizeof(framegraph_image*) * (*numAttachments));
+    (*attachments)[*numAttachments - 1] = image;
+    return vulkan_renderpass_builder_add_attachment(builder, description);
+}
 
-    u32 passesPtr = 0;
-    framegraph_pass** passes = malloc(sizeof(framegraph_pass*) * 256);
-    CLEAR_MEMORY_ARRAY(passes, 256);
-    for (u32 i = 0; i < numPassesWithDuplicates; i++) {
-        bool unique = true;
-        for (u32 j = 0; j < passesPtr; j++) {
-            if (passesWithDuplicates[i] == passes[j]) {
-                unique = false;
+// One subpass per merged pass, with the outputs, depth and resolve as attachments and attachment inputs as input attachments
+// Attachments stay in the layout of each use, the renderpass moves them between subpasses and the framegraph's barriers do everything outside it
+void create_group_renderpass(framegraph_framegraph* framegraph, u32 first, u32 last, vulkan_context* ctx) {
+    framegraph_pass* owner = framegraph->orderedPasses[first];
+    vulkan_renderpass_builder* builder = vulkan_renderpass_builder_create();
+
+    u32 numAttachments = 0;
+    framegraph_image** attachments = malloc(0);
+    for (u32 p = first; p <= last; p++) {
+        framegraph_pass* pass = framegraph->orderedPasses[p];
+        pass->samples = VK_SAMPLE_COUNT_1_BIT;
+
+        vulkan_subpass_config subpass;
+        CLEAR_MEMORY(&subpass);
+        subpass.inputAttachments = malloc(sizeof(vulkan_subpass_attachment) * pass->config.numInputs);
+        subpass.colorAttachments = malloc(sizeof(vulkan_subpass_attachment) * pass->config.numOutputs);
+
+        for (u32 i = 0; pass->config.attachmentInputs && i < pass->config.numInputs; i++) {
+            framegraph_image* input = framegraph_get_image(framegraph, pass->config.inputs[i]);
+            VkSampleCountFlagBits samples = input->multisampled ? (VkSampleCountFlagBits)framegraph->config.maxSamples : VK_SAMPLE_COUNT_1_BIT;
+            VkAttachmentDescription attachment = input->format == VK_FORMAT_D32_SFLOAT ? vulkan_renderpass_get_default_depth_attachment(samples) : vulkan_renderpass_get_default_color_attachment(input->format, samples);
+            attachment.finalLayout = VK_IMAGE_LAYOUT_SHADER_READ_ONLY_OPTIMAL;
+            subpass.inputAttachments[subpass.numInputAttachments++] = add_group_attachment(builder, &numAttachments, &attachments, pass, input, &attachment);
+        }
+
+        for (u32 i = 0; i < pass->config.numOutputs; i++) {
+            framegraph_image* output = framegraph_get_image(framegraph, pass->config.outputs[i]);
+            VkSampleCountFlagBits samples = output->multisampled ? (VkSampleCountFlagBits)framegraph->config.maxSamples : VK_SAMPLE_COUNT_1_BIT;
+            VkAttachmentDescription attachment = vulkan_renderpass_get_default_color_attachment(output->format, samples);
+            attachment.finalLayout = VK_IMAGE_LAYOUT_COLOR_ATTACHMENT_OPTIMAL;
+            subpass.colorAttachments[subpass.numColorAttachments++] = add_group_attachment(builder, &numAttachments, &attachments, pass, output, &attachment);
+            pass->samples = samples;
+        }
+
+        if (pass->config.depth != FRAMEGRAPH_NO_IMAGE) {
+            framegraph_image* depth = framegraph_get_image(framegraph, pass->config.depth);
+            VkSampleCountFlagBits samples = depth->multisampled ? (VkSampleCountFlagBits)framegraph->config.maxSamples : VK_SAMPLE_COUNT_1_BIT;
+            VkAttachmentDescription attachment = vulkan_renderpass_get_default_depth_attachment(samples);
+            attachment.finalLayout = VK_IMAGE_LAYOUT_DEPTH_STENCIL_ATTACHMENT_OPTIMAL;
+            subpass.isDepthBuffered = true;
+            subpass.depthAttachment = add_group_attachment(builder, &numAttachments, &attachments, pass, depth, &attachment);
+            pass->samples = samples;
+        }
+
+        // The subpass only takes a single resolve reference so it resolves the first output, always averaging
+        if (pass->config.resolve != FRAMEGRAPH_NO_IMAGE) {
+            framegraph_image* resolve = framegraph_get_image(framegraph, pass->config.resolve);
+            if (vulkan_format_is_integer(resolve->format)) {
+                FATAL("Render pass resolves can't average integer format %d, resolving it needs dynamic rendering", resolve->format);
             }
+            VkAttachmentDescription attachment = vulkan_renderpass_get_default_resolve_attachment(resolve->format);
+            attachment.finalLayout = VK_IMAGE_LAYOUT_COLOR_ATTACHMENT_OPTIMAL;
+            subpass.isResolving = true;
+            subpass.resolveAttachment = add_group_attachment(builder, &numAttachments, &attachments, pass, resolve, &attachment);
         }
-        if (unique) {
-            passes[passesPtr] = passesWithDuplicates[i];
-            passesPtr++;
+
+        vulkan_renderpass_builder_add_subpass(builder, &subpass);
+        free(subpass.inputAttachments);
+        free(subpass.colorAttachments);
+    }
+    owner->renderpass = vulkan_renderpass_builder_build(builder, ctx->device);
+
+    // Framebuffers that include the backbuffer are duplicated for every swapchain image
+    bool usesBackbuffer = false;
+    for (u32 i = 0; i < numAttachments; i++) {
+        if (framegraph_is_backbuffer(attachments[i])) usesBackbuffer = true;
+    }
+    owner->numFramebuffers = usesBackbuffer ? ctx->swapchain->numImages : 1;
+    owner->framebuffers = malloc(sizeof(vulkan_framebuffer*) * owner->numFramebuffers);
+
+    vulkan_image** images = malloc(sizeof(vulkan_image*) * (numAttachments > 0 ? numAttachments : 1));
+    for (u32 i = 0; i < owner->numFramebuffers; i++) {
+        for (u32 j = 0; j < numAttachments; j++) {
+            images[j] = framegraph_is_backbuffer(attachments[j]) ? ctx->swapchain->images[i] : attachments[j]->image;
         }
+        owner->framebuffers[i] = vulkan_framebuffer_create(ctx->device, owner->renderpass, numAttachments, images);
     }
-    
-    free(passesWithDuplicatesReversed);
-    free(passesWithDuplicates);
+    free(images);
+    free(attachments);
 
-    return passes;
+    for (u32 p = first; p <= last; p++) {
+        framegraph_pass* pass = framegraph->orderedPasses[p];
+        pass->renderpass = owner->renderpass;
+        pass->width = owner->framebuffers[0]->width;
+        pass->height = owner->framebuffers[0]->height;
+    }
 }
 
-void framegraph_compile(framegraph_framegraph* framegraph) {
-    framegraph_pass** passes = get_pass_list(framegraph);
-    INFO("Flattened passes");
+// Loads and stores the same way the renderpass attachments would, left in the layout of its use since the framegraph's barriers do every transition
+VkRenderingAttachmentInfo get_rendering_attachment(framegraph_pass* pass, framegraph_image* image, VkImageLayout layout) {
+    VkRenderingAttachmentInfo attachment;
+    CLEAR_MEMORY(&attachment);
+    attachment.sType = VK_STRUCTURE_TYPE_RENDERING_ATTACHMENT_INFO;
+    attachment.imageView = image->image ? image->image->imageView : VK_NULL_HANDLE;
+    attachment.imageLayout = layout;
+    attachment.loadOp = image->write == pass ? VK_ATTACHMENT_LOAD_OP_CLEAR : VK_ATTACHMENT_LOAD_OP_LOAD;
+    attachment.storeOp = image->tileOnly ? VK_ATTACHMENT_STORE_OP_DONT_CARE : VK_ATTACHMENT_STORE_OP_STORE;
+    attachment.clearValue = vulkan_renderpass_get_clear_value(image->format);
+    return attachment;
+}
+
+// Nothing here depends on the size of the pass apart from its render area, so a resize doesn't create any objects for it
+void create_pass_rendering(framegraph_framegraph* framegraph, framegraph_pass* pass, vulkan_context* ctx) {
+    framegraph_rendering* rendering = &pass->rendering;
+    pass->dynamicRendering = true;
+    pass->samples = VK_SAMPLE_COUNT_1_BIT;
+    pass->width = framegraph->config.width;
+    pass->height = framegraph->config.height;
+
+    rendering->colorAttachments = malloc(sizeof(VkRenderingAttachmentInfo) * pass->config.numOutputs);
+    rendering->colorImages = malloc(sizeof(framegraph_image*) * pass->config.numOutputs);
+    rendering->formats.colorFormats = malloc(sizeof(VkFormat) * pass->config.numOutputs);
+    for (u32 i = 0; i < pass->config.numOutputs; i++) {
+        framegraph_image* output = framegraph_get_image(framegraph, pass->config.outputs[i]);
+        rendering->colorAttachments[i] = get_rendering_attachment(pass, output, VK_IMAGE_LAYOUT_COLOR_ATTACHMENT_OPTIMAL);
+        rendering->colorImages[i] = output;
+        rendering->formats.colorFormats[i] = output->format;
+        pass->samples = output->multisampled ? (VkSampleCountFlagBits)framegraph->config.maxSamples : VK_SAMPLE_COUNT_1_BIT;
+        if (i == 0) {
+            get_framegraph_image_extent(output, ctx, &pass->width, &pass->height);
+        }
+    }
+    rendering->numColorAttachments = pass->config.numOutputs;
+    rendering->formats.numColorFormats = pass->config.numOutputs;
+
+    rendering->formats.depthFormat = VK_FORMAT_UNDEFINED;
+    if (pass->config.depth != FRAMEGRAPH_NO_IMAGE) {
+        framegraph_image* depth = framegraph_get_image(framegraph, pass->config.depth);
+        rendering->depthBuffered = true;
+        rendering->depthAttachment = get_rendering_attachment(pass, depth, VK_IMAGE_LAYOUT_DEPTH_STENCIL_ATTACHMENT_OPTIMAL);
+        rendering->formats.depthFormat = depth->format;
+        pass->samples = depth->multisampled ? (VkSampleCountFlagBits)framegraph->config.maxSamples : VK_SAMPLE_COUNT_1_BIT;
+        if (pass->config.numOutputs == 0) {
+            get_framegraph_image_extent(depth, ctx, &pass->width, &pass->height);
+        }
+    }
 
-    // TODO: Reflect info out of shaders to make renderpass, pipeline and descriptor info
-    // TODO: Make physical resources (perhaps use a special allocator that reuses images)
-    // TODO: Build renderpass barriers
+    // Like the subpass it resolves the first output only, depth isn't resolved
+    // Integer samples can't be averaged, so those take sample zero, which every device supports
+    if (pass->config.resolve != FRAMEGRAPH_NO_IMAGE && pass->config.numOutputs > 0) {
+        framegraph_image* resolve = framegraph_get_image(framegraph, pass->config.resolve);
+        VkRenderingAttachmentInfo* attachment = &rendering->colorAttachments[0];
+        attachment->resolveMode = vulkan_format_is_integer(resolve->format) ? VK_RESOLVE_MODE_SAMPLE_ZERO_BIT : VK_RESOLVE_MODE_AVERAGE_BIT;
+        attachment->resolveImageView = resolve->image ? resolve->image->imageView : VK_NULL_HANDLE;
+        attachment->resolveImageLayout = VK_IMAGE_LAYOUT_COLOR_ATTACHMENT_OPTIMAL;
+        rendering->resolveImage = resolve;
+    }
 }
-void framegraph_create_resources(framegraph_framegraph* framegraph, vulkan_context* ctx) {}
-VkCommandBuffer framegraph_record(framegraph_framegraph* framegraph, vulkan_context* ctx) {
-    return vulkan_command_pool_get_buffer(ctx->commandPool);
+
+void reflect_pass_layouts(framegraph_pass* pass, vulkan_context* ctx) {
+    pass->numDescriptorLayouts = 0;
+    pass->descriptorLayouts = NULL;
+    pass->numPushConstantRanges = 0;
+
+    vulkan_shader_reflection reflection;
+    CLEAR_MEMORY(&reflection);
+    if (!vulkan_reflect_merge(&reflection, &pass->config.shaders.vertex->reflection) || !vulkan_reflect_merge(&reflection, &pass->config.shaders.fragment->reflection)) {
+        vulkan_reflect_free(&reflection);
+        return;
+    }
+
+    pass->numDescriptorLayouts = vulkan_reflect_get_num_sets(&reflection);
+    pass->descriptorLayouts = malloc(sizeof(vulkan_descriptor_set_layout*) * pass->numDescriptorLayouts);
+    for (u32 i = 0; i < pass->numDescriptorLayouts; i++) {
+        pass->descriptorLayouts[i] = vulkan_reflect_build_set_layout(&reflection, i, ctx->device);
+    }
+
+    pass->numPushConstantRanges = reflection.hasPushConstants ? 1 : 0;
+    pass->pushConstantRange = reflection.pushConstants;
+    vulkan_reflect_free(&reflection);
+}
+
+// The pipeline doesn't depend on the size of the pass, so a rebuild for a new resolution hits the PSO cache
+void request_pass_pipeline(framegraph_pass* pass, vulkan_context* ctx) {
+    VkPipelineColorBlendAttachmentState* blending = malloc(sizeof(VkPipelineColorBlendAttachmentState) * pass->config.numOutputs);
+    for (u32 i = 0; i < pass->config.numOutputs; i++) {
+        blending[i] = vulkan_get_default_blending();
+    }
+
+    vulkan_pipeline_config config;
+    CLEAR_MEMORY(&config);
+    config.vertexShader = pass->config.shaders.vertex;
+    config.fragmentShader = pass->config.shaders.fragment;
+    config.subpass = pass->subpass;
+    config.renderpass = pass->renderpass;
+    if (pass->dynamicRendering) {
+        config.rendering = pass->rendering.formats;
+    }
+    if (pass->config.numSetLayouts > 0) {
+        config.numSetLayouts = pass->config.numSetLayouts;
+        config.setLayouts = pass->config.setLayouts;
+        config.numPushConstantRanges = pass->config.numPushConstantRanges;
+        config.pushConstantRanges = pass->config.pushConstantRanges;
+    } else {
+        config.numSetLayouts = pass->numDescriptorLayouts;
+        config.setLayouts = pass->descriptorLayouts;
+        config.numPushConstantRanges = pass->numPushConstantRanges;
+        config.pushConstantRanges = &pass->pushConstantRange;
+    }
+    config.numBlendingAttachments = pass->config.numOutputs;
+    config.blendingAttachments = blending;
+    config.rasterizerCullMode = pass->config.cullMode;
+    config.samples = pass->samples;
+    config.dynamicState = PIPELINE_DYNAMIC_CULL_MODE | (pass->config.depth != FRAMEGRAPH_NO_IMAGE ? PIPELINE_DYNAMIC_DEPTH : 0);
+
+    for (u32 i = 0; i < pass->numPsos; i++) {
+        config.specialization = pass->config.numVariants > 0 ? &pass->config.variants[i] : NULL;
+
+        // A config the shaders don't match keeps whatever pipeline the pass already had
+        vulkan_pso* pso = vulkan_pso_cache_request(ctx->psos, &config);
+        if (pso != NULL) {
+            pass->psos[i] = pso;
+        }
+    }
+    free(blending);
+}
+
+#define FRAMEGRAPH_WRITE_ACCESS (VK_ACCESS_2_COLOR_ATTACHMENT_WRITE_BIT | VK_ACCESS_2_DEPTH_STENCIL_ATTACHMENT_WRITE_BIT | VK_ACCESS_2_SHADER_WRITE_BIT | VK_ACCESS_2_SHADER_STORAGE_WRITE_BIT | VK_ACCESS_2_TRANSFER_WRITE_BIT | VK_ACCESS_2_MEMORY_WRITE_BIT)
+#define FRAMEGRAPH_STALL_STAGES (VK_PIPELINE_STAGE_2_ALL_COMMANDS_BIT | VK_PIPELINE_STAGE_2_ALL_GRAPHICS_BIT | VK_PIPELINE_STAGE_2_TOP_OF_PIPE_BIT | VK_PIPELINE_STAGE_2_BOTTOM_OF_PIPE_BIT)
+
+// Compute passes write their outputs as storage images and sample their inputs
+// For graphics passes attachment roles win over inputs, an image can't be both sampled and rendered to in the same pass
+bool get_pass_image_state(framegraph_pass* pass, framegraph_image* image, framegraph_image_state* state) {
+    if (pass->config.compute) {
+        for (u32 i = 0; i < pass->config.numOutputs; i++) {
+            if (pass->config.outputs[i] != image->handle) continue;
+            state->stages = VK_PIPELINE_STAGE_2_COMPUTE_SHADER_BIT;
+            state->access = VK_ACCESS_2_SHADER_STORAGE_WRITE_BIT;
+            state->layout = VK_IMAGE_LAYOUT_GENERAL;
+            return true;
+        }
+        for (u32 i = 0; i < pass->config.numInputs; i++) {
+            if (pass->config.inputs[i] != image->handle) continue;
+            state->stages = VK_PIPELINE_STAGE_2_COMPUTE_SHADER_BIT;
+            state->access = VK_ACCESS_2_SHADER_SAMPLED_READ_BIT;
+            state->layout = VK_IMAGE_LAYOUT_SHADER_READ_ONLY_OPTIMAL;
+            return true;
+        }
+        return false;
+    }
+
+    for (u32 i = 0; i < pass->config.numOutputs; i++) {
+        if (pass->config.outputs[i] != image->handle) continue;
+        // Outputs are cleared and written without blending, so nothing reads the old contents
+        state->stages = VK_PIPELINE_STAGE_2_COLOR_ATTACHMENT_OUTPUT_BIT;
+        state->access = VK_ACCESS_2_COLOR_ATTACHMENT_WRITE_BIT;
+        state->layout = VK_IMAGE_LAYOUT_COLOR_ATTACHMENT_OPTIMAL;
+        return true;
+    }
+    if (pass->config.depth == image->handle) {
+        state->stages = VK_PIPELINE_STAGE_2_EARLY_FRAGMENT_TESTS_BIT | VK_PIPELINE_STAGE_2_LATE_FRAGMENT_TESTS_BIT;
+        // Clearing on load is a write even when the pass has depth writes off
+        state->access = VK_ACCESS_2_DEPTH_STENCIL_ATTACHMENT_READ_BIT | VK_ACCESS_2_DEPTH_STENCIL_ATTACHMENT_WRITE_BIT;
+        state->layout = VK_IMAGE_LAYOUT_DEPTH_STENCIL_ATTACHMENT_OPTIMAL;
+        return true;
+    }
+    if (pass->config.resolve == image->handle) {
+        state->stages = VK_PIPELINE_STAGE_2_COLOR_ATTACHMENT_OUTPUT_BIT;
+        state->access = VK_ACCESS_2_COLOR_ATTACHMENT_WRITE_BIT;
+        state->layout = VK_IMAGE_LAYOUT_COLOR_ATTACHMENT_OPTIMAL;
+        return true;
+    }
+    for (u32 i = 0; i < pass->config.numInputs; i++) {
+        if (pass->config.inputs[i] != image->handle) continue;
+        state->stages = VK_PIPELINE_STAGE_2_FRAGMENT_SHADER_BIT;
+        state->access = pass->config.attachmentInputs ? VK_ACCESS_2_INPUT_ATTACHMENT_READ_BIT : VK_ACCESS_2_SHADER_SAMPLED_READ_BIT;
+        state->layout = VK_IMAGE_LAYOUT_SHADER_READ_ONLY_OPTIMAL;
+        return true;
+    }
+    return false;
+}
+
+// Where the image is left at the end of a frame, which the next frame's first use has to wait on since frames in flight share the images
+framegraph_image_state get_image_last_state(framegraph_framegraph* framegraph, framegraph_image* image) {
+    framegraph_image_state state;
+    CLEAR_MEMORY(&state);
+    for (u32 i = image->firstUse; i <= image->lastUse; i++) {
+        framegraph_image_state passState;
+        if (!get_pass_image_state(framegraph->orderedPasses[i], image, &passState)) continue;
+        // Trailing reads all have to finish, the last write is only visible through them if it's included too
+        if (passState.access & FRAMEGRAPH_WRITE_ACCESS) {
+            state = passState;
+        } else {
+            state.stages |= passState.stages;
+            state.access |= passState.access;
+            state.layout = passState.layout;
+        }
+    }
+    return state;
+}
+
+void add_barrier(framegraph_framegraph* framegraph, framegraph_barrier_batch* batch, framegraph_image* image, framegraph_image_state* src, framegraph_image_state* dst) {
+    batch->numBarriers++;
+    batch->barriers = realloc(batch->barriers, sizeof(VkImageMemoryBarrier2) * batch->numBarriers);
+    batch->images = realloc(batch->images, sizeof(framegraph_image*) * batch->numBarriers);
+
+    VkImageMemoryBarrier2* barrier = &batch->barriers[batch->numBarriers - 1];
+    CLEAR_MEMORY(barrier);
+    barrier->sType = VK_STRUCTURE_TYPE_IMAGE_MEMORY_BARRIER_2;
+    barrier->srcStageMask = src->stages;
+    // Only writes need making available, after reads an execution dependency is enough
+    barrier->srcAccessMask = src->access & FRAMEGRAPH_WRITE_ACCESS;
+    barrier->dstStageMask = dst->stages;
+    barrier->dstAccessMask = dst->access;
+    barrier->oldLayout = src->layout;
+    barrier->newLayout = dst->layout;
+    barrier->srcQueueFamilyIndex = VK_QUEUE_FAMILY_IGNORED;
+    barrier->dstQueueFamilyIndex = VK_QUEUE_FAMILY_IGNORED;
+    barrier->subresourceRange.aspectMask = image->format == VK_FORMAT_D32_SFLOAT ? VK_IMAGE_ASPECT_DEPTH_BIT : VK_IMAGE_ASPECT_COLOR_BIT;
+    barrier->subresourceRange.levelCount = 1;
+    barrier->subresourceRange.layerCount = 1;
+    batch->images[batch->numBarriers - 1] = image;
+
+    framegraph->barrierStats.numBarriers++;
+    if ((src->stages & FRAMEGRAPH_STALL_STAGES) || (dst->stages & FRAMEGRAPH_STALL_STAGES)) {
+        framegraph->barrierStats.numFullStalls++;
+    }
+}
+
+framegraph_split_barrier* get_split_barrier(framegraph_framegraph* framegraph, u32 signalPass, u32 waitPass) {
+    for (u32 i = 0; i < framegraph->numSplitBarriers; i++) {
+        framegraph_split_barrier* split = &framegraph->splitBarriers[i];
+        if (split->signalPass == signalPass && split->waitPass == waitPass) return split;
+    }
+
+    framegraph->numSplitBarriers++;
+    framegraph->splitBarriers = realloc(framegraph->splitBarriers, sizeof(framegraph_split_barrier) * framegraph->numSplitBarriers);
+    framegraph_split_barrier* split = &framegraph->splitBarriers[framegraph->numSplitBarriers - 1];
+    CLEAR_MEMORY(split);
+    split->signalPass = signalPass;
+    split->waitPass = waitPass;
+
+    split->numEvents = framegraph->config.framesInFlight > 0 ? framegraph->config.framesInFlight : 1;
+    split->events = malloc(sizeof(VkEvent) * split->numEvents);
+    VkEventCreateInfo createInfo;
+    CLEAR_MEMORY(&createInfo);
+    createInfo.sType = VK_STRUCTURE_TYPE_EVENT_CREATE_INFO;
+    createInfo.flags = VK_EVENT_CREATE_DEVICE_ONLY_BIT;
+    for (u32 i = 0; i < split->numEvents; i++) {
+        VkResult result = vkCreateEvent(framegraph->ctx->device->device, &createInfo, NULL, &split->events[i]);
+        if (result != VK_SUCCESS) {
+            FATAL("Vulkan event creation failed with error code: %d", result);
+        }
+    }
+    return split;
+}
+
+// Contents moving between queues are released by the queue that had them and acquired by the one taking them, with a semaphore in between
+void add_queue_transfer(framegraph_framegraph* framegraph, framegraph_image* image, u32 srcPass, u32 dstPass, framegraph_image_state* src, framegraph_image_state* dst) {
+    u32 releaseIndex = framegraph->orderedPasses[srcPass]->submission;
+    framegraph_submission* release = &framegraph->submissions[releaseIndex];
+    framegraph_submission* acquire = &framegraph->submissions[framegraph->orderedPasses[dstPass]->submission];
+    if (acquire->waitSubmission == UINT32_MAX || acquire->waitSubmission < releaseIndex) {
+        acquire->waitSubmission = releaseIndex;
+    }
+    acquire->waitStages |= dst->stages;
+
+    u32 srcFamily = get_queue_family(framegraph, release->queue);
+    u32 dstFamily = get_queue_family(framegraph, acquire->queue);
+    framegraph_image_state handover;
+    CLEAR_MEMORY(&handover);
+    handover.stages = VK_PIPELINE_STAGE_2_NONE;
+    handover.layout = dst->layout;
+    add_barrier(framegraph, &release->releases, image, src, &handover);
+    release->releases.barriers[release->releases.numBarriers - 1].srcQueueFamilyIndex = srcFamily;
+    release->releases.barriers[release->releases.numBarriers - 1].dstQueueFamilyIndex = dstFamily;
+
+    handover.layout = src->layout;
+    add_barrier(framegraph, &acquire->acquires, image, &handover, dst);
+    acquire->acquires.barriers[acquire->acquires.numBarriers - 1].srcQueueFamilyIndex = srcFamily;
+    acquire->acquires.barriers[acquire->acquires.numBarriers - 1].dstQueueFamilyIndex = dstFamily;
+    framegraph->queueStats.numOwnershipTransfers++;
+}
+
+u32 get_last_subpass(framegraph_framegraph* framegraph, u32 passIndex) {
+    framegraph_pass* owner = framegraph->orderedPasses[passIndex]->owner;
+    while (passIndex + 1 < framegraph->numOrderedPasses && framegraph->orderedPasses[passIndex + 1]->owner == owner) {
+        passIndex++;
+    }
+    return passIndex;
+}
+
+// Walks each image through the passes that use it, emitting a barrier only where the state changes in a way that needs one
+// Barriers go in a batch before the pass that needs them, or onto an event when the previous use was further back than the pass before
+void build_barriers(framegraph_framegraph* framegraph) {
+    CLEAR_MEMORY(&framegraph->barrierStats);
+    framegraph->queueStats.numOwnershipTransfers = 0;
+
+    for (u32 i = 0; i < framegraph->numImages; i++) {
+        framegraph_image* image = framegraph->images[i];
+        if (image->firstUse == UINT32_MAX) continue;
+
+        // Contents never carry over between frames so every frame starts from undefined, after the previous frame's last use
+        framegraph_image_state previous;
+        CLEAR_MEMORY(&previous);
+        if (framegraph_is_backbuffer(image)) {
+            // Acquiring signals a semaphore the submit waits on at this stage, which is all that has to be chained onto
+            previous.stages = VK_PIPELINE_STAGE_2_COLOR_ATTACHMENT_OUTPUT_BIT;
+        } else {
+            previous = get_image_last_state(framegraph, image);
+            // Images aliasing the same memory have to be done with it too
+            for (u32 j = 0; j < framegraph->numImages; j++) {
+                framegraph_image* other = framegraph->images[j];
+                if (other == image || other->image == NULL || image->image == NULL || !framegraph_images_share_memory(image, other)) continue;
+                framegraph_image_state otherState = get_image_last_state(framegraph, other);
+                previous.stages |= otherState.stages;
+                previous.access |= otherState.access;
+            }
+        }
+        previous.layout = VK_IMAGE_LAYOUT_UNDEFINED;
+        u32 previousPass = UINT32_MAX;
+
+        for (u32 j = image->firstUse; j <= image->lastUse; j++) {
+            framegraph_pass* pass = framegraph->orderedPasses[j];
+            framegraph_image_state next;
+            if (!get_pass_image_state(pass, image, &next)) continue;
+
+            if (previousPass == UINT32_MAX && framegraph->orderedPasses[image->lastUse]->queue != pass->queue) {
+                // Last frame's stages are on the other queue, which the start of this frame already waits on as a whole
+                previous.stages = VK_PIPELINE_STAGE_2_NONE;
+                previous.access = 0;
+            }
+            if (previousPass != UINT32_MAX && framegraph->orderedPasses[previousPass]->queue != pass->queue) {
+                add_queue_transfer(framegraph, image, previousPass, j, &previous, &next);
+                previous = next;
+                previousPass = j;
+                continue;
+            }
+
+            if (previousPass != UINT32_MAX && framegraph->orderedPasses[previousPass]->owner == pass->owner) {
+                if (next.access & FRAMEGRAPH_WRITE_ACCESS) {
+                    previous = next;
+                } else {
+                    previous.stages |= next.stages;
+                    previous.access |= next.access;
+                    previous.layout = next.layout;
+                }
+                previousPass = j;
+                framegraph->barrierStats.numInRenderpass++;
+                continue;
+            }
+
+            bool readAfterRead = !(previous.access & FRAMEGRAPH_WRITE_ACCESS) && !(next.access & FRAMEGRAPH_WRITE_ACCESS);
+            if (readAfterRead && previous.layout == next.layout && previousPass != UINT32_MAX) {
+                // A later write then waits on every read so far
+                previous.stages |= next.stages;
+                previous.access |= next.access;
+                previousPass = j;
+                framegraph->barrierStats.numElided++;
+                continue;
+            }
+
+            // Nothing can wait or signal inside a render pass, so barriers go before the first subpass and events are set after the last
+            u32 waitPass = j - pass->subpass;
+            u32 signalPass = previousPass != UINT32_MAX ? get_last_subpass(framegraph, previousPass) : UINT32_MAX;
+            if (signalPass != UINT32_MAX && waitPass - signalPass > 1) {
+                framegraph_split_barrier* split = get_split_barrier(framegraph, signalPass, waitPass);
+                add_barrier(framegraph, &split->batch, image, &previous, &next);
+                framegraph->barrierStats.numSplit++;
+            } else {
+                add_barrier(framegraph, &framegraph->orderedPasses[waitPass]->barriers, image, &previous, &next);
+            }
+            previous = next;
+            previousPass = j;
+        }
+
+        if (framegraph_is_backbuffer(image)) {
+            // Presenting waits on the submit's semaphore, so nothing after the transition has to wait on it
+            framegraph_image_state present;
+            CLEAR_MEMORY(&present);
+            present.stages = VK_PIPELINE_STAGE_2_NONE;
+            present.layout = VK_IMAGE_LAYOUT_PRESENT_SRC_KHR;
+            add_barrier(framegraph, &framegraph->finalBarriers, image, &previous, &present);
+        }
+    }
+
+    framegraph_barrier_stats* stats = &framegraph->barrierStats;
+    for (u32 i = 0; i < framegraph->numOrderedPasses; i++) {
+        if (framegraph->orderedPasses[i]->barriers.numBarriers > 0) stats->numBatches++;
+    }
+    stats->numBatches += framegraph->numSplitBarriers * 2;
+    for (u32 i = 0; i < framegraph->numSubmissions; i++) {
+        if (framegraph->submissions[i].acquires.numBarriers > 0) stats->numBatches++;
+        if (framegraph->submissions[i].releases.numBarriers > 0) stats->numBatches++;
+    }
+    if (framegraph->finalBarriers.numBarriers > 0) stats->numBatches++;
+    INFO("Framegraph barriers: %d image barriers in %d batches, %d split onto events, %d elided, %d inside render passes, %d full stalls",
+        stats->numBarriers, stats->numBatches, stats->numSplit, stats->numElided, stats->numInRenderpass, stats->numFullStalls);
+}
+
+// One slot per render pass or compute pass, so merged passes share the slot of the pass they were merged into
+void plan_pass_profiling(framegraph_framegraph* framegraph, vulkan_context* ctx) {
+    for (u32 i = 0; i < framegraph->numPasses; i++) {
+        framegraph->passes[i]->profileSlot = UINT32_MAX;
+    }
+    if (!framegraph->config.profile || !ctx->physical->features12.hostQueryReset) {
+        if (framegraph->config.profile) {
+            WARN("Framegraph profiling needs host query resets, which the device doesn't support");
+        }
+        if (framegraph->profiler) {
+            framegraph_profiler_set_plan(framegraph->profiler, 0, NULL);
+        }
+        return;
+    }
+
+    if (framegraph->profiler && framegraph->profiler->numFrames != framegraph->config.framesInFlight) {
+        framegraph_profiler_destroy(framegraph->profiler);
+        framegraph->profiler = NULL;
+    }
+    if (framegraph->profiler == NULL) {
+        framegraph->profiler = framegraph_profiler_create(ctx, framegraph->config.framesInFlight);
+    }
+
+    u32 numSlots = 0;
+    framegraph_profiler_slot* slots = malloc(sizeof(framegraph_profiler_slot) * framegraph->numOrderedPasses);
+    for (u32 i = 0; i < framegraph->numOrderedPasses; i++) {
+        framegraph_pass* pass = framegraph->orderedPasses[i];
+        if (pass->subpass > 0) continue;
+
+        framegraph_profiler_slot* slot = &slots[numSlots];
+        slot->pass = pass->index;
+        slot->timestampBits = pass->queue == FRAMEGRAPH_QUEUE_COMPUTE ? ctx->physical->queues.computeTimestampBits : ctx->physical->queues.graphicsTimestampBits;
+        slot->statistics = framegraph->config.pipelineStatistics && !pass->config.compute;
+
+        // The query stays active around the secondaries the parallel passes record into, which needs inheritedQueries
+        if (!ctx->physical->features.inheritedQueries) {
+            u32 lastSubpass = get_last_subpass(framegraph, i);
+            for (u32 j = i; j <= lastSubpass; j++) {
+                if (framegraph->orderedPasses[j]->config.parallelExecFn) slot->statistics = false;
+            }
+        }
+        pass->profileSlot = numSlots++;
+    }
+    framegraph_profiler_set_plan(framegraph->profiler, numSlots, slots);
+    free(slots);
+}
+
+// Subpasses are the only way to read an attachment in place, so passes that were merged or read attachment inputs need a renderpass
+bool framegraph_pass_can_render_dynamically(framegraph_framegraph* framegraph, u32 passIndex, vulkan_context* ctx) {
+    framegraph_pass* pass = framegraph->orderedPasses[passIndex];
+    if (!framegraph->config.dynamicRendering || !ctx->physical->features13.dynamicRendering) return false;
+    return !pass->config.attachmentInputs && get_last_subpass(framegraph, passIndex) == passIndex;
+}
+
+void framegraph_create_resources(framegraph_framegraph* framegraph, vulkan_context* ctx) {
+    framegraph->ctx = ctx;
+    if (framegraph->transientPool == NULL) {
+        framegraph->transientPool = framegraph_transient_pool_create(ctx);
+    }
+
+    for (u32 i = 0; i < framegraph->numImages; i++) {
+        framegraph->images[i]->width = framegraph->config.width;
+        framegraph->images[i]->height = framegraph->config.height;
+    }
+    assign_pass_queues(framegraph, ctx);
+    compute_image_lifetimes(framegraph);
+    merge_passes(framegraph, ctx);
+    place_transient_images(framegraph, ctx);
+
+    for (u32 i = 0; i < framegraph->numPasses; i++) {
+        framegraph_pass* pass = framegraph->passes[i];
+        pass->numPsos = pass->config.numVariants > 0 ? pass->config.numVariants : 1;
+        pass->psos = malloc(sizeof(vulkan_pso*) * pass->numPsos);
+        CLEAR_MEMORY_ARRAY(pass->psos, pass->numPsos);
+        pass->fallbacks = malloc(sizeof(vulkan_pso*) * pass->numPsos);
+        CLEAR_MEMORY_ARRAY(pass->fallbacks, pass->numPsos);
+        pass->pipelines = malloc(sizeof(vulkan_pipeline*) * pass->numPsos);
+        CLEAR_MEMORY_ARRAY(pass->pipelines, pass->numPsos);
+    }
+
+    if (framegraph->config.dynamicRendering && !ctx->physical->features13.dynamicRendering) {
+        WARN("Framegraph dynamic rendering isn't supported by the device, every pass gets a renderpass instead");
+    }
+    u32 numDynamic = 0;
+    u32 numRenderpasses = 0;
+    for (u32 i = 0; i < framegraph->numOrderedPasses; i++) {
+        framegraph_pass* pass = framegraph->orderedPasses[i];
+        if (pass->subpass > 0 || pass->config.compute) continue;
+        if (framegraph_pass_can_render_dynamically(framegraph, i, ctx)) {
+            create_pass_rendering(framegraph, pass, ctx);
+            numDynamic++;
+        } else {
+            create_group_renderpass(framegraph, i, get_last_subpass(framegraph, i), ctx);
+            numRenderpasses++;
+        }
+    }
+    if (framegraph->config.dynamicRendering) {
+        INFO("Framegraph begins %d passes with dynamic rendering, %d still need a renderpass", numDynamic, numRenderpasses);
+    }
+    for (u32 i = 0; i < framegraph->numOrderedPasses; i++) {
+        framegraph_pass* pass = framegraph->orderedPasses[i];
+        if (pass->config.shaders.vertex && pass->config.shaders.fragment) {
+            if (pass->config.numSetLayouts == 0) {
+                reflect_pass_layouts(pass, ctx);
+            }
+            request_pass_pipeline(pass, ctx);
+        }
+    }
+
+    build_submissions(framegraph);
+    build_barriers(framegraph);
+    create_queue_timelines(framegraph, ctx);
+    plan_pass_profiling(framegraph, ctx);
+    framegraph_log_timeline(framegraph);
+}
+
+u64 framegraph_hash(framegraph_framegraph* framegraph) {
+    u64 hash = hash_u64(framegraph->config.width, HASH_SEED);
+    hash = hash_u64(framegraph->config.height, hash);
+    hash = hash_u64(framegraph->config.maxSamples, hash);
+    hash = hash_u64(framegraph->config.framesInFlight, hash);
+    hash = hash_u64(framegraph->config.profile, hash);
+    hash = hash_u64(framegraph->config.pipelineStatistics, hash);
+    hash = hash_u64(framegraph->config.dynamicRendering, hash);
+
+    hash = hash_u64(framegraph->numImages, hash);
+    for (u32 i = 0; i < framegraph->numImages; i++) {
+        framegraph_image* image = framegraph->images[i];
+        hash = hash_string(image->name, hash);
+        hash = hash_u64(image->format, hash);
+        hash = hash_u64(image->multisampled, hash);
+        hash = hash_u64(image->exported, hash);
+    }
+
+    // Callbacks and their data are read when recording, so swapping them doesn't need a new plan
+    hash = hash_u64(framegraph->numPasses, hash);
+    for (u32 i = 0; i < framegraph->numPasses; i++) {
+        framegraph_pass_config* config = &framegraph->passes[i]->config;
+        hash = hash_u64(config->numInputs, hash);
+        for (u32 j = 0; j < config->numInputs; j++) {
+            hash = hash_u64(config->inputs[j], hash);
+        }
+        hash = hash_u64(config->numOutputs, hash);
+        for (u32 j = 0; j < config->numOutputs; j++) {
+            hash = hash_u64(config->outputs[j], hash);
+        }
+        hash = hash_u64(config->depth, hash);
+        hash = hash_u64(config->resolve, hash);
+        hash = hash_u64(config->attachmentInputs, hash);
+        hash = hash_u64(config->compute, hash);
+        hash = hash_u64(config->asyncCompute, hash);
+
+        // Shaders and set layouts are shared objects so their pointers identify them, reloads go through framegraph_reload_shader instead
+        hash = hash_u64((u64)(uintptr_t)config->shaders.vertex, hash);
+        hash = hash_u64((u64)(uintptr_t)config->shaders.fragment, hash);
+        hash = hash_u64(config->numSetLayouts, hash);
+        for (u32 j = 0; j < config->numSetLayouts; j++) {
+            hash = hash_u64((u64)(uintptr_t)config->setLayouts[j], hash);
+        }
+        hash = hash_u64(config->numPushConstantRanges, hash);
+        for (u32 j = 0; j < config->numPushConstantRanges; j++) {
+            hash = hash_bytes(&config->pushConstantRanges[j], sizeof(VkPushConstantRange), hash);
+        }
+        hash = hash_u64(config->cullMode, hash);
+        hash = hash_u64(config->depthTest, hash);
+        hash = hash_u64(config->depthWrite, hash);
+        hash = hash_u64(config->numVariants, hash);
+        hash = hash_u64((u64)(uintptr_t)config->variants, hash);
+    }
+
+    return hash;
+}
+
+bool framegraph_update(framegraph_framegraph* framegraph, vulkan_context* ctx) {
+    u64 hash = framegraph_hash(framegraph);
+    if (framegraph->compiled && framegraph->compiledHash == hash) return false;
+
+    // Frames still in flight can be using the old images and framebuffers
+    if (framegraph->ctx) {
+        vkDeviceWaitIdle(ctx->device->device);
+    }
+    release_compiled_framegraph(framegraph);
+    framegraph_compile(framegraph);
+    framegraph_log_schedule(framegraph);
+    framegraph_create_resources(framegraph, ctx);
+    framegraph->compiled = true;
+    framegraph->compiledHash = hash;
+    INFO("Compiled framegraph %016llx at %dx%d", (unsigned long long)hash, framegraph->config.width, framegraph->config.height);
+
+    return true;
+}
+
+void framegraph_reload_shader(framegraph_framegraph* framegraph, vulkan_shader* shader) {
+    for (u32 i = 0; i < framegraph->numOrderedPasses; i++) {
+        framegraph_pass* pass = framegraph->orderedPasses[i];
+        if (pass->config.shaders.vertex != shader && pass->config.shaders.fragment != shader) continue;
+
+        // The shader's bindings may have changed, the old layouts are still referenced by the old pipeline's layout
+        u32 numPreviousLayouts = pass->numDescriptorLayouts;
+        vulkan_descriptor_set_layout** previousLayouts = pass->descriptorLayouts;
+        if (pass->config.numSetLayouts == 0) {
+            reflect_pass_layouts(pass, framegraph->ctx);
+        }
+
+        vulkan_pso** previous = malloc(sizeof(vulkan_pso*) * pass->numPsos);
+        memcpy(previous, pass->psos, sizeof(vulkan_pso*) * pass->numPsos);
+        request_pass_pipeline(pass, framegraph->ctx);
+        for (u32 j = 0; j < pass->numPsos; j++) {
+            if (previous[j] != NULL && pass->psos[j] != previous[j] && vulkan_pso_is_ready(previous[j])) {
+                pass->fallbacks[j] = previous[j];
+            }
+        }
+        free(previous);
+
+        if (pass->config.numSetLayouts == 0) {
+            for (u32 j = 0; j < numPreviousLayouts; j++) {
+                vulkan_descriptor_set_layout_destroy(previousLayouts[j]);
+            }
+            free(previousLayouts);
+        }
+    }
+}
+
+// Secondary command buffers don't inherit any state so this runs again for every job of a parallel pass
+void begin_pass_state(framegraph_pass* pass, VkCommandBuffer cmd) {
+    // With variants each draw binds its own pipeline, dynamic state set here outlives those binds
+    if (pass->config.numVariants == 0) {
+        vkCmdBindPipeline(cmd, VK_PIPELINE_BIND_POINT_GRAPHICS, pass->pipelines[0]->pipeline);
+    }
+    vulkan_pipeline_set_viewport(cmd, pass->width, pass->height);
+    vkCmdSetCullMode(cmd, pass->config.cullMode);
+    if (pass->config.depth != FRAMEGRAPH_NO_IMAGE) {
+        vkCmdSetDepthTestEnable(cmd, pass->config.depthTest);
+        vkCmdSetDepthWriteEnable(cmd, pass->config.depthWrite);
+        vkCmdSetDepthCompareOp(cmd, VK_COMPARE_OP_LESS);
+    }
+}
+
+// Secondary command buffers executed while a pipeline statistics query is active have to say which statistics they count towards
+VkQueryPipelineStatisticFlags get_inherited_statistics(framegraph_pass* pass) {
+    framegraph_profiler* profiler = pass->framegraph->profiler;
+    u32 slot = pass->owner->profileSlot;
+    if (profiler == NULL || slot >= profiler->numSlots || !profiler->slots[slot].statistics) return 0;
+    return profiler->statisticFlags;
+}
+
+void record_pass_job(void* data) {
+    framegraph_record_job* job = (framegraph_record_job*)data;
+    job->cmd = vulkan_command_pool_next_buffer(job->pool, VK_COMMAND_BUFFER_LEVEL_SECONDARY);
+
+    // With dynamic rendering the buffer is only told the attachment formats it draws to
+    VkCommandBufferInheritanceRenderingInfo renderingInheritance;
+    CLEAR_MEMORY(&renderingInheritance);
+    renderingInheritance.sType = VK_STRUCTURE_TYPE_COMMAND_BUFFER_INHERITANCE_RENDERING_INFO;
+    renderingInheritance.colorAttachmentCount = job->pass->rendering.formats.numColorFormats;
+    renderingInheritance.pColorAttachmentFormats = job->pass->rendering.formats.colorFormats;
+    renderingInheritance.depthAttachmentFormat = job->pass->rendering.formats.depthFormat;
+    renderingInheritance.rasterizationSamples = job->pass->samples;
+
+    VkCommandBufferInheritanceInfo inheritance;
+    CLEAR_MEMORY(&inheritance);
+    inheritance.sType = VK_STRUCTURE_TYPE_COMMAND_BUFFER_INHERITANCE_INFO;
+    if (job->pass->dynamicRendering) {
+        inheritance.pNext = &renderingInheritance;
+    } else {
+        inheritance.renderPass = job->pass->renderpass->renderpass;
+        inheritance.subpass = job->pass->subpass;
+        inheritance.framebuffer = job->framebuffer->framebuffer;
+    }
+    inheritance.pipelineStatistics = get_inherited_statistics(job->pass);
+
+    VkCommandBufferBeginInfo beginInfo;
+    CLEAR_MEMORY(&beginInfo);
+    beginInfo.sType = VK_STRUCTURE_TYPE_COMMAND_BUFFER_BEGIN_INFO;
+    beginInfo.flags = VK_COMMAND_BUFFER_USAGE_ONE_TIME_SUBMIT_BIT | VK_COMMAND_BUFFER_USAGE_RENDER_PASS_CONTINUE_BIT;
+    beginInfo.pInheritanceInfo = &inheritance;
+    VkResult result = vkBeginCommandBuffer(job->cmd, &beginInfo);
+    if (result != VK_SUCCESS) {
+        FATAL("Vulkan secondary command buffer begin failed with error code: %d", result);
+    }
+
+    begin_pass_state(job->pass, job->cmd);
+    job->pass->config.parallelExecFn(job->cmd, job->job, job->numJobs, job->pass->config.dataPtr);
+
+    result = vkEndCommandBuffer(job->cmd);
+    if (result != VK_SUCCESS) {
+        FATAL("Vulkan secondary command buffer end failed with error code: %d", result);
+    }
+}
+
+void record_parallel_pass(framegraph_framegraph* framegraph, framegraph_pass* pass, vulkan_framebuffer* framebuffer, VkCommandBuffer cmd, u32 numWorkerPools, vulkan_command_pool** workerPools) {
+    if (numWorkerPools > framegraph->numRecordJobs) {
+        framegraph->numRecordJobs = numWorkerPools;
+        framegraph->recordJobs = realloc(framegraph->recordJobs, sizeof(framegraph_record_job) * numWorkerPools);
+        framegraph->recordBuffers = realloc(framegraph->recordBuffers, sizeof(VkCommandBuffer) * numWorkerPools);
+    }
+
+    for (u32 i = 0; i < numWorkerPools; i++) {
+        framegraph_record_job* job = &framegraph->recordJobs[i];
+        job->pass = pass;
+        job->framebuffer = framebuffer;
+        job->pool = workerPools[i];
+        job->job = i;
+        job->numJobs = numWorkerPools;
+        job->cmd = VK_NULL_HANDLE;
+    }
+
+    // The main thread takes the first job rather than sitting idle, the group only waits on these jobs and not on any PSO compiles
+    for (u32 i = 1; i < numWorkerPools; i++) {
+        job_group_submit(framegraph->recordGroup, framegraph->ctx->jobs, record_pass_job, &framegraph->recordJobs[i]);
+    }
+    record_pass_job(&framegraph->recordJobs[0]);
+    job_group_wait(framegraph->recordGroup);
+
+    for (u32 i = 0; i < numWorkerPools; i++) {
+        framegraph->recordBuffers[i] = framegraph->recordJobs[i].cmd;
+    }
+    vkCmdExecuteCommands(cmd, numWorkerPools, framegraph->recordBuffers);
+}
+
+// The same images go in every frame apart from the backbuffer, which is whichever swapchain image was acquired
+VkDependencyInfo resolve_barrier_batch(framegraph_framegraph* framegraph, framegraph_barrier_batch* batch, u32 imageIndex) {
+    for (u32 i = 0; i < batch->numBarriers; i++) {
+        framegraph_image* image = batch->images[i];
+        batch->barriers[i].image = image->image ? image->image->image : framegraph->ctx->swapchain->images[imageIndex]->image;
+    }
+
+    VkDependencyInfo dependency;
+    CLEAR_MEMORY(&dependency);
+    dependency.sType = VK_STRUCTURE_TYPE_DEPENDENCY_INFO;
+    dependency.imageMemoryBarrierCount = batch->numBarriers;
+    dependency.pImageMemoryBarriers = batch->barriers;
+    return dependency;
+}
+
+void record_barrier_batch(framegraph_framegraph* framegraph, framegraph_barrier_batch* batch, VkCommandBuffer cmd, u32 imageIndex) {
+    if (batch->numBarriers == 0) return;
+    VkDependencyInfo dependency = resolve_barrier_batch(framegraph, batch, imageIndex);
+    vkCmdPipelineBarrier2(cmd, &dependency);
+}
+
+void wait_split_barriers(framegraph_framegraph* framegraph, u32 passIndex, VkCommandBuffer cmd, u32 frameIndex, u32 imageIndex) {
+    for (u32 i = 0; i < framegraph->numSplitBarriers; i++) {
+        framegraph_split_barrier* split = &framegraph->splitBarriers[i];
+        if (split->waitPass != passIndex) continue;
+
+        VkEvent event = split->events[frameIndex % split->numEvents];
+        VkDependencyInfo dependency = resolve_barrier_batch(framegraph, &split->batch, imageIndex);
+        vkCmdWaitEvents2(cmd, 1, &event, &dependency);
+
+        // Reset once the wait is done with it, so it's unsignalled again by the time this frame slot comes back round
+        VkPipelineStageFlags2 waitStages = 0;
+        for (u32 j = 0; j < split->batch.numBarriers; j++) {
+            waitStages |= split->batch.barriers[j].dstStageMask;
+        }
+        vkCmdResetEvent2(cmd, event, waitStages);
+    }
+}
+
+void signal_split_barriers(framegraph_framegraph* framegraph, u32 passIndex, VkCommandBuffer cmd, u32 frameIndex, u32 imageIndex) {
+    for (u32 i = 0; i < framegraph->numSplitBarriers; i++) {
+        framegraph_split_barrier* split = &framegraph->splitBarriers[i];
+        if (split->signalPass != passIndex) continue;
+
+        VkDependencyInfo dependency = resolve_barrier_batch(framegraph, &split->batch, imageIndex);
+        vkCmdSetEvent2(cmd, split->events[frameIndex % split->numEvents], &dependency);
+    }
+}
+
+// The backbuffer's views are filled in here since they depend on which swapchain image was acquired
+void begin_pass_rendering(framegraph_framegraph* framegraph, framegraph_pass* pass, VkCommandBuffer cmd, u32 imageIndex, bool secondary) {
+    framegraph_rendering* rendering = &pass->rendering;
+    VkImageView backbuffer = framegraph->ctx->swapchain->images[imageIndex]->imageView;
+    for (u32 i = 0; i < rendering->numColorAttachments; i++) {
+        if (framegraph_is_backbuffer(rendering->colorImages[i])) {
+            rendering->colorAttachments[i].imageView = backbuffer;
+        }
+    }
+    if (rendering->resolveImage && framegraph_is_backbuffer(rendering->resolveImage)) {
+        rendering->colorAttachments[0].resolveImageView = backbuffer;
+    }
+
+    VkRenderingInfo renderingInfo;
+    CLEAR_MEMORY(&renderingInfo);
+    renderingInfo.sType = VK_STRUCTURE_TYPE_RENDERING_INFO;
+    renderingInfo.flags = secondary ? VK_RENDERING_CONTENTS_SECONDARY_COMMAND_BUFFERS_BIT : 0;
+    renderingInfo.renderArea.extent.width = pass->width;
+    renderingInfo.renderArea.extent.height = pass->height;
+    renderingInfo.layerCount = 1;
+    renderingInfo.colorAttachmentCount = rendering->numColorAttachments;
+    renderingInfo.pColorAttachments = rendering->colorAttachments;
+    renderingInfo.pDepthAttachment = rendering->depthBuffered ? &rendering->depthAttachment : NULL;
+    vkCmdBeginRendering(cmd, &renderingInfo);
+}
+
+// Queries begin after the prepareFn and barriers, so work the pass sets up for itself isn't charged to it
+void record_compute_pass(framegraph_framegraph* framegraph, framegraph_pass* pass, u32 passIndex, VkCommandBuffer cmd, framegraph_frame* frame) {
+    if (pass->config.prepareFn) {
+        pass->config.prepareFn(cmd, pass->config.dataPtr);
+    }
+    wait_split_barriers(framegraph, passIndex, cmd, frame->frameIndex, frame->imageIndex);
+    record_barrier_batch(framegraph, &pass->barriers, cmd, frame->imageIndex);
+    if (framegraph->profiler) {
+        framegraph_profiler_begin(framegraph->profiler, cmd, frame->frameIndex, pass->profileSlot);
+    }
+    if (pass->config.execFn) {
+        pass->config.execFn(cmd, pass->config.dataPtr);
+    } else if (pass->config.parallelExecFn) {
+        pass->config.parallelExecFn(cmd, 0, 1, pass->config.dataPtr);
+    }
+    if (framegraph->profiler) {
+        framegraph_profiler_end(framegraph->profiler, cmd, frame->frameIndex, pass->profileSlot);
+    }
+    signal_split_barriers(framegraph, passIndex, cmd, frame->frameIndex, frame->imageIndex);
+}
+
+void record_graphics_pass(framegraph_framegraph* framegraph, vulkan_context* ctx, framegraph_pass* pass, u32 passIndex, VkCommandBuffer cmd, framegraph_frame* frame) {
+    framegraph_pass* owner = pass->owner;
+    vulkan_framebuffer* framebuffer = owner->numFramebuffers > 0 ? owner->framebuffers[owner->numFramebuffers > 1 ? frame->imageIndex : 0] : NULL;
+
+    // The pass still runs its load and store ops while its pipeline is compiling, it just doesn't draw
+    // Resolved here on the main thread so parallel jobs only ever read them
+    bool anyPipeline = false;
+    for (u32 j = 0; j < pass->numPsos; j++) {
+        pass->pipelines[j] = pass->psos[j] ? vulkan_pso_cache_get(ctx->psos, pass->psos[j], pass->fallbacks[j]) : NULL;
+        if (pass->fallbacks[j] && vulkan_pso_is_ready(pass->psos[j])) {
+            pass->fallbacks[j] = NULL;
+        }
+        anyPipeline |= pass->pipelines[j] != NULL;
+    }
+
+    // Merged passes never have a prepareFn or barriers of their own, those all happen before the render pass begins
+    bool parallel = anyPipeline && pass->config.parallelExecFn && frame->numWorkerPools > 0;
+    VkSubpassContents contents = parallel ? VK_SUBPASS_CONTENTS_SECONDARY_COMMAND_BUFFERS : VK_SUBPASS_CONTENTS_INLINE;
+    if (pass->subpass == 0) {
+        if (pass->config.prepareFn) {
+            pass->config.prepareFn(cmd, pass->config.dataPtr);
+        }
+
+        wait_split_barriers(framegraph, passIndex, cmd, frame->frameIndex, frame->imageIndex);
+        record_barrier_batch(framegraph, &pass->barriers, cmd, frame->imageIndex);
+        // Queries can't begin in a subpass recorded from secondary command buffers, so the whole render pass is measured from out here
+        // Culling and the like in the prepareFn is left out, it isn't the pass's own rendering
+        if (framegraph->profiler) {
+            framegraph_profiler_begin(framegraph->profiler, cmd, frame->frameIndex, pass->profileSlot);
+        }
+        if (pass->dynamicRendering) {
+            begin_pass_rendering(framegraph, pass, cmd, frame->imageIndex, parallel);
+        } else {
+            vulkan_renderpass_bind(cmd, pass->renderpass, framebuffer, contents);
+        }
+    } else {
+        vkCmdNextSubpass(cmd, contents);
+    }
+
+    if (parallel) {
+        record_parallel_pass(framegraph, pass, framebuffer, cmd, frame->numWorkerPools, frame->workerPools);
+    } else {
+        if (anyPipeline) {
+            begin_pass_state(pass, cmd);
+            if (pass->config.execFn) {
+                pass->config.execFn(cmd, pass->config.dataPtr);
+            } else if (pass->config.parallelExecFn) {
+                pass->config.parallelExecFn(cmd, 0, 1, pass->config.dataPtr);
+            }
+        }
+    }
+
+    if (passIndex + 1 < framegraph->numOrderedPasses && framegraph->orderedPasses[passIndex + 1]->subpass > 0) return;
+    if (owner->dynamicRendering) {
+        vkCmdEndRendering(cmd);
+    } else {
+        vkCmdEndRenderPass(cmd);
+    }
+    if (framegraph->profiler) {
+        framegraph_profiler_end(framegraph->profiler, cmd, frame->frameIndex, owner->profileSlot);
+    }
+    signal_split_barriers(framegraph, passIndex, cmd, frame->frameIndex, frame->imageIndex);
+}
+
+VkCommandBuffer record_submission(framegraph_framegraph* framegraph, vulkan_context* ctx, framegraph_submission* submission, bool last, framegraph_frame* frame) {
+    VkCommandBuffer cmd = vulkan_command_pool_next_buffer(frame->pools[submission->queue], VK_COMMAND_BUFFER_LEVEL_PRIMARY);
+
+    VkCommandBufferBeginInfo beginInfo;
+    CLEAR_MEMORY(&beginInfo);
+    beginInfo.sType = VK_STRUCTURE_TYPE_COMMAND_BUFFER_BEGIN_INFO;
+    beginInfo.flags = VK_COMMAND_BUFFER_USAGE_ONE_TIME_SUBMIT_BIT;
+    VkResult result = vkBeginCommandBuffer(cmd, &beginInfo);
+    if (result != VK_SUCCESS) {
+        FATAL("Vulkan command buffer begin failed with error code: %d", result);
+    }
+
+    record_barrier_batch(framegraph, &submission->acquires, cmd, frame->imageIndex);
+    for (u32 i = submission->firstPass; i < submission->firstPass + submission->numPasses; i++) {
+        framegraph_pass* pass = framegraph->orderedPasses[i];
+        if (pass->config.compute) {
+            record_compute_pass(framegraph, pass, i, cmd, frame);
+        } else {
+            record_graphics_pass(framegraph, ctx, pass, i, cmd, frame);
+        }
+    }
+    record_barrier_batch(framegraph, &submission->releases, cmd, frame->imageIndex);
+    if (last) {
+        record_barrier_batch(framegraph, &framegraph->finalBarriers, cmd, frame->imageIndex);
+    }
+
+    result = vkEndCommandBuffer(cmd);
+    if (result != VK_SUCCESS) {
+        FATAL("Vulkan command buffer end failed with error code: %d", result);
+    }
+    return cmd;
+}
+
+VkSemaphoreSubmitInfo get_semaphore_submit_info(VkSemaphore semaphore, u64 value, VkPipelineStageFlags2 stages) {
+    VkSemaphoreSubmitInfo info;
+    CLEAR_MEMORY(&info);
+    info.sType = VK_STRUCTURE_TYPE_SEMAPHORE_SUBMIT_INFO;
+    info.semaphore = semaphore;
+    info.value = value;
+    info.stageMask = stages;
+    return info;
+}
+
+// Each submission signals its queue's timeline, and waits on the other queue's at the value of the submission it depends on
+// Between frames, the first compute submission waits for the previous frame's graphics and the last graphics submission for all of this frame's compute
+void framegraph_submit(framegraph_framegraph* framegraph, vulkan_context* ctx, framegraph_frame* frame) {
+    if (framegraph->profiler) {
+        framegraph_profiler_collect(framegraph->profiler, frame->frameIndex);
+    }
+
+    u64 bases[FRAMEGRAPH_QUEUE_COUNT];
+    memcpy(bases, framegraph->timelineValues, sizeof(bases));
+    bool timelines = framegraph->timelines[FRAMEGRAPH_QUEUE_GRAPHICS] != VK_NULL_HANDLE;
+
+    bool waitedForImage = false;
+    for (u32 i = 0; i < framegraph->numSubmissions; i++) {
+        framegraph_submission* submission = &framegraph->submissions[i];
+        framegraph_queue other = submission->queue == FRAMEGRAPH_QUEUE_GRAPHICS ? FRAMEGRAPH_QUEUE_COMPUTE : FRAMEGRAPH_QUEUE_GRAPHICS;
+        bool last = i == framegraph->numSubmissions - 1;
+
+        VkCommandBufferSubmitInfo cmdInfo;
+        CLEAR_MEMORY(&cmdInfo);
+        cmdInfo.sType = VK_STRUCTURE_TYPE_COMMAND_BUFFER_SUBMIT_INFO;
+        cmdInfo.commandBuffer = record_submission(framegraph, ctx, submission, last, frame);
+
+        u32 numWaits = 0;
+        VkSemaphoreSubmitInfo waits[2];
+        u32 numSignals = 0;
+        VkSemaphoreSubmitInfo signals[2];
+        if (submission->queue == FRAMEGRAPH_QUEUE_GRAPHICS && !waitedForImage) {
+            waits[numWaits++] = get_semaphore_submit_info(frame->imageAvailable, 0, VK_PIPELINE_STAGE_2_COLOR_ATTACHMENT_OUTPUT_BIT);
+            waitedForImage = true;
+        }
+        if (timelines) {
+            // Only the highest value matters since a timeline passing it has passed every lower one too
+            u64 waitValue = 0;
+            VkPipelineStageFlags2 waitStages = submission->waitStages;
+            if (submission->waitSubmission != UINT32_MAX) {
+                waitValue = bases[other] + framegraph->submissions[submission->waitSubmission].queueIndex + 1;
+            }
+            if (submission->queue == FRAMEGRAPH_QUEUE_COMPUTE && submission->queueIndex == 0 && bases[other] > waitValue) {
+                waitValue = bases[other];
+                waitStages = VK_PIPELINE_STAGE_2_ALL_COMMANDS_BIT;
+            }
+            if (last && bases[other] + framegraph->numQueueSubmissions[other] > waitValue) {
+                waitValue = bases[other] + framegraph->numQueueSubmissions[other];
+                waitStages = VK_PIPELINE_STAGE_2_ALL_COMMANDS_BIT;
+            }
+            if (waitValue > 0) {
+                waits[numWaits++] = get_semaphore_submit_info(framegraph->timelines[other], waitValue, waitStages);
+            }
+            signals[numSignals++] = get_semaphore_submit_info(framegraph->timelines[submission->queue], bases[submission->queue] + submission->queueIndex + 1, VK_PIPELINE_STAGE_2_ALL_COMMANDS_BIT);
+        }
+        if (last) {
+            signals[numSignals++] = get_semaphore_submit_info(frame->renderFinished, 0, VK_PIPELINE_STAGE_2_ALL_COMMANDS_BIT);
+        }
+
+        VkSubmitInfo2 submitInfo;
+        CLEAR_MEMORY(&submitInfo);
+        submitInfo.sType = VK_STRUCTURE_TYPE_SUBMIT_INFO_2;
+        submitInfo.waitSemaphoreInfoCount = numWaits;
+        submitInfo.pWaitSemaphoreInfos = waits;
+        submitInfo.commandBufferInfoCount = 1;
+        submitInfo.pCommandBufferInfos = &cmdInfo;
+        submitInfo.signalSemaphoreInfoCount = numSignals;
+        submitInfo.pSignalSemaphoreInfos = signals;
+        VkQueue queue = submission->queue == FRAMEGRAPH_QUEUE_COMPUTE ? ctx->device->compute : ctx->device->graphics;
+        VkResult result = vkQueueSubmit2(queue, 1, &submitInfo, last ? frame->fence : VK_NULL_HANDLE);
+        if (result != VK_SUCCESS) {
+            FATAL("Vulkan queue submit failed with error code: %d", result);
+        }
+    }
+
+    for (u32 i = 0; i < FRAMEGRAPH_QUEUE_COUNT; i++) {
+        framegraph->timelineValues[i] += framegraph->numQueueSubmissions[i];
+    }
+}
+
+const char* get_queue_name(framegraph_queue queue) {
+    return queue == FRAMEGRAPH_QUEUE_COMPUTE ? "compute" : "graphics";
+}
+
+// A graphics pass overlaps an async compute submission when it's in a graphics submission that the compute one neither waits on nor is waited on by
+// Overlapping passes are marked with a star
+void framegraph_log_timeline(framegraph_framegraph* framegraph) {
+    framegraph_queue_stats* stats = &framegraph->queueStats;
+    stats->numSubmissions = framegraph->numSubmissions;
+    stats->numAsyncPasses = 0;
+    stats->numOverlapped = 0;
+    bool* overlapped = malloc(sizeof(bool) * (framegraph->numOrderedPasses > 0 ? framegraph->numOrderedPasses : 1));
+    CLEAR_MEMORY_ARRAY(overlapped, framegraph->numOrderedPasses);
+
+    for (u32 i = 0; i < framegraph->numSubmissions; i++) {
+        framegraph_submission* submission = &framegraph->submissions[i];
+        if (submission->queue != FRAMEGRAPH_QUEUE_COMPUTE) continue;
+        stats->numAsyncPasses += submission->numPasses;
+
+        // The last submission always waits on every compute submission
+        u32 start = submission->waitSubmission == UINT32_MAX ? 0 : submission->waitSubmission + 1;
+        u32 end = framegraph->numSubmissions - 1;
+        for (u32 j = i + 1; j < framegraph->numSubmissions; j++) {
+            u32 wait = framegraph->submissions[j].waitSubmission;
+            if (wait != UINT32_MAX && wait >= i) {
+                end = j;
+                break;
+            }
+        }
+        for (u32 j = start; j < end; j++) {
+            framegraph_submission* graphics = &framegraph->submissions[j];
+            if (graphics->queue != FRAMEGRAPH_QUEUE_GRAPHICS) continue;
+            for (u32 k = graphics->firstPass; k < graphics->firstPass + graphics->numPasses; k++) {
+                overlapped[k] = true;
+            }
+        }
+    }
+    for (u32 i = 0; i < framegraph->numOrderedPasses; i++) {
+        if (overlapped[i]) stats->numOverlapped++;
+    }
+
+    INFO("Framegraph timeline: %d submissions, %d async compute passes, %d graphics passes can overlap them, %d ownership transfers",
+        stats->numSubmissions, stats->numAsyncPasses, stats->numOverlapped, stats->numOwnershipTransfers);
+    for (u32 i = 0; i < framegraph->numSubmissions; i++) {
+        framegraph_submission* submission = &framegraph->submissions[i];
+        char line[512];
+        u32 length = snprintf(line, sizeof(line), "  %-8s %d |", get_queue_name(submission->queue), submission->queueIndex);
+        for (u32 j = submission->firstPass; j < submission->firstPass + submission->numPasses && length < sizeof(line); j++) {
+            length += snprintf(line + length, sizeof(line) - length, " %s%s", get_pass_name(framegraph->orderedPasses[j]), overlapped[j] ? "*" : "");
+        }
+        if (submission->waitSubmission != UINT32_MAX && length < sizeof(line)) {
+            framegraph_submission* wait = &framegraph->submissions[submission->waitSubmission];
+            snprintf(line + length, sizeof(line) - length, " (waits on %s %d)", get_queue_name(wait->queue), wait->queueIndex);
+        }
+        INFO("%s", line);
+    }
+    free(overlapped);
+}
+
+static const char* statisticNames[FRAMEGRAPH_STATISTIC_COUNT] = {
+    "vertexInvocations", "clippingInvocations", "clippingPrimitives", "fragmentInvocations"
+};
+
+bool framegraph_get_pass_timing(framegraph_pass* pass, framegraph_pass_timing* timing) {
+    if (pass->framegraph->profiler == NULL) {
+        CLEAR_MEMORY(timing);
+        return false;
+    }
+    return framegraph_profiler_get_timing(pass->framegraph->profiler, pass->index, timing);
+}
+
+void framegraph_log_timings(framegraph_framegraph* framegraph) {
+    if (framegraph->profiler == NULL) return;
+
+    INFO("Framegraph GPU timings over the last %d frames:", FRAMEGRAPH_PROFILER_HISTORY);
+    for (u32 i = 0; i < framegraph->numOrderedPasses; i++) {
+        framegraph_pass* pass = framegraph->orderedPasses[i];
+        if (pass->subpass > 0) {
+            INFO("  %-24s merged into %s", get_pass_name(pass), get_pass_name(pass->owner));
+            continue;
+        }
+
+        framegraph_pass_timing timing;
+        if (!framegraph_get_pass_timing(pass, &timing)) {
+            INFO("  %-24s not measured yet", get_pass_name(pass));
+            continue;
+        }
+        char line[512];
+        u32 length = snprintf(line, sizeof(line), "  %-24s avg %.3f ms, p50 %.3f, p95 %.3f, p99 %.3f, max %.3f",
+            get_pass_name(pass), timing.averageMs, timing.p50Ms, timing.p95Ms, timing.p99Ms, timing.maxMs);
+        if (timing.numStatisticSamples > 0 && length < sizeof(line)) {
+            snprintf(line + length, sizeof(line) - length, " | %.0f vertices, %.0f primitives clipped into %.0f, %.0f fragments",
+                timing.statistics[FRAMEGRAPH_STATISTIC_VERTEX_INVOCATIONS], timing.statistics[FRAMEGRAPH_STATISTIC_CLIPPING_INVOCATIONS],
+                timing.statistics[FRAMEGRAPH_STATISTIC_CLIPPING_PRIMITIVES], timing.statistics[FRAMEGRAPH_STATISTIC_FRAGMENT_INVOCATIONS]);
+        }
+        INFO("%s", line);
+    }
+}
+
+void framegraph_dump_timings_json(framegraph_framegraph* framegraph, const char* path) {
+    cJSON* root = cJSON_CreateObject();
+    cJSON_AddNumberToObject(root, "history", FRAMEGRAPH_PROFILER_HISTORY);
+    cJSON_AddBoolToObject(root, "profiling", framegraph->profiler != NULL);
+
+    cJSON* passes = cJSON_AddArrayToObject(root, "passes");
+    for (u32 i = 0; i < framegraph->numOrderedPasses; i++) {
+        framegraph_pass* pass = framegraph->orderedPasses[i];
+        cJSON* entry = cJSON_CreateObject();
+        cJSON_AddStringToObject(entry, "name", get_pass_name(pass));
+        cJSON_AddNumberToObject(entry, "declared", pass->index);
+        cJSON_AddStringToObject(entry, "queue", get_queue_name(pass->queue));
+        if (pass->subpass > 0) {
+            cJSON_AddStringToObject(entry, "mergedInto", get_pass_name(pass->owner));
+        }
+
+        framegraph_pass_timing timing;
+        framegraph_get_pass_timing(pass, &timing);
+        cJSON_AddNumberToObject(entry, "samples", timing.numSamples);
+        cJSON_AddNumberToObject(entry, "averageMs", timing.averageMs);
+        cJSON_AddNumberToObject(entry, "p50Ms", timing.p50Ms);
+        cJSON_AddNumberToObject(entry, "p95Ms", timing.p95Ms);
+        cJSON_AddNumberToObject(entry, "p99Ms", timing.p99Ms);
+        cJSON_AddNumberToObject(entry, "maxMs", timing.maxMs);
+        if (timing.numStatisticSamples > 0) {
+            cJSON* statistics = cJSON_AddObjectToObject(entry, "statistics");
+            for (u32 j = 0; j < FRAMEGRAPH_STATISTIC_COUNT; j++) {
+                cJSON_AddNumberToObject(statistics, statisticNames[j], timing.statistics[j]);
+            }
+        }
+        cJSON_AddItemToArray(passes, entry);
+    }
+
+    char* text = cJSON_Print(root);
+    FILE* file = fopen(path, "w");
+    if (file == NULL) {
+        ERROR("Could not open file: %s", path);
+    } else {
+        fputs(text, file);
+        fclose(file);
+        INFO("Wrote framegraph timings to %s", path);
+    }
+
+    cJSON_free(text);
+    cJSON_Delete(root);
 }
\ No newline at end of file
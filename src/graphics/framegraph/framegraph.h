@@ -4,6 +4,21 @@
 #include "graphics/vulkan/shader.h"
 #include "graphics/vulkan/descriptor.h"
 #include "graphics/vulkan/pipeline.h"
+#include "graphics/vulkan/renderpass.h"
+#include "graphics/vulkan/image.h"
+#include "graphics/vulkan/pso.h"
+
+#include "core/hashmap.h"
+
+#include "transient.h"
+#include "profiler.h"
+
+// The image that is swapped for the current swapchain image when recording
+#define FRAMEGRAPH_BACKBUFFER "backbuffer"
+
+// Images are referred to by the handle framegraph_add_image returns, zero is never handed out so a cleared config uses no images
+typedef u32 framegraph_image_handle;
+#define FRAMEGRAPH_NO_IMAGE 0
 
 typedef struct framegraph_pass_t framegraph_pass;
 typedef struct framegraph_image_t framegraph_image;
@@ -14,65 +29,310 @@ typedef struct {
     vulkan_shader* fragment;
 } framegraph_pass_shaders;
 
+typedef enum {
+    FRAMEGRAPH_QUEUE_GRAPHICS,
+    FRAMEGRAPH_QUEUE_COMPUTE, // Only used when the device has a compute family separate from graphics
+    FRAMEGRAPH_QUEUE_COUNT
+} framegraph_queue;
+
+// How a pass uses an image, the barrier before the pass goes from the image's previous state to this one
+typedef struct {
+    VkPipelineStageFlags2 stages;
+    VkAccessFlags2 access;
+    VkImageLayout layout;
+} framegraph_image_state;
+
+// Recorded together in one vkCmdPipelineBarrier2, the backbuffer's VkImage is only filled in when recording
+typedef struct {
+    u32 numBarriers;
+    VkImageMemoryBarrier2* barriers;
+    framegraph_image** images;
+} framegraph_barrier_batch;
+
+// For a source pass that finished more than one pass earlier, the event is set straight after it so the passes in between aren't held up
+typedef struct {
+    u32 signalPass;
+    u32 waitPass;
+    framegraph_barrier_batch batch;
+    u32 numEvents;
+    VkEvent* events; // One per frame in flight, since a frame's wait may still be pending when the next frame would set it
+} framegraph_split_barrier;
+
+typedef struct {
+    u32 numBatches;
+    u32 numBarriers;
+    u32 numSplit;
+    u32 numElided; // Reads after reads in the same layout, which need nothing
+    u32 numInRenderpass; // Between subpasses of a merged render pass, its subpass dependencies cover them
+    u32 numFullStalls; // Barriers waiting on or blocking every stage, should stay at zero
+} framegraph_barrier_stats;
+
+// A run of consecutive passes on one queue, recorded into its own command buffer and submitted on its own
+typedef struct {
+    framegraph_queue queue;
+    u32 firstPass;
+    u32 numPasses;
+    u32 queueIndex; // Among the submissions on the same queue, it signals that queue's timeline with the frame's base plus this plus one
+    u32 waitSubmission; // The latest submission on the other queue it has to wait for, UINT32_MAX if none
+    VkPipelineStageFlags2 waitStages;
+    framegraph_barrier_batch acquires; // Images taken over from the other queue, before the first pass
+    framegraph_barrier_batch releases; // Images handed over to the other queue, after the last pass
+} framegraph_submission;
+
+// How a pass begins rendering without a renderpass, the backbuffer's views are only filled in when recording
+typedef struct {
+    u32 numColorAttachments;
+    VkRenderingAttachmentInfo* colorAttachments; // The first one resolves into resolveImage, if the pass has one
+    framegraph_image** colorImages;
+    framegraph_image* resolveImage;
+    bool depthBuffered;
+    VkRenderingAttachmentInfo depthAttachment;
+    vulkan_rendering_formats formats; // What its pipelines and secondary command buffers are built against
+} framegraph_rendering;
+
+typedef struct {
+    u32 numSubmissions;
+    u32 numAsyncPasses;
+    u32 numOverlapped; // Graphics passes that nothing orders against an async compute submission, so they can run alongside it
+    u32 numOwnershipTransfers;
+} framegraph_queue_stats;
+
 typedef struct {
+    const char* name; // Only used when reporting the schedule
+    // Copied when the pass is declared, so the arrays only have to live until then
     u32 numInputs;
-    const char* inputs[256];
+    const framegraph_image_handle* inputs;
     u32 numOutputs;
-    const char* outputs[256];
-    const char* depth;
-    const char* resolve;
+    const framegraph_image_handle* outputs;
+    framegraph_image_handle depth;
+    framegraph_image_handle resolve;
+    // The inputs are read with subpassLoad at the pixel being shaded rather than sampled, so they're bound as input attachments
+    // and the pass can be merged into the render pass of the passes writing them
+    bool attachmentInputs;
+    // Recorded by execFn outside of any render pass, the outputs are written as storage images and the inputs sampled
+    bool compute;
+    // Lets a compute pass run on the async compute queue alongside graphics work, when the device has one
+    bool asyncCompute;
 
     framegraph_pass_shaders shaders;
+    u32 numSetLayouts;
+    vulkan_descriptor_set_layout** setLayouts;
+    u32 numPushConstantRanges;
+    VkPushConstantRange* pushConstantRanges;
+
+    // Set as dynamic state when the pass is recorded so the same pipeline can be shared between passes
+    VkCullModeFlags cullMode;
+    bool depthTest;
+    bool depthWrite;
+
+    // One pipeline is built per specialization, the pass then leaves binding to execFn which picks them with framegraph_pass_get_pipeline
+    // These must outlive the framegraph
+    u32 numVariants;
+    VkSpecializationInfo* variants;
 
     void* dataPtr;
+    // Recorded before the render pass begins, for work like compute dispatches that can't happen inside it
+    void(*prepareFn)(VkCommandBuffer, void*);
     void(*execFn)(VkCommandBuffer, void*);
+    // Set instead of execFn to record the pass across the worker threads, each job gets its own secondary command buffer
+    // and they are executed in job order, so the result is the same as recording it serially
+    void(*parallelExecFn)(VkCommandBuffer cmd, u32 job, u32 numJobs, void* dataPtr);
 } framegraph_pass_config;
 
 typedef struct framegraph_pass_t {
     framegraph_framegraph* framegraph;
     framegraph_pass_config config;
+    u32 index; // In declaration order
+    framegraph_queue queue;
+    u32 submission;
+    framegraph_image_handle* handles; // The config's inputs then outputs, which it points into
+
+    // Resolved from the config's handles when the pass is declared, into the framegraph's links
+    // Declaring more passes can move the links, so the pointers are only set by the compile
+    u32 firstLink;
+    u32 numReadImages;
+    framegraph_image** readImages;
+    u32 numWriteImages;
+    framegraph_image** writeImages;
     
+    // Reflected from the shaders when the config doesn't give set layouts
     u32 numDescriptorLayouts;
     vulkan_descriptor_set_layout** descriptorLayouts;
-    vulkan_pipeline pipeline;
+    u32 numPushConstantRanges;
+    VkPushConstantRange pushConstantRange;
+
+    u32 width;
+    u32 height;
+    VkSampleCountFlagBits samples;
+    // Passes merged into an earlier pass's render pass share its renderpass and record as a later subpass of it
+    framegraph_pass* owner; // The pass beginning the render pass, itself if it wasn't merged
+    u32 subpass;
+    vulkan_renderpass* renderpass;
+    u32 numFramebuffers; // One per swapchain image if the pass renders to the backbuffer, none for merged passes or with dynamic rendering
+    vulkan_framebuffer** framebuffers;
+    // Begun with vkCmdBeginRendering instead, only ever for passes nothing was merged into
+    bool dynamicRendering;
+    framegraph_rendering rendering;
+    u32 numPsos; // One per variant, or just one when the pass has none
+    vulkan_pso** psos;
+    vulkan_pso** fallbacks; // The previous pipelines, drawn with while a reloaded shader compiles
+    vulkan_pipeline** pipelines; // Resolved from the psos each time the pass is recorded, NULL while still compiling
+    framegraph_barrier_batch barriers; // Recorded before the pass begins
+    u32 profileSlot; // UINT32_MAX when not profiled, merged passes are measured along with the pass they were merged into
 } framegraph_pass;
 
 typedef struct framegraph_image_t {
     framegraph_framegraph* framegraph;
-    const char* name;
+    framegraph_image_handle handle;
+    char* name; // Owned by the image
 
     u32 width;
     u32 height;
     VkFormat format;
     bool multisampled;
+    vulkan_image* image; // NULL for the backbuffer
+
+    // Indices into the ordered passes, an image that no ordered pass uses gets no memory
+    u32 firstUse;
+    u32 lastUse;
+    VkMemoryRequirements requirements;
+    u32 block;
+    u64 offset;
+    bool tileOnly; // Only used inside one render pass, so it's never stored and can be lazily allocated
+    bool storage; // Written by a compute pass
+    // Used on the async compute queue, which doesn't run in pass order with graphics, so its memory isn't shared with anything
+    bool asyncQueue;
 
-    framegraph_pass* write;
-    u32 numReads;
-    framegraph_pass* reads[256];
+    framegraph_pass* write; // The first pass to write it, later ones using it depend on this one
+    bool exported; // Keeps the passes writing it alive even though nothing in the graph reads it
 } framegraph_image;
 
 typedef struct {
     u32 width;
     u32 height;
     VkSampleCountFlags maxSamples;
+    u32 framesInFlight;
+    // Times every pass on the GPU, pipeline statistics are only counted for graphics passes and only while profiling
+    bool profile;
+    bool pipelineStatistics;
+    // Begins render passes with vkCmdBeginRendering instead of creating renderpasses and framebuffers for them, when the device can
+    // Merged passes and passes reading attachment inputs still get a renderpass, since only subpasses can read attachments in place
+    bool dynamicRendering;
 } framegraph_config;
 
+typedef struct {
+    u64 unaliasedSize; // What the transient images would take with an allocation each
+    u64 aliasedSize;
+    u32 numBlocks;
+} framegraph_memory_stats;
+
+typedef struct {
+    framegraph_pass* pass;
+    vulkan_framebuffer* framebuffer; // NULL with dynamic rendering
+    vulkan_command_pool* pool;
+    u32 job;
+    u32 numJobs;
+    VkCommandBuffer cmd;
+} framegraph_record_job;
+
 typedef struct framegraph_framegraph_t {
     framegraph_config config;
 
     u32 numImages;
-    framegraph_image* images[256];
+    framegraph_image** images; // Indexed by handle minus one
+    hashmap* imageNames; // From the hash of each name to its image, only used when declaring
+    framegraph_image_handle backbuffer;
 
     u32 numPasses;
-    framegraph_pass* passes[256];
+    framegraph_pass** passes;
+    // What every pass reads then writes, back to back in declaration order
+    u32 numLinks;
+    u32 linkCapacity;
+    framegraph_image** links;
+
+    // The declaration above is compiled into everything below, and only compiled again when its hash changes
+    bool compiled;
+    u64 compiledHash;
+    vulkan_context* ctx;
+    u32 numOrderedPasses;
+    framegraph_pass** orderedPasses; // Dependencies first, passes that don't lead to the backbuffer or an exported image are culled
+    u32 numCulledPasses;
+    u32 numMergedPasses;
+    framegraph_transient_pool* transientPool;
+    framegraph_memory_stats memoryStats;
+
+    u32 numSplitBarriers;
+    framegraph_split_barrier* splitBarriers;
+    framegraph_barrier_batch finalBarriers; // Hands the backbuffer over to presentation
+    framegraph_barrier_stats barrierStats;
+
+    u32 numSubmissions;
+    framegraph_submission* submissions;
+    u32 numQueueSubmissions[FRAMEGRAPH_QUEUE_COUNT];
+    VkSemaphore timelines[FRAMEGRAPH_QUEUE_COUNT]; // Only created when the plan has more than one submission
+    u64 timelineValues[FRAMEGRAPH_QUEUE_COUNT]; // Reached once everything submitted so far has finished
+    framegraph_queue_stats queueStats;
+
+    framegraph_profiler* profiler; // Created by the first plan that profiles, its histories carry over between compiles
+
+    job_group* recordGroup;
+    u32 numRecordJobs;
+    framegraph_record_job* recordJobs;
+    VkCommandBuffer* recordBuffers;
 } framegraph_framegraph;
 
+// What a frame is recorded with and how its submissions fit around presenting
+typedef struct {
+    vulkan_command_pool* pools[FRAMEGRAPH_QUEUE_COUNT]; // Primary buffers for each queue's submissions, both can be the same graphics pool
+    // Parallel passes record one job per worker pool, the pools must be reset by the caller once the frame has finished on the GPU
+    u32 numWorkerPools;
+    vulkan_command_pool** workerPools;
+    // Picks the events split barriers use and the profiler's queries, so it has to be below the config's framesInFlight
+    // and the fence of the frame that last used it has to have signalled
+    u32 frameIndex;
+    u32 imageIndex;
+    VkSemaphore imageAvailable; // Waited on by the first graphics submission
+    VkSemaphore renderFinished; // Signalled by the last graphics submission, along with the fence
+    VkFence fence;
+} framegraph_frame;
+
+// Declared once, then compiled by framegraph_update and replayed every frame
 framegraph_framegraph* framegraph_create(framegraph_config config);
 void framegraph_destroy(framegraph_framegraph* framegraph);
+// A new size or sample count is picked up by the next update
+void framegraph_set_config(framegraph_framegraph* framegraph, framegraph_config config);
+// Makes the next update compile even though the declaration hasn't changed, for when the swapchain images were replaced
+void framegraph_invalidate(framegraph_framegraph* framegraph);
 
-void framegraph_add_image(framegraph_framegraph* framegraph, const char* name, VkFormat format, bool multisampled);
-void framegraph_add_pass(framegraph_framegraph* framegraph, framegraph_pass_config config);
+// The name is copied, declaring FRAMEGRAPH_BACKBUFFER gives the image standing in for the swapchain
+framegraph_image_handle framegraph_add_image(framegraph_framegraph* framegraph, const char* name, VkFormat format, bool multisampled);
+// FRAMEGRAPH_NO_IMAGE if no image has the name
+framegraph_image_handle framegraph_find_image(framegraph_framegraph* framegraph, const char* name);
+// NULL for FRAMEGRAPH_NO_IMAGE or a handle from another framegraph
+framegraph_image* framegraph_get_image(framegraph_framegraph* framegraph, framegraph_image_handle handle);
+// For images read outside the graph, the passes writing them are kept even though no pass reads them
+void framegraph_export_image(framegraph_framegraph* framegraph, framegraph_image_handle handle);
+framegraph_pass* framegraph_add_pass(framegraph_framegraph* framegraph, framegraph_pass_config config);
+// Only valid while the pass is being recorded
+vulkan_pipeline* framegraph_pass_get_pipeline(framegraph_pass* pass, u32 variant);
+// Replaces the pass's declaration, the pass itself stays valid
+void framegraph_set_pass_config(framegraph_pass* pass, framegraph_pass_config config);
 
+// Covers everything the compiled plan is built from, the size and sample count, the images and how passes use them
+u64 framegraph_hash(framegraph_framegraph* framegraph);
+// Compiles the pass order, images, renderpasses and pipelines if the hash changed since the last compile, returns whether it did
+// Waits for the device to go idle before releasing the previous plan
+bool framegraph_update(framegraph_framegraph* framegraph, vulkan_context* ctx);
+// Only the scheduling part of a compile, culling and ordering the passes, framegraph_update already calls it
 void framegraph_compile(framegraph_framegraph* framegraph);
-void framegraph_create_resources(framegraph_framegraph* framegraph, vulkan_context* ctx);
-VkCommandBuffer framegraph_record(framegraph_framegraph* framegraph, vulkan_context* ctx);
+void framegraph_log_schedule(framegraph_framegraph* framegraph);
+// Requests new pipelines for every pass using the shader, the old ones keep drawing until they are ready
+void framegraph_reload_shader(framegraph_framegraph* framegraph, vulkan_shader* shader);
+void framegraph_log_timeline(framegraph_framegraph* framegraph);
+// Rolling GPU timings, false until the pass has been measured or if it was merged into another pass's render pass
+bool framegraph_get_pass_timing(framegraph_pass* pass, framegraph_pass_timing* timing);
+void framegraph_log_timings(framegraph_framegraph* framegraph);
+void framegraph_dump_timings_json(framegraph_framegraph* framegraph, const char* path);
+// Records every submission of the plan and submits them to their queues, the last graphics one waits on all compute work
+// so the fence covers the whole frame
+void framegraph_submit(framegraph_framegraph* framegraph, vulkan_context* ctx, framegraph_frame* frame);
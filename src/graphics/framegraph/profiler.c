@@ -0,0 +1,212 @@
+#include "profiler.h"
+
+#include "core/sort.h"
+
+#include <math.h>
+
+// Results are written in bit order, which is the order of framegraph_statistic
+#define FRAMEGRAPH_STATISTIC_FLAGS (VK_QUERY_PIPELINE_STATISTIC_VERTEX_SHADER_INVOCATIONS_BIT | VK_QUERY_PIPELINE_STATISTIC_CLIPPING_INVOCATIONS_BIT | VK_QUERY_PIPELINE_STATISTIC_CLIPPING_PRIMITIVES_BIT | VK_QUERY_PIPELINE_STATISTIC_FRAGMENT_SHADER_INVOCATIONS_BIT)
+
+framegraph_profiler* framegraph_profiler_create(vulkan_context* ctx, u32 numFrames) {
+    framegraph_profiler* profiler = malloc(sizeof(framegraph_profiler));
+    CLEAR_MEMORY(profiler);
+    profiler->ctx = ctx;
+    profiler->numFrames = numFrames;
+    profiler->statisticFlags = ctx->physical->features.pipelineStatisticsQuery ? FRAMEGRAPH_STATISTIC_FLAGS : 0;
+    profiler->timestampPeriod = ctx->physical->properties.limits.timestampPeriod;
+    profiler->slots = malloc(0);
+    profiler->timestampPools = malloc(sizeof(VkQueryPool) * numFrames);
+    profiler->statisticsPools = malloc(sizeof(VkQueryPool) * numFrames);
+    profiler->pending = malloc(sizeof(bool) * numFrames);
+    for (u32 i = 0; i < numFrames; i++) {
+        profiler->timestampPools[i] = VK_NULL_HANDLE;
+        profiler->statisticsPools[i] = VK_NULL_HANDLE;
+        profiler->pending[i] = false;
+    }
+    profiler->histories = malloc(0);
+
+    return profiler;
+}
+
+void destroy_profiler_pools(framegraph_profiler* profiler) {
+    for (u32 i = 0; i < profiler->numFrames; i++) {
+        if (profiler->timestampPools[i] != VK_NULL_HANDLE) {
+            vkDestroyQueryPool(profiler->ctx->device->device, profiler->timestampPools[i], NULL);
+            profiler->timestampPools[i] = VK_NULL_HANDLE;
+        }
+        if (profiler->statisticsPools[i] != VK_NULL_HANDLE) {
+            vkDestroyQueryPool(profiler->ctx->device->device, profiler->statisticsPools[i], NULL);
+            profiler->statisticsPools[i] = VK_NULL_HANDLE;
+        }
+        profiler->pending[i] = false;
+    }
+}
+
+void framegraph_profiler_destroy(framegraph_profiler* profiler) {
+    destroy_profiler_pools(profiler);
+    free(profiler->slots);
+    free(profiler->timestampPools);
+    free(profiler->statisticsPools);
+    free(profiler->pending);
+    free(profiler->histories);
+    free(profiler);
+}
+
+VkQueryPool create_profiler_pool(framegraph_profiler* profiler, VkQueryType type, u32 numQueries, VkQueryPipelineStatisticFlags statistics) {
+    VkQueryPoolCreateInfo createInfo;
+    CLEAR_MEMORY(&createInfo);
+    createInfo.sType = VK_STRUCTURE_TYPE_QUERY_POOL_CREATE_INFO;
+    createInfo.queryType = type;
+    createInfo.queryCount = numQueries;
+    createInfo.pipelineStatistics = statistics;
+
+    VkQueryPool pool;
+    VkResult result = vkCreateQueryPool(profiler->ctx->device->device, &createInfo, NULL, &pool);
+    if (result != VK_SUCCESS) {
+        FATAL("Vulkan query pool creation failed with error code: %d", result);
+        return VK_NULL_HANDLE;
+    }
+    // Queries start out in an undefined state and have to be reset before their first use
+    vkResetQueryPool(profiler->ctx->device->device, pool, 0, numQueries);
+    return pool;
+}
+
+void framegraph_profiler_set_plan(framegraph_profiler* profiler, u32 numSlots, framegraph_profiler_slot* slots) {
+    destroy_profiler_pools(profiler);
+    profiler->numSlots = numSlots;
+    profiler->slots = realloc(profiler->slots, sizeof(framegraph_profiler_slot) * numSlots);
+    memcpy(profiler->slots, slots, sizeof(framegraph_profiler_slot) * numSlots);
+
+    bool anyStatistics = false;
+    for (u32 i = 0; i < numSlots; i++) {
+        if (profiler->slots[i].pass >= profiler->numHistories) {
+            u32 numHistories = profiler->slots[i].pass + 1;
+            u32 numAdded = numHistories - profiler->numHistories;
+            profiler->histories = realloc(profiler->histories, sizeof(framegraph_pass_history) * numHistories);
+            CLEAR_MEMORY_ARRAY(&profiler->histories[profiler->numHistories], numAdded);
+            profiler->numHistories = numHistories;
+        }
+        profiler->slots[i].statistics &= profiler->statisticFlags != 0;
+        anyStatistics |= profiler->slots[i].statistics;
+    }
+    if (numSlots == 0) return;
+
+    for (u32 i = 0; i < profiler->numFrames; i++) {
+        profiler->timestampPools[i] = create_profiler_pool(profiler, VK_QUERY_TYPE_TIMESTAMP, numSlots * 2, 0);
+        if (anyStatistics) {
+            profiler->statisticsPools[i] = create_profiler_pool(profiler, VK_QUERY_TYPE_PIPELINE_STATISTICS, numSlots, profiler->statisticFlags);
+        }
+    }
+}
+
+void framegraph_profiler_collect(framegraph_profiler* profiler, u32 frameIndex) {
+    if (!profiler->pending[frameIndex]) return;
+    profiler->pending[frameIndex] = false;
+    VkDevice device = profiler->ctx->device->device;
+
+    // Each query is followed by its availability, queries that were never written this frame just stay unavailable
+    u64* timestamps = malloc(sizeof(u64) * profiler->numSlots * 4);
+    vkGetQueryPoolResults(device, profiler->timestampPools[frameIndex], 0, profiler->numSlots * 2, sizeof(u64) * profiler->numSlots * 4, timestamps, sizeof(u64) * 2, VK_QUERY_RESULT_64_BIT | VK_QUERY_RESULT_WITH_AVAILABILITY_BIT);
+    for (u32 i = 0; i < profiler->numSlots; i++) {
+        framegraph_profiler_slot* slot = &profiler->slots[i];
+        u64* results = &timestamps[i * 4];
+        if (slot->timestampBits == 0 || !results[1] || !results[3]) continue;
+
+        // Only the valid bits count, so the difference is taken modulo them in case the counter wrapped
+        u64 mask = slot->timestampBits >= 64 ? UINT64_MAX : (1ull << slot->timestampBits) - 1;
+        u64 ticks = (results[2] - results[0]) & mask;
+        framegraph_pass_history* history = &profiler->histories[slot->pass];
+        history->durations[history->nextSample] = (u64)((double)ticks * profiler->timestampPeriod);
+        history->nextSample = (history->nextSample + 1) % FRAMEGRAPH_PROFILER_HISTORY;
+        if (history->numSamples < FRAMEGRAPH_PROFILER_HISTORY) history->numSamples++;
+    }
+    free(timestamps);
+    vkResetQueryPool(device, profiler->timestampPools[frameIndex], 0, profiler->numSlots * 2);
+
+    if (profiler->statisticsPools[frameIndex] == VK_NULL_HANDLE) return;
+    u32 stride = FRAMEGRAPH_STATISTIC_COUNT + 1;
+    u64* statistics = malloc(sizeof(u64) * profiler->numSlots * stride);
+    vkGetQueryPoolResults(device, profiler->statisticsPools[frameIndex], 0, profiler->numSlots, sizeof(u64) * profiler->numSlots * stride, statistics, sizeof(u64) * stride, VK_QUERY_RESULT_64_BIT | VK_QUERY_RESULT_WITH_AVAILABILITY_BIT);
+    for (u32 i = 0; i < profiler->numSlots; i++) {
+        u64* results = &statistics[i * stride];
+        if (!profiler->slots[i].statistics || !results[FRAMEGRAPH_STATISTIC_COUNT]) continue;
+
+        framegraph_pass_history* history = &profiler->histories[profiler->slots[i].pass];
+        memcpy(history->statistics[history->nextStatisticSample], results, sizeof(u64) * FRAMEGRAPH_STATISTIC_COUNT);
+        history->nextStatisticSample = (history->nextStatisticSample + 1) % FRAMEGRAPH_PROFILER_HISTORY;
+        if (history->numStatisticSamples < FRAMEGRAPH_PROFILER_HISTORY) history->numStatisticSamples++;
+    }
+    free(statistics);
+    vkResetQueryPool(device, profiler->statisticsPools[frameIndex], 0, profiler->numSlots);
+}
+
+// Both timestamps wait for all earlier work, so a pass's time doesn't include whatever it overlapped with
+void framegraph_profiler_begin(framegraph_profiler* profiler, VkCommandBuffer cmd, u32 frameIndex, u32 slot) {
+    if (slot >= profiler->numSlots) return;
+    profiler->pending[frameIndex] = true;
+    if (profiler->slots[slot].timestampBits > 0) {
+        vkCmdWriteTimestamp2(cmd, VK_PIPELINE_STAGE_2_ALL_COMMANDS_BIT, profiler->timestampPools[frameIndex], slot * 2);
+    }
+    if (profiler->slots[slot].statistics) {
+        vkCmdBeginQuery(cmd, profiler->statisticsPools[frameIndex], slot, 0);
+    }
+}
+
+void framegraph_profiler_end(framegraph_profiler* profiler, VkCommandBuffer cmd, u32 frameIndex, u32 slot) {
+    if (slot >= profiler->numSlots) return;
+    if (profiler->slots[slot].statistics) {
+        vkCmdEndQuery(cmd, profiler->statisticsPools[frameIndex], slot);
+    }
+    if (profiler->slots[slot].timestampBits > 0) {
+        vkCmdWriteTimestamp2(cmd, VK_PIPELINE_STAGE_2_ALL_COMMANDS_BIT, profiler->timestampPools[frameIndex], slot * 2 + 1);
+    }
+}
+
+// Nearest rank, the smallest sample at least the given fraction of samples are at or below
+void framegraph_profiler_reset_history(framegraph_profiler* profiler, u32 pass) {
+    if (pass >= profiler->numHistories) return;
+    CLEAR_MEMORY(&profiler->histories[pass]);
+}
+
+double get_profiler_percentile(u64* sorted, u32 count, double fraction) {
+    u32 rank = (u32)ceil(fraction * count);
+    if (rank < 1) rank = 1;
+    if (rank > count) rank = count;
+    return (double)sorted[rank - 1] / 1000000.0;
+}
+
+bool framegraph_profiler_get_timing(framegraph_profiler* profiler, u32 pass, framegraph_pass_timing* timing) {
+    CLEAR_MEMORY(timing);
+    if (pass >= profiler->numHistories || profiler->histories[pass].numSamples == 0) return false;
+    framegraph_pass_history* history = &profiler->histories[pass];
+
+    u64 sorted[FRAMEGRAPH_PROFILER_HISTORY];
+    u64 tempKeys[FRAMEGRAPH_PROFILER_HISTORY];
+    u32 order[FRAMEGRAPH_PROFILER_HISTORY];
+    u32 tempOrder[FRAMEGRAPH_PROFILER_HISTORY];
+    u64 total = 0;
+    for (u32 i = 0; i < history->numSamples; i++) {
+        sorted[i] = history->durations[i];
+        order[i] = i;
+        total += history->durations[i];
+    }
+    radix_sort_u64(history->numSamples, sorted, order, tempKeys, tempOrder);
+
+    timing->numSamples = history->numSamples;
+    timing->averageMs = (double)total / history->numSamples / 1000000.0;
+    timing->p50Ms = get_profiler_percentile(sorted, history->numSamples, 0.5);
+    timing->p95Ms = get_profiler_percentile(sorted, history->numSamples, 0.95);
+    timing->p99Ms = get_profiler_percentile(sorted, history->numSamples, 0.99);
+    timing->maxMs = (double)sorted[history->numSamples - 1] / 1000000.0;
+
+    timing->numStatisticSamples = history->numStatisticSamples;
+    for (u32 i = 0; i < history->numStatisticSamples; i++) {
+        for (u32 j = 0; j < FRAMEGRAPH_STATISTIC_COUNT; j++) {
+            timing->statistics[j] += (double)history->statistics[i][j];
+        }
+    }
+    for (u32 j = 0; history->numStatisticSamples > 0 && j < FRAMEGRAPH_STATISTIC_COUNT; j++) {
+        timing->statistics[j] /= history->numStatisticSamples;
+    }
+    return true;
+}
\ No newline at end of file
@@ -0,0 +1,80 @@
+#pragma once
+
+#include "core/core.h"
+#include "vulkan/vulkan.h"
+#include "graphics/vulkan/context.h"
+
+// How many of the frames a pass ran in its rolling timings cover
+#define FRAMEGRAPH_PROFILER_HISTORY 128
+
+// Counted for graphics passes when pipeline statistics are on, in the order the query writes them
+typedef enum {
+    FRAMEGRAPH_STATISTIC_VERTEX_INVOCATIONS,
+    FRAMEGRAPH_STATISTIC_CLIPPING_INVOCATIONS,
+    FRAMEGRAPH_STATISTIC_CLIPPING_PRIMITIVES,
+    FRAMEGRAPH_STATISTIC_FRAGMENT_INVOCATIONS,
+    FRAMEGRAPH_STATISTIC_COUNT
+} framegraph_statistic;
+
+// Over the last FRAMEGRAPH_PROFILER_HISTORY frames the pass was measured in
+typedef struct {
+    u32 numSamples;
+    double averageMs;
+    double p50Ms;
+    double p95Ms;
+    double p99Ms;
+    double maxMs;
+    u32 numStatisticSamples; // Zero for passes that aren't counted
+    double statistics[FRAMEGRAPH_STATISTIC_COUNT]; // Averages per frame
+} framegraph_pass_timing;
+
+typedef struct {
+    u32 numSamples;
+    u32 nextSample;
+    u64 durations[FRAMEGRAPH_PROFILER_HISTORY]; // Nanoseconds
+    u32 numStatisticSamples;
+    u32 nextStatisticSample;
+    u64 statistics[FRAMEGRAPH_PROFILER_HISTORY][FRAMEGRAPH_STATISTIC_COUNT];
+} framegraph_pass_history;
+
+// What one slot of a plan measures, a pass or a whole render pass of merged passes
+typedef struct {
+    u32 pass; // The declaration index results are kept under
+    u32 timestampBits; // Zero when the pass's queue can't write timestamps
+    bool statistics; // Ignored when the device can't count them
+} framegraph_profiler_slot;
+
+// One query pool of each kind per frame in flight, a frame's results are read once its fence has signalled so nothing waits on the GPU
+// Histories are kept by declaration index and outlive a compile, only the pools are rebuilt for a new plan
+typedef struct {
+    vulkan_context* ctx;
+    u32 numFrames;
+    VkQueryPipelineStatisticFlags statisticFlags; // Zero when the device can't count them
+    double timestampPeriod; // Nanoseconds per tick
+
+    u32 numSlots;
+    framegraph_profiler_slot* slots;
+    VkQueryPool* timestampPools; // Two queries per slot
+    VkQueryPool* statisticsPools; // One query per slot, only created with statistics
+    bool* pending; // Whether the frame has recorded queries that haven't been read yet
+
+    u32 numHistories;
+    framegraph_pass_history* histories;
+} framegraph_profiler;
+
+// The device needs host query resets, results are read and reset from the CPU
+framegraph_profiler* framegraph_profiler_create(vulkan_context* ctx, u32 numFrames);
+void framegraph_profiler_destroy(framegraph_profiler* profiler);
+
+// Drops any results still in flight, so the device has to be idle
+void framegraph_profiler_set_plan(framegraph_profiler* profiler, u32 numSlots, framegraph_profiler_slot* slots);
+// Reads the frame's previous results into the histories, only once its fence has signalled and before its slots are recorded again
+void framegraph_profiler_collect(framegraph_profiler* profiler, u32 frameIndex);
+// Outside of any render pass, statistics count everything recorded between the two
+void framegraph_profiler_begin(framegraph_profiler* profiler, VkCommandBuffer cmd, u32 frameIndex, u32 slot);
+void framegraph_profiler_end(framegraph_profiler* profiler, VkCommandBuffer cmd, u32 frameIndex, u32 slot);
+
+// Forgets the pass's samples, for when what it measures has changed
+void framegraph_profiler_reset_history(framegraph_profiler* profiler, u32 pass);
+// Returns false if the pass hasn't been measured yet
+bool framegraph_profiler_get_timing(framegraph_profiler* profiler, u32 pass, framegraph_pass_timing* timing);
\ No newline at end of file
@@ -0,0 +1,80 @@
+#include "transient.h"
+
+framegraph_transient_pool* framegraph_transient_pool_create(vulkan_context* ctx) {
+    framegraph_transient_pool* pool = malloc(sizeof(framegraph_transient_pool));
+    CLEAR_MEMORY(pool);
+    pool->ctx = ctx;
+    pool->blocks = malloc(0);
+
+    return pool;
+}
+
+void framegraph_transient_pool_destroy(framegraph_transient_pool* pool) {
+    framegraph_transient_pool_begin(pool);
+    framegraph_transient_pool_trim(pool);
+    free(pool->blocks);
+    free(pool);
+}
+
+void framegraph_transient_pool_begin(framegraph_transient_pool* pool) {
+    for (u32 i = 0; i < pool->numBlocks; i++) {
+        pool->blocks[i].claimed = false;
+    }
+}
+
+VmaAllocation framegraph_transient_pool_claim(framegraph_transient_pool* pool, VkMemoryRequirements* requirements, bool lazy) {
+    // Alignments are powers of two so a block allocated with a larger one satisfies a smaller one
+    framegraph_memory_block* best = NULL;
+    for (u32 i = 0; i < pool->numBlocks; i++) {
+        framegraph_memory_block* block = &pool->blocks[i];
+        if (block->claimed || block->lazy != lazy || block->size < requirements->size || block->alignment < requirements->alignment) continue;
+        if (!(requirements->memoryTypeBits & (1u << block->memoryTypeIndex))) continue;
+        if (best == NULL || block->size < best->size) {
+            best = block;
+        }
+    }
+    if (best != NULL) {
+        best->claimed = true;
+        return best->allocation;
+    }
+
+    VmaAllocationCreateInfo allocInfo;
+    CLEAR_MEMORY(&allocInfo);
+    allocInfo.usage = VMA_MEMORY_USAGE_GPU_ONLY;
+    allocInfo.preferredFlags = lazy ? VK_MEMORY_PROPERTY_LAZILY_ALLOCATED_BIT : 0;
+
+    VmaAllocation allocation;
+    VmaAllocationInfo info;
+    VkResult result = vmaAllocateMemory(pool->ctx->allocator, requirements, &allocInfo, &allocation, &info);
+    if (result != VK_SUCCESS) {
+        FATAL("Vulkan transient memory allocation of %llu bytes failed with error code: %d", (unsigned long long)requirements->size, result);
+        return NULL;
+    }
+    vulkan_memory_track_allocation(pool->ctx, MEMORY_CATEGORY_FRAMEGRAPH, allocation);
+
+    pool->numBlocks++;
+    pool->blocks = realloc(pool->blocks, sizeof(framegraph_memory_block) * pool->numBlocks);
+    framegraph_memory_block* block = &pool->blocks[pool->numBlocks - 1];
+    block->allocation = allocation;
+    block->size = requirements->size;
+    block->alignment = requirements->alignment;
+    block->memoryTypeIndex = info.memoryType;
+    block->lazy = lazy;
+    block->claimed = true;
+
+    return allocation;
+}
+
+void framegraph_transient_pool_trim(framegraph_transient_pool* pool) {
+    u32 numKept = 0;
+    for (u32 i = 0; i < pool->numBlocks; i++) {
+        framegraph_memory_block* block = &pool->blocks[i];
+        if (block->claimed) {
+            pool->blocks[numKept++] = *block;
+            continue;
+        }
+        vulkan_memory_track_free(pool->ctx, MEMORY_CATEGORY_FRAMEGRAPH, block->allocation);
+        vmaFreeMemory(pool->ctx->allocator, block->allocation);
+    }
+    pool->numBlocks = numKept;
+}
\ No newline at end of file
@@ -0,0 +1,35 @@
+#pragma once
+
+#include "core/core.h"
+#include "vulkan/vulkan.h"
+#include "graphics/vulkan/context.h"
+
+#include "vk_mem_alloc.h"
+
+// Device memory the framegraph places its transient images into, several images share a block when their lifetimes don't overlap
+typedef struct {
+    VmaAllocation allocation;
+    u64 size;
+    u64 alignment;
+    u32 memoryTypeIndex;
+    bool lazy;
+    bool claimed;
+} framegraph_memory_block;
+
+// Blocks outlive a compile, so recompiling at the same size or smaller allocates nothing
+typedef struct {
+    vulkan_context* ctx;
+    u32 numBlocks;
+    framegraph_memory_block* blocks;
+} framegraph_transient_pool;
+
+framegraph_transient_pool* framegraph_transient_pool_create(vulkan_context* ctx);
+void framegraph_transient_pool_destroy(framegraph_transient_pool* pool);
+
+// Marks every block as free to be claimed by the next compile
+void framegraph_transient_pool_begin(framegraph_transient_pool* pool);
+// Reuses the smallest unclaimed block that fits, allocating a new one otherwise
+// Lazy blocks only hold images that never leave tile memory, they prefer lazily allocated memory which tilers may never back at all
+VmaAllocation framegraph_transient_pool_claim(framegraph_transient_pool* pool, VkMemoryRequirements* requirements, bool lazy);
+// Frees the blocks the compile didn't claim
+void framegraph_transient_pool_trim(framegraph_transient_pool* pool);
\ No newline at end of file
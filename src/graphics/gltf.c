@@ -85,7 +85,13 @@ void gltf_load_buffer(gltf_gltf* gltf, const cJSON* data, gltf_buffer* buffer) {
     buffer->uri = uri->valuestring;
     buffer->byteLength = (size_t)cJSON_GetObjectItemCaseSensitive(data, "byteLength")->valueint;
 
-    char* bufferFilePath = gltf_merge_paths(gltf->path, buffer->uri);
+    gltf_buffer_load_data(buffer);
+}
+
+void gltf_buffer_load_data(gltf_buffer* buffer) {
+    if (buffer->data != NULL) return;
+
+    char* bufferFilePath = gltf_merge_paths(buffer->gltf->path, buffer->uri);
     FILE* bufferFile;
     fopen_s(&bufferFile, bufferFilePath, "rb");
     if (!bufferFile) {
@@ -98,6 +104,11 @@ void gltf_load_buffer(gltf_gltf* gltf, const cJSON* data, gltf_buffer* buffer) {
     fclose(bufferFile);
 }
 
+void gltf_buffer_release_data(gltf_buffer* buffer) {
+    free(buffer->data);
+    buffer->data = NULL;
+}
+
 void gltf_load_buffer_view(gltf_gltf* gltf, const cJSON* data, gltf_buffer_view* bufferView) {
     bufferView->buffer = &gltf->buffers[cJSON_GetObjectItemCaseSensitive(data, "buffer")->valueint];
     
@@ -177,9 +188,9 @@ void gltf_load_material(gltf_gltf* gltf, const cJSON* data, gltf_material* mater
     if (alphaMode == NULL) {
         material->alphaMode = ALPHA_MODE_OPAQUE;
     } else {
-        if (strcmp(alphaMode->valuestring, "OPAQUE"))     material->alphaMode = ALPHA_MODE_OPAQUE;
-        else if (strcmp(alphaMode->valuestring, "MASK"))  material->alphaMode = ALPHA_MODE_MASK;
-        else if (strcmp(alphaMode->valuestring, "BLEND")) material->alphaMode = ALPHA_MODE_BLEND;
+        if (strcmp(alphaMode->valuestring, "OPAQUE") == 0)     material->alphaMode = ALPHA_MODE_OPAQUE;
+        else if (strcmp(alphaMode->valuestring, "MASK") == 0)  material->alphaMode = ALPHA_MODE_MASK;
+        else if (strcmp(alphaMode->valuestring, "BLEND") == 0) material->alphaMode = ALPHA_MODE_BLEND;
     }
 
     material->alphaCutoff = (float)cJSON_GetDoubleOptional(data, "alphaCutoff", 0.5f);
@@ -402,6 +413,7 @@ gltf_gltf* gltf_load_file(const char* path) {
     const cJSON* buffer;
     i = 0;
     cJSON_ArrayForEach(buffer, buffers) {
+        gltf->buffers[i].gltf = gltf;
         gltf->buffers[i].id = i;
         gltf_load_buffer(gltf, buffer, &gltf->buffers[i]);
         i++;
@@ -418,6 +430,7 @@ gltf_gltf* gltf_load_file(const char* path) {
     const cJSON* image;
     i = 0;
     cJSON_ArrayForEach(image, images) {
+        gltf->images[i].gltf = gltf;
         gltf->images[i].id = i;
         const cJSON* uri = cJSON_GetObjectItemCaseSensitive(image, "uri");
         if (uri == NULL) {
@@ -260,4 +260,7 @@ char* gltf_merge_paths(const char* path, const char* uri);
 gltf_gltf* gltf_load_file(const char* path);
 void gltf_unload(gltf_gltf* gltf);
 
+void gltf_buffer_load_data(gltf_buffer* buffer);
+void gltf_buffer_release_data(gltf_buffer* buffer);
+
 size_t gltf_get_accessor_offset(gltf_accessor* accessor);
@@ -0,0 +1,326 @@
+#include "indirect.h"
+#include "residency.h"
+
+#include <math.h>
+
+typedef struct {
+    u32 firstIndex;
+    u32 indexCount;
+    i32 vertexOffset;
+} indirect_geometry;
+
+u8* accessor_element(gltf_accessor* accessor, u64 index, u64 elementSize) {
+    u64 stride = accessor->bufferView->byteStride ? accessor->bufferView->byteStride : elementSize;
+    return (u8*)accessor->bufferView->buffer->data + gltf_get_accessor_offset(accessor) + index * stride;
+}
+
+// The merged streams use the same layout as vulkan_vertex, so only float attributes can be copied across
+void copy_float_attribute(gltf_accessor* accessor, u32 numComponents, u64 numVertices, float* dst) {
+    if (accessor == NULL || accessor->componentType != ACCESSOR_COMPONENT_TYPE_FLOAT) {
+        if (accessor != NULL) {
+            WARN("Accessor %d isn't made of floats, leaving it zeroed in the merged geometry", accessor->id);
+        }
+        CLEAR_MEMORY_ARRAY(dst, numVertices * numComponents);
+        return;
+    }
+    for (u64 i = 0; i < numVertices; i++) {
+        memcpy(&dst[i * numComponents], accessor_element(accessor, i, sizeof(float) * numComponents), sizeof(float) * numComponents);
+    }
+}
+
+void copy_indices(gltf_accessor* accessor, u32* dst) {
+    for (u64 i = 0; i < accessor->count; i++) {
+        switch (accessor->componentType) {
+        case(ACCESSOR_COMPONENT_TYPE_U8)  : dst[i] = *accessor_element(accessor, i, sizeof(u8)); break;
+        case(ACCESSOR_COMPONENT_TYPE_U16) : dst[i] = *(u16*)accessor_element(accessor, i, sizeof(u16)); break;
+        case(ACCESSOR_COMPONENT_TYPE_U32) : dst[i] = *(u32*)accessor_element(accessor, i, sizeof(u32)); break;
+        default : dst[i] = 0; break;
+        }
+    }
+}
+
+indirect_geometry* merge_geometry(indirect_scene* scene, u32* meshFirstGeometry) {
+    gltf_gltf* gltf = scene->model->gltf;
+
+    u64 numVertices = 0;
+    u64 numIndices = 0;
+    u32 numGeometries = 0;
+    for (u32 i = 0; i < gltf->numMeshes; i++) {
+        meshFirstGeometry[i] = numGeometries;
+        numGeometries += gltf->meshes[i].numPrimitives;
+        for (u32 j = 0; j < gltf->meshes[i].numPrimitives; j++) {
+            numVertices += gltf->meshes[i].primitives[j].position->count;
+            numIndices += gltf->meshes[i].primitives[j].index->count;
+        }
+    }
+
+    float* positions = malloc(sizeof(vec3) * numVertices);
+    float* normals = malloc(sizeof(vec3) * numVertices);
+    float* uvs = malloc(sizeof(vec2) * numVertices);
+    u32* indices = malloc(sizeof(u32) * numIndices);
+    indirect_geometry* geometries = malloc(sizeof(indirect_geometry) * numGeometries);
+
+    u64 vertexBase = 0;
+    u64 indexBase = 0;
+    for (u32 i = 0; i < gltf->numMeshes; i++) {
+        for (u32 j = 0; j < gltf->meshes[i].numPrimitives; j++) {
+            gltf_mesh_primitive* primitive = &gltf->meshes[i].primitives[j];
+            u64 count = primitive->position->count;
+            copy_float_attribute(primitive->position, 3, count, &positions[vertexBase * 3]);
+            copy_float_attribute(primitive->normal, 3, count, &normals[vertexBase * 3]);
+            copy_float_attribute(primitive->baseColorTextureUV, 2, count, &uvs[vertexBase * 2]);
+            copy_indices(primitive->index, &indices[indexBase]);
+
+            indirect_geometry* geometry = &geometries[meshFirstGeometry[i] + j];
+            geometry->firstIndex = (u32)indexBase;
+            geometry->indexCount = (u32)primitive->index->count;
+            geometry->vertexOffset = (i32)vertexBase;
+
+            vertexBase += count;
+            indexBase += primitive->index->count;
+        }
+    }
+
+    scene->positions = vulkan_buffer_create_with_data(scene->ctx, VK_BUFFER_USAGE_VERTEX_BUFFER_BIT, sizeof(vec3) * numVertices, MEMORY_CATEGORY_GEOMETRY, positions);
+    scene->normals = vulkan_buffer_create_with_data(scene->ctx, VK_BUFFER_USAGE_VERTEX_BUFFER_BIT, sizeof(vec3) * numVertices, MEMORY_CATEGORY_GEOMETRY, normals);
+    scene->uvs = vulkan_buffer_create_with_data(scene->ctx, VK_BUFFER_USAGE_VERTEX_BUFFER_BIT, sizeof(vec2) * numVertices, MEMORY_CATEGORY_GEOMETRY, uvs);
+    scene->indices = vulkan_buffer_create_with_data(scene->ctx, VK_BUFFER_USAGE_INDEX_BUFFER_BIT, sizeof(u32) * numIndices, MEMORY_CATEGORY_GEOMETRY, indices);
+    INFO("Merged %d primitives into %llu vertices and %llu indices", numGeometries, (unsigned long long)numVertices, (unsigned long long)numIndices);
+
+    free(positions);
+    free(normals);
+    free(uvs);
+    free(indices);
+    return geometries;
+}
+
+u32 get_bucket(indirect_scene* scene, u32 variant, VkCullModeFlags cullMode) {
+    for (u32 i = 0; i < scene->numBuckets; i++) {
+        if (scene->buckets[i].variant == variant && scene->buckets[i].cullMode == cullMode) return i;
+    }
+
+    scene->numBuckets++;
+    scene->buckets = realloc(scene->buckets, sizeof(indirect_bucket) * scene->numBuckets);
+    indirect_bucket* bucket = &scene->buckets[scene->numBuckets - 1];
+    CLEAR_MEMORY(bucket);
+    bucket->variant = variant;
+    bucket->cullMode = cullMode;
+    return scene->numBuckets - 1;
+}
+
+void node_add_instances(indirect_scene* scene, gltf_node* node, indirect_geometry* geometries, u32* meshFirstGeometry, indirect_instance** instances) {
+    if (node->mesh) {
+        *instances = realloc(*instances, sizeof(indirect_instance) * (scene->numInstances + node->mesh->numPrimitives));
+        for (u32 i = 0; i < node->mesh->numPrimitives; i++) {
+            gltf_mesh_primitive* primitive = &node->mesh->primitives[i];
+            indirect_geometry* geometry = &geometries[meshFirstGeometry[node->mesh->id] + i];
+            indirect_instance* instance = &(*instances)[scene->numInstances++];
+            CLEAR_MEMORY(instance);
+
+            // Same space the CPU path draws in, node transforms aren't applied by either
+            vec3 min = { primitive->position->min[0], primitive->position->min[1], primitive->position->min[2] };
+            vec3 max = { primitive->position->max[0], primitive->position->max[1], primitive->position->max[2] };
+            glm_vec3_center(min, max, instance->sphere);
+            instance->sphere[3] = glm_vec3_distance(min, max) * 0.5f;
+
+            instance->firstIndex = geometry->firstIndex;
+            instance->indexCount = geometry->indexCount;
+            instance->vertexOffset = geometry->vertexOffset;
+            instance->material = primitive->material->id;
+            instance->bucket = get_bucket(scene, scene->model->materialVariants[primitive->material->id], primitive->material->doubleSided ? VK_CULL_MODE_NONE : VK_CULL_MODE_BACK_BIT);
+            scene->buckets[instance->bucket].maxCommands++;
+        }
+    }
+
+    for (u32 i = 0; i < node->numChildren; i++) {
+        node_add_instances(scene, node->children[i], geometries, meshFirstGeometry, instances);
+    }
+}
+
+indirect_scene* indirect_scene_create(vulkan_context* ctx, model_model* model, u32 numFrames) {
+    indirect_scene* scene = malloc(sizeof(indirect_scene));
+    CLEAR_MEMORY(scene);
+    scene->ctx = ctx;
+    scene->model = model;
+
+    u32* meshFirstGeometry = malloc(sizeof(u32) * model->gltf->numMeshes);
+    indirect_geometry* geometries = merge_geometry(scene, meshFirstGeometry);
+
+    indirect_instance* instances = malloc(0);
+    scene->buckets = malloc(0);
+    for (u32 i = 0; i < model->gltf->scene->numNodes; i++) {
+        node_add_instances(scene, model->gltf->scene->nodes[i], geometries, meshFirstGeometry, &instances);
+    }
+    free(geometries);
+    free(meshFirstGeometry);
+
+    // Each bucket gets a slot for every instance in it so a frame where nothing is culled still fits
+    u32 firstCommand = 0;
+    for (u32 i = 0; i < scene->numBuckets; i++) {
+        scene->buckets[i].firstCommand = firstCommand;
+        firstCommand += scene->buckets[i].maxCommands;
+    }
+    for (u32 i = 0; i < scene->numInstances; i++) {
+        instances[i].commandBase = scene->buckets[instances[i].bucket].firstCommand;
+    }
+
+    bool* imageUsed = malloc(sizeof(bool) * model->gltf->numImages);
+    CLEAR_MEMORY_ARRAY(imageUsed, model->gltf->numImages);
+    scene->images = malloc(0);
+    for (u32 i = 0; i < scene->numInstances; i++) {
+        gltf_texture_reference* baseColor = &model->gltf->materials[instances[i].material].pbr.baseColorTexture;
+        if (baseColor->useDefault || imageUsed[baseColor->texture->source->id]) continue;
+        imageUsed[baseColor->texture->source->id] = true;
+        scene->images = realloc(scene->images, sizeof(u32) * (scene->numImages + 1));
+        scene->images[scene->numImages++] = baseColor->texture->source->id;
+    }
+    free(imageUsed);
+    scene->instances = vulkan_buffer_create_with_data(ctx, VK_BUFFER_USAGE_STORAGE_BUFFER_BIT, sizeof(indirect_instance) * (scene->numInstances > 0 ? scene->numInstances : 1), MEMORY_CATEGORY_GEOMETRY, instances);
+    free(instances);
+
+    scene->numFrames = numFrames;
+    scene->frames = malloc(sizeof(indirect_frame) * numFrames);
+    for (u32 i = 0; i < numFrames; i++) {
+        scene->frames[i].commands = vulkan_buffer_create(ctx, VK_BUFFER_USAGE_STORAGE_BUFFER_BIT | VK_BUFFER_USAGE_INDIRECT_BUFFER_BIT, sizeof(VkDrawIndexedIndirectCommand) * (scene->numInstances > 0 ? scene->numInstances : 1), MEMORY_CATEGORY_GEOMETRY);
+        scene->frames[i].counts = vulkan_buffer_create(ctx, VK_BUFFER_USAGE_STORAGE_BUFFER_BIT | VK_BUFFER_USAGE_INDIRECT_BUFFER_BIT | VK_BUFFER_USAGE_TRANSFER_DST_BIT, sizeof(u32) * (scene->numBuckets > 0 ? scene->numBuckets : 1), MEMORY_CATEGORY_GEOMETRY);
+    }
+    INFO("GPU driven scene has %d instances in %d pipeline buckets", scene->numInstances, scene->numBuckets);
+
+    return scene;
+}
+
+void indirect_scene_destroy(indirect_scene* scene) {
+    indirect_scene_set_cull_shader(scene, NULL);
+    for (u32 i = 0; i < scene->numFrames; i++) {
+        vulkan_buffer_destroy(scene->frames[i].commands);
+        vulkan_buffer_destroy(scene->frames[i].counts);
+    }
+    free(scene->frames);
+    vulkan_buffer_destroy(scene->instances);
+    free(scene->buckets);
+    free(scene->images);
+    vulkan_buffer_destroy(scene->positions);
+    vulkan_buffer_destroy(scene->normals);
+    vulkan_buffer_destroy(scene->uvs);
+    vulkan_buffer_destroy(scene->indices);
+    free(scene);
+}
+
+void indirect_scene_touch_resources(indirect_scene* scene) {
+    if (scene->model->residency == NULL) return;
+    for (u32 i = 0; i < scene->numImages; i++) {
+        residency_manager_touch_image(scene->model->residency, scene->model, scene->images[i]);
+    }
+}
+
+void indirect_scene_set_cull_shader(indirect_scene* scene, vulkan_shader* shader) {
+    if (scene->cullPipeline) {
+        vulkan_pipeline_destroy(scene->cullPipeline);
+        scene->cullPipeline = NULL;
+    }
+    if (scene->cullLayout) {
+        vulkan_descriptor_set_layout_destroy(scene->cullLayout);
+        scene->cullLayout = NULL;
+    }
+    scene->cullShader = shader;
+    if (shader == NULL) return;
+
+    VkPushConstantRange pushConstants;
+    pushConstants.stageFlags = VK_SHADER_STAGE_COMPUTE_BIT;
+    pushConstants.offset = 0;
+    pushConstants.size = sizeof(indirect_cull_constants);
+
+    scene->cullLayout = vulkan_reflect_build_set_layout(&shader->reflection, 0, scene->ctx->device);
+    vulkan_pipeline_layout_config layoutConfig;
+    CLEAR_MEMORY(&layoutConfig);
+    layoutConfig.numSetLayouts = 1;
+    layoutConfig.setLayouts = &scene->cullLayout;
+    layoutConfig.numPushConstantRanges = 1;
+    layoutConfig.pushConstantRanges = &pushConstants;
+    scene->cullPipeline = vulkan_compute_pipeline_create(scene->ctx->device, shader, &layoutConfig);
+}
+
+void record_memory_barrier(VkCommandBuffer cmd, VkMemoryBarrier2* barrier) {
+    VkDependencyInfo dependency;
+    CLEAR_MEMORY(&dependency);
+    dependency.sType = VK_STRUCTURE_TYPE_DEPENDENCY_INFO;
+    dependency.memoryBarrierCount = 1;
+    dependency.pMemoryBarriers = barrier;
+    vkCmdPipelineBarrier2(cmd, &dependency);
+}
+
+void indirect_scene_cull(indirect_scene* scene, VkCommandBuffer cmd, u32 frameIndex, vulkan_descriptor_linear_allocator* descriptors, mat4 view, mat4 proj, u32 viewportHeight) {
+    indirect_frame* frame = &scene->frames[frameIndex];
+
+    // With no pipeline every count stays zero, so the draws still read valid buffers
+    vkCmdFillBuffer(cmd, frame->counts->buffer, 0, VK_WHOLE_SIZE, 0);
+
+    VkMemoryBarrier2 clearBarrier;
+    CLEAR_MEMORY(&clearBarrier);
+    clearBarrier.sType = VK_STRUCTURE_TYPE_MEMORY_BARRIER_2;
+    clearBarrier.srcStageMask = VK_PIPELINE_STAGE_2_CLEAR_BIT;
+    clearBarrier.srcAccessMask = VK_ACCESS_2_TRANSFER_WRITE_BIT;
+    clearBarrier.dstStageMask = VK_PIPELINE_STAGE_2_COMPUTE_SHADER_BIT | VK_PIPELINE_STAGE_2_DRAW_INDIRECT_BIT;
+    clearBarrier.dstAccessMask = VK_ACCESS_2_SHADER_STORAGE_READ_BIT | VK_ACCESS_2_SHADER_STORAGE_WRITE_BIT | VK_ACCESS_2_INDIRECT_COMMAND_READ_BIT;
+    record_memory_barrier(cmd, &clearBarrier);
+
+    if (scene->cullPipeline == NULL || scene->numInstances == 0) return;
+
+    vulkan_descriptor_set set = vulkan_descriptor_linear_allocator_allocate(descriptors, scene->cullLayout);
+    vulkan_descriptor_set_write_storage_buffer(&set, 0, scene->instances);
+    vulkan_descriptor_set_write_storage_buffer(&set, 1, frame->commands);
+    vulkan_descriptor_set_write_storage_buffer(&set, 2, frame->counts);
+
+    indirect_cull_constants constants;
+    CLEAR_MEMORY(&constants);
+    mat4 viewProj;
+    glm_mat4_mul(proj, view, viewProj);
+    glm_frustum_planes(viewProj, constants.planes);
+
+    mat4 inverseView;
+    glm_mat4_inv(view, inverseView);
+    glm_vec4_copy(inverseView[3], constants.eye);
+    constants.eye[3] = fabsf(proj[1][1]) * (float)viewportHeight * 0.5f;
+    constants.numInstances = scene->numInstances;
+    constants.minPixelRadius = INDIRECT_MIN_PIXEL_RADIUS;
+
+    vkCmdBindPipeline(cmd, VK_PIPELINE_BIND_POINT_COMPUTE, scene->cullPipeline->pipeline);
+    vkCmdBindDescriptorSets(cmd, VK_PIPELINE_BIND_POINT_COMPUTE, scene->cullPipeline->layout->layout, 0, 1, &set.set, 0, NULL);
+    vkCmdPushConstants(cmd, scene->cullPipeline->layout->layout, VK_SHADER_STAGE_COMPUTE_BIT, 0, sizeof(indirect_cull_constants), &constants);
+    vkCmdDispatch(cmd, (scene->numInstances + INDIRECT_CULL_GROUP_SIZE - 1) / INDIRECT_CULL_GROUP_SIZE, 1, 1);
+
+    VkMemoryBarrier2 cullBarrier;
+    CLEAR_MEMORY(&cullBarrier);
+    cullBarrier.sType = VK_STRUCTURE_TYPE_MEMORY_BARRIER_2;
+    cullBarrier.srcStageMask = VK_PIPELINE_STAGE_2_COMPUTE_SHADER_BIT;
+    cullBarrier.srcAccessMask = VK_ACCESS_2_SHADER_STORAGE_WRITE_BIT;
+    cullBarrier.dstStageMask = VK_PIPELINE_STAGE_2_DRAW_INDIRECT_BIT;
+    cullBarrier.dstAccessMask = VK_ACCESS_2_INDIRECT_COMMAND_READ_BIT;
+    record_memory_barrier(cmd, &cullBarrier);
+}
+
+void indirect_scene_draw(indirect_scene* scene, VkCommandBuffer cmd, u32 frameIndex, vulkan_pipeline_layout* layout, vulkan_pipeline** variantPipelines) {
+    indirect_frame* frame = &scene->frames[frameIndex];
+
+    VkBuffer vertexBuffers[3] = { scene->positions->buffer, scene->normals->buffer, scene->uvs->buffer };
+    VkDeviceSize offsets[3] = { 0, 0, 0 };
+    vkCmdBindVertexBuffers(cmd, 0, 3, vertexBuffers, offsets);
+    vkCmdBindIndexBuffer(cmd, scene->indices->buffer, 0, VK_INDEX_TYPE_UINT32);
+
+    // The material comes from the instance buffer, only the table it indexes is pushed
+    model_draw_constants constants;
+    constants.materialBuffer = scene->model->materialBufferIndex;
+    constants.material = 0;
+    vkCmdPushConstants(cmd, layout->layout, VK_SHADER_STAGE_VERTEX_BIT | VK_SHADER_STAGE_FRAGMENT_BIT, 0, sizeof(model_draw_constants), &constants);
+
+    for (u32 i = 0; i < scene->numBuckets; i++) {
+        indirect_bucket* bucket = &scene->buckets[i];
+        vulkan_pipeline* pipeline = variantPipelines[bucket->variant];
+        if (pipeline == NULL || bucket->maxCommands == 0) continue;
+
+        vkCmdBindPipeline(cmd, VK_PIPELINE_BIND_POINT_GRAPHICS, pipeline->pipeline);
+        vkCmdSetCullMode(cmd, bucket->cullMode);
+        vkCmdDrawIndexedIndirectCount(cmd, frame->commands->buffer, sizeof(VkDrawIndexedIndirectCommand) * bucket->firstCommand,
+            frame->counts->buffer, sizeof(u32) * i, bucket->maxCommands, sizeof(VkDrawIndexedIndirectCommand));
+    }
+}
\ No newline at end of file
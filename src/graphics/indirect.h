@@ -0,0 +1,90 @@
+#pragma once
+
+#include "core/core.h"
+#include "vulkan/vulkan.h"
+#include "vulkan/context.h"
+#include "vulkan/buffer.h"
+#include "vulkan/descriptor.h"
+#include "vulkan/pipeline.h"
+#include "vulkan/shader.h"
+
+#include "cglm/cglm.h"
+
+#include "model.h"
+
+#define INDIRECT_CULL_GROUP_SIZE 64
+#define INDIRECT_MIN_PIXEL_RADIUS 0.5f
+
+// Matches Instance in cull.comp and indirect.vert
+typedef struct {
+    vec4 sphere; // Bounds in model space, xyz is the centre and w the radius
+    u32 firstIndex;
+    u32 indexCount;
+    i32 vertexOffset;
+    u32 material;
+    u32 bucket;
+    u32 commandBase; // First command slot of the bucket
+    u32 padding[2];
+} indirect_instance;
+
+typedef struct {
+    vec4 planes[6];
+    vec4 eye;
+    u32 numInstances;
+    float minPixelRadius;
+} indirect_cull_constants;
+
+// Draws that can share one indirect count draw, they need the same pipeline and the same cull mode
+typedef struct {
+    u32 variant;
+    VkCullModeFlags cullMode;
+    u32 firstCommand;
+    u32 maxCommands;
+} indirect_bucket;
+
+// Written by the GPU every frame, so each frame in flight needs its own
+typedef struct {
+    vulkan_buffer* commands;
+    vulkan_buffer* counts;
+} indirect_frame;
+
+// The model's geometry merged into one set of vertex streams so draws only differ by their offsets into them,
+// with compute culling writing the draws straight into indirect buffers
+typedef struct {
+    vulkan_context* ctx;
+    model_model* model;
+
+    vulkan_buffer* positions;
+    vulkan_buffer* normals;
+    vulkan_buffer* uvs;
+    vulkan_buffer* indices;
+
+    u32 numInstances;
+    vulkan_buffer* instances;
+    u32 numBuckets;
+    indirect_bucket* buckets;
+    u32 numImages;
+    u32* images; // Every glTF image an instance samples, the GPU picks what's visible so they all have to stay resident
+
+    vulkan_shader* cullShader;
+    vulkan_descriptor_set_layout* cullLayout;
+    vulkan_pipeline* cullPipeline;
+
+    u32 numFrames;
+    indirect_frame* frames;
+} indirect_scene;
+
+// Reads the geometry out of the glTF, so has to be created before the model releases its CPU copies
+indirect_scene* indirect_scene_create(vulkan_context* ctx, model_model* model, u32 numFrames);
+void indirect_scene_destroy(indirect_scene* scene);
+
+// NULL shader unloads the culling pipeline, the caller makes sure the GPU is done with the old one
+void indirect_scene_set_cull_shader(indirect_scene* scene, vulkan_shader* shader);
+
+// Marks every image the instances sample as used this frame, in place of the CPU path's per draw touches
+void indirect_scene_touch_resources(indirect_scene* scene);
+
+// Clears the counts and dispatches the culling, outside of any render pass
+void indirect_scene_cull(indirect_scene* scene, VkCommandBuffer cmd, u32 frameIndex, vulkan_descriptor_linear_allocator* descriptors, mat4 view, mat4 proj, u32 viewportHeight);
+// One indirect count draw per bucket, the global and bindless sets need to be bound already
+void indirect_scene_draw(indirect_scene* scene, VkCommandBuffer cmd, u32 frameIndex, vulkan_pipeline_layout* layout, vulkan_pipeline** variantPipelines);
\ No newline at end of file
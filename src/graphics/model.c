@@ -1,5 +1,10 @@
 #include "model.h"
 
+#include "residency.h"
+#include "core/sort.h"
+
+#include <stddef.h>
+
 VkFilter gltf_filter_to_vk_filter(gltf_sampler_filter filter) {
     switch (filter) {
         case(SAMPLER_FILTER_LINEAR) : return VK_FILTER_LINEAR;
@@ -19,29 +24,148 @@ VkSamplerAddressMode gltf_wrap_mode_to_vk_address_mode(gltf_sampler_wrap_mode wr
     return VK_SAMPLER_ADDRESS_MODE_REPEAT;
 }
 
-model_model* model_load_from_gltf(vulkan_context* ctx, gltf_gltf* gltf, vulkan_descriptor_set_layout* materialSetLayout, vulkan_pipeline_layout* pipelineLayout) {
+vulkan_buffer* model_upload_buffer(model_model* model, u32 index) {
+    gltf_buffer* buffer = &model->gltf->buffers[index];
+
+    // The CPU copy may have been released after the first upload, in which case it is read back from disk just for this upload
+    bool reloaded = buffer->data == NULL;
+    gltf_buffer_load_data(buffer);
+    model->buffers[index] = vulkan_buffer_create_with_data(model->ctx, VK_BUFFER_USAGE_VERTEX_BUFFER_BIT | VK_BUFFER_USAGE_INDEX_BUFFER_BIT, buffer->byteLength, MEMORY_CATEGORY_GEOMETRY, buffer->data);
+    if (reloaded) {
+        gltf_buffer_release_data(buffer);
+    }
+
+    model->bufferStates[index].size = vulkan_memory_get_allocation_size(model->ctx, model->buffers[index]->allocation);
+    model->bufferStates[index].resident = true;
+    return model->buffers[index];
+}
+
+vulkan_image* model_upload_image(model_model* model, u32 index) {
+    char* path = gltf_merge_paths(model->gltf->path, model->gltf->images[index].uri);
+    model->images[index] = vulkan_image_create_from_file(model->ctx, path, VK_FORMAT_R8G8B8A8_SRGB, VK_IMAGE_USAGE_SAMPLED_BIT, VK_IMAGE_ASPECT_COLOR_BIT); // TODO: Format and aspects for other types of images
+    free(path);
+
+    model->imageStates[index].size = vulkan_memory_get_allocation_size(model->ctx, model->images[index]->allocation);
+    model->imageStates[index].resident = true;
+
+    // The slot is kept across evictions so material data referencing it never has to be rewritten
+    if (model->imageIndices[index] == BINDLESS_INVALID_INDEX) {
+        model->imageIndices[index] = vulkan_bindless_table_add_image(model->bindless, model->images[index]);
+    } else {
+        vulkan_bindless_table_update_image(model->bindless, model->imageIndices[index], model->images[index]);
+    }
+    return model->images[index];
+}
+
+void model_evict_buffer(model_model* model, u32 index) {
+    vulkan_buffer_destroy(model->buffers[index]);
+    model->buffers[index] = NULL;
+    model->bufferStates[index].resident = false;
+}
+
+void model_evict_image(model_model* model, u32 index) {
+    vulkan_bindless_table_update_image(model->bindless, model->imageIndices[index], vulkan_image_get_default_color_texture(model->ctx));
+    vulkan_image_destroy(model->images[index]);
+    model->images[index] = NULL;
+    model->imageStates[index].resident = false;
+}
+
+u32 texture_image_index(model_model* model, gltf_texture_reference* reference) {
+    if (reference->useDefault || reference->texture->source == NULL) return BINDLESS_DEFAULT_IMAGE;
+    return model->imageIndices[reference->texture->source->id];
+}
+
+u32 texture_sampler_index(model_model* model, gltf_texture_reference* reference) {
+    if (reference->useDefault || reference->texture->sampler == NULL) return BINDLESS_DEFAULT_SAMPLER;
+    return model->samplerIndices[reference->texture->sampler->id];
+}
+
+model_material_variant material_variant(model_model* model, gltf_material* material) {
+    model_material_variant variant;
+    CLEAR_MEMORY(&variant);
+    variant.alphaMode = material->alphaMode;
+    variant.alphaCutoff = material->alphaMode == ALPHA_MODE_MASK ? material->alphaCutoff : 0.0f; // Only masked variants differ by cutoff
+    variant.hasBaseColorTexture = texture_image_index(model, &material->pbr.baseColorTexture) != BINDLESS_DEFAULT_IMAGE;
+    return variant;
+}
+
+void create_material_variants(model_model* model) {
+    model->variantMapEntries[0].constantID = 0;
+    model->variantMapEntries[0].offset = offsetof(model_material_variant, alphaMode);
+    model->variantMapEntries[0].size = sizeof(u32);
+    model->variantMapEntries[1].constantID = 1;
+    model->variantMapEntries[1].offset = offsetof(model_material_variant, alphaCutoff);
+    model->variantMapEntries[1].size = sizeof(float);
+    model->variantMapEntries[2].constantID = 2;
+    model->variantMapEntries[2].offset = offsetof(model_material_variant, hasBaseColorTexture);
+    model->variantMapEntries[2].size = sizeof(VkBool32);
+
+    model->variants = malloc(0);
+    model->materialVariants = malloc(sizeof(u32) * model->gltf->numMaterials);
+    for (u32 i = 0; i < model->gltf->numMaterials; i++) {
+        model_material_variant variant = material_variant(model, &model->gltf->materials[i]);
+
+        u32 index = model->numVariants;
+        for (u32 j = 0; j < model->numVariants; j++) {
+            if (memcmp(&model->variants[j], &variant, sizeof(model_material_variant)) == 0) {
+                index = j;
+                break;
+            }
+        }
+        if (index == model->numVariants) {
+            model->numVariants++;
+            model->variants = realloc(model->variants, sizeof(model_material_variant) * model->numVariants);
+            model->variants[index] = variant;
+        }
+        model->materialVariants[i] = index;
+    }
+
+    // Built once the variants array has stopped moving
+    model->variantSpecializations = malloc(sizeof(VkSpecializationInfo) * model->numVariants);
+    for (u32 i = 0; i < model->numVariants; i++) {
+        model->variantSpecializations[i].mapEntryCount = MODEL_VARIANT_CONSTANTS;
+        model->variantSpecializations[i].pMapEntries = model->variantMapEntries;
+        model->variantSpecializations[i].dataSize = sizeof(model_material_variant);
+        model->variantSpecializations[i].pData = &model->variants[i];
+    }
+    INFO("%d materials need %d pipeline variants", model->gltf->numMaterials, model->numVariants);
+    if (model->numVariants > 0x200) {
+        WARN("Draw keys only hold 512 variants, draws with the rest sort as if they shared pipelines");
+    }
+}
+
+model_model* model_load_from_gltf(vulkan_context* ctx, gltf_gltf* gltf, vulkan_bindless_table* bindless) {
     model_model* model = malloc(sizeof(model_model));
+    CLEAR_MEMORY(model);
     model->ctx = ctx;
     model->gltf = gltf;
+    model->bindless = bindless;
 
     // Upload buffers to the GPU
     model->buffers = malloc(sizeof(vulkan_buffer*) * model->gltf->numBuffers);
     CLEAR_MEMORY_ARRAY(model->buffers, model->gltf->numBuffers);
+    model->bufferStates = malloc(sizeof(model_resource_state) * model->gltf->numBuffers);
+    CLEAR_MEMORY_ARRAY(model->bufferStates, model->gltf->numBuffers);
 
     for (u32 i = 0; i < model->gltf->numBuffers; i++) {
-        model->buffers[i] = vulkan_buffer_create_with_data(ctx, VK_BUFFER_USAGE_VERTEX_BUFFER_BIT | VK_BUFFER_USAGE_INDEX_BUFFER_BIT, model->gltf->buffers[i].byteLength, model->gltf->buffers[i].data);
+        model_upload_buffer(model, i);
     }
 
     // Upload images to the GPU
     model->images = malloc(sizeof(vulkan_image*) * model->gltf->numImages);
     CLEAR_MEMORY_ARRAY(model->images, model->gltf->numImages);
+    model->imageStates = malloc(sizeof(model_resource_state) * model->gltf->numImages);
+    CLEAR_MEMORY_ARRAY(model->imageStates, model->gltf->numImages);
+    model->imageIndices = malloc(sizeof(u32) * model->gltf->numImages);
+    memset(model->imageIndices, 0xFF, sizeof(u32) * model->gltf->numImages);
 
     for (u32 i = 0; i < model->gltf->numImages; i++) {
-        model->images[i] = vulkan_image_create_from_file(ctx, gltf_merge_paths(model->gltf->path, model->gltf->images[i].uri), VK_FORMAT_R8G8B8A8_SRGB, VK_IMAGE_USAGE_SAMPLED_BIT, VK_IMAGE_ASPECT_COLOR_BIT); // TODO: Format and aspects for other types of images
+        model_upload_image(model, i);
     }
 
     model->samplers = malloc(sizeof(vulkan_sampler*) * model->gltf->numSamplers);
     CLEAR_MEMORY_ARRAY(model->samplers, model->gltf->numSamplers);
+    model->samplerIndices = malloc(sizeof(u32) * model->gltf->numSamplers);
 
     for (u32 i = 0; i < model->gltf->numSamplers; i++) {
         model->samplers[i] = vulkan_sampler_create(ctx, 
@@ -49,62 +173,144 @@ model_model* model_load_from_gltf(vulkan_context* ctx, gltf_gltf* gltf, vulkan_d
             gltf_filter_to_vk_filter(model->gltf->samplers[i].minFilter),
             gltf_wrap_mode_to_vk_address_mode(model->gltf->samplers[i].wrapS),
             gltf_wrap_mode_to_vk_address_mode(model->gltf->samplers[i].wrapT));
+        model->samplerIndices[i] = vulkan_bindless_table_add_sampler(bindless, model->samplers[i]);
     }
 
-    // Prepare material descriptor sets
-    /*model->materialSets = malloc(sizeof(vulkan_descriptor_set*) * model->gltf->numMaterials);
-    CLEAR_MEMORY_ARRAY(model->materialSets, model->gltf->numMaterials);
-    model->materialDataBuffers = malloc(sizeof(vulkan_buffer*) * model->gltf->numMaterials);
-    CLEAR_MEMORY_ARRAY(model->materialDataBuffers, model->gltf->numMaterials);
+    // All materials live in one storage buffer which shaders index with the material id from the push constants
+    u32 numMaterials = model->gltf->numMaterials > 0 ? model->gltf->numMaterials : 1;
+    model_material_data* materials = malloc(sizeof(model_material_data) * numMaterials);
+    CLEAR_MEMORY_ARRAY(materials, numMaterials);
 
     for (u32 i = 0; i < model->gltf->numMaterials; i++) {
-        model->materialSets[i] = vulkan_descriptor_set_allocate(model->materialSetAllocator);
+        memcpy(materials[i].baseColorFactor, model->gltf->materials[i].pbr.baseColorFactor, sizeof(float) * 4);
+        materials[i].baseColorTexture = texture_image_index(model, &model->gltf->materials[i].pbr.baseColorTexture);
+        materials[i].baseColorSampler = texture_sampler_index(model, &model->gltf->materials[i].pbr.baseColorTexture);
+    }
 
-        model_material_data data;
-        CLEAR_MEMORY(&data);
-        memcpy(data.baseColorFactor, model->gltf->materials[i].pbr.baseColorFactor, sizeof(float) * 4);
-        model->materialDataBuffers[i] = vulkan_buffer_create_with_data(ctx, VK_BUFFER_USAGE_UNIFORM_BUFFER_BIT, sizeof(model_material_data), &data);
-        vulkan_descriptor_set_write_buffer(model->materialSets[i], 0, model->materialDataBuffers[i]);
+    model->materialBuffer = vulkan_buffer_create_with_data(ctx, VK_BUFFER_USAGE_STORAGE_BUFFER_BIT, sizeof(model_material_data) * numMaterials, MEMORY_CATEGORY_UNIFORM, materials);
+    model->materialBufferIndex = vulkan_bindless_table_add_buffer(bindless, model->materialBuffer);
+    free(materials);
 
-        vulkan_descriptor_set_write_image(model->materialSets[i], 1, model->images[model->gltf->materials[i].pbr.baseColorTexture.texture->source->id], model->samplers[model->gltf->materials[i].pbr.baseColorTexture.texture->sampler->id]);
-    }*/
+    create_material_variants(model);
+    model->draws = malloc(0);
+    model->sortedDraws = malloc(0);
+    model->drawKeys = malloc(0);
+    model->drawOrder = malloc(0);
+    model->tempKeys = malloc(0);
+    model->tempOrder = malloc(0);
 
     return model;
 }
 void model_unload(model_model* model) {
+    if (model->residency) {
+        residency_manager_unregister_model(model->residency, model);
+    }
+
+    // Evicted resources have already been destroyed by the residency manager
     for (u32 i = 0; i < model->gltf->numBuffers; i++) {
-        vulkan_buffer_destroy(model->buffers[i]);
+        if (model->bufferStates[i].resident) {
+            vulkan_buffer_destroy(model->buffers[i]);
+        }
     }
     free(model->buffers);
+    free(model->bufferStates);
 
     for (u32 i = 0; i < model->gltf->numImages; i++) {
-        vulkan_image_destroy(model->images[i]);
+        if (model->imageStates[i].resident) {
+            vulkan_image_destroy(model->images[i]);
+        }
+        if (model->imageIndices[i] != BINDLESS_INVALID_INDEX) {
+            vulkan_bindless_table_remove_image(model->bindless, model->imageIndices[i]);
+        }
     }
     free(model->images);
+    free(model->imageStates);
+    free(model->imageIndices);
 
-    // for (u32 i = 0; i < model->gltf->numMaterials; i++) {
-    //     vulkan_buffer_destroy(model->materialDataBuffers[i]);
-    //     vulkan_descriptor_set_free(model->materialSets[i]);
-    // }
-    // free(model->materialDataBuffers);
-    // free(model->materialSets);
+    vulkan_bindless_table_remove_buffer(model->bindless, model->materialBufferIndex);
+    vulkan_buffer_destroy(model->materialBuffer);
 
     for (u32 i = 0; i < model->gltf->numSamplers; i++) {
+        vulkan_bindless_table_remove_sampler(model->bindless, model->samplerIndices[i]);
         vulkan_sampler_destroy(model->samplers[i]);
     }
     free(model->samplers);
+    free(model->samplerIndices);
 
-    // vulkan_descriptor_allocator_destroy(model->materialSetAllocator);
+    free(model->variants);
+    free(model->variantSpecializations);
+    free(model->materialVariants);
+    free(model->draws);
+    free(model->sortedDraws);
+    free(model->drawKeys);
+    free(model->drawOrder);
+    free(model->tempKeys);
+    free(model->tempOrder);
 
     free(model);
 }
 
-void node_render(gltf_node* node, VkCommandBuffer cmd, model_model* model) {
+vulkan_buffer* resident_buffer(model_model* model, u32 index) {
+    if (model->residency) {
+        residency_manager_touch_buffer(model->residency, model, index);
+    }
+    return model->buffers[index];
+}
+
+// Positive floats order the same as their bit patterns, so the top half of the bits is a cheap 16 bit depth
+u64 draw_key_depth(gltf_mesh_primitive* primitive, mat4 view) {
+    vec4 center = {
+        (primitive->position->min[0] + primitive->position->max[0]) * 0.5f,
+        (primitive->position->min[1] + primitive->position->max[1]) * 0.5f,
+        (primitive->position->min[2] + primitive->position->max[2]) * 0.5f,
+        1.0f
+    };
+    vec4 viewCenter;
+    glm_mat4_mulv(view, center, viewCenter);
+
+    float depth = -viewCenter[2] > 0.0f ? -viewCenter[2] : 0.0f;
+    u32 bits;
+    memcpy(&bits, &depth, sizeof(u32));
+    return bits >> 16;
+}
+
+u64 draw_key(gltf_mesh_primitive* primitive, model_draw* draw, mat4 view) {
+    // Blending is weighted so doesn't depend on order, blended draws still sort front to back
+    return ((u64)MODEL_DRAW_PASS_SCENE << MODEL_DRAW_KEY_PASS_SHIFT) |
+           ((u64)primitive->material->alphaMode << MODEL_DRAW_KEY_ALPHA_MODE_SHIFT) |
+           (((u64)draw->variant & 0x1FF) << MODEL_DRAW_KEY_VARIANT_SHIFT) |
+           ((u64)primitive->material->doubleSided << MODEL_DRAW_KEY_CULL_SHIFT) |
+           (((u64)primitive->material->id & 0xFFFF) << MODEL_DRAW_KEY_MATERIAL_SHIFT) |
+           (((u64)primitive->index->bufferView->buffer->id & 0xFFFF) << MODEL_DRAW_KEY_GEOMETRY_SHIFT) |
+           (draw_key_depth(primitive, view) << MODEL_DRAW_KEY_DEPTH_SHIFT);
+}
+
+void node_prepare_draws(gltf_node* node, model_model* model, mat4 view) {
     if (node->mesh) {
+        // The list is rebuilt every frame, so it only ever grows
+        if (model->numDraws + node->mesh->numPrimitives > model->maxDraws) {
+            model->maxDraws = model->numDraws + node->mesh->numPrimitives;
+            model->draws = realloc(model->draws, sizeof(model_draw) * model->maxDraws);
+            model->sortedDraws = realloc(model->sortedDraws, sizeof(model_draw) * model->maxDraws);
+            model->drawKeys = realloc(model->drawKeys, sizeof(u64) * model->maxDraws);
+            model->drawOrder = realloc(model->drawOrder, sizeof(u32) * model->maxDraws);
+            model->tempKeys = realloc(model->tempKeys, sizeof(u64) * model->maxDraws);
+            model->tempOrder = realloc(model->tempOrder, sizeof(u32) * model->maxDraws);
+        }
         for (u32 i = 0; i < node->mesh->numPrimitives; i++) {
             gltf_mesh_primitive* primitive = &node->mesh->primitives[i];
+            model_draw* draw = &model->draws[model->numDraws++];
+
+            draw->variant = model->materialVariants[primitive->material->id];
+            // Culling is dynamic state so sidedness doesn't need its own variants
+            draw->cullMode = primitive->material->doubleSided ? VK_CULL_MODE_NONE : VK_CULL_MODE_BACK_BIT;
+
+            if (model->residency && !primitive->material->pbr.baseColorTexture.useDefault) {
+                residency_manager_touch_image(model->residency, model, primitive->material->pbr.baseColorTexture.texture->source->id);
+            }
 
-            // vkCmdBindDescriptorSets(cmd, VK_PIPELINE_BIND_POINT_GRAPHICS, model->pipelineLayout->layout, 1, 1, &model->materialSets[primitive->material->id]->set, 0, NULL);
+            draw->constants.materialBuffer = model->materialBufferIndex;
+            draw->constants.material = primitive->material->id;
 
             // Load vertex and index buffers
             gltf_accessor* accessors[3] = {
@@ -113,33 +319,61 @@ void node_render(gltf_node* node, VkCommandBuffer cmd, model_model* model) {
                 primitive->baseColorTextureUV
             };
 
-            VkBuffer buffers[3];
-            VkDeviceSize offsets[3];
-
-            for (u32 i = 0; i < 3; i++) {
-                buffers[i] = model->buffers[accessors[i]->bufferView->buffer->id]->buffer;
-                offsets[i] = gltf_get_accessor_offset(accessors[i]);
+            for (u32 j = 0; j < 3; j++) {
+                draw->vertexBuffers[j] = resident_buffer(model, accessors[j]->bufferView->buffer->id)->buffer;
+                draw->vertexOffsets[j] = gltf_get_accessor_offset(accessors[j]);
             }
 
-            vkCmdBindVertexBuffers(cmd, 0, 3, buffers, offsets);
-
-            VkIndexType indexType;
             switch (primitive->index->componentType) {
-            case(ACCESSOR_COMPONENT_TYPE_U16) : indexType = VK_INDEX_TYPE_UINT16; break;
-            case(ACCESSOR_COMPONENT_TYPE_U32) : indexType = VK_INDEX_TYPE_UINT32; break;
+            case(ACCESSOR_COMPONENT_TYPE_U16) : draw->indexType = VK_INDEX_TYPE_UINT16; break;
+            case(ACCESSOR_COMPONENT_TYPE_U32) : draw->indexType = VK_INDEX_TYPE_UINT32; break;
             }
-            vkCmdBindIndexBuffer(cmd, model->buffers[primitive->index->bufferView->buffer->id]->buffer, gltf_get_accessor_offset(primitive->index), indexType);
-            vkCmdDrawIndexed(cmd, (u32)primitive->index->count, 1, 0, 0, 0);
+            draw->indexBuffer = resident_buffer(model, primitive->index->bufferView->buffer->id)->buffer;
+            draw->indexOffset = gltf_get_accessor_offset(primitive->index);
+            draw->indexCount = (u32)primitive->index->count;
+            draw->key = draw_key(primitive, draw, view);
         }
     }
 
     for (u32 i = 0; i < node->numChildren; i++) {
-        node_render(node->children[i], cmd, model);
+        node_prepare_draws(node->children[i], model, view);
     }
 }
 
-void model_render(model_model* model, VkCommandBuffer cmd) {
+void model_prepare_draws(model_model* model, mat4 view) {
+    model->numDraws = 0;
     for (u32 i = 0; i < model->gltf->scene->numNodes; i++) {
-        node_render(model->gltf->scene->nodes[i], cmd, model);
+        node_prepare_draws(model->gltf->scene->nodes[i], model, view);
+    }
+
+    // Only the keys and indices go through the sort, the draws themselves are moved once at the end
+    for (u32 i = 0; i < model->numDraws; i++) {
+        model->drawKeys[i] = model->draws[i].key;
+        model->drawOrder[i] = i;
+    }
+    radix_sort_u64(model->numDraws, model->drawKeys, model->drawOrder, model->tempKeys, model->tempOrder);
+    for (u32 i = 0; i < model->numDraws; i++) {
+        model->sortedDraws[i] = model->draws[model->drawOrder[i]];
+    }
+
+    model_draw* sorted = model->sortedDraws;
+    model->sortedDraws = model->draws;
+    model->draws = sorted;
+}
+
+void model_record_draws(model_model* model, VkCommandBuffer cmd, vulkan_pipeline_layout* layout, vulkan_pipeline** variantPipelines, u32 firstDraw, u32 numDraws, vulkan_encoder_stats* stats) {
+    vulkan_command_encoder encoder;
+    vulkan_command_encoder_begin(&encoder, cmd, stats);
+
+    for (u32 i = firstDraw; i < firstDraw + numDraws; i++) {
+        model_draw* draw = &model->draws[i];
+
+        vulkan_pipeline* pipeline = variantPipelines[draw->variant];
+        if (pipeline == NULL) continue;
+        vulkan_command_encoder_bind_pipeline(&encoder, pipeline);
+        vulkan_command_encoder_set_cull_mode(&encoder, draw->cullMode);
+        vulkan_command_encoder_push_constants(&encoder, layout, VK_SHADER_STAGE_VERTEX_BIT | VK_SHADER_STAGE_FRAGMENT_BIT, sizeof(model_draw_constants), &draw->constants);
+        vulkan_command_encoder_bind_vertex_buffers(&encoder, 3, draw->vertexBuffers, draw->vertexOffsets);
+        vulkan_command_encoder_draw_indexed(&encoder, draw->indexBuffer, draw->indexOffset, draw->indexType, draw->indexCount);
     }
 }
\ No newline at end of file
@@ -7,15 +7,69 @@
 #include "vulkan/image.h"
 #include "vulkan/descriptor.h"
 #include "vulkan/pipeline.h"
+#include "vulkan/bindless.h"
 
 #include "cglm/cglm.h"
 
 #include "gltf.h"
+#include "vulkan/encoder.h"
 
+typedef struct residency_manager_t residency_manager;
+
+// Laid out to match the std430 Material struct in shader.frag
 typedef struct {
     vec4 baseColorFactor;
+    u32 baseColorTexture;
+    u32 baseColorSampler;
+    u32 padding[2];
 } model_material_data;
 
+typedef struct {
+    u32 materialBuffer;
+    u32 material;
+} model_draw_constants;
+
+// Draws are sorted by these fields, most significant first, so the state that is most expensive to change changes least
+#define MODEL_DRAW_KEY_PASS_SHIFT 60         // 4 bits, which pass or layer draws it
+#define MODEL_DRAW_KEY_ALPHA_MODE_SHIFT 58   // 2 bits, opaque before masked before blended
+#define MODEL_DRAW_KEY_VARIANT_SHIFT 49      // 9 bits, which pipeline
+#define MODEL_DRAW_KEY_CULL_SHIFT 48         // 1 bit, double sided
+#define MODEL_DRAW_KEY_MATERIAL_SHIFT 32     // 16 bits
+#define MODEL_DRAW_KEY_GEOMETRY_SHIFT 16     // 16 bits, the index buffer
+#define MODEL_DRAW_KEY_DEPTH_SHIFT 0         // 16 bits, front to back
+
+// Models are only drawn by the scene pass so far, the other ids are free for shadow or depth prepasses
+#define MODEL_DRAW_PASS_SCENE 0
+
+// Everything a draw needs already resolved, so recording doesn't touch the glTF or the residency manager
+typedef struct {
+    u64 key;
+    u32 variant;
+    VkCullModeFlags cullMode;
+    model_draw_constants constants;
+    VkBuffer vertexBuffers[3];
+    VkDeviceSize vertexOffsets[3];
+    VkBuffer indexBuffer;
+    VkDeviceSize indexOffset;
+    VkIndexType indexType;
+    u32 indexCount;
+} model_draw;
+
+#define MODEL_VARIANT_CONSTANTS 3
+
+// Laid out to match the specialization constants in shader.frag, one of these per distinct pipeline the model needs
+typedef struct {
+    u32 alphaMode;
+    float alphaCutoff;
+    VkBool32 hasBaseColorTexture;
+} model_material_variant;
+
+typedef struct {
+    u64 size;
+    u64 lastUsedFrame;
+    bool resident;
+} model_resource_state;
+
 typedef struct {
     vulkan_context* ctx;
     gltf_gltf* gltf;
@@ -23,9 +77,44 @@ typedef struct {
     vulkan_buffer** buffers;
     vulkan_image** images;
     vulkan_sampler** samplers;
+
+    vulkan_bindless_table* bindless;
+    u32* imageIndices;
+    u32* samplerIndices;
+    vulkan_buffer* materialBuffer;
+    u32 materialBufferIndex;
+
+    // Materials that specialize the shader the same way share a variant
+    u32 numVariants;
+    model_material_variant* variants;
+    VkSpecializationInfo* variantSpecializations;
+    VkSpecializationMapEntry variantMapEntries[MODEL_VARIANT_CONSTANTS];
+    u32* materialVariants;
+
+    residency_manager* residency;
+    model_resource_state* bufferStates;
+    model_resource_state* imageStates;
+
+    u32 numDraws;
+    u32 maxDraws;
+    model_draw* draws;
+    model_draw* sortedDraws; // Gathered into in key order then swapped with draws
+    u64* drawKeys;
+    u32* drawOrder;
+    u64* tempKeys;
+    u32* tempOrder;
 } model_model;
 
-model_model* model_load_from_gltf(vulkan_context* ctx, gltf_gltf* gltf);
+model_model* model_load_from_gltf(vulkan_context* ctx, gltf_gltf* gltf, vulkan_bindless_table* bindless);
 void model_unload(model_model* model);
 
-void model_render(model_model* model, VkCommandBuffer cmd);
\ No newline at end of file
+vulkan_buffer* model_upload_buffer(model_model* model, u32 index);
+vulkan_image* model_upload_image(model_model* model, u32 index);
+void model_evict_buffer(model_model* model, u32 index);
+void model_evict_image(model_model* model, u32 index);
+
+// Walks the scene into model->draws and sorts them by key, streaming in anything it uses, so has to run on the main thread
+void model_prepare_draws(model_model* model, mat4 view);
+// Safe to call from several threads at once on different command buffers, each with its own stats
+// Pipelines are indexed by variant, draws whose variant has no pipeline yet are skipped
+void model_record_draws(model_model* model, VkCommandBuffer cmd, vulkan_pipeline_layout* layout, vulkan_pipeline** variantPipelines, u32 firstDraw, u32 numDraws, vulkan_encoder_stats* stats);
\ No newline at end of file
@@ -1,8 +1,18 @@
 #include "renderer.h"
 
 #include "vulkan/vertex.h"
+#include "core/input.h"
 #include "cglm/cglm.h"
 
+#define MEMORY_PRESSURE_THRESHOLD 0.9f
+#define MEMORY_REPORT_KEY GLFW_KEY_F12
+#define MEMORY_REPORT_PATH "memory.json"
+#define GPU_DRIVEN_KEY GLFW_KEY_F10
+#define TIMINGS_REPORT_KEY GLFW_KEY_F11
+#define TIMINGS_REPORT_PATH "timings.json"
+#define RESIDENCY_BUDGET_FRACTION 0.8f // Below the pressure threshold so eviction starts before the warning
+#define BINDLESS_SET 1
+
 typedef struct {
     mat4 view;
     mat4 proj;
@@ -14,6 +24,194 @@ void create_swapchain(renderer* render) {
     if (render->ctx->swapchain == NULL) {
         render->ctx->swapchain = vulkan_swapchain_create(render->ctx, render->ctx->win, render->ctx->surface);
     }
+
+    render->numRenderFinished = render->ctx->swapchain->numImages;
+    render->renderFinished = malloc(sizeof(VkSemaphore) * render->numRenderFinished);
+    for (u32 i = 0; i < render->numRenderFinished; i++) {
+        render->renderFinished[i] = vulkan_context_get_semaphore(render->ctx, 0);
+    }
+}
+
+static bool memoryReportRequested = false;
+static bool gpuDrivenToggled = false;
+static bool timingsReportRequested = false;
+
+void renderer_keyboard_listener(i32 key, key_action action) {
+    if (key == MEMORY_REPORT_KEY && action == PRESS) {
+        memoryReportRequested = true;
+    }
+    if (key == GPU_DRIVEN_KEY && action == PRESS) {
+        gpuDrivenToggled = true;
+    }
+    if (key == TIMINGS_REPORT_KEY && action == PRESS) {
+        timingsReportRequested = true;
+    }
+}
+
+void renderer_memory_pressure(vulkan_context* ctx, u32 heapIndex, u64 usage, u64 budget, void* data) {
+    WARN("Memory heap %d is over %d%% of its budget (%llu / %llu bytes)", heapIndex, (i32)(MEMORY_PRESSURE_THRESHOLD * 100), (unsigned long long)usage, (unsigned long long)budget);
+}
+
+// The draw list is prepared on the main thread before recording, each job only encodes its own contiguous slice of it
+void draw_models(VkCommandBuffer cmd, u32 job, u32 numJobs, void* dataPtr) {
+    renderer* render = (renderer*)dataPtr;
+    u32 drawsPerJob = (render->model->numDraws + numJobs - 1) / numJobs;
+    u32 firstDraw = job * drawsPerJob;
+    if (firstDraw >= render->model->numDraws) return;
+    u32 numDraws = render->model->numDraws - firstDraw < drawsPerJob ? render->model->numDraws - firstDraw : drawsPerJob;
+
+    renderer_frame* frame = &render->frames[render->frameIndex];
+    vkCmdBindDescriptorSets(cmd, VK_PIPELINE_BIND_POINT_GRAPHICS, render->sceneLayout->layout, 0, 1, &frame->globalSet.set, 0, NULL);
+    vulkan_bindless_table_bind(render->bindless, cmd, render->sceneLayout, BINDLESS_SET);
+    // Indexed by material variant, the pass resolves these just before calling back into here
+    model_record_draws(render->model, cmd, render->sceneLayout, render->scenePass->pipelines, firstDraw, numDraws, &render->jobDrawStats[job]);
+}
+
+// Runs before the scene pass begins, culling straight into the indirect buffers the pass then draws from
+void cull_scene(VkCommandBuffer cmd, void* dataPtr) {
+    renderer* render = (renderer*)dataPtr;
+    indirect_scene_cull(render->indirect, cmd, render->frameIndex, render->frameDescriptors, render->view, render->proj, render->ctx->swapchain->extent.height);
+}
+
+void draw_scene_indirect(VkCommandBuffer cmd, void* dataPtr) {
+    renderer* render = (renderer*)dataPtr;
+    renderer_frame* frame = &render->frames[render->frameIndex];
+    vkCmdBindDescriptorSets(cmd, VK_PIPELINE_BIND_POINT_GRAPHICS, render->indirectLayout->layout, 0, 1, &frame->indirectSet.set, 0, NULL);
+    vulkan_bindless_table_bind(render->bindless, cmd, render->indirectLayout, BINDLESS_SET);
+    indirect_scene_draw(render->indirect, cmd, render->frameIndex, render->indirectLayout, render->scenePass->pipelines);
+}
+
+framegraph_config get_framegraph_config(renderer* render) {
+    framegraph_config framegraphConfig;
+    framegraphConfig.width = render->ctx->swapchain->extent.width;
+    framegraphConfig.height = render->ctx->swapchain->extent.height;
+    framegraphConfig.maxSamples = render->ctx->physical->maxSamples;
+    framegraphConfig.framesInFlight = FRAMES_IN_FLIGHT;
+    framegraphConfig.profile = true;
+    framegraphConfig.pipelineStatistics = true;
+    framegraphConfig.dynamicRendering = true;
+    return framegraphConfig;
+}
+
+// The set layouts live in the renderer since the pass keeps pointing at them after this returns, the image handles are copied
+framegraph_pass_config get_scene_pass_config(renderer* render) {
+    render->sceneSetLayouts[0] = render->gpuDriven ? render->indirectGlobalLayout : render->globalLayout;
+    render->sceneSetLayouts[1] = render->bindless->layout;
+
+    framegraph_pass_config renderPassConfig;
+    CLEAR_MEMORY(&renderPassConfig);
+    renderPassConfig.name = "scene";
+    renderPassConfig.numOutputs = 1;
+    renderPassConfig.outputs = &render->albedoImage;
+    renderPassConfig.depth = render->depthImage;
+    renderPassConfig.resolve = render->backbufferImage;
+    renderPassConfig.shaders.vertex = render->vertexShader;
+    renderPassConfig.shaders.fragment = render->fragmentShader;
+    renderPassConfig.numSetLayouts = 2;
+    renderPassConfig.setLayouts = render->sceneSetLayouts;
+    renderPassConfig.numPushConstantRanges = render->sceneLayout->numPushConstantRanges;
+    renderPassConfig.pushConstantRanges = render->sceneLayout->pushConstantRanges;
+    renderPassConfig.cullMode = VK_CULL_MODE_BACK_BIT;
+    renderPassConfig.depthTest = true;
+    renderPassConfig.depthWrite = true;
+    renderPassConfig.numVariants = render->model->numVariants;
+    renderPassConfig.variants = render->model->variantSpecializations;
+    renderPassConfig.dataPtr = render;
+    if (render->gpuDriven) {
+        // Only a handful of indirect draws are left to record, so there's nothing worth splitting across threads
+        renderPassConfig.shaders.vertex = render->indirectVertexShader;
+        renderPassConfig.prepareFn = cull_scene;
+        renderPassConfig.execFn = draw_scene_indirect;
+    } else {
+        renderPassConfig.parallelExecFn = draw_models;
+    }
+    return renderPassConfig;
+}
+
+// Declared once, framegraph_update compiles it again whenever its hash changes
+void declare_framegraph(renderer* render) {
+    render->framegraph = framegraph_create(get_framegraph_config(render));
+
+    render->albedoImage = framegraph_add_image(render->framegraph, "albedo", render->ctx->swapchain->format, true);
+    render->depthImage = framegraph_add_image(render->framegraph, "depth", VK_FORMAT_D32_SFLOAT, true);
+    render->backbufferImage = framegraph_add_image(render->framegraph, FRAMEGRAPH_BACKBUFFER, render->ctx->swapchain->format, false);
+
+    render->scenePass = framegraph_add_pass(render->framegraph, get_scene_pass_config(render));
+}
+
+void update_global_data(renderer* render, renderer_frame* frame) {
+    global_data data;
+    vec3 eye = { 0.0f, 2.0f, 0.0f };
+    vec3 center = { 1.0f, 2.0f, 0.0f };
+    vec3 up = { 0.0f, 1.0f, 0.0f };
+    glm_lookat(eye, center, up, data.view);
+    glm_mat4_copy(data.view, render->view);
+
+    // The aspect ratio is the only thing a resize changes for the scene, and it lives in a uniform rather than a pipeline
+    float aspect = (float)render->ctx->swapchain->extent.width / (float)render->ctx->swapchain->extent.height;
+    glm_perspective(glm_rad(70.0f), aspect, 0.1f, 1000.0f, data.proj);
+    data.proj[1][1] *= -1.0f;
+    glm_mat4_copy(data.proj, render->proj);
+    vulkan_buffer_update(frame->globalBuffer, sizeof(global_data), &data);
+
+    if (render->gpuDriven) {
+        frame->indirectSet = vulkan_descriptor_linear_allocator_allocate(render->frameDescriptors, render->indirectGlobalLayout);
+        vulkan_descriptor_set_write_buffer(&frame->indirectSet, 0, frame->globalBuffer);
+        vulkan_descriptor_set_write_storage_buffer(&frame->indirectSet, 1, render->indirect->instances);
+    } else {
+        frame->globalSet = vulkan_descriptor_linear_allocator_allocate(render->frameDescriptors, render->globalLayout);
+        vulkan_descriptor_set_write_buffer(&frame->globalSet, 0, frame->globalBuffer);
+    }
+}
+
+void renderer_shader_reloaded(vulkan_shader* shader, void* data) {
+    renderer* render = (renderer*)data;
+    // Culling isn't part of the framegraph's pipelines, it's rare enough to just swap it once the GPU is idle
+    if (shader == render->cullShader) {
+        vkDeviceWaitIdle(render->ctx->device->device);
+        indirect_scene_set_cull_shader(render->indirect, shader);
+        return;
+    }
+    framegraph_reload_shader(render->framegraph, shader);
+}
+
+bool load_gpu_driven(renderer* render) {
+    // Both are owned by the shader library, so one that did load doesn't need cleaning up when the other didn't
+    vulkan_shader* vertexShader = vulkan_shader_library_load(render->ctx->shaders, "shaders/indirect.vert.spv", VERTEX);
+    vulkan_shader* cullShader = vulkan_shader_library_load(render->ctx->shaders, "shaders/cull.comp.spv", COMPUTE);
+    if (vertexShader == NULL || cullShader == NULL) return false;
+
+    render->indirectVertexShader = vertexShader;
+    render->cullShader = cullShader;
+    indirect_scene_set_cull_shader(render->indirect, render->cullShader);
+
+    // Same as the scene layout apart from set 0, which also holds the instances the vertex shader reads materials from
+    render->indirectGlobalLayout = vulkan_reflect_build_set_layout(&render->indirectVertexShader->reflection, 0, render->ctx->device);
+    vulkan_descriptor_set_layout* setLayouts[2] = { render->indirectGlobalLayout, render->bindless->layout };
+    vulkan_pipeline_layout_config layoutConfig;
+    CLEAR_MEMORY(&layoutConfig);
+    layoutConfig.numSetLayouts = 2;
+    layoutConfig.setLayouts = setLayouts;
+    layoutConfig.numPushConstantRanges = render->sceneLayout->numPushConstantRanges;
+    layoutConfig.pushConstantRanges = render->sceneLayout->pushConstantRanges;
+    render->indirectLayout = vulkan_pipeline_layout_create(render->ctx->device, &layoutConfig);
+    return true;
+}
+
+void toggle_gpu_driven(renderer* render) {
+    if (render->indirect == NULL) {
+        WARN("The device doesn't support indirect count draws, staying on CPU driven rendering");
+        return;
+    }
+    if (render->indirectLayout == NULL && !load_gpu_driven(render)) {
+        WARN("The GPU driven shaders couldn't be loaded, staying on CPU driven rendering");
+        return;
+    }
+
+    // Changes the pass's shaders and layouts, so the next update compiles new pipelines for it
+    render->gpuDriven = !render->gpuDriven;
+    framegraph_set_pass_config(render->scenePass, get_scene_pass_config(render));
+    INFO("Switched to %s driven rendering", render->gpuDriven ? "GPU" : "CPU");
 }
 
 renderer* renderer_create(window* win) {
@@ -21,19 +219,77 @@ renderer* renderer_create(window* win) {
     CLEAR_MEMORY(render);
     render->ctx = vulkan_context_create(win); 
     
-    render->imageAvailable = vulkan_context_get_semaphore(render->ctx, 0);
-    render->renderFinished = vulkan_context_get_semaphore(render->ctx, 0);
-    render->inFlight = vulkan_context_get_fence(render->ctx, VK_FENCE_CREATE_SIGNALED_BIT);  
+    for (u32 i = 0; i < FRAMES_IN_FLIGHT; i++) {
+        renderer_frame* frame = &render->frames[i];
+        frame->imageAvailable = vulkan_context_get_semaphore(render->ctx, 0);
+        frame->inFlight = vulkan_context_get_fence(render->ctx, VK_FENCE_CREATE_SIGNALED_BIT);
+        // Transient since the buffers only live for a frame, they are reset with the whole pool rather than one by one
+        frame->commandPool = vulkan_command_pool_create(render->ctx->device, render->ctx->physical->queues.graphicsIndex, VK_COMMAND_POOL_CREATE_TRANSIENT_BIT);
+        frame->computePool = render->ctx->physical->queues.asyncCompute ? vulkan_command_pool_create(render->ctx->device, render->ctx->physical->queues.computeIndex, VK_COMMAND_POOL_CREATE_TRANSIENT_BIT) : frame->commandPool;
+        frame->globalBuffer = vulkan_buffer_create(render->ctx, VK_BUFFER_USAGE_UNIFORM_BUFFER_BIT, sizeof(global_data), MEMORY_CATEGORY_UNIFORM);
+
+        // The main thread records a job too
+        frame->numWorkerPools = render->ctx->jobs->numThreads + 1;
+        frame->workerPools = malloc(sizeof(vulkan_command_pool*) * frame->numWorkerPools);
+        for (u32 j = 0; j < frame->numWorkerPools; j++) {
+            frame->workerPools[j] = vulkan_command_pool_create(render->ctx->device, render->ctx->physical->queues.graphicsIndex, VK_COMMAND_POOL_CREATE_TRANSIENT_BIT);
+        }
+    }
+    render->jobDrawStats = malloc(sizeof(vulkan_encoder_stats) * render->frames[0].numWorkerPools);
+
+    render->frameDescriptors = vulkan_descriptor_linear_allocator_create(render->ctx->device, FRAMES_IN_FLIGHT);
+
+    render->vertexShader = vulkan_shader_library_load(render->ctx->shaders, "shaders/shader.vert.spv", VERTEX);
+    render->fragmentShader = vulkan_shader_library_load(render->ctx->shaders, "shaders/shader.frag.spv", FRAGMENT);
+    vulkan_shader_library_set_reload_callback(render->ctx->shaders, renderer_shader_reloaded, render);
+
+    // Set 0 holds per-frame globals and comes straight from the vertex shader, set 1 is the bindless table shared by every draw
+    render->bindless = vulkan_bindless_table_create(render->ctx);
+    render->globalLayout = vulkan_reflect_build_set_layout(&render->vertexShader->reflection, 0, render->ctx->device);
+
+    vulkan_descriptor_set_layout* sceneSetLayouts[2] = { render->globalLayout, render->bindless->layout };
+    VkPushConstantRange drawConstants;
+    drawConstants.stageFlags = VK_SHADER_STAGE_VERTEX_BIT | VK_SHADER_STAGE_FRAGMENT_BIT;
+    drawConstants.offset = 0;
+    drawConstants.size = sizeof(model_draw_constants);
+
+    vulkan_pipeline_layout_config sceneLayoutConfig;
+    CLEAR_MEMORY(&sceneLayoutConfig);
+    sceneLayoutConfig.numSetLayouts = 2;
+    sceneLayoutConfig.setLayouts = sceneSetLayouts;
+    sceneLayoutConfig.numPushConstantRanges = 1;
+    sceneLayoutConfig.pushConstantRanges = &drawConstants;
+    render->sceneLayout = vulkan_pipeline_layout_create(render->ctx->device, &sceneLayoutConfig);
+
+    vulkan_memory_set_pressure_callback(render->ctx, MEMORY_PRESSURE_THRESHOLD, renderer_memory_pressure, render);
+    input_manager_register_keyboard_listener(renderer_keyboard_listener);
 
     create_swapchain(render);
 
+    // The scene pass declares a pipeline per material variant so the model has to be loaded first
     render->gltf = gltf_load_file("models/samples/2.0/Sponza/glTF/Sponza.gltf");
-    render->model = model_load_from_gltf(render->ctx, render->gltf);
+    render->model = model_load_from_gltf(render->ctx, render->gltf, render->bindless);
+    if (vulkan_physical_device_supports_indirect_count(render->ctx->physical)) {
+        render->indirect = indirect_scene_create(render->ctx, render->model, FRAMES_IN_FLIGHT);
+    }
+    declare_framegraph(render);
+
+    // Uploads copy straight into mapped memory so the CPU side data is no longer needed once loading returns
+    render->residency = residency_manager_create(render->ctx, RESIDENCY_BUDGET_FRACTION, FRAMES_IN_FLIGHT);
+    residency_manager_register_model(render->residency, render->model);
+    residency_manager_release_cpu_copies(render->residency, render->model, VK_NULL_HANDLE);
 
     return render;
 }
 
 void destroy_swapchain(renderer* render, bool destroySwapchain) {
+    for (u32 i = 0; i < render->numRenderFinished; i++) {
+        vkDestroySemaphore(render->ctx->device->device, render->renderFinished[i], NULL);
+    }
+    free(render->renderFinished);
+    render->numRenderFinished = 0;
+    render->renderFinished = NULL;
+
     if (destroySwapchain) {
         vulkan_swapchain_destroy(render->ctx->swapchain);
         render->ctx->swapchain = NULL;
@@ -41,106 +297,140 @@ void destroy_swapchain(renderer* render, bool destroySwapchain) {
 }
 
 void renderer_destroy(renderer* render) {
+    framegraph_log_timings(render->framegraph);
+    framegraph_destroy(render->framegraph);
     destroy_swapchain(render, false);  
 
+    if (render->indirect) {
+        indirect_scene_destroy(render->indirect);
+    }
     model_unload(render->model);
     gltf_unload(render->gltf);  
+    residency_manager_destroy(render->residency);
 
-    vkDestroySemaphore(render->ctx->device->device, render->imageAvailable, NULL);
-    vkDestroySemaphore(render->ctx->device->device, render->renderFinished, NULL);
-    vkDestroyFence(render->ctx->device->device, render->inFlight, NULL);
+    for (u32 i = 0; i < FRAMES_IN_FLIGHT; i++) {
+        renderer_frame* frame = &render->frames[i];
+        vkDestroySemaphore(render->ctx->device->device, frame->imageAvailable, NULL);
+        vkDestroyFence(render->ctx->device->device, frame->inFlight, NULL);
+        if (frame->computePool != frame->commandPool) {
+            vulkan_command_pool_destroy(frame->computePool);
+        }
+        vulkan_command_pool_destroy(frame->commandPool);
+        for (u32 j = 0; j < frame->numWorkerPools; j++) {
+            vulkan_command_pool_destroy(frame->workerPools[j]);
+        }
+        free(frame->workerPools);
+        vulkan_buffer_destroy(frame->globalBuffer);
+    }
 
-    vulkan_context_destroy(render->ctx);
-    free(render);
-}
+    vulkan_descriptor_allocator_stats_log("Per-frame", &render->frameDescriptors->stats);
+    vulkan_encoder_stats_log("Last frame", &render->frameDrawStats);
+    vulkan_encoder_stats_log("Total", &render->drawStats);
+    free(render->jobDrawStats);
+    vulkan_descriptor_linear_allocator_destroy(render->frameDescriptors);
 
-typedef struct {
-    model_model* model;
-} render_data;
+    if (render->indirectLayout) {
+        vulkan_pipeline_layout_destroy(render->indirectLayout);
+        vulkan_descriptor_set_layout_destroy(render->indirectGlobalLayout);
+    }
+    vulkan_pipeline_layout_destroy(render->sceneLayout);
+    vulkan_descriptor_set_layout_destroy(render->globalLayout);
+    vulkan_bindless_table_destroy(render->bindless);
 
-void draw_models(VkCommandBuffer cmd, void* dataPtr) {
-    render_data* data = (render_data*)dataPtr;
-    model_render(data->model, cmd);
+    vulkan_context_destroy(render->ctx);
+    free(render);
 }
 
 void renderer_render(renderer* render) {
-    vulkan_shader* renderVertexShader = vulkan_shader_load_from_file(render->ctx->device, "shaders/vert.spv", VERTEX);
-	vulkan_shader* renderFragmentShader = vulkan_shader_load_from_file(render->ctx->device, "shaders/frag.spv", FRAGMENT);
-
-    framegraph_config framegraphConfig;
-    framegraphConfig.width = render->ctx->swapchain->extent.width;
-    framegraphConfig.height = render->ctx->swapchain->extent.height;
-    framegraphConfig.maxSamples = render->ctx->physical->maxSamples;
-    framegraph_framegraph* framegraph = framegraph_create(framegraphConfig);
-    
-    render_data data;
-    data.model = render->model;
-
-    framegraph_add_image(framegraph, "albedo", VK_FORMAT_R8G8B8_SRGB, true);
-    framegraph_add_image(framegraph, "depth", VK_FORMAT_D32_SFLOAT, true);
-    framegraph_add_image(framegraph, "backbuffer", render->ctx->swapchain->format, false);
-    framegraph_pass_config renderPassConfig;
-    CLEAR_MEMORY(&renderPassConfig);
-    renderPassConfig.numOutputs = 1;
-    renderPassConfig.outputs[0] = "albedo";
-    renderPassConfig.depth = "depth";
-    renderPassConfig.resolve = "backbuffer";
-    renderPassConfig.shaders.vertex = renderVertexShader;
-    renderPassConfig.shaders.fragment = renderFragmentShader;
-    renderPassConfig.dataPtr = &data;
-    renderPassConfig.execFn = draw_models;
-    framegraph_add_pass(framegraph, renderPassConfig);
-
-    framegraph_compile(framegraph);
-    framegraph_create_resources(framegraph, render->ctx);
-
-    vulkan_shader_destroy(renderVertexShader);
-	vulkan_shader_destroy(renderFragmentShader);
+    if (render->recreateSwapchain) {
+        vkDeviceWaitIdle(render->ctx->device->device);
+        destroy_swapchain(render, true);
+        create_swapchain(render);
+        // The extent is part of the hash but the backbuffer images are new even when it hasn't changed
+        framegraph_set_config(render->framegraph, get_framegraph_config(render));
+        framegraph_invalidate(render->framegraph);
+        render->recreateSwapchain = false;
+    }
+    if (gpuDrivenToggled) {
+        toggle_gpu_driven(render);
+        gpuDrivenToggled = false;
+    }
+    framegraph_update(render->framegraph, render->ctx);
 
-    vkWaitForFences(render->ctx->device->device, 1, &render->inFlight, VK_TRUE, UINT64_MAX);
+    // Only waits on the frame that last used this slot, the ones after it can still be on the GPU
+    renderer_frame* frame = &render->frames[render->frameIndex];
+    vkWaitForFences(render->ctx->device->device, 1, &frame->inFlight, VK_TRUE, UINT64_MAX);
 
+    // A suboptimal image is still acquired and its semaphore still signals, so it gets drawn and presented before recreating
     u32 imageIndex;
-    VkResult aquireResult = vkAcquireNextImageKHR(render->ctx->device->device, render->ctx->swapchain->swapchain, UINT64_MAX, render->imageAvailable, VK_NULL_HANDLE, &imageIndex);
-    if (aquireResult == VK_ERROR_OUT_OF_DATE_KHR || aquireResult == VK_SUBOPTIMAL_KHR) {
+    VkResult aquireResult = vkAcquireNextImageKHR(render->ctx->device->device, render->ctx->swapchain->swapchain, UINT64_MAX, frame->imageAvailable, VK_NULL_HANDLE, &imageIndex);
+    if (aquireResult == VK_ERROR_OUT_OF_DATE_KHR) {
+        render->recreateSwapchain = true;
+        return;
+    }
+    else if (aquireResult == VK_SUBOPTIMAL_KHR) {
         render->recreateSwapchain = true;
     }
     else if (aquireResult != VK_SUCCESS) {
         FATAL("Vulkan swapchain image aquisition failed with error code: %d", aquireResult);
     }
 
-    if (render->recreateSwapchain) {
-        destroy_swapchain(render, true);
-        create_swapchain(render);
-        render->recreateSwapchain = false;
-        return;
+    vkResetFences(render->ctx->device->device, 1, &frame->inFlight);
+    vulkan_command_pool_reset(frame->commandPool);
+    if (frame->computePool != frame->commandPool) {
+        vulkan_command_pool_reset(frame->computePool);
+    }
+    for (u32 i = 0; i < frame->numWorkerPools; i++) {
+        vulkan_command_pool_reset(frame->workerPools[i]);
     }
 
-    vkResetFences(render->ctx->device->device, 1, &render->inFlight);
-
-    if (render->cmd != NULL) {
-        vulkan_command_pool_free_buffer(render->ctx->commandPool, render->cmd);
+    vulkan_memory_new_frame(render->ctx);
+    residency_manager_begin_frame(render->residency);
+    vulkan_descriptor_linear_allocator_begin_frame(render->frameDescriptors, render->frameIndex);
+    if (memoryReportRequested) {
+        vulkan_memory_dump_json(render->ctx, MEMORY_REPORT_PATH);
+        memoryReportRequested = false;
+    }
+    if (timingsReportRequested) {
+        framegraph_log_timings(render->framegraph);
+        framegraph_dump_timings_json(render->framegraph, TIMINGS_REPORT_PATH);
+        timingsReportRequested = false;
+    }
+    vulkan_shader_library_poll(render->ctx->shaders);
+    update_global_data(render, frame);
+    if (!render->gpuDriven) {
+        model_prepare_draws(render->model, render->view);
+    } else {
+        indirect_scene_touch_resources(render->indirect);
     }
+    CLEAR_MEMORY_ARRAY(render->jobDrawStats, render->frames[0].numWorkerPools);
 
-    VkCommandBuffer cmd = framegraph_record(framegraph, render->ctx);
-    VkSubmitInfo submitInfo;
-    CLEAR_MEMORY(&submitInfo);
-    VkPipelineStageFlags waitStage = VK_PIPELINE_STAGE_COLOR_ATTACHMENT_OUTPUT_BIT;
-    submitInfo.sType = VK_STRUCTURE_TYPE_SUBMIT_INFO;
-    submitInfo.waitSemaphoreCount = 1;
-    submitInfo.pWaitSemaphores = &render->imageAvailable;
-    submitInfo.pWaitDstStageMask = &waitStage;
-    submitInfo.commandBufferCount = 1;
-    submitInfo.pCommandBuffers = &cmd;
-    submitInfo.signalSemaphoreCount = 1;
-    submitInfo.pSignalSemaphores = &render->renderFinished;
-    VkResult result = vkQueueSubmit(render->ctx->device->graphics, 1, &submitInfo, render->inFlight);
+    // The framegraph waits on the acquire and signals presenting, splitting the frame over the graphics and compute queues
+    framegraph_frame framegraphFrame;
+    CLEAR_MEMORY(&framegraphFrame);
+    framegraphFrame.pools[FRAMEGRAPH_QUEUE_GRAPHICS] = frame->commandPool;
+    framegraphFrame.pools[FRAMEGRAPH_QUEUE_COMPUTE] = frame->computePool;
+    framegraphFrame.numWorkerPools = frame->numWorkerPools;
+    framegraphFrame.workerPools = frame->workerPools;
+    framegraphFrame.frameIndex = render->frameIndex;
+    framegraphFrame.imageIndex = imageIndex;
+    framegraphFrame.imageAvailable = frame->imageAvailable;
+    framegraphFrame.renderFinished = render->renderFinished[imageIndex];
+    framegraphFrame.fence = frame->inFlight;
+    framegraph_submit(render->framegraph, render->ctx, &framegraphFrame);
+
+    CLEAR_MEMORY(&render->frameDrawStats);
+    for (u32 i = 0; i < frame->numWorkerPools; i++) {
+        vulkan_encoder_stats_add(&render->frameDrawStats, &render->jobDrawStats[i]);
+    }
+    vulkan_encoder_stats_add(&render->drawStats, &render->frameDrawStats);
 
     VkPresentInfoKHR presentInfo;
     CLEAR_MEMORY(&presentInfo);
 
     presentInfo.sType = VK_STRUCTURE_TYPE_PRESENT_INFO_KHR;
     presentInfo.waitSemaphoreCount = 1;
-    presentInfo.pWaitSemaphores = &render->renderFinished;
+    presentInfo.pWaitSemaphores = &render->renderFinished[imageIndex];
     presentInfo.swapchainCount = 1;
     presentInfo.pSwapchains = &render->ctx->swapchain->swapchain;
     presentInfo.pImageIndices = &imageIndex;
@@ -152,5 +442,7 @@ void renderer_render(renderer* render) {
     else if (presentResult != VK_SUCCESS) {
         FATAL("Vulkan swapchain presentation failed with error code: %d", presentResult);
     }
+
+    render->frameIndex = (render->frameIndex + 1) % FRAMES_IN_FLIGHT;
     INFO("Frame done");
 }
\ No newline at end of file
@@ -8,20 +8,72 @@
 #include "vulkan/pipeline.h"
 #include "vulkan/renderpass.h"
 #include "vulkan/image.h"
+#include "vulkan/bindless.h"
+#include "vulkan/shaderlibrary.h"
 #include "window.h"
 #include "model.h"
+#include "residency.h"
+#include "indirect.h"
 #include "framegraph/framegraph.h"
 
-typedef struct {
-    vulkan_context* ctx;
+// How many frames the CPU can record ahead of the GPU
+#define FRAMES_IN_FLIGHT 2
 
+// Everything a frame writes to while it is in flight, reused once its fence signals
+typedef struct {
     VkSemaphore imageAvailable;
-    VkSemaphore renderFinished;
     VkFence inFlight;
-    VkCommandBuffer cmd;
+    vulkan_command_pool* commandPool;
+    vulkan_command_pool* computePool; // The same pool as commandPool without an async compute queue
+    // One per recording thread, secondary command buffers from parallel passes come out of these
+    u32 numWorkerPools;
+    vulkan_command_pool** workerPools;
 
+    vulkan_buffer* globalBuffer;
+    vulkan_descriptor_set globalSet;
+    vulkan_descriptor_set indirectSet;
+} renderer_frame;
+
+typedef struct {
+    vulkan_context* ctx;
+
+    renderer_frame frames[FRAMES_IN_FLIGHT];
+    u32 frameIndex;
+    // One per swapchain image, the frame's fence doesn't cover the present waiting on it so a slot can't safely reuse its own
+    u32 numRenderFinished;
+    VkSemaphore* renderFinished;
+    vulkan_descriptor_linear_allocator* frameDescriptors;
+
+    vulkan_bindless_table* bindless;
+    vulkan_descriptor_set_layout* globalLayout;
+    vulkan_pipeline_layout* sceneLayout;
+
+    vulkan_shader* vertexShader;
+    vulkan_shader* fragmentShader;
+    framegraph_framegraph* framegraph;
+    framegraph_image_handle albedoImage;
+    framegraph_image_handle depthImage;
+    framegraph_image_handle backbufferImage;
+    framegraph_pass* scenePass;
+    vulkan_descriptor_set_layout* sceneSetLayouts[2];
+
+    mat4 view;
+    mat4 proj;
     gltf_gltf* gltf;
     model_model* model;
+    // One per recording job so they don't share counters, summed once recording is done
+    vulkan_encoder_stats* jobDrawStats;
+    vulkan_encoder_stats frameDrawStats;
+    vulkan_encoder_stats drawStats;
+    residency_manager* residency;
+
+    // NULL when the device can't draw with indirect counts, the shaders and layouts are only loaded once it is first switched on
+    indirect_scene* indirect;
+    bool gpuDriven;
+    vulkan_shader* indirectVertexShader;
+    vulkan_shader* cullShader;
+    vulkan_descriptor_set_layout* indirectGlobalLayout;
+    vulkan_pipeline_layout* indirectLayout;
 
     bool recreateSwapchain;
 } renderer;
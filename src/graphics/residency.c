@@ -0,0 +1,193 @@
+#include "residency.h"
+
+typedef struct {
+    model_model* model;
+    bool isImage;
+    u32 index;
+    u64 lastUsedFrame;
+} residency_candidate;
+
+residency_manager* residency_manager_create(vulkan_context* ctx, float budgetFraction, u32 framesInFlight) {
+    residency_manager* manager = malloc(sizeof(residency_manager));
+    CLEAR_MEMORY(manager);
+    manager->ctx = ctx;
+    manager->budgetFraction = budgetFraction;
+    manager->framesInFlight = framesInFlight;
+    manager->models = malloc(0);
+    manager->pendingReleases = malloc(0);
+
+    return manager;
+}
+
+void residency_manager_destroy(residency_manager* manager) {
+    for (u32 i = 0; i < manager->numModels; i++) {
+        manager->models[i]->residency = NULL;
+    }
+    INFO("Residency manager evicted %llu resources and streamed %llu back in", (unsigned long long)manager->numEvictions, (unsigned long long)manager->numStreams);
+
+    free(manager->models);
+    free(manager->pendingReleases);
+    free(manager);
+}
+
+void residency_manager_register_model(residency_manager* manager, model_model* model) {
+    manager->numModels++;
+    manager->models = realloc(manager->models, sizeof(model_model*) * manager->numModels);
+    manager->models[manager->numModels - 1] = model;
+    model->residency = manager;
+
+    for (u32 i = 0; i < model->gltf->numBuffers; i++) {
+        model->bufferStates[i].lastUsedFrame = manager->frame;
+        if (model->bufferStates[i].resident) manager->residentBytes += model->bufferStates[i].size;
+    }
+    for (u32 i = 0; i < model->gltf->numImages; i++) {
+        model->imageStates[i].lastUsedFrame = manager->frame;
+        if (model->imageStates[i].resident) manager->residentBytes += model->imageStates[i].size;
+    }
+}
+
+void residency_manager_unregister_model(residency_manager* manager, model_model* model) {
+    for (u32 i = 0; i < manager->numModels; i++) {
+        if (manager->models[i] == model) {
+            manager->models[i] = manager->models[manager->numModels - 1];
+            manager->numModels--;
+            break;
+        }
+    }
+
+    u32 release = 0;
+    while (release < manager->numPendingReleases) {
+        if (manager->pendingReleases[release].model == model) {
+            manager->pendingReleases[release] = manager->pendingReleases[manager->numPendingReleases - 1];
+            manager->numPendingReleases--;
+        } else {
+            release++;
+        }
+    }
+
+    for (u32 i = 0; i < model->gltf->numBuffers; i++) {
+        if (model->bufferStates[i].resident) manager->residentBytes -= model->bufferStates[i].size;
+    }
+    for (u32 i = 0; i < model->gltf->numImages; i++) {
+        if (model->imageStates[i].resident) manager->residentBytes -= model->imageStates[i].size;
+    }
+    model->residency = NULL;
+}
+
+void residency_manager_touch_buffer(residency_manager* manager, model_model* model, u32 index) {
+    model_resource_state* state = &model->bufferStates[index];
+    state->lastUsedFrame = manager->frame;
+
+    if (!state->resident) {
+        model_upload_buffer(model, index);
+        manager->residentBytes += state->size;
+        manager->numStreams++;
+    }
+}
+
+void residency_manager_touch_image(residency_manager* manager, model_model* model, u32 index) {
+    model_resource_state* state = &model->imageStates[index];
+    state->lastUsedFrame = manager->frame;
+
+    if (!state->resident) {
+        model_upload_image(model, index);
+        manager->residentBytes += state->size;
+        manager->numStreams++;
+    }
+}
+
+void evict(residency_manager* manager, residency_candidate* candidate) {
+    model_model* model = candidate->model;
+    model_resource_state* state;
+    if (candidate->isImage) {
+        state = &model->imageStates[candidate->index];
+        model_evict_image(model, candidate->index);
+    } else {
+        state = &model->bufferStates[candidate->index];
+        model_evict_buffer(model, candidate->index);
+    }
+
+    manager->residentBytes -= state->size;
+    manager->numEvictions++;
+}
+
+int compare_candidates(const void* a, const void* b) {
+    u64 frameA = ((const residency_candidate*)a)->lastUsedFrame;
+    u64 frameB = ((const residency_candidate*)b)->lastUsedFrame;
+    return (frameA > frameB) - (frameA < frameB);
+}
+
+void release_cpu_copies(model_model* model) {
+    for (u32 i = 0; i < model->gltf->numBuffers; i++) {
+        gltf_buffer_release_data(&model->gltf->buffers[i]);
+    }
+}
+
+void residency_manager_begin_frame(residency_manager* manager) {
+    manager->frame++;
+
+    u32 releaseIndex = 0;
+    while (releaseIndex < manager->numPendingReleases) {
+        residency_pending_release* release = &manager->pendingReleases[releaseIndex];
+        if (vkGetFenceStatus(manager->ctx->device->device, release->fence) == VK_SUCCESS) {
+            release_cpu_copies(release->model);
+            *release = manager->pendingReleases[manager->numPendingReleases - 1];
+            manager->numPendingReleases--;
+        } else {
+            releaseIndex++;
+        }
+    }
+
+    // Whatever else is allocated on the device (framegraph images, staging, other processes) comes out of the budget first
+    u64 deviceUsage, deviceBudget;
+    vulkan_memory_get_device_budget(manager->ctx, &deviceUsage, &deviceBudget);
+    u64 otherUsage = deviceUsage > manager->residentBytes ? deviceUsage - manager->residentBytes : 0;
+    u64 available = (u64)((double)deviceBudget * manager->budgetFraction);
+    manager->budget = available > otherUsage ? available - otherUsage : 0;
+
+    if (manager->residentBytes <= manager->budget) return;
+
+    // Anything used by a frame that may still be executing on the GPU can't be evicted
+    u32 numCandidates = 0;
+    residency_candidate* candidates = malloc(0);
+    for (u32 i = 0; i < manager->numModels; i++) {
+        model_model* model = manager->models[i];
+        u32 numResources = model->gltf->numBuffers + model->gltf->numImages;
+        candidates = realloc(candidates, sizeof(residency_candidate) * (numCandidates + numResources));
+
+        for (u32 j = 0; j < numResources; j++) {
+            bool isImage = j >= model->gltf->numBuffers;
+            u32 index = isImage ? j - model->gltf->numBuffers : j;
+            model_resource_state* state = isImage ? &model->imageStates[index] : &model->bufferStates[index];
+            if (!state->resident || state->lastUsedFrame + manager->framesInFlight >= manager->frame) continue;
+
+            candidates[numCandidates].model = model;
+            candidates[numCandidates].isImage = isImage;
+            candidates[numCandidates].index = index;
+            candidates[numCandidates].lastUsedFrame = state->lastUsedFrame;
+            numCandidates++;
+        }
+    }
+
+    qsort(candidates, numCandidates, sizeof(residency_candidate), compare_candidates);
+    for (u32 i = 0; i < numCandidates && manager->residentBytes > manager->budget; i++) {
+        evict(manager, &candidates[i]);
+    }
+    free(candidates);
+
+    if (manager->residentBytes > manager->budget) {
+        DEBUG("Resident set (%llu bytes) is over budget (%llu bytes) but everything left is in use", (unsigned long long)manager->residentBytes, (unsigned long long)manager->budget);
+    }
+}
+
+void residency_manager_release_cpu_copies(residency_manager* manager, model_model* model, VkFence uploadFence) {
+    if (uploadFence == VK_NULL_HANDLE) {
+        release_cpu_copies(model);
+        return;
+    }
+
+    manager->numPendingReleases++;
+    manager->pendingReleases = realloc(manager->pendingReleases, sizeof(residency_pending_release) * manager->numPendingReleases);
+    manager->pendingReleases[manager->numPendingReleases - 1].model = model;
+    manager->pendingReleases[manager->numPendingReleases - 1].fence = uploadFence;
+}
\ No newline at end of file
@@ -0,0 +1,43 @@
+#pragma once
+
+#include "core/core.h"
+#include "vulkan/vulkan.h"
+#include "vulkan/context.h"
+
+#include "model.h"
+
+typedef struct {
+    model_model* model;
+    VkFence fence;
+} residency_pending_release;
+
+typedef struct residency_manager_t {
+    vulkan_context* ctx;
+
+    float budgetFraction; // Of the device local budget, recomputed every frame from VMA's heap budgets
+    u64 budget;
+    u64 residentBytes;
+    u64 frame;
+    u32 framesInFlight;
+
+    u32 numModels;
+    model_model** models;
+
+    u32 numPendingReleases;
+    residency_pending_release* pendingReleases;
+
+    u64 numEvictions;
+    u64 numStreams;
+} residency_manager;
+
+residency_manager* residency_manager_create(vulkan_context* ctx, float budgetFraction, u32 framesInFlight);
+void residency_manager_destroy(residency_manager* manager);
+
+void residency_manager_register_model(residency_manager* manager, model_model* model);
+void residency_manager_unregister_model(residency_manager* manager, model_model* model);
+
+void residency_manager_touch_buffer(residency_manager* manager, model_model* model, u32 index);
+void residency_manager_touch_image(residency_manager* manager, model_model* model, u32 index);
+
+void residency_manager_begin_frame(residency_manager* manager);
+void residency_manager_release_cpu_copies(residency_manager* manager, model_model* model, VkFence uploadFence);
\ No newline at end of file
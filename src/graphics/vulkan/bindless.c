@@ -0,0 +1,212 @@
+#include "bindless.h"
+
+void slots_create(vulkan_bindless_slots* slots, u32 capacity) {
+    CLEAR_MEMORY(slots);
+    slots->capacity = capacity;
+    slots->free = malloc(sizeof(u32) * capacity);
+}
+
+u32 slots_acquire(vulkan_bindless_slots* slots, const char* kind) {
+    if (slots->numFree != 0) {
+        return slots->free[--slots->numFree];
+    }
+    if (slots->next == slots->capacity) {
+        FATAL("Bindless %s table is full (%d entries)", kind, slots->capacity);
+    }
+    return slots->next++;
+}
+
+void slots_release(vulkan_bindless_slots* slots, u32 index) {
+    slots->free[slots->numFree++] = index;
+}
+
+void write_descriptor(vulkan_bindless_table* table, u32 binding, u32 index, VkDescriptorType type, VkDescriptorImageInfo* imageInfo, VkDescriptorBufferInfo* bufferInfo) {
+    VkWriteDescriptorSet writeInfo;
+    CLEAR_MEMORY(&writeInfo);
+
+    writeInfo.sType = VK_STRUCTURE_TYPE_WRITE_DESCRIPTOR_SET;
+    writeInfo.dstSet = table->set;
+    writeInfo.dstBinding = binding;
+    writeInfo.dstArrayElement = index;
+    writeInfo.descriptorCount = 1;
+    writeInfo.descriptorType = type;
+    writeInfo.pImageInfo = imageInfo;
+    writeInfo.pBufferInfo = bufferInfo;
+
+    vkUpdateDescriptorSets(table->ctx->device->device, 1, &writeInfo, 0, NULL);
+}
+
+vulkan_bindless_table* vulkan_bindless_table_create(vulkan_context* ctx) {
+    vulkan_bindless_table* table = malloc(sizeof(vulkan_bindless_table));
+    CLEAR_MEMORY(table);
+    table->ctx = ctx;
+
+    u32 numBindings = 3;
+    VkDescriptorSetLayoutBinding* bindings = malloc(sizeof(VkDescriptorSetLayoutBinding) * numBindings);
+    CLEAR_MEMORY_ARRAY(bindings, numBindings);
+    bindings[0].binding = BINDLESS_IMAGE_BINDING;
+    bindings[0].descriptorType = VK_DESCRIPTOR_TYPE_SAMPLED_IMAGE;
+    bindings[0].descriptorCount = BINDLESS_MAX_IMAGES;
+    bindings[0].stageFlags = VK_SHADER_STAGE_FRAGMENT_BIT;
+    bindings[1].binding = BINDLESS_SAMPLER_BINDING;
+    bindings[1].descriptorType = VK_DESCRIPTOR_TYPE_SAMPLER;
+    bindings[1].descriptorCount = BINDLESS_MAX_SAMPLERS;
+    bindings[1].stageFlags = VK_SHADER_STAGE_FRAGMENT_BIT;
+    bindings[2].binding = BINDLESS_BUFFER_BINDING;
+    bindings[2].descriptorType = VK_DESCRIPTOR_TYPE_STORAGE_BUFFER;
+    bindings[2].descriptorCount = BINDLESS_MAX_BUFFERS;
+    bindings[2].stageFlags = VK_SHADER_STAGE_VERTEX_BIT | VK_SHADER_STAGE_FRAGMENT_BIT;
+
+    // Slots are filled and replaced while the set is bound, and most of them are never written at all
+    VkDescriptorBindingFlags bindingFlags[3];
+    for (u32 i = 0; i < numBindings; i++) {
+        bindingFlags[i] = VK_DESCRIPTOR_BINDING_PARTIALLY_BOUND_BIT | VK_DESCRIPTOR_BINDING_UPDATE_AFTER_BIND_BIT | VK_DESCRIPTOR_BINDING_UPDATE_UNUSED_WHILE_PENDING_BIT;
+    }
+
+    VkDescriptorSetLayoutBindingFlagsCreateInfo bindingFlagsInfo;
+    CLEAR_MEMORY(&bindingFlagsInfo);
+    bindingFlagsInfo.sType = VK_STRUCTURE_TYPE_DESCRIPTOR_SET_LAYOUT_BINDING_FLAGS_CREATE_INFO;
+    bindingFlagsInfo.bindingCount = numBindings;
+    bindingFlagsInfo.pBindingFlags = bindingFlags;
+
+    VkDescriptorSetLayoutCreateInfo layoutInfo;
+    CLEAR_MEMORY(&layoutInfo);
+    layoutInfo.sType = VK_STRUCTURE_TYPE_DESCRIPTOR_SET_LAYOUT_CREATE_INFO;
+    layoutInfo.pNext = &bindingFlagsInfo;
+    layoutInfo.flags = VK_DESCRIPTOR_SET_LAYOUT_CREATE_UPDATE_AFTER_BIND_POOL_BIT;
+    layoutInfo.bindingCount = numBindings;
+    layoutInfo.pBindings = bindings;
+
+    table->layout = malloc(sizeof(vulkan_descriptor_set_layout));
+    CLEAR_MEMORY(table->layout);
+    table->layout->device = ctx->device;
+    table->layout->numBindings = numBindings;
+    table->layout->bindings = bindings;
+    table->layout->refCount = 1; // Kept out of the device's layout cache since the cache doesn't key on binding flags
+
+    VkResult layoutResult = vkCreateDescriptorSetLayout(ctx->device->device, &layoutInfo, NULL, &table->layout->layout);
+    if (layoutResult != VK_SUCCESS) {
+        FATAL("Vulkan bindless descriptor set layout creation failed with error code: %d", layoutResult);
+    }
+
+    VkDescriptorPoolSize poolSizes[3];
+    for (u32 i = 0; i < numBindings; i++) {
+        poolSizes[i].type = bindings[i].descriptorType;
+        poolSizes[i].descriptorCount = bindings[i].descriptorCount;
+    }
+
+    VkDescriptorPoolCreateInfo poolInfo;
+    CLEAR_MEMORY(&poolInfo);
+    poolInfo.sType = VK_STRUCTURE_TYPE_DESCRIPTOR_POOL_CREATE_INFO;
+    poolInfo.flags = VK_DESCRIPTOR_POOL_CREATE_UPDATE_AFTER_BIND_BIT;
+    poolInfo.maxSets = 1;
+    poolInfo.poolSizeCount = numBindings;
+    poolInfo.pPoolSizes = poolSizes;
+
+    VkResult poolResult = vkCreateDescriptorPool(ctx->device->device, &poolInfo, NULL, &table->pool);
+    if (poolResult != VK_SUCCESS) {
+        FATAL("Vulkan bindless descriptor pool creation failed with error code: %d", poolResult);
+    }
+
+    VkDescriptorSetAllocateInfo allocInfo;
+    CLEAR_MEMORY(&allocInfo);
+    allocInfo.sType = VK_STRUCTURE_TYPE_DESCRIPTOR_SET_ALLOCATE_INFO;
+    allocInfo.descriptorPool = table->pool;
+    allocInfo.descriptorSetCount = 1;
+    allocInfo.pSetLayouts = &table->layout->layout;
+
+    VkResult setResult = vkAllocateDescriptorSets(ctx->device->device, &allocInfo, &table->set);
+    if (setResult != VK_SUCCESS) {
+        FATAL("Vulkan bindless descriptor set allocation failed with error code: %d", setResult);
+    }
+
+    slots_create(&table->images, BINDLESS_MAX_IMAGES);
+    slots_create(&table->samplers, BINDLESS_MAX_SAMPLERS);
+    slots_create(&table->buffers, BINDLESS_MAX_BUFFERS);
+
+    table->defaultSampler = vulkan_sampler_create(ctx, VK_FILTER_LINEAR, VK_FILTER_LINEAR, VK_SAMPLER_ADDRESS_MODE_REPEAT, VK_SAMPLER_ADDRESS_MODE_REPEAT);
+    vulkan_bindless_table_add_image(table, vulkan_image_get_default_color_texture(ctx));
+    vulkan_bindless_table_add_sampler(table, table->defaultSampler);
+
+    return table;
+}
+
+void vulkan_bindless_table_destroy(vulkan_bindless_table* table) {
+    vkDestroyDescriptorPool(table->ctx->device->device, table->pool, NULL);
+    vulkan_descriptor_set_layout_destroy(table->layout);
+    vulkan_sampler_destroy(table->defaultSampler);
+
+    free(table->images.free);
+    free(table->samplers.free);
+    free(table->buffers.free);
+    free(table);
+}
+
+u32 vulkan_bindless_table_add_image(vulkan_bindless_table* table, vulkan_image* image) {
+    u32 index = slots_acquire(&table->images, "image");
+    vulkan_bindless_table_update_image(table, index, image);
+    return index;
+}
+
+void vulkan_bindless_table_update_image(vulkan_bindless_table* table, u32 index, vulkan_image* image) {
+    VkDescriptorImageInfo imageInfo;
+    CLEAR_MEMORY(&imageInfo);
+    imageInfo.imageLayout = VK_IMAGE_LAYOUT_SHADER_READ_ONLY_OPTIMAL;
+    imageInfo.imageView = image->imageView;
+
+    write_descriptor(table, BINDLESS_IMAGE_BINDING, index, VK_DESCRIPTOR_TYPE_SAMPLED_IMAGE, &imageInfo, NULL);
+}
+
+void vulkan_bindless_table_remove_image(vulkan_bindless_table* table, u32 index) {
+    // Point the slot at the default texture so a stale index samples white rather than a destroyed view
+    vulkan_bindless_table_update_image(table, index, vulkan_image_get_default_color_texture(table->ctx));
+    slots_release(&table->images, index);
+}
+
+u32 vulkan_bindless_table_add_sampler(vulkan_bindless_table* table, vulkan_sampler* sampler) {
+    for (u32 i = 0; i < table->samplers.next; i++) {
+        if (table->samplerEntries[i] == sampler) {
+            table->samplerRefCounts[i]++;
+            return i;
+        }
+    }
+
+    u32 index = slots_acquire(&table->samplers, "sampler");
+    table->samplerEntries[index] = sampler;
+    table->samplerRefCounts[index] = 1;
+
+    VkDescriptorImageInfo imageInfo;
+    CLEAR_MEMORY(&imageInfo);
+    imageInfo.sampler = sampler->sampler;
+
+    write_descriptor(table, BINDLESS_SAMPLER_BINDING, index, VK_DESCRIPTOR_TYPE_SAMPLER, &imageInfo, NULL);
+    return index;
+}
+
+void vulkan_bindless_table_remove_sampler(vulkan_bindless_table* table, u32 index) {
+    if (--table->samplerRefCounts[index] != 0) return;
+
+    table->samplerEntries[index] = NULL;
+    slots_release(&table->samplers, index);
+}
+
+u32 vulkan_bindless_table_add_buffer(vulkan_bindless_table* table, vulkan_buffer* buffer) {
+    u32 index = slots_acquire(&table->buffers, "buffer");
+
+    VkDescriptorBufferInfo bufferInfo;
+    CLEAR_MEMORY(&bufferInfo);
+    bufferInfo.buffer = buffer->buffer;
+    bufferInfo.offset = 0;
+    bufferInfo.range = VK_WHOLE_SIZE;
+
+    write_descriptor(table, BINDLESS_BUFFER_BINDING, index, VK_DESCRIPTOR_TYPE_STORAGE_BUFFER, NULL, &bufferInfo);
+    return index;
+}
+
+void vulkan_bindless_table_remove_buffer(vulkan_bindless_table* table, u32 index) {
+    slots_release(&table->buffers, index);
+}
+
+void vulkan_bindless_table_bind(vulkan_bindless_table* table, VkCommandBuffer cmd, vulkan_pipeline_layout* layout, u32 setIndex) {
+    vkCmdBindDescriptorSets(cmd, VK_PIPELINE_BIND_POINT_GRAPHICS, layout->layout, setIndex, 1, &table->set, 0, NULL);
+}
\ No newline at end of file
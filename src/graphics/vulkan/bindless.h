@@ -0,0 +1,63 @@
+#pragma once
+
+#include "core/core.h"
+#include "vulkan/vulkan.h"
+
+#include "context.h"
+#include "buffer.h"
+#include "image.h"
+#include "descriptor.h"
+#include "pipeline.h"
+
+#define BINDLESS_MAX_IMAGES 16384
+#define BINDLESS_MAX_SAMPLERS 256
+#define BINDLESS_MAX_BUFFERS 1024
+
+#define BINDLESS_IMAGE_BINDING 0
+#define BINDLESS_SAMPLER_BINDING 1
+#define BINDLESS_BUFFER_BINDING 2
+
+// Slot 0 of the image and sampler arrays always holds a usable default so a missing texture never needs a special case
+#define BINDLESS_DEFAULT_IMAGE 0
+#define BINDLESS_DEFAULT_SAMPLER 0
+#define BINDLESS_INVALID_INDEX UINT32_MAX
+
+typedef struct {
+    u32 capacity;
+    u32 next;
+    u32 numFree;
+    u32* free;
+} vulkan_bindless_slots;
+
+typedef struct {
+    vulkan_context* ctx;
+
+    vulkan_descriptor_set_layout* layout;
+    VkDescriptorPool pool;
+    VkDescriptorSet set;
+
+    vulkan_bindless_slots images;
+    vulkan_bindless_slots samplers;
+    vulkan_bindless_slots buffers;
+
+    vulkan_sampler* defaultSampler;
+
+    // Cached samplers are shared, so a sampler added twice reuses its slot
+    vulkan_sampler* samplerEntries[BINDLESS_MAX_SAMPLERS];
+    u32 samplerRefCounts[BINDLESS_MAX_SAMPLERS];
+} vulkan_bindless_table;
+
+vulkan_bindless_table* vulkan_bindless_table_create(vulkan_context* ctx);
+void vulkan_bindless_table_destroy(vulkan_bindless_table* table);
+
+u32 vulkan_bindless_table_add_image(vulkan_bindless_table* table, vulkan_image* image);
+void vulkan_bindless_table_update_image(vulkan_bindless_table* table, u32 index, vulkan_image* image);
+void vulkan_bindless_table_remove_image(vulkan_bindless_table* table, u32 index);
+
+u32 vulkan_bindless_table_add_sampler(vulkan_bindless_table* table, vulkan_sampler* sampler);
+void vulkan_bindless_table_remove_sampler(vulkan_bindless_table* table, u32 index);
+
+u32 vulkan_bindless_table_add_buffer(vulkan_bindless_table* table, vulkan_buffer* buffer);
+void vulkan_bindless_table_remove_buffer(vulkan_bindless_table* table, u32 index);
+
+void vulkan_bindless_table_bind(vulkan_bindless_table* table, VkCommandBuffer cmd, vulkan_pipeline_layout* layout, u32 setIndex);
\ No newline at end of file
@@ -1,6 +1,6 @@
 #include "buffer.h"
 
-vulkan_buffer* vulkan_buffer_create(vulkan_context* ctx, VkBufferUsageFlags usage, u64 size) {
+vulkan_buffer* vulkan_buffer_create(vulkan_context* ctx, VkBufferUsageFlags usage, u64 size, vulkan_memory_category category) {
     VkBufferCreateInfo createInfo;
     CLEAR_MEMORY(&createInfo);
     createInfo.sType = VK_STRUCTURE_TYPE_BUFFER_CREATE_INFO;
@@ -14,21 +14,24 @@ vulkan_buffer* vulkan_buffer_create(vulkan_context* ctx, VkBufferUsageFlags usag
     vulkan_buffer* buffer = malloc(sizeof(vulkan_buffer));
     buffer->ctx = ctx;
     buffer->size = size;
+    buffer->category = category;
     VkResult result = vmaCreateBuffer(ctx->allocator, &createInfo, &allocInfo, &buffer->buffer, &buffer->allocation, NULL);
     if (result != VK_SUCCESS) {
         FATAL("Vulkan buffer creation failed with error code: %d", result);
     }
+    vulkan_memory_track_allocation(ctx, category, buffer->allocation);
 
     return buffer;
 }
 
-vulkan_buffer* vulkan_buffer_create_with_data(vulkan_context* context, VkBufferUsageFlags usage, u64 size, void* data) {
-    vulkan_buffer* buffer = vulkan_buffer_create(context, usage, size);
+vulkan_buffer* vulkan_buffer_create_with_data(vulkan_context* context, VkBufferUsageFlags usage, u64 size, vulkan_memory_category category, void* data) {
+    vulkan_buffer* buffer = vulkan_buffer_create(context, usage, size, category);
     vulkan_buffer_update(buffer, size, data);
     return buffer;
 }
 
 void vulkan_buffer_destroy(vulkan_buffer* buffer) {
+    vulkan_memory_track_free(buffer->ctx, buffer->category, buffer->allocation);
     vmaDestroyBuffer(buffer->ctx->allocator, buffer->buffer, buffer->allocation);
     free(buffer);
 }
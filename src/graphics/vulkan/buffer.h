@@ -10,10 +10,11 @@ typedef struct {
     vulkan_context* ctx;
 
     u64 size;
+    vulkan_memory_category category;
 } vulkan_buffer;
 
-vulkan_buffer* vulkan_buffer_create(vulkan_context* context, VkBufferUsageFlags usage, u64 size);
-vulkan_buffer* vulkan_buffer_create_with_data(vulkan_context* context, VkBufferUsageFlags usage, u64 size, void* data);
+vulkan_buffer* vulkan_buffer_create(vulkan_context* context, VkBufferUsageFlags usage, u64 size, vulkan_memory_category category);
+vulkan_buffer* vulkan_buffer_create_with_data(vulkan_context* context, VkBufferUsageFlags usage, u64 size, vulkan_memory_category category, void* data);
 void vulkan_buffer_destroy(vulkan_buffer* buffer);
 
 void vulkan_buffer_update(vulkan_buffer* buffer, u64 size, void* data);
\ No newline at end of file
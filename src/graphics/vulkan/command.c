@@ -1,15 +1,18 @@
 #include "command.h"
 
-vulkan_command_pool* vulkan_command_pool_create(vulkan_device* device, u32 queueIndex) {
+vulkan_command_pool* vulkan_command_pool_create(vulkan_device* device, u32 queueIndex, VkCommandPoolCreateFlags flags) {
     VkCommandPoolCreateInfo createInfo;
     CLEAR_MEMORY(&createInfo);
 
     createInfo.sType = VK_STRUCTURE_TYPE_COMMAND_POOL_CREATE_INFO;
     createInfo.queueFamilyIndex = queueIndex;
-    createInfo.flags = VK_COMMAND_POOL_CREATE_RESET_COMMAND_BUFFER_BIT;
+    createInfo.flags = flags;
 
     vulkan_command_pool* pool = malloc(sizeof(vulkan_command_pool));
+    CLEAR_MEMORY(pool);
     pool->device = device;
+    pool->buffers[VK_COMMAND_BUFFER_LEVEL_PRIMARY] = malloc(0);
+    pool->buffers[VK_COMMAND_BUFFER_LEVEL_SECONDARY] = malloc(0);
     VkResult result = vkCreateCommandPool(device->device, &createInfo, NULL, &pool->pool);
     if (result != VK_SUCCESS) {
         FATAL("Vulkan command pool creation failed with error code: %d", result);
@@ -19,16 +22,18 @@ vulkan_command_pool* vulkan_command_pool_create(vulkan_device* device, u32 queue
 }
 void vulkan_command_pool_destroy(vulkan_command_pool* pool) {
     vkDestroyCommandPool(pool->device->device, pool->pool, NULL);
+    free(pool->buffers[VK_COMMAND_BUFFER_LEVEL_PRIMARY]);
+    free(pool->buffers[VK_COMMAND_BUFFER_LEVEL_SECONDARY]);
     free(pool);
 }
 
-VkCommandBuffer vulkan_command_pool_get_buffer(vulkan_command_pool* pool) {
+VkCommandBuffer allocate_command_buffer(vulkan_command_pool* pool, VkCommandBufferLevel level) {
     VkCommandBufferAllocateInfo allocInfo;
     CLEAR_MEMORY(&allocInfo);
 
     allocInfo.sType = VK_STRUCTURE_TYPE_COMMAND_BUFFER_ALLOCATE_INFO;
     allocInfo.commandPool = pool->pool;
-    allocInfo.level = VK_COMMAND_BUFFER_LEVEL_PRIMARY;
+    allocInfo.level = level;
     allocInfo.commandBufferCount = 1;
 
     VkCommandBuffer cmd;
@@ -40,6 +45,29 @@ VkCommandBuffer vulkan_command_pool_get_buffer(vulkan_command_pool* pool) {
     return cmd;
 }
 
+VkCommandBuffer vulkan_command_pool_get_buffer(vulkan_command_pool* pool) {
+    return allocate_command_buffer(pool, VK_COMMAND_BUFFER_LEVEL_PRIMARY);
+}
+
 void vulkan_command_pool_free_buffer(vulkan_command_pool* pool, VkCommandBuffer cmd) {
     vkFreeCommandBuffers(pool->device->device, pool->pool, 1, &cmd);
+}
+
+VkCommandBuffer vulkan_command_pool_next_buffer(vulkan_command_pool* pool, VkCommandBufferLevel level) {
+    if (pool->numUsedBuffers[level] == pool->numBuffers[level]) {
+        pool->numBuffers[level]++;
+        pool->buffers[level] = realloc(pool->buffers[level], sizeof(VkCommandBuffer) * pool->numBuffers[level]);
+        pool->buffers[level][pool->numUsedBuffers[level]] = allocate_command_buffer(pool, level);
+    }
+
+    return pool->buffers[level][pool->numUsedBuffers[level]++];
+}
+
+void vulkan_command_pool_reset(vulkan_command_pool* pool) {
+    VkResult result = vkResetCommandPool(pool->device->device, pool->pool, 0);
+    if (result != VK_SUCCESS) {
+        FATAL("Vulkan command pool reset failed with error code: %d", result);
+    }
+    pool->numUsedBuffers[VK_COMMAND_BUFFER_LEVEL_PRIMARY] = 0;
+    pool->numUsedBuffers[VK_COMMAND_BUFFER_LEVEL_SECONDARY] = 0;
 }
\ No newline at end of file
@@ -7,10 +7,21 @@
 typedef struct {
     VkCommandPool pool;
     vulkan_device* device;
+
+    // Buffers handed out by next_buffer, kept allocated so resetting the pool recycles them, indexed by VkCommandBufferLevel
+    u32 numBuffers[2];
+    u32 numUsedBuffers[2];
+    VkCommandBuffer* buffers[2];
 } vulkan_command_pool;
 
-vulkan_command_pool* vulkan_command_pool_create(vulkan_device* device, u32 queueIndex);
+vulkan_command_pool* vulkan_command_pool_create(vulkan_device* device, u32 queueIndex, VkCommandPoolCreateFlags flags);
 void vulkan_command_pool_destroy(vulkan_command_pool* pool);
 
+// One off buffers, the pool needs VK_COMMAND_POOL_CREATE_RESET_COMMAND_BUFFER_BIT to free them individually
 VkCommandBuffer vulkan_command_pool_get_buffer(vulkan_command_pool* pool);
-void vulkan_command_pool_free_buffer(vulkan_command_pool* pool, VkCommandBuffer cmd);
\ No newline at end of file
+void vulkan_command_pool_free_buffer(vulkan_command_pool* pool, VkCommandBuffer cmd);
+
+// Recycled buffers, only valid until the pool is next reset
+VkCommandBuffer vulkan_command_pool_next_buffer(vulkan_command_pool* pool, VkCommandBufferLevel level);
+// Resets every buffer allocated from the pool at once, none of them can still be executing
+void vulkan_command_pool_reset(vulkan_command_pool* pool);
\ No newline at end of file
@@ -1,9 +1,16 @@
 #include "context.h"
 
+#include "pso.h"
+#include "shaderlibrary.h"
+#include "image.h"
+
+#define PIPELINE_CACHE_PATH "pipeline_cache.bin"
+
 vulkan_context* vulkan_context_create(window* win)
 {
 	vulkan_context* ctx = malloc(sizeof(vulkan_context));
 	ctx->win = win;
+	ctx->defaultColorTexture = NULL;
 
 	u32 numGlfwExtensions;
 	const char** glfwExtensions = glfwGetRequiredInstanceExtensions(&numGlfwExtensions);
@@ -26,12 +33,19 @@ vulkan_context* vulkan_context_create(window* win)
 	}
 	INFO("Created vulkan surface");
 
-	const char* deviceExtensions[] = { VK_KHR_SWAPCHAIN_EXTENSION_NAME };
+	u32 numDeviceExtensions = 1;
+	const char* deviceExtensions[2] = { VK_KHR_SWAPCHAIN_EXTENSION_NAME };
 
-	ctx->physical = vulkan_physical_device_create(ctx->instance, ctx->surface, 1, deviceExtensions);
+	ctx->physical = vulkan_physical_device_create(ctx->instance, ctx->surface, numDeviceExtensions, deviceExtensions);
 	INFO("Using GPU: %s", ctx->physical->properties.deviceName);
 
-	ctx->device = vulkan_device_create(ctx->instance, ctx->physical, 1, deviceExtensions, 1, layers);
+	// Budget tracking is optional, without it VMA estimates the budget from the heap sizes
+	bool memoryBudget = vulkan_physical_device_has_extension(ctx->physical, VK_EXT_MEMORY_BUDGET_EXTENSION_NAME);
+	if (memoryBudget) {
+		deviceExtensions[numDeviceExtensions++] = VK_EXT_MEMORY_BUDGET_EXTENSION_NAME;
+	}
+
+	ctx->device = vulkan_device_create(ctx->instance, ctx->physical, numDeviceExtensions, deviceExtensions, 1, layers);
 	INFO("Created vulkan device");
 
 	VmaAllocatorCreateInfo allocatorCreateInfo;
@@ -40,6 +54,9 @@ vulkan_context* vulkan_context_create(window* win)
 	allocatorCreateInfo.physicalDevice = ctx->physical->physical;
 	allocatorCreateInfo.device = ctx->device->device;
 	allocatorCreateInfo.instance = ctx->instance->instance;
+	if (memoryBudget) {
+		allocatorCreateInfo.flags |= VMA_ALLOCATOR_CREATE_EXT_MEMORY_BUDGET_BIT;
+	}
 
 	VkResult allocatorResult = vmaCreateAllocator(&allocatorCreateInfo, &ctx->allocator);
 	if (allocatorResult != VK_SUCCESS) {
@@ -47,10 +64,22 @@ vulkan_context* vulkan_context_create(window* win)
 	}
 	INFO("Created VMA allocator");
 
+	ctx->memory = vulkan_memory_tracker_create(ctx);
+
+	ctx->device->pipelineCache = vulkan_pipeline_cache_create(ctx->device, PIPELINE_CACHE_PATH);
+	INFO("Created pipeline cache");
+
+	// Leave a core for the main thread
+	u32 numCores = thread_hardware_concurrency();
+	ctx->jobs = job_pool_create(numCores > 1 ? numCores - 1 : 1);
+	ctx->psos = vulkan_pso_cache_create(ctx->device, ctx->jobs);
+	ctx->shaders = vulkan_shader_library_create(ctx->device, ctx->psos);
+	INFO("Created %d worker threads", ctx->jobs->numThreads);
+
 	ctx->swapchain = vulkan_swapchain_create(ctx, win, ctx->surface);
 	INFO("Created swapchain");
 
-	ctx->commandPool = vulkan_command_pool_create(ctx->device, ctx->physical->queues.graphicsIndex);
+	ctx->commandPool = vulkan_command_pool_create(ctx->device, ctx->physical->queues.graphicsIndex, VK_COMMAND_POOL_CREATE_RESET_COMMAND_BUFFER_BIT);
 	INFO("Created command pool");
 
 	return ctx;
@@ -60,7 +89,15 @@ void vulkan_context_destroy(vulkan_context* ctx)
 {
 	vulkan_command_pool_destroy(ctx->commandPool);
 	vulkan_swapchain_destroy(ctx->swapchain);
+	if (ctx->defaultColorTexture) {
+		vulkan_image_destroy(ctx->defaultColorTexture);
+	}
+	vulkan_memory_tracker_destroy(ctx->memory);
+	vulkan_shader_library_destroy(ctx->shaders);
+	vulkan_pso_cache_destroy(ctx->psos);
+	job_pool_destroy(ctx->jobs);
 	vmaDestroyAllocator(ctx->allocator);
+	vulkan_pipeline_cache_destroy(ctx->device->pipelineCache);
 	vulkan_device_destroy(ctx->device);
 	vulkan_physical_device_destroy(ctx->physical);
 	vkDestroySurfaceKHR(ctx->instance->instance, ctx->surface, NULL);
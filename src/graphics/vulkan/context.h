@@ -10,12 +10,25 @@
 #include "device.h"
 #include "swapchain.h"
 #include "command.h"
+#include "memory.h"
+#include "pipelinecache.h"
+#include "core/jobs.h"
+
+// Both of these build pipelines, which need most of the other vulkan headers, so they are included where they're used
+typedef struct _vulkan_pso_cache vulkan_pso_cache;
+typedef struct _vulkan_shader_library vulkan_shader_library;
+typedef struct _vulkan_image vulkan_image;
 
 typedef struct _vulkan_context {
 	vulkan_instance*        instance;
 	vulkan_physical_device* physical;
 	vulkan_device*          device;
 	VmaAllocator            allocator;
+	vulkan_memory_tracker*  memory;
+	job_pool*               jobs;
+	vulkan_pso_cache*       psos;
+	vulkan_shader_library*  shaders;
+	vulkan_image*           defaultColorTexture; // Created on first use, released before the memory tracker reports leaks
 
 	VkSurfaceKHR surface;
 	vulkan_swapchain* swapchain;
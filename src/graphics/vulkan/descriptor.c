@@ -1,5 +1,7 @@
 #include "descriptor.h"
 
+#include "core/hash.h"
+
 vulkan_descriptor_set_layout_builder* vulkan_descriptor_set_layout_builder_create() {
     vulkan_descriptor_set_layout_builder* builder = malloc(sizeof(vulkan_descriptor_set_layout_builder));
     CLEAR_MEMORY(builder);
@@ -9,7 +11,40 @@ vulkan_descriptor_set_layout_builder* vulkan_descriptor_set_layout_builder_creat
     return builder;
 }
 
+u64 hash_set_layout_bindings(u32 numBindings, VkDescriptorSetLayoutBinding* bindings) {
+    u64 hash = hash_u64(numBindings, HASH_SEED);
+    for (u32 i = 0; i < numBindings; i++) {
+        hash = hash_u64(bindings[i].binding, hash);
+        hash = hash_u64(bindings[i].descriptorType, hash);
+        hash = hash_u64(bindings[i].descriptorCount, hash);
+        hash = hash_u64(bindings[i].stageFlags, hash);
+        hash = hash_u64((u64)(uintptr_t)bindings[i].pImmutableSamplers, hash);
+    }
+    return hash;
+}
+
+bool set_layout_bindings_equal(vulkan_descriptor_set_layout* layout, u32 numBindings, VkDescriptorSetLayoutBinding* bindings) {
+    if (layout->numBindings != numBindings) return false;
+    for (u32 i = 0; i < numBindings; i++) {
+        if (layout->bindings[i].binding != bindings[i].binding ||
+            layout->bindings[i].descriptorType != bindings[i].descriptorType ||
+            layout->bindings[i].descriptorCount != bindings[i].descriptorCount ||
+            layout->bindings[i].stageFlags != bindings[i].stageFlags ||
+            layout->bindings[i].pImmutableSamplers != bindings[i].pImmutableSamplers) return false;
+    }
+    return true;
+}
+
 vulkan_descriptor_set_layout* vulkan_descriptor_set_layout_builder_build(vulkan_descriptor_set_layout_builder* builder, vulkan_device* device) {
+    u64 hash = hash_set_layout_bindings(builder->numBindings, builder->bindings);
+    vulkan_descriptor_set_layout* cached = hashmap_get(device->setLayoutCache, hash);
+    if (cached != NULL && set_layout_bindings_equal(cached, builder->numBindings, builder->bindings)) {
+        cached->refCount++;
+        free(builder->bindings);
+        free(builder);
+        return cached;
+    }
+
     VkDescriptorSetLayoutCreateInfo createInfo;
     CLEAR_MEMORY(&createInfo);
 
@@ -18,15 +53,23 @@ vulkan_descriptor_set_layout* vulkan_descriptor_set_layout_builder_build(vulkan_
     createInfo.pBindings = builder->bindings;
 
     vulkan_descriptor_set_layout* layout = malloc(sizeof(vulkan_descriptor_set_layout));
+    CLEAR_MEMORY(layout);
     layout->device = device;
     layout->numBindings = builder->numBindings;
     layout->bindings = builder->bindings;
+    layout->hash = hash;
+    layout->refCount = 1;
 
     VkResult result = vkCreateDescriptorSetLayout(device->device, &createInfo, NULL, &layout->layout);
     if (result != VK_SUCCESS) {
         FATAL("Vulkan descriptor set layout creation failed with error code: %d", result);
     }
 
+    // On the off chance of a hash collision the new layout just stays out of the cache
+    if (cached == NULL) {
+        hashmap_set(device->setLayoutCache, hash, layout);
+    }
+
     free(builder); // The bindings array is now used in the descriptor set layout struct so it doesn't need to be freed
 
     return layout;
@@ -44,12 +87,34 @@ void vulkan_descriptor_set_layout_builder_add(vulkan_descriptor_set_layout_build
     builder->bindings[builder->numBindings - 1].pImmutableSamplers = NULL;
 }
 
+void vulkan_descriptor_set_layout_builder_add_binding(vulkan_descriptor_set_layout_builder* builder, u32 binding, VkDescriptorType type, u32 count, VkShaderStageFlags stages) {
+    builder->numBindings++;
+    builder->bindings = realloc(builder->bindings, sizeof(VkDescriptorSetLayoutBinding) * builder->numBindings);
+
+    builder->bindings[builder->numBindings - 1].binding = binding;
+    builder->bindings[builder->numBindings - 1].descriptorCount = count;
+    builder->bindings[builder->numBindings - 1].descriptorType = type;
+    builder->bindings[builder->numBindings - 1].stageFlags = stages;
+    builder->bindings[builder->numBindings - 1].pImmutableSamplers = NULL;
+}
+
 void vulkan_descriptor_set_layout_destroy(vulkan_descriptor_set_layout* layout) {
+    if (--layout->refCount != 0) return;
+    if (hashmap_get(layout->device->setLayoutCache, layout->hash) == layout) {
+        hashmap_remove(layout->device->setLayoutCache, layout->hash);
+    }
+
     vkDestroyDescriptorSetLayout(layout->device->device, layout->layout, NULL);
     free(layout->bindings);
     free(layout);
 }
 
+void vulkan_descriptor_allocator_stats_log(const char* name, vulkan_descriptor_allocator_stats* stats) {
+    INFO("%s descriptors: %llu allocated, %llu freed, %d live sets in %d pools (%llu pools created, %llu destroyed, %llu resets)", name,
+        (unsigned long long)stats->allocations, (unsigned long long)stats->frees, stats->liveSets, stats->livePools,
+        (unsigned long long)stats->poolsCreated, (unsigned long long)stats->poolsDestroyed, (unsigned long long)stats->poolResets);
+}
+
 vulkan_descriptor_allocator* vulkan_descriptor_allocator_create(vulkan_device* device, vulkan_descriptor_set_layout* layout) {
     vulkan_descriptor_allocator* allocator = malloc(sizeof(vulkan_descriptor_allocator));
     CLEAR_MEMORY(allocator);
@@ -60,9 +125,12 @@ vulkan_descriptor_allocator* vulkan_descriptor_allocator_create(vulkan_device* d
 
     return allocator;
 }
+
 void vulkan_descriptor_allocator_destroy(vulkan_descriptor_allocator* allocator) {
     for (u32 i = 0; i < allocator->numPools; i++) {
+        if (allocator->pools[i] == NULL) continue;
         vkDestroyDescriptorPool(allocator->device->device, allocator->pools[i]->pool, NULL);
+        free(allocator->pools[i]);
     }
     free(allocator->pools);
     free(allocator);
@@ -76,7 +144,7 @@ vulkan_descriptor_pool* vulkan_descriptor_pool_create(vulkan_device* device, vul
         allPoolSizes[i].type = i;
     }
     for (u32 i = 0; i < layout->numBindings; i++) {
-        allPoolSizes[layout->bindings[i].descriptorType].descriptorCount += SETS_PER_POOL;
+        allPoolSizes[layout->bindings[i].descriptorType].descriptorCount += SETS_PER_POOL * layout->bindings[i].descriptorCount;
     }
     VkDescriptorPoolSize poolSizes[11];
     u32 ptr = 0;
@@ -90,12 +158,16 @@ vulkan_descriptor_pool* vulkan_descriptor_pool_create(vulkan_device* device, vul
     CLEAR_MEMORY(pool);
 
     pool->device = device;
-    pool->remaining = SETS_PER_POOL;
+    pool->numFreeSlots = SETS_PER_POOL;
+    for (u32 i = 0; i < SETS_PER_POOL; i++) {
+        pool->freeSlots[i] = SETS_PER_POOL - (i + 1); // Hand out the lowest slots first
+    }
 
     VkDescriptorPoolCreateInfo createInfo;
     CLEAR_MEMORY(&createInfo);
 
     createInfo.sType = VK_STRUCTURE_TYPE_DESCRIPTOR_POOL_CREATE_INFO;
+    createInfo.flags = VK_DESCRIPTOR_POOL_CREATE_FREE_DESCRIPTOR_SET_BIT;
     createInfo.maxSets = SETS_PER_POOL;
     createInfo.poolSizeCount = ptr;
     createInfo.pPoolSizes = poolSizes;
@@ -108,38 +180,58 @@ vulkan_descriptor_pool* vulkan_descriptor_pool_create(vulkan_device* device, vul
     return pool;
 }
 
-vulkan_descriptor_set* vulkan_descriptor_set_allocate(vulkan_descriptor_allocator* allocator) {
-    if (allocator->currentPoolIndex == 0 || allocator->pools[allocator->currentPoolIndex]->remaining == 0) {
-        // No capacity remaining, need a new set
+bool pool_has_capacity(vulkan_descriptor_allocator* allocator, u32 poolIndex) {
+    return poolIndex < allocator->numPools && allocator->pools[poolIndex] != NULL && allocator->pools[poolIndex]->numFreeSlots != 0;
+}
 
-        bool freeSlot = false;
+vulkan_descriptor_set* vulkan_descriptor_set_allocate(vulkan_descriptor_allocator* allocator) {
+    if (!pool_has_capacity(allocator, allocator->currentPoolIndex)) {
+        // Prefer a pool that already exists and has had sets freed from it
+        bool found = false;
         for (u32 i = 0; i < allocator->numPools; i++) {
-            if (allocator->pools[i] == NULL) {
-                // A pool has been fully freed and destroyed so the slot can be used again
+            if (pool_has_capacity(allocator, i)) {
                 allocator->currentPoolIndex = i;
-                freeSlot = true;
+                found = true;
+                break;
             }
         }
 
-        if (!freeSlot) {
-            // No slots are free so the array must be extended and a new pool allocated
-            allocator->currentPoolIndex = allocator->numPools;
-            allocator->numPools++;
-            allocator->pools = realloc(allocator->pools, sizeof(vulkan_descriptor_pool*) * allocator->numPools);
-        }
+        if (!found) {
+            bool freeSlot = false;
+            for (u32 i = 0; i < allocator->numPools; i++) {
+                if (allocator->pools[i] == NULL) {
+                    // A pool has been fully freed and destroyed so the slot can be used again
+                    allocator->currentPoolIndex = i;
+                    freeSlot = true;
+                    break;
+                }
+            }
 
-        allocator->pools[allocator->currentPoolIndex] = vulkan_descriptor_pool_create(allocator->device, allocator->layout);
+            if (!freeSlot) {
+                // No slots are free so the array must be extended and a new pool allocated
+                allocator->currentPoolIndex = allocator->numPools;
+                allocator->numPools++;
+                allocator->pools = realloc(allocator->pools, sizeof(vulkan_descriptor_pool*) * allocator->numPools);
+            }
+
+            allocator->pools[allocator->currentPoolIndex] = vulkan_descriptor_pool_create(allocator->device, allocator->layout);
+            allocator->stats.poolsCreated++;
+            allocator->stats.livePools++;
+        }
     }
 
+    vulkan_descriptor_pool* pool = allocator->pools[allocator->currentPoolIndex];
+
     VkDescriptorSetAllocateInfo allocInfo;
     CLEAR_MEMORY(&allocInfo);
 
     allocInfo.sType = VK_STRUCTURE_TYPE_DESCRIPTOR_SET_ALLOCATE_INFO;
-    allocInfo.descriptorPool = allocator->pools[allocator->currentPoolIndex]->pool;
+    allocInfo.descriptorPool = pool->pool;
     allocInfo.descriptorSetCount = 1;
     allocInfo.pSetLayouts = &allocator->layout->layout;
 
-    vulkan_descriptor_set* set = malloc(sizeof(vulkan_descriptor_set));
+    vulkan_descriptor_set* set = &pool->sets[pool->freeSlots[pool->numFreeSlots - 1]];
+    set->device = allocator->device;
     set->allocator = allocator;
     set->poolIndex = allocator->currentPoolIndex;
 
@@ -147,37 +239,160 @@ vulkan_descriptor_set* vulkan_descriptor_set_allocate(vulkan_descriptor_allocato
     if (result != VK_SUCCESS) {
         FATAL("Vulkan descriptor set allocation failed with error code: %d", result);
     }
+    pool->numFreeSlots--;
 
-    allocator->pools[allocator->currentPoolIndex]->sets[SETS_PER_POOL - allocator->pools[allocator->currentPoolIndex]->remaining] = set;
-    allocator->pools[allocator->currentPoolIndex]->remaining--;
+    allocator->stats.allocations++;
+    allocator->stats.liveSets++;
 
     return set;
 }
 
 void vulkan_descriptor_set_free(vulkan_descriptor_set* set) {
     vulkan_descriptor_allocator* allocator = (vulkan_descriptor_allocator*)set->allocator;
-    vulkan_descriptor_pool* pool = allocator->pools[set->poolIndex];
-    
-    if (pool->freed == SETS_PER_POOL) {
-        // Pool has no descriptor sets, delete it
-        VkDescriptorSet* sets = malloc(sizeof(VkDescriptorSet) * SETS_PER_POOL);
-        for (u32 i = 0; i < SETS_PER_POOL; i++) {
-            sets[i] = pool->sets[i]->set;
-        }
+    u32 poolIndex = set->poolIndex;
+    vulkan_descriptor_pool* pool = allocator->pools[poolIndex];
 
-        vkFreeDescriptorSets(allocator->device->device, pool->pool, SETS_PER_POOL, sets);
-        for (u32 i = 0; i < SETS_PER_POOL; i++) {
-            free(pool->sets[i]);
-        }
-        free(pool->sets);
+    vkFreeDescriptorSets(allocator->device->device, pool->pool, 1, &set->set);
+    pool->freeSlots[pool->numFreeSlots++] = (u32)(set - pool->sets);
+    set->set = VK_NULL_HANDLE;
+
+    allocator->stats.frees++;
+    allocator->stats.liveSets--;
 
+    if (pool->numFreeSlots == SETS_PER_POOL && poolIndex != allocator->currentPoolIndex) {
+        // Pool has no descriptor sets and new sets are going elsewhere, delete it
         vkDestroyDescriptorPool(allocator->device->device, pool->pool, NULL);
+        free(pool);
 
-        pool = NULL; // Set the pool in the allocator's array to null so the slot can be reused
+        allocator->pools[poolIndex] = NULL; // The slot can be reused by the next pool that gets created
+        allocator->stats.poolsDestroyed++;
+        allocator->stats.livePools--;
     }
 }
 
-void vulkan_descriptor_set_write_buffer(vulkan_descriptor_set* set, u32 binding, vulkan_buffer* buffer) {
+VkDescriptorPool linear_pool_create(vulkan_device* device) {
+    // Linear pools aren't tied to one layout so they are sized for a typical mix of descriptors
+    VkDescriptorPoolSize poolSizes[] = {
+        { VK_DESCRIPTOR_TYPE_SAMPLER,                LINEAR_SETS_PER_POOL / 2 },
+        { VK_DESCRIPTOR_TYPE_COMBINED_IMAGE_SAMPLER, LINEAR_SETS_PER_POOL * 4 },
+        { VK_DESCRIPTOR_TYPE_SAMPLED_IMAGE,          LINEAR_SETS_PER_POOL * 4 },
+        { VK_DESCRIPTOR_TYPE_STORAGE_IMAGE,          LINEAR_SETS_PER_POOL },
+        { VK_DESCRIPTOR_TYPE_UNIFORM_BUFFER,         LINEAR_SETS_PER_POOL * 2 },
+        { VK_DESCRIPTOR_TYPE_STORAGE_BUFFER,         LINEAR_SETS_PER_POOL * 2 },
+        { VK_DESCRIPTOR_TYPE_UNIFORM_BUFFER_DYNAMIC, LINEAR_SETS_PER_POOL },
+        { VK_DESCRIPTOR_TYPE_STORAGE_BUFFER_DYNAMIC, LINEAR_SETS_PER_POOL },
+        { VK_DESCRIPTOR_TYPE_INPUT_ATTACHMENT,       LINEAR_SETS_PER_POOL / 2 }
+    };
+
+    VkDescriptorPoolCreateInfo createInfo;
+    CLEAR_MEMORY(&createInfo);
+
+    createInfo.sType = VK_STRUCTURE_TYPE_DESCRIPTOR_POOL_CREATE_INFO;
+    createInfo.maxSets = LINEAR_SETS_PER_POOL;
+    createInfo.poolSizeCount = sizeof(poolSizes) / sizeof(VkDescriptorPoolSize);
+    createInfo.pPoolSizes = poolSizes;
+
+    VkDescriptorPool pool;
+    VkResult result = vkCreateDescriptorPool(device->device, &createInfo, NULL, &pool);
+    if (result != VK_SUCCESS) {
+        FATAL("Vulkan descriptor pool creation failed with error code: %d", result);
+    }
+
+    return pool;
+}
+
+vulkan_descriptor_linear_allocator* vulkan_descriptor_linear_allocator_create(vulkan_device* device, u32 numFrames) {
+    vulkan_descriptor_linear_allocator* allocator = malloc(sizeof(vulkan_descriptor_linear_allocator));
+    CLEAR_MEMORY(allocator);
+
+    allocator->device = device;
+    allocator->numFrames = numFrames;
+    allocator->frames = malloc(sizeof(vulkan_descriptor_linear_frame) * numFrames);
+    CLEAR_MEMORY_ARRAY(allocator->frames, numFrames);
+    for (u32 i = 0; i < numFrames; i++) {
+        allocator->frames[i].pools = malloc(0);
+    }
+
+    return allocator;
+}
+
+void vulkan_descriptor_linear_allocator_destroy(vulkan_descriptor_linear_allocator* allocator) {
+    for (u32 i = 0; i < allocator->numFrames; i++) {
+        for (u32 j = 0; j < allocator->frames[i].numPools; j++) {
+            vkDestroyDescriptorPool(allocator->device->device, allocator->frames[i].pools[j], NULL);
+        }
+        free(allocator->frames[i].pools);
+    }
+    free(allocator->frames);
+    free(allocator);
+}
+
+void vulkan_descriptor_linear_allocator_begin_frame(vulkan_descriptor_linear_allocator* allocator, u32 frameIndex) {
+    // The caller has waited on this frame's fence, so nothing allocated the last time it was used can still be in flight
+    allocator->currentFrame = frameIndex;
+    vulkan_descriptor_linear_frame* frame = &allocator->frames[frameIndex];
+
+    for (u32 i = 0; i <= frame->currentPool && i < frame->numPools; i++) {
+        vkResetDescriptorPool(allocator->device->device, frame->pools[i], 0);
+        allocator->stats.poolResets++;
+    }
+    allocator->stats.frees += frame->numSets;
+    allocator->stats.liveSets -= frame->numSets;
+    frame->numSets = 0;
+    frame->currentPool = 0;
+}
+
+vulkan_descriptor_set vulkan_descriptor_linear_allocator_allocate(vulkan_descriptor_linear_allocator* allocator, vulkan_descriptor_set_layout* layout) {
+    vulkan_descriptor_linear_frame* frame = &allocator->frames[allocator->currentFrame];
+
+    vulkan_descriptor_set set;
+    CLEAR_MEMORY(&set);
+    set.device = allocator->device;
+    set.allocator = allocator;
+    set.poolIndex = frame->currentPool;
+
+    VkDescriptorSetAllocateInfo allocInfo;
+    CLEAR_MEMORY(&allocInfo);
+
+    allocInfo.sType = VK_STRUCTURE_TYPE_DESCRIPTOR_SET_ALLOCATE_INFO;
+    allocInfo.descriptorSetCount = 1;
+    allocInfo.pSetLayouts = &layout->layout;
+
+    VkResult result = VK_ERROR_OUT_OF_POOL_MEMORY;
+    if (frame->currentPool < frame->numPools) {
+        allocInfo.descriptorPool = frame->pools[frame->currentPool];
+        result = vkAllocateDescriptorSets(allocator->device->device, &allocInfo, &set.set);
+    }
+
+    if (result == VK_ERROR_OUT_OF_POOL_MEMORY || result == VK_ERROR_FRAGMENTED_POOL) {
+        // The current pool is full, move on to the next one, creating it if this frame has never needed it before
+        if (frame->currentPool < frame->numPools) {
+            frame->currentPool++;
+        }
+        if (frame->currentPool == frame->numPools) {
+            frame->numPools++;
+            frame->pools = realloc(frame->pools, sizeof(VkDescriptorPool) * frame->numPools);
+            frame->pools[frame->currentPool] = linear_pool_create(allocator->device);
+            allocator->stats.poolsCreated++;
+            allocator->stats.livePools++;
+        }
+
+        allocInfo.descriptorPool = frame->pools[frame->currentPool];
+        set.poolIndex = frame->currentPool;
+        result = vkAllocateDescriptorSets(allocator->device->device, &allocInfo, &set.set);
+    }
+    if (result != VK_SUCCESS) {
+        FATAL("Vulkan descriptor set allocation failed with error code: %d", result);
+    }
+
+    frame->numSets++;
+    allocator->stats.allocations++;
+    allocator->stats.liveSets++;
+
+    return set;
+}
+
+void write_buffer_descriptor(vulkan_descriptor_set* set, u32 binding, vulkan_buffer* buffer, VkDescriptorType type) {
     VkDescriptorBufferInfo bufferInfo;
     CLEAR_MEMORY(&bufferInfo);
 
@@ -193,11 +408,18 @@ void vulkan_descriptor_set_write_buffer(vulkan_descriptor_set* set, u32 binding,
     writeInfo.dstBinding = binding;
     writeInfo.dstArrayElement = 0;
     writeInfo.descriptorCount = 1;
-    writeInfo.descriptorType = VK_DESCRIPTOR_TYPE_UNIFORM_BUFFER;
+    writeInfo.descriptorType = type;
     writeInfo.pBufferInfo = &bufferInfo;
 
-    vulkan_descriptor_allocator* allocator = (vulkan_descriptor_allocator*)set->allocator;
-    vkUpdateDescriptorSets(allocator->device->device, 1, &writeInfo, 0, NULL);
+    vkUpdateDescriptorSets(set->device->device, 1, &writeInfo, 0, NULL);
+}
+
+void vulkan_descriptor_set_write_buffer(vulkan_descriptor_set* set, u32 binding, vulkan_buffer* buffer) {
+    write_buffer_descriptor(set, binding, buffer, VK_DESCRIPTOR_TYPE_UNIFORM_BUFFER);
+}
+
+void vulkan_descriptor_set_write_storage_buffer(vulkan_descriptor_set* set, u32 binding, vulkan_buffer* buffer) {
+    write_buffer_descriptor(set, binding, buffer, VK_DESCRIPTOR_TYPE_STORAGE_BUFFER);
 }
 
 void vulkan_descriptor_set_write_image(vulkan_descriptor_set* set, u32 binding, vulkan_image* image, vulkan_sampler* sampler) {
@@ -219,8 +441,7 @@ void vulkan_descriptor_set_write_image(vulkan_descriptor_set* set, u32 binding,
     writeInfo.descriptorType = VK_DESCRIPTOR_TYPE_COMBINED_IMAGE_SAMPLER;
     writeInfo.pImageInfo = &imageInfo;
 
-    vulkan_descriptor_allocator* allocator = (vulkan_descriptor_allocator*)set->allocator;
-    vkUpdateDescriptorSets(allocator->device->device, 1, &writeInfo, 0, NULL);
+    vkUpdateDescriptorSets(set->device->device, 1, &writeInfo, 0, NULL);
 }
 
 void vulkan_descriptor_set_write_input_attachment(vulkan_descriptor_set* set, u32 binding, vulkan_image* image) {
@@ -242,6 +463,5 @@ void vulkan_descriptor_set_write_input_attachment(vulkan_descriptor_set* set, u3
     writeInfo.descriptorType = VK_DESCRIPTOR_TYPE_INPUT_ATTACHMENT;
     writeInfo.pImageInfo = &imageInfo;
 
-    vulkan_descriptor_allocator* allocator = (vulkan_descriptor_allocator*)set->allocator;
-    vkUpdateDescriptorSets(allocator->device->device, 1, &writeInfo, 0, NULL);
+    vkUpdateDescriptorSets(set->device->device, 1, &writeInfo, 0, NULL);
 }
\ No newline at end of file
@@ -13,21 +13,38 @@ typedef struct {
     VkDescriptorSetLayoutBinding* bindings;
 } vulkan_descriptor_set_layout_builder;
 
+// Layouts are shared through the device's cache, destroying one only drops a reference
 typedef struct {
     VkDescriptorSetLayout layout;
     vulkan_device* device;
     u32 numBindings;
     VkDescriptorSetLayoutBinding* bindings;
+    u64 hash;
+    u32 refCount;
 } vulkan_descriptor_set_layout;
 
 vulkan_descriptor_set_layout_builder* vulkan_descriptor_set_layout_builder_create();
 vulkan_descriptor_set_layout* vulkan_descriptor_set_layout_builder_build(vulkan_descriptor_set_layout_builder* builder, vulkan_device* device);
 void vulkan_descriptor_set_layout_builder_add(vulkan_descriptor_set_layout_builder* builder, VkDescriptorType type);
+void vulkan_descriptor_set_layout_builder_add_binding(vulkan_descriptor_set_layout_builder* builder, u32 binding, VkDescriptorType type, u32 count, VkShaderStageFlags stages);
 
 void vulkan_descriptor_set_layout_destroy(vulkan_descriptor_set_layout* layout);
 
+typedef struct {
+    u64 allocations;
+    u64 frees;
+    u64 poolsCreated;
+    u64 poolsDestroyed;
+    u64 poolResets;
+    u32 liveSets;
+    u32 livePools;
+} vulkan_descriptor_allocator_stats;
+
+void vulkan_descriptor_allocator_stats_log(const char* name, vulkan_descriptor_allocator_stats* stats);
+
 typedef struct {
     VkDescriptorSet set;
+    vulkan_device* device;
     void* allocator;
     u32 poolIndex;
 } vulkan_descriptor_set;
@@ -36,9 +53,9 @@ typedef struct {
     VkDescriptorPool pool;
     vulkan_device* device;
 
-    vulkan_descriptor_set* sets[SETS_PER_POOL];
-    u32 remaining;
-    u32 freed;
+    vulkan_descriptor_set sets[SETS_PER_POOL];
+    u32 numFreeSlots;
+    u32 freeSlots[SETS_PER_POOL];
 } vulkan_descriptor_pool;
 
 typedef struct {
@@ -47,6 +64,7 @@ typedef struct {
     vulkan_descriptor_pool** pools; 
     vulkan_device* device;
     vulkan_descriptor_set_layout* layout;
+    vulkan_descriptor_allocator_stats stats;
 } vulkan_descriptor_allocator;
 
 vulkan_descriptor_allocator* vulkan_descriptor_allocator_create(vulkan_device* device, vulkan_descriptor_set_layout* layout);
@@ -55,6 +73,30 @@ void vulkan_descriptor_allocator_destroy(vulkan_descriptor_allocator* allocator)
 vulkan_descriptor_set* vulkan_descriptor_set_allocate(vulkan_descriptor_allocator* allocator);
 void vulkan_descriptor_set_free(vulkan_descriptor_set* set);
 
+#define LINEAR_SETS_PER_POOL 256
+
+typedef struct {
+    u32 numPools;
+    u32 currentPool;
+    VkDescriptorPool* pools;
+    u32 numSets;
+} vulkan_descriptor_linear_frame;
+
+typedef struct {
+    vulkan_device* device;
+    u32 numFrames;
+    u32 currentFrame;
+    vulkan_descriptor_linear_frame* frames;
+    vulkan_descriptor_allocator_stats stats;
+} vulkan_descriptor_linear_allocator;
+
+vulkan_descriptor_linear_allocator* vulkan_descriptor_linear_allocator_create(vulkan_device* device, u32 numFrames);
+void vulkan_descriptor_linear_allocator_destroy(vulkan_descriptor_linear_allocator* allocator);
+
+void vulkan_descriptor_linear_allocator_begin_frame(vulkan_descriptor_linear_allocator* allocator, u32 frameIndex);
+vulkan_descriptor_set vulkan_descriptor_linear_allocator_allocate(vulkan_descriptor_linear_allocator* allocator, vulkan_descriptor_set_layout* layout);
+
 void vulkan_descriptor_set_write_buffer(vulkan_descriptor_set* set, u32 binding, vulkan_buffer* buffer);
+void vulkan_descriptor_set_write_storage_buffer(vulkan_descriptor_set* set, u32 binding, vulkan_buffer* buffer);
 void vulkan_descriptor_set_write_image(vulkan_descriptor_set* set, u32 binding, vulkan_image* image, vulkan_sampler* sampler);
 void vulkan_descriptor_set_write_input_attachment(vulkan_descriptor_set* set, u32 binding, vulkan_image* image);
\ No newline at end of file
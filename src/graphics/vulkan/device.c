@@ -6,6 +6,7 @@ vulkan_device* vulkan_device_create(vulkan_instance* instance, vulkan_physical_d
     CLEAR_MEMORY_ARRAY(queueIndexUsage, 256);
     queueIndexUsage[physical->queues.graphicsIndex]++;
     queueIndexUsage[physical->queues.presentIndex]++;
+    queueIndexUsage[physical->queues.computeIndex]++;
 
     u32 uniqueQueueIndices[256];
     u32 numUniqueQueueIndices = 0;
@@ -16,21 +17,55 @@ vulkan_device* vulkan_device_create(vulkan_instance* instance, vulkan_physical_d
         }
     }
 
+    // Read by vkCreateDevice, so it has to outlive the loop
+    float priorities[1] = { 1.0f };
     VkDeviceQueueCreateInfo* queueInfos = malloc(sizeof(VkDeviceQueueCreateInfo) * numUniqueQueueIndices);
     CLEAR_MEMORY_ARRAY(queueInfos, numUniqueQueueIndices);
     for (u32 i = 0; i < numUniqueQueueIndices; i++) {
-        float priorites[1] = { 1.0f };
         queueInfos[i].sType = VK_STRUCTURE_TYPE_DEVICE_QUEUE_CREATE_INFO;
-        queueInfos[i].queueFamilyIndex = physical->queues.graphicsIndex;
+        queueInfos[i].queueFamilyIndex = uniqueQueueIndices[i];
         queueInfos[i].queueCount = 1;
-        queueInfos[i].pQueuePriorities = priorites;
+        queueInfos[i].pQueuePriorities = priorities;
     }
 
-    VkPhysicalDeviceFeatures deviceFeatures;
+    // Descriptor indexing for the bindless texture and material tables
+    VkPhysicalDeviceVulkan12Features features12;
+    CLEAR_MEMORY(&features12);
+    features12.sType = VK_STRUCTURE_TYPE_PHYSICAL_DEVICE_VULKAN_1_2_FEATURES;
+    features12.descriptorIndexing = VK_TRUE;
+    features12.runtimeDescriptorArray = VK_TRUE;
+    features12.descriptorBindingPartiallyBound = VK_TRUE;
+    features12.descriptorBindingSampledImageUpdateAfterBind = VK_TRUE;
+    features12.descriptorBindingStorageBufferUpdateAfterBind = VK_TRUE;
+    features12.descriptorBindingUpdateUnusedWhilePending = VK_TRUE;
+    features12.shaderSampledImageArrayNonUniformIndexing = VK_TRUE;
+    // The framegraph's submissions on different queues wait on each other with these
+    features12.timelineSemaphore = VK_TRUE;
+    // Optional, only the GPU driven path needs it
+    features12.drawIndirectCount = vulkan_physical_device_supports_indirect_count(physical);
+    // Optional, the framegraph only profiles passes with it since it resets its queries from the CPU
+    features12.hostQueryReset = physical->features12.hostQueryReset;
+
+    VkPhysicalDeviceVulkan13Features features13;
+    CLEAR_MEMORY(&features13);
+    features13.sType = VK_STRUCTURE_TYPE_PHYSICAL_DEVICE_VULKAN_1_3_FEATURES;
+    features13.synchronization2 = VK_TRUE;
+    // Optional, the framegraph begins rendering without render pass objects with it
+    features13.dynamicRendering = physical->features13.dynamicRendering;
+    features12.pNext = &features13;
+
+    VkPhysicalDeviceFeatures2 deviceFeatures;
     CLEAR_MEMORY(&deviceFeatures);
-    deviceFeatures.samplerAnisotropy = VK_TRUE;
-    deviceFeatures.independentBlend = VK_TRUE;
-    deviceFeatures.sampleRateShading = VK_TRUE;
+    deviceFeatures.sType = VK_STRUCTURE_TYPE_PHYSICAL_DEVICE_FEATURES_2;
+    deviceFeatures.pNext = &features12;
+    deviceFeatures.features.samplerAnisotropy = VK_TRUE;
+    deviceFeatures.features.independentBlend = VK_TRUE;
+    deviceFeatures.features.sampleRateShading = VK_TRUE;
+    deviceFeatures.features.shaderStorageBufferArrayDynamicIndexing = VK_TRUE;
+    deviceFeatures.features.multiDrawIndirect = vulkan_physical_device_supports_indirect_count(physical);
+    deviceFeatures.features.drawIndirectFirstInstance = vulkan_physical_device_supports_indirect_count(physical); // The cull pass writes each instance's index there
+    deviceFeatures.features.pipelineStatisticsQuery = physical->features.pipelineStatisticsQuery;
+    deviceFeatures.features.inheritedQueries = physical->features.inheritedQueries;
 
     // Device create info
     VkDeviceCreateInfo createInfo;
@@ -43,7 +78,7 @@ vulkan_device* vulkan_device_create(vulkan_instance* instance, vulkan_physical_d
     createInfo.ppEnabledLayerNames = layers;
     createInfo.queueCreateInfoCount = numUniqueQueueIndices;
     createInfo.pQueueCreateInfos = queueInfos;
-    createInfo.pEnabledFeatures = &deviceFeatures;
+    createInfo.pNext = &deviceFeatures;
 
     vulkan_device* device = malloc(sizeof(vulkan_device));
     VkResult result = vkCreateDevice(physical->physical, &createInfo, NULL, &device->device);
@@ -54,13 +89,27 @@ vulkan_device* vulkan_device_create(vulkan_instance* instance, vulkan_physical_d
 
     vkGetDeviceQueue(device->device, physical->queues.graphicsIndex, 0, &device->graphics);
     vkGetDeviceQueue(device->device, physical->queues.presentIndex, 0, &device->present);
+    vkGetDeviceQueue(device->device, physical->queues.computeIndex, 0, &device->compute);
 
     device->physical = physical;
+    device->setLayoutCache = hashmap_create(0);
+    device->pipelineLayoutCache = hashmap_create(0);
+    device->samplerCache = hashmap_create(0);
 
     return device;
 }
 
 void vulkan_device_destroy(vulkan_device* device) {
+    if (device->setLayoutCache->count != 0 || device->pipelineLayoutCache->count != 0) {
+        WARN("Leaked %d descriptor set layouts and %d pipeline layouts", device->setLayoutCache->count, device->pipelineLayoutCache->count);
+    }
+    if (device->samplerCache->count != 0) {
+        WARN("Leaked %d samplers", device->samplerCache->count);
+    }
+    hashmap_destroy(device->setLayoutCache);
+    hashmap_destroy(device->pipelineLayoutCache);
+    hashmap_destroy(device->samplerCache);
+
     vkDestroyDevice(device->device, NULL);
     free(device);
 }
\ No newline at end of file
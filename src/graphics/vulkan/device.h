@@ -2,16 +2,27 @@
 
 #include "core/core.h"
 #include "vulkan/vulkan.h"
+#include "core/hashmap.h"
 
 #include "instance.h"
 #include "physical.h"
 
+typedef struct _vulkan_pipeline_cache vulkan_pipeline_cache;
+
 typedef struct {
     VkDevice device;
     VkQueue graphics;
     VkQueue present;
+    VkQueue compute; // The same queue as graphics when there's no async compute family
 
     vulkan_physical_device* physical;
+
+    // Shared descriptor set and pipeline layouts, keyed on a hash of their create info
+    hashmap* setLayoutCache;
+    hashmap* pipelineLayoutCache;
+    hashmap* samplerCache;
+
+    vulkan_pipeline_cache* pipelineCache;
 } vulkan_device;
 
 vulkan_device* vulkan_device_create(vulkan_instance* instance, vulkan_physical_device* physical, u32 numExtensions, const char** extensions, u32 numLayers, const char** layers);
@@ -0,0 +1,108 @@
+#include "encoder.h"
+
+void vulkan_encoder_stats_add(vulkan_encoder_stats* stats, vulkan_encoder_stats* other) {
+    stats->draws += other->draws;
+    stats->pipelineBinds += other->pipelineBinds;
+    stats->pipelineBindsSkipped += other->pipelineBindsSkipped;
+    stats->cullModeSets += other->cullModeSets;
+    stats->cullModeSetsSkipped += other->cullModeSetsSkipped;
+    stats->vertexBinds += other->vertexBinds;
+    stats->vertexBindsSkipped += other->vertexBindsSkipped;
+    stats->indexBinds += other->indexBinds;
+    stats->indexBindsSkipped += other->indexBindsSkipped;
+    stats->pushConstants += other->pushConstants;
+    stats->pushConstantsSkipped += other->pushConstantsSkipped;
+}
+
+void vulkan_encoder_stats_log(const char* name, vulkan_encoder_stats* stats) {
+    u64 issued = stats->pipelineBinds + stats->cullModeSets + stats->vertexBinds + stats->indexBinds + stats->pushConstants;
+    u64 skipped = stats->pipelineBindsSkipped + stats->cullModeSetsSkipped + stats->vertexBindsSkipped + stats->indexBindsSkipped + stats->pushConstantsSkipped;
+    INFO("%s draws: %llu draws, %llu state changes issued and %llu eliminated (pipeline %llu/%llu, cull mode %llu/%llu, vertex %llu/%llu, index %llu/%llu, push constants %llu/%llu issued/eliminated)", name,
+        (unsigned long long)stats->draws, (unsigned long long)issued, (unsigned long long)skipped,
+        (unsigned long long)stats->pipelineBinds, (unsigned long long)stats->pipelineBindsSkipped,
+        (unsigned long long)stats->cullModeSets, (unsigned long long)stats->cullModeSetsSkipped,
+        (unsigned long long)stats->vertexBinds, (unsigned long long)stats->vertexBindsSkipped,
+        (unsigned long long)stats->indexBinds, (unsigned long long)stats->indexBindsSkipped,
+        (unsigned long long)stats->pushConstants, (unsigned long long)stats->pushConstantsSkipped);
+}
+
+void vulkan_command_encoder_begin(vulkan_command_encoder* encoder, VkCommandBuffer cmd, vulkan_encoder_stats* stats) {
+    CLEAR_MEMORY(encoder);
+    encoder->cmd = cmd;
+    encoder->stats = stats;
+    encoder->cullMode = VK_CULL_MODE_FLAG_BITS_MAX_ENUM;
+}
+
+void vulkan_command_encoder_bind_pipeline(vulkan_command_encoder* encoder, vulkan_pipeline* pipeline) {
+    if (pipeline->pipeline == encoder->pipeline) {
+        encoder->stats->pipelineBindsSkipped++;
+        return;
+    }
+    vkCmdBindPipeline(encoder->cmd, VK_PIPELINE_BIND_POINT_GRAPHICS, pipeline->pipeline);
+    encoder->pipeline = pipeline->pipeline;
+    encoder->stats->pipelineBinds++;
+}
+
+void vulkan_command_encoder_set_cull_mode(vulkan_command_encoder* encoder, VkCullModeFlags cullMode) {
+    if (cullMode == encoder->cullMode) {
+        encoder->stats->cullModeSetsSkipped++;
+        return;
+    }
+    vkCmdSetCullMode(encoder->cmd, cullMode);
+    encoder->cullMode = cullMode;
+    encoder->stats->cullModeSets++;
+}
+
+void vulkan_command_encoder_bind_vertex_buffers(vulkan_command_encoder* encoder, u32 numBuffers, VkBuffer* buffers, VkDeviceSize* offsets) {
+    if (numBuffers > ENCODER_MAX_VERTEX_BUFFERS) {
+        FATAL("Encoder can only track %d vertex buffers, %d were bound", ENCODER_MAX_VERTEX_BUFFERS, numBuffers);
+        return;
+    }
+
+    if (numBuffers == encoder->numVertexBuffers &&
+        memcmp(buffers, encoder->vertexBuffers, sizeof(VkBuffer) * numBuffers) == 0 &&
+        memcmp(offsets, encoder->vertexOffsets, sizeof(VkDeviceSize) * numBuffers) == 0) {
+        encoder->stats->vertexBindsSkipped++;
+        return;
+    }
+    vkCmdBindVertexBuffers(encoder->cmd, 0, numBuffers, buffers, offsets);
+    encoder->numVertexBuffers = numBuffers;
+    memcpy(encoder->vertexBuffers, buffers, sizeof(VkBuffer) * numBuffers);
+    memcpy(encoder->vertexOffsets, offsets, sizeof(VkDeviceSize) * numBuffers);
+    encoder->stats->vertexBinds++;
+}
+
+void vulkan_command_encoder_push_constants(vulkan_command_encoder* encoder, vulkan_pipeline_layout* layout, VkShaderStageFlags stages, u32 size, void* data) {
+    if (size > ENCODER_MAX_PUSH_CONSTANTS) {
+        FATAL("Encoder can only track %d bytes of push constants, %d were pushed", ENCODER_MAX_PUSH_CONSTANTS, size);
+        return;
+    }
+
+    if (size == encoder->pushConstantSize && memcmp(data, encoder->pushConstants, size) == 0) {
+        encoder->stats->pushConstantsSkipped++;
+        return;
+    }
+    vkCmdPushConstants(encoder->cmd, layout->layout, stages, 0, size, data);
+    encoder->pushConstantSize = size;
+    memcpy(encoder->pushConstants, data, size);
+    encoder->stats->pushConstants++;
+}
+
+void vulkan_command_encoder_draw_indexed(vulkan_command_encoder* encoder, VkBuffer indexBuffer, VkDeviceSize indexOffset, VkIndexType indexType, u32 indexCount) {
+    VkDeviceSize indexSize = indexType == VK_INDEX_TYPE_UINT16 ? 2 : 4;
+
+    // Bound from the start of the buffer when the offset allows, so the next draw out of it can reuse the bind
+    VkDeviceSize bindOffset = indexOffset % indexSize == 0 ? 0 : indexOffset;
+    if (indexBuffer == encoder->indexBuffer && bindOffset == encoder->indexOffset && indexType == encoder->indexType) {
+        encoder->stats->indexBindsSkipped++;
+    } else {
+        vkCmdBindIndexBuffer(encoder->cmd, indexBuffer, bindOffset, indexType);
+        encoder->indexBuffer = indexBuffer;
+        encoder->indexOffset = bindOffset;
+        encoder->indexType = indexType;
+        encoder->stats->indexBinds++;
+    }
+
+    vkCmdDrawIndexed(encoder->cmd, indexCount, 1, (u32)((indexOffset - bindOffset) / indexSize), 0, 0);
+    encoder->stats->draws++;
+}
\ No newline at end of file
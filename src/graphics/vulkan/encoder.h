@@ -0,0 +1,56 @@
+#pragma once
+
+#include "core/core.h"
+#include "vulkan/vulkan.h"
+
+#include "pipeline.h"
+
+#define ENCODER_MAX_VERTEX_BUFFERS 8
+#define ENCODER_MAX_PUSH_CONSTANTS 128
+
+// Counts what was asked for against what actually reached the command buffer
+typedef struct {
+    u64 draws;
+    u64 pipelineBinds;
+    u64 pipelineBindsSkipped;
+    u64 cullModeSets;
+    u64 cullModeSetsSkipped;
+    u64 vertexBinds;
+    u64 vertexBindsSkipped;
+    u64 indexBinds;
+    u64 indexBindsSkipped;
+    u64 pushConstants;
+    u64 pushConstantsSkipped;
+} vulkan_encoder_stats;
+
+void vulkan_encoder_stats_add(vulkan_encoder_stats* stats, vulkan_encoder_stats* other);
+void vulkan_encoder_stats_log(const char* name, vulkan_encoder_stats* stats);
+
+// Tracks what is bound on one command buffer and drops any command that wouldn't change it
+// Only ever used from one thread, parallel recording gives every job its own encoder
+typedef struct {
+    VkCommandBuffer cmd;
+    vulkan_encoder_stats* stats;
+
+    VkPipeline pipeline;
+    VkCullModeFlags cullMode;
+    u32 numVertexBuffers;
+    VkBuffer vertexBuffers[ENCODER_MAX_VERTEX_BUFFERS];
+    VkDeviceSize vertexOffsets[ENCODER_MAX_VERTEX_BUFFERS];
+    VkBuffer indexBuffer;
+    VkDeviceSize indexOffset;
+    VkIndexType indexType;
+    u32 pushConstantSize;
+    u8 pushConstants[ENCODER_MAX_PUSH_CONSTANTS];
+} vulkan_command_encoder;
+
+// Nothing is assumed to be bound, so whatever state the command buffer already has will be set again
+void vulkan_command_encoder_begin(vulkan_command_encoder* encoder, VkCommandBuffer cmd, vulkan_encoder_stats* stats);
+
+void vulkan_command_encoder_bind_pipeline(vulkan_command_encoder* encoder, vulkan_pipeline* pipeline);
+void vulkan_command_encoder_set_cull_mode(vulkan_command_encoder* encoder, VkCullModeFlags cullMode);
+void vulkan_command_encoder_bind_vertex_buffers(vulkan_command_encoder* encoder, u32 numBuffers, VkBuffer* buffers, VkDeviceSize* offsets);
+// Push constants survive pipeline binds as long as the layouts agree on the ranges, which every variant of a pass does
+void vulkan_command_encoder_push_constants(vulkan_command_encoder* encoder, vulkan_pipeline_layout* layout, VkShaderStageFlags stages, u32 size, void* data);
+// Draws that share an index buffer are rebased with firstIndex rather than rebinding it at a new offset
+void vulkan_command_encoder_draw_indexed(vulkan_command_encoder* encoder, VkBuffer indexBuffer, VkDeviceSize indexOffset, VkIndexType indexType, u32 indexCount);
\ No newline at end of file
@@ -2,6 +2,7 @@
 
 #include "stb_image.h"
 #include "buffer.h"
+#include "core/hash.h"
 
 void create_image_view(vulkan_image* image, VkImageAspectFlags aspects) {
     VkImageViewCreateInfo createInfo;
@@ -34,12 +35,107 @@ typedef struct {
     VkImageAspectFlags aspects;
 } transition_layout_info;
 
+vulkan_image_layout_access vulkan_image_get_layout_access(VkImageLayout layout) {
+    vulkan_image_layout_access access;
+    switch (layout) {
+    case(VK_IMAGE_LAYOUT_UNDEFINED) :
+    case(VK_IMAGE_LAYOUT_PRESENT_SRC_KHR) :
+        access.stages = VK_PIPELINE_STAGE_2_NONE;
+        access.access = VK_ACCESS_2_NONE;
+        break;
+    case(VK_IMAGE_LAYOUT_TRANSFER_DST_OPTIMAL) :
+        access.stages = VK_PIPELINE_STAGE_2_ALL_TRANSFER_BIT;
+        access.access = VK_ACCESS_2_TRANSFER_WRITE_BIT;
+        break;
+    case(VK_IMAGE_LAYOUT_TRANSFER_SRC_OPTIMAL) :
+        access.stages = VK_PIPELINE_STAGE_2_ALL_TRANSFER_BIT;
+        access.access = VK_ACCESS_2_TRANSFER_READ_BIT;
+        break;
+    case(VK_IMAGE_LAYOUT_SHADER_READ_ONLY_OPTIMAL) :
+        access.stages = VK_PIPELINE_STAGE_2_FRAGMENT_SHADER_BIT;
+        access.access = VK_ACCESS_2_SHADER_SAMPLED_READ_BIT;
+        break;
+    case(VK_IMAGE_LAYOUT_COLOR_ATTACHMENT_OPTIMAL) :
+        access.stages = VK_PIPELINE_STAGE_2_COLOR_ATTACHMENT_OUTPUT_BIT;
+        access.access = VK_ACCESS_2_COLOR_ATTACHMENT_READ_BIT | VK_ACCESS_2_COLOR_ATTACHMENT_WRITE_BIT;
+        break;
+    case(VK_IMAGE_LAYOUT_DEPTH_ATTACHMENT_OPTIMAL) :
+    case(VK_IMAGE_LAYOUT_DEPTH_STENCIL_ATTACHMENT_OPTIMAL) :
+        access.stages = VK_PIPELINE_STAGE_2_EARLY_FRAGMENT_TESTS_BIT | VK_PIPELINE_STAGE_2_LATE_FRAGMENT_TESTS_BIT;
+        access.access = VK_ACCESS_2_DEPTH_STENCIL_ATTACHMENT_READ_BIT | VK_ACCESS_2_DEPTH_STENCIL_ATTACHMENT_WRITE_BIT;
+        break;
+    default :
+        // Correct for anything, just slow
+        WARN("No narrow access for image layout %d, synchronizing with everything", layout);
+        access.stages = VK_PIPELINE_STAGE_2_ALL_COMMANDS_BIT;
+        access.access = VK_ACCESS_2_MEMORY_READ_BIT | VK_ACCESS_2_MEMORY_WRITE_BIT;
+        break;
+    }
+    return access;
+}
+
+bool vulkan_format_is_integer(VkFormat format) {
+    switch (format) {
+    case(VK_FORMAT_R8_UINT) :
+    case(VK_FORMAT_R8_SINT) :
+    case(VK_FORMAT_R8G8_UINT) :
+    case(VK_FORMAT_R8G8_SINT) :
+    case(VK_FORMAT_R8G8B8_UINT) :
+    case(VK_FORMAT_R8G8B8_SINT) :
+    case(VK_FORMAT_B8G8R8_UINT) :
+    case(VK_FORMAT_B8G8R8_SINT) :
+    case(VK_FORMAT_R8G8B8A8_UINT) :
+    case(VK_FORMAT_R8G8B8A8_SINT) :
+    case(VK_FORMAT_B8G8R8A8_UINT) :
+    case(VK_FORMAT_B8G8R8A8_SINT) :
+    case(VK_FORMAT_R16_UINT) :
+    case(VK_FORMAT_R16_SINT) :
+    case(VK_FORMAT_R16G16_UINT) :
+    case(VK_FORMAT_R16G16_SINT) :
+    case(VK_FORMAT_R16G16B16_UINT) :
+    case(VK_FORMAT_R16G16B16_SINT) :
+    case(VK_FORMAT_R16G16B16A16_UINT) :
+    case(VK_FORMAT_R16G16B16A16_SINT) :
+    case(VK_FORMAT_R32_UINT) :
+    case(VK_FORMAT_R32_SINT) :
+    case(VK_FORMAT_R32G32_UINT) :
+    case(VK_FORMAT_R32G32_SINT) :
+    case(VK_FORMAT_R32G32B32_UINT) :
+    case(VK_FORMAT_R32G32B32_SINT) :
+    case(VK_FORMAT_R32G32B32A32_UINT) :
+    case(VK_FORMAT_R32G32B32A32_SINT) :
+    case(VK_FORMAT_R64_UINT) :
+    case(VK_FORMAT_R64_SINT) :
+    case(VK_FORMAT_R64G64_UINT) :
+    case(VK_FORMAT_R64G64_SINT) :
+    case(VK_FORMAT_R64G64B64_UINT) :
+    case(VK_FORMAT_R64G64B64_SINT) :
+    case(VK_FORMAT_R64G64B64A64_UINT) :
+    case(VK_FORMAT_R64G64B64A64_SINT) :
+    case(VK_FORMAT_A8B8G8R8_UINT_PACK32) :
+    case(VK_FORMAT_A8B8G8R8_SINT_PACK32) :
+    case(VK_FORMAT_A2R10G10B10_UINT_PACK32) :
+    case(VK_FORMAT_A2R10G10B10_SINT_PACK32) :
+    case(VK_FORMAT_A2B10G10R10_UINT_PACK32) :
+    case(VK_FORMAT_A2B10G10R10_SINT_PACK32) :
+        return true;
+    default :
+        return false;
+    }
+}
+
 void transition_layout_body(VkCommandBuffer cmd, void* _info) {
     transition_layout_info* info = (transition_layout_info*)_info;
-    VkImageMemoryBarrier barrier;
-    CLEAR_MEMORY(&barrier);
+    vulkan_image_layout_access src = vulkan_image_get_layout_access(info->from);
+    vulkan_image_layout_access dst = vulkan_image_get_layout_access(info->to);
 
-    barrier.sType = VK_STRUCTURE_TYPE_IMAGE_MEMORY_BARRIER;
+    VkImageMemoryBarrier2 barrier;
+    CLEAR_MEMORY(&barrier);
+    barrier.sType = VK_STRUCTURE_TYPE_IMAGE_MEMORY_BARRIER_2;
+    barrier.srcStageMask = src.stages;
+    barrier.srcAccessMask = src.access;
+    barrier.dstStageMask = dst.stages;
+    barrier.dstAccessMask = dst.access;
     barrier.oldLayout = info->from;
     barrier.newLayout = info->to;
     barrier.srcQueueFamilyIndex = VK_QUEUE_FAMILY_IGNORED;
@@ -51,33 +147,12 @@ void transition_layout_body(VkCommandBuffer cmd, void* _info) {
     barrier.subresourceRange.baseArrayLayer = 0;
     barrier.subresourceRange.layerCount = 1;
 
-    VkPipelineStageFlags sourceStage;
-    VkPipelineStageFlags destinationStage;
-
-    if (info->from == VK_IMAGE_LAYOUT_UNDEFINED && info->to == VK_IMAGE_LAYOUT_TRANSFER_DST_OPTIMAL) {
-        barrier.srcAccessMask = 0;
-        barrier.dstAccessMask = VK_ACCESS_TRANSFER_WRITE_BIT;
-
-        sourceStage = VK_PIPELINE_STAGE_TOP_OF_PIPE_BIT;
-        destinationStage = VK_PIPELINE_STAGE_TRANSFER_BIT;
-    } else if (info->from == VK_IMAGE_LAYOUT_TRANSFER_DST_OPTIMAL && info->to == VK_IMAGE_LAYOUT_SHADER_READ_ONLY_OPTIMAL) {
-        barrier.srcAccessMask = VK_ACCESS_TRANSFER_WRITE_BIT;
-        barrier.dstAccessMask = VK_ACCESS_SHADER_READ_BIT;
-
-        sourceStage = VK_PIPELINE_STAGE_TRANSFER_BIT;
-        destinationStage = VK_PIPELINE_STAGE_FRAGMENT_SHADER_BIT;
-    } else {
-        FATAL("Unsupported layout transition from %d to %d", info->from, info->to);
-    }
-
-    vkCmdPipelineBarrier(
-        cmd,
-        sourceStage, destinationStage,
-        0,
-        0, NULL,
-        0, NULL,
-        1, &barrier
-    );
+    VkDependencyInfo dependency;
+    CLEAR_MEMORY(&dependency);
+    dependency.sType = VK_STRUCTURE_TYPE_DEPENDENCY_INFO;
+    dependency.imageMemoryBarrierCount = 1;
+    dependency.pImageMemoryBarriers = &barrier;
+    vkCmdPipelineBarrier2(cmd, &dependency);
 }
 
 void transition_layout(vulkan_image* image, VkImageLayout from, VkImageLayout to, VkImageAspectFlags aspects) {
@@ -133,23 +208,27 @@ void copy_buffer_to_image(vulkan_image* dst, vulkan_buffer* src) {
     vulkan_context_start_and_execute(dst->ctx, NULL, &info, copy_buffer_to_image_body);
 }
 
-vulkan_image* vulkan_image_create(vulkan_context* ctx, VkFormat format, VkImageUsageFlags usage, u32 width, u32 height, VkImageAspectFlags aspects, VkSampleCountFlagBits samples) {
-    VkImageCreateInfo createInfo;
-    CLEAR_MEMORY(&createInfo);
+void fill_image_create_info(VkImageCreateInfo* createInfo, VkFormat format, VkImageUsageFlags usage, u32 width, u32 height, VkSampleCountFlagBits samples) {
+    CLEAR_MEMORY(createInfo);
+
+    createInfo->sType = VK_STRUCTURE_TYPE_IMAGE_CREATE_INFO;
+    createInfo->imageType = VK_IMAGE_TYPE_2D;
+    createInfo->extent.width = width;
+    createInfo->extent.height = height;
+    createInfo->extent.depth = 1;
+    createInfo->mipLevels = 1;
+    createInfo->arrayLayers = 1;
+    createInfo->format = format;
+    createInfo->tiling = VK_IMAGE_TILING_OPTIMAL;
+    createInfo->initialLayout = VK_IMAGE_LAYOUT_UNDEFINED;
+    createInfo->usage = VK_IMAGE_USAGE_TRANSFER_DST_BIT | usage;
+    createInfo->sharingMode = VK_SHARING_MODE_EXCLUSIVE;
+    createInfo->samples = samples;
+}
 
-    createInfo.sType = VK_STRUCTURE_TYPE_IMAGE_CREATE_INFO;
-    createInfo.imageType = VK_IMAGE_TYPE_2D;
-    createInfo.extent.width = width;
-    createInfo.extent.height = height;
-    createInfo.extent.depth = 1;
-    createInfo.mipLevels = 1;
-    createInfo.arrayLayers = 1;
-    createInfo.format = format;
-    createInfo.tiling = VK_IMAGE_TILING_OPTIMAL;
-    createInfo.initialLayout = VK_IMAGE_LAYOUT_UNDEFINED;
-    createInfo.usage = VK_IMAGE_USAGE_TRANSFER_DST_BIT | usage;
-    createInfo.sharingMode = VK_SHARING_MODE_EXCLUSIVE;
-    createInfo.samples = samples;
+vulkan_image* vulkan_image_create(vulkan_context* ctx, VkFormat format, VkImageUsageFlags usage, u32 width, u32 height, VkImageAspectFlags aspects, VkSampleCountFlagBits samples, vulkan_memory_category category) {
+    VkImageCreateInfo createInfo;
+    fill_image_create_info(&createInfo, format, usage, width, height, samples);
 
     VmaAllocationCreateInfo allocInfo;
     CLEAR_MEMORY(&allocInfo);
@@ -160,27 +239,76 @@ vulkan_image* vulkan_image_create(vulkan_context* ctx, VkFormat format, VkImageU
     image->ctx = ctx;
     image->format = format;
     image->ownsImage = true;
+    image->ownsMemory = true;
     image->width = width;
     image->height = height;
     image->samples = samples;
+    image->category = category;
 
     VkResult result = vmaCreateImage(ctx->allocator, &createInfo, &allocInfo, &image->image, &image->allocation, NULL);
     if (result != VK_SUCCESS) {
         FATAL("Vulkan image creation failed with error code: %d", result);
     }
+    vulkan_memory_track_allocation(ctx, category, image->allocation);
     
     create_image_view(image, aspects);
 
     return image;
 }
 
+VkMemoryRequirements vulkan_image_get_memory_requirements(vulkan_context* ctx, VkFormat format, VkImageUsageFlags usage, u32 width, u32 height, VkSampleCountFlagBits samples) {
+    VkImageCreateInfo createInfo;
+    fill_image_create_info(&createInfo, format, usage, width, height, samples);
+
+    VkDeviceImageMemoryRequirements info;
+    CLEAR_MEMORY(&info);
+    info.sType = VK_STRUCTURE_TYPE_DEVICE_IMAGE_MEMORY_REQUIREMENTS;
+    info.pCreateInfo = &createInfo;
+
+    VkMemoryRequirements2 requirements;
+    CLEAR_MEMORY(&requirements);
+    requirements.sType = VK_STRUCTURE_TYPE_MEMORY_REQUIREMENTS_2;
+    vkGetDeviceImageMemoryRequirements(ctx->device->device, &info, &requirements);
+
+    return requirements.memoryRequirements;
+}
+
+vulkan_image* vulkan_image_create_aliased(vulkan_context* ctx, VkFormat format, VkImageUsageFlags usage, u32 width, u32 height, VkImageAspectFlags aspects, VkSampleCountFlagBits samples, VmaAllocation allocation, VkDeviceSize offset) {
+    VkImageCreateInfo createInfo;
+    fill_image_create_info(&createInfo, format, usage, width, height, samples);
+
+    vulkan_image* image = malloc(sizeof(vulkan_image));
+    image->ctx = ctx;
+    image->allocation = allocation;
+    image->format = format;
+    image->ownsImage = true;
+    image->ownsMemory = false;
+    image->width = width;
+    image->height = height;
+    image->samples = samples;
+    image->category = MEMORY_CATEGORY_FRAMEGRAPH;
+
+    VkResult result = vkCreateImage(ctx->device->device, &createInfo, NULL, &image->image);
+    if (result != VK_SUCCESS) {
+        FATAL("Vulkan image creation failed with error code: %d", result);
+    }
+    result = vmaBindImageMemory2(ctx->allocator, allocation, offset, image->image, NULL);
+    if (result != VK_SUCCESS) {
+        FATAL("Vulkan aliased image binding failed with error code: %d", result);
+    }
+
+    create_image_view(image, aspects);
+
+    return image;
+}
+
 vulkan_image* vulkan_image_create_from_file(vulkan_context* ctx, const char* path, VkFormat format, VkImageUsageFlags usage, VkImageAspectFlags aspects) {
     i32 width, height, channels;
     u8* pixels = stbi_load(path, &width, &height, &channels, 4);
     if (!pixels) {
         FATAL("Failed to load texture: %s", path);
     }
-    vulkan_buffer* buffer = vulkan_buffer_create_with_data(ctx, VK_BUFFER_USAGE_TRANSFER_SRC_BIT, width * height * 4, pixels);
+    vulkan_buffer* buffer = vulkan_buffer_create_with_data(ctx, VK_BUFFER_USAGE_TRANSFER_SRC_BIT, width * height * 4, MEMORY_CATEGORY_STAGING, pixels);
     stbi_image_free(pixels);
 
     VkImageCreateInfo createInfo;
@@ -209,14 +337,17 @@ vulkan_image* vulkan_image_create_from_file(vulkan_context* ctx, const char* pat
     image->ctx = ctx;
     image->format = format;
     image->ownsImage = true;
+    image->ownsMemory = true;
     image->width = width;
     image->height = height;
     image->samples = VK_SAMPLE_COUNT_1_BIT;
+    image->category = MEMORY_CATEGORY_TEXTURE;
     
     VkResult result = vmaCreateImage(ctx->allocator, &createInfo, &allocInfo, &image->image, &image->allocation, NULL);
     if (result != VK_SUCCESS) {
         FATAL("Vulkan image creation failed with error code: %d", result);
     }
+    vulkan_memory_track_allocation(ctx, image->category, image->allocation);
 
     transition_layout(image, VK_IMAGE_LAYOUT_UNDEFINED, VK_IMAGE_LAYOUT_TRANSFER_DST_OPTIMAL, aspects);
     copy_buffer_to_image(image, buffer);
@@ -233,6 +364,7 @@ vulkan_image* vulkan_image_create_from_image(vulkan_context* ctx, VkImage img, V
     image->ctx = ctx;
     image->image = img;
     image->ownsImage = false;
+    image->ownsMemory = false;
     image->format = format;
     image->width = width;
     image->height = height;
@@ -245,32 +377,71 @@ vulkan_image* vulkan_image_create_from_image(vulkan_context* ctx, VkImage img, V
 
 void vulkan_image_destroy(vulkan_image* image) {
     vkDestroyImageView(image->ctx->device->device, image->imageView, NULL);
-    if (image->ownsImage) {
+    if (image->ownsMemory) {
+        vulkan_memory_track_free(image->ctx, image->category, image->allocation);
         vmaDestroyImage(image->ctx->allocator, image->image, image->allocation);
+    } else if (image->ownsImage) {
+        vkDestroyImage(image->ctx->device->device, image->image, NULL);
     }
     free(image);
 }
 
 vulkan_image* vulkan_image_get_default_color_texture(vulkan_context* ctx) {
-    static vulkan_image* image = NULL;
-    if (image == NULL) {
-        image = vulkan_image_create(ctx, VK_FORMAT_R32G32B32A32_SFLOAT, VK_IMAGE_USAGE_SAMPLED_BIT, 1, 1, VK_IMAGE_ASPECT_COLOR_BIT, VK_SAMPLE_COUNT_1_BIT);
+    if (ctx->defaultColorTexture == NULL) {
+        vulkan_image* image = vulkan_image_create(ctx, VK_FORMAT_R32G32B32A32_SFLOAT, VK_IMAGE_USAGE_SAMPLED_BIT, 1, 1, VK_IMAGE_ASPECT_COLOR_BIT, VK_SAMPLE_COUNT_1_BIT, MEMORY_CATEGORY_TEXTURE);
         float white[4] = {1.0f, 1.0f, 1.0f, 1.0f};
-        vulkan_buffer* buffer = vulkan_buffer_create_with_data(ctx, VK_BUFFER_USAGE_TRANSFER_SRC_BIT, sizeof(float) * 4, (void*)white);
+        vulkan_buffer* buffer = vulkan_buffer_create_with_data(ctx, VK_BUFFER_USAGE_TRANSFER_SRC_BIT, sizeof(float) * 4, MEMORY_CATEGORY_STAGING, (void*)white);
 
         transition_layout(image, VK_IMAGE_LAYOUT_UNDEFINED, VK_IMAGE_LAYOUT_TRANSFER_DST_OPTIMAL, VK_IMAGE_ASPECT_COLOR_BIT);
         copy_buffer_to_image(image, buffer);
         transition_layout(image, VK_IMAGE_LAYOUT_TRANSFER_DST_OPTIMAL, VK_IMAGE_LAYOUT_SHADER_READ_ONLY_OPTIMAL, VK_IMAGE_ASPECT_COLOR_BIT);
+        vulkan_buffer_destroy(buffer);
+        ctx->defaultColorTexture = image;
     }
 
-    return image;
+    return ctx->defaultColorTexture;
 }
 
-vulkan_sampler* vulkan_sampler_create(vulkan_context* ctx, VkFilter magFilter, VkFilter minFilter, VkSamplerAddressMode addressModeU, VkSamplerAddressMode addressModeV) {
-    vulkan_sampler* sampler = malloc(sizeof(vulkan_sampler));
-    CLEAR_MEMORY(sampler);
-    sampler->ctx = ctx;
+u64 hash_sampler_info(VkSamplerCreateInfo* info) {
+    u64 hash = hash_u64(info->flags, HASH_SEED);
+    hash = hash_u64(info->magFilter, hash);
+    hash = hash_u64(info->minFilter, hash);
+    hash = hash_u64(info->mipmapMode, hash);
+    hash = hash_u64(info->addressModeU, hash);
+    hash = hash_u64(info->addressModeV, hash);
+    hash = hash_u64(info->addressModeW, hash);
+    hash = hash_bytes(&info->mipLodBias, sizeof(float), hash);
+    hash = hash_u64(info->anisotropyEnable, hash);
+    hash = hash_bytes(&info->maxAnisotropy, sizeof(float), hash);
+    hash = hash_u64(info->compareEnable, hash);
+    hash = hash_u64(info->compareOp, hash);
+    hash = hash_bytes(&info->minLod, sizeof(float), hash);
+    hash = hash_bytes(&info->maxLod, sizeof(float), hash);
+    hash = hash_u64(info->borderColor, hash);
+    hash = hash_u64(info->unnormalizedCoordinates, hash);
+    return hash;
+}
+
+bool sampler_info_equal(VkSamplerCreateInfo* a, VkSamplerCreateInfo* b) {
+    return a->flags == b->flags &&
+        a->magFilter == b->magFilter &&
+        a->minFilter == b->minFilter &&
+        a->mipmapMode == b->mipmapMode &&
+        a->addressModeU == b->addressModeU &&
+        a->addressModeV == b->addressModeV &&
+        a->addressModeW == b->addressModeW &&
+        a->mipLodBias == b->mipLodBias &&
+        a->anisotropyEnable == b->anisotropyEnable &&
+        a->maxAnisotropy == b->maxAnisotropy &&
+        a->compareEnable == b->compareEnable &&
+        a->compareOp == b->compareOp &&
+        a->minLod == b->minLod &&
+        a->maxLod == b->maxLod &&
+        a->borderColor == b->borderColor &&
+        a->unnormalizedCoordinates == b->unnormalizedCoordinates;
+}
 
+vulkan_sampler* vulkan_sampler_create(vulkan_context* ctx, VkFilter magFilter, VkFilter minFilter, VkSamplerAddressMode addressModeU, VkSamplerAddressMode addressModeV) {
     VkSamplerCreateInfo createInfo;
     CLEAR_MEMORY(&createInfo);
 
@@ -291,15 +462,45 @@ vulkan_sampler* vulkan_sampler_create(vulkan_context* ctx, VkFilter magFilter, V
     createInfo.minLod = 0.0f;
     createInfo.maxLod = 0.0f;
 
-    VkResult result = vkCreateSampler(ctx->device->device, &createInfo, NULL, &sampler->sampler);
+    return vulkan_sampler_create_from_info(ctx, &createInfo);
+}
+
+vulkan_sampler* vulkan_sampler_create_from_info(vulkan_context* ctx, VkSamplerCreateInfo* info) {
+    // Extension structs aren't part of the key, so samplers that use them are never shared
+    bool cacheable = info->pNext == NULL;
+    u64 hash = hash_sampler_info(info);
+    vulkan_sampler* cached = cacheable ? hashmap_get(ctx->device->samplerCache, hash) : NULL;
+    if (cached != NULL && sampler_info_equal(&cached->info, info)) {
+        cached->refCount++;
+        return cached;
+    }
+
+    vulkan_sampler* sampler = malloc(sizeof(vulkan_sampler));
+    CLEAR_MEMORY(sampler);
+    sampler->ctx = ctx;
+    sampler->info = *info;
+    sampler->info.pNext = NULL;
+    sampler->hash = hash;
+    sampler->refCount = 1;
+
+    VkResult result = vkCreateSampler(ctx->device->device, info, NULL, &sampler->sampler);
     if (result != VK_SUCCESS) {
         FATAL("Vulkan sampler creation failed with error code: %d", result);
     }
 
+    if (cacheable && cached == NULL) {
+        hashmap_set(ctx->device->samplerCache, hash, sampler);
+    }
+
     return sampler;
 }
 
 void vulkan_sampler_destroy(vulkan_sampler* sampler) {
+    if (--sampler->refCount != 0) return;
+    if (hashmap_get(sampler->ctx->device->samplerCache, sampler->hash) == sampler) {
+        hashmap_remove(sampler->ctx->device->samplerCache, sampler->hash);
+    }
+
     vkDestroySampler(sampler->ctx->device->device, sampler->sampler, NULL);
     free(sampler);
 }
\ No newline at end of file
@@ -11,24 +11,45 @@ typedef struct _vulkan_image {
     VkImage image;
     VmaAllocation allocation;
     bool ownsImage;
+    bool ownsMemory; // False for swapchain images and for images aliased into memory someone else allocated
     VkImageView imageView;
     VkFormat format;
     u32 width;
     u32 height;
     VkSampleCountFlagBits samples;
+    vulkan_memory_category category;
 } vulkan_image;
 
-vulkan_image* vulkan_image_create(vulkan_context* ctx, VkFormat format, VkImageUsageFlags usage, u32 width, u32 height, VkImageAspectFlags aspects, VkSampleCountFlagBits samples);
+// The stages and accesses that use an image in a layout, so one-off transitions only wait on what the layout implies
+typedef struct {
+    VkPipelineStageFlags2 stages;
+    VkAccessFlags2 access;
+} vulkan_image_layout_access;
+
+vulkan_image_layout_access vulkan_image_get_layout_access(VkImageLayout layout);
+
+vulkan_image* vulkan_image_create(vulkan_context* ctx, VkFormat format, VkImageUsageFlags usage, u32 width, u32 height, VkImageAspectFlags aspects, VkSampleCountFlagBits samples, vulkan_memory_category category);
 vulkan_image* vulkan_image_create_from_file(vulkan_context* ctx, const char* path, VkFormat format, VkImageUsageFlags usage, VkImageAspectFlags aspects);
+// Requirements of an image vulkan_image_create would make, without creating one
+VkMemoryRequirements vulkan_image_get_memory_requirements(vulkan_context* ctx, VkFormat format, VkImageUsageFlags usage, u32 width, u32 height, VkSampleCountFlagBits samples);
+// Binds the image at an offset into an existing allocation, which it doesn't free, so other images can share the memory
+vulkan_image* vulkan_image_create_aliased(vulkan_context* ctx, VkFormat format, VkImageUsageFlags usage, u32 width, u32 height, VkImageAspectFlags aspects, VkSampleCountFlagBits samples, VmaAllocation allocation, VkDeviceSize offset);
 vulkan_image* vulkan_image_create_from_image(vulkan_context* ctx, VkImage image, VkFormat format, u32 width, u32 height, VkImageAspectFlags aspects);
 void vulkan_image_destroy(vulkan_image* image);
 
 vulkan_image* vulkan_image_get_default_color_texture(vulkan_context* ctx);
+// Integer formats can't be averaged, so they can't be filtered or resolved the usual way
+bool vulkan_format_is_integer(VkFormat format);
 
+// Samplers are shared through the device's cache, destroying one only drops a reference
 typedef struct {
     vulkan_context* ctx;
     VkSampler sampler;
+    VkSamplerCreateInfo info;
+    u64 hash;
+    u32 refCount;
 } vulkan_sampler;
 
 vulkan_sampler* vulkan_sampler_create(vulkan_context* ctx, VkFilter magFilter, VkFilter minFilter, VkSamplerAddressMode addressModeU, VkSamplerAddressMode addressModeV);
+vulkan_sampler* vulkan_sampler_create_from_info(vulkan_context* ctx, VkSamplerCreateInfo* info);
 void vulkan_sampler_destroy(vulkan_sampler* sampler);
\ No newline at end of file
@@ -0,0 +1,154 @@
+#include "memory.h"
+
+#include "context.h"
+#include "cJSON.h"
+
+static const char* categoryNames[MEMORY_CATEGORY_COUNT] = {
+    "geometry", "textures", "framegraph", "staging", "uniforms"
+};
+
+vulkan_memory_tracker* vulkan_memory_tracker_create(vulkan_context* ctx) {
+    vulkan_memory_tracker* tracker = malloc(sizeof(vulkan_memory_tracker));
+    CLEAR_MEMORY(tracker);
+    tracker->ctx = ctx;
+    tracker->pressureThreshold = 1.0f;
+
+    return tracker;
+}
+
+void vulkan_memory_tracker_destroy(vulkan_memory_tracker* tracker) {
+    // Anything still tracked at this point was never released by its owner
+    for (u32 i = 0; i < MEMORY_CATEGORY_COUNT; i++) {
+        if (tracker->categories[i].numAllocations != 0) {
+            WARN("Leaked %llu %s allocations (%llu bytes)", (unsigned long long)tracker->categories[i].numAllocations, categoryNames[i], (unsigned long long)tracker->categories[i].current);
+        }
+    }
+    free(tracker);
+}
+
+const char* vulkan_memory_category_name(vulkan_memory_category category) {
+    return categoryNames[category];
+}
+
+u64 vulkan_memory_get_allocation_size(vulkan_context* ctx, VmaAllocation allocation) {
+    VmaAllocationInfo allocationInfo;
+    vmaGetAllocationInfo(ctx->allocator, allocation, &allocationInfo);
+    return allocationInfo.size;
+}
+
+void vulkan_memory_track_allocation(vulkan_context* ctx, vulkan_memory_category category, VmaAllocation allocation) {
+    vulkan_memory_tracker* tracker = ctx->memory;
+    u64 size = vulkan_memory_get_allocation_size(ctx, allocation);
+
+    vulkan_memory_category_stats* stats = &tracker->categories[category];
+    stats->current += size;
+    stats->numAllocations++;
+    stats->totalAllocations++;
+    if (stats->current > stats->peak) stats->peak = stats->current;
+
+    tracker->current += size;
+    if (tracker->current > tracker->peak) tracker->peak = tracker->current;
+}
+
+void vulkan_memory_track_free(vulkan_context* ctx, vulkan_memory_category category, VmaAllocation allocation) {
+    vulkan_memory_tracker* tracker = ctx->memory;
+    u64 size = vulkan_memory_get_allocation_size(ctx, allocation);
+
+    vulkan_memory_category_stats* stats = &tracker->categories[category];
+    stats->current -= size;
+    stats->numAllocations--;
+    tracker->current -= size;
+}
+
+void vulkan_memory_set_pressure_callback(vulkan_context* ctx, float threshold, vulkan_memory_pressure_fn fn, void* data) {
+    ctx->memory->pressureThreshold = threshold;
+    ctx->memory->pressureFn = fn;
+    ctx->memory->pressureData = data;
+}
+
+void vulkan_memory_new_frame(vulkan_context* ctx) {
+    vulkan_memory_tracker* tracker = ctx->memory;
+    tracker->frameIndex++;
+    vmaSetCurrentFrameIndex(ctx->allocator, tracker->frameIndex); // Lets VMA refresh its budget numbers
+
+    if (tracker->pressureFn == NULL) return;
+
+    const VkPhysicalDeviceMemoryProperties* memoryProperties;
+    vmaGetMemoryProperties(ctx->allocator, &memoryProperties);
+    VmaBudget budgets[VK_MAX_MEMORY_HEAPS];
+    vmaGetHeapBudgets(ctx->allocator, budgets);
+
+    for (u32 i = 0; i < memoryProperties->memoryHeapCount; i++) {
+        if (budgets[i].budget == 0) continue;
+
+        // Only report when a heap crosses the threshold, not every frame it stays above it
+        bool underPressure = (float)budgets[i].usage >= tracker->pressureThreshold * (float)budgets[i].budget;
+        if (underPressure && !tracker->underPressure[i]) {
+            tracker->pressureFn(ctx, i, budgets[i].usage, budgets[i].budget, tracker->pressureData);
+        }
+        tracker->underPressure[i] = underPressure;
+    }
+}
+
+void vulkan_memory_get_device_budget(vulkan_context* ctx, u64* usage, u64* budget) {
+    const VkPhysicalDeviceMemoryProperties* memoryProperties;
+    vmaGetMemoryProperties(ctx->allocator, &memoryProperties);
+    VmaBudget budgets[VK_MAX_MEMORY_HEAPS];
+    vmaGetHeapBudgets(ctx->allocator, budgets);
+
+    // Summed over the device local heaps, which is where the resident set lives
+    *usage = 0;
+    *budget = 0;
+    for (u32 i = 0; i < memoryProperties->memoryHeapCount; i++) {
+        if (!(memoryProperties->memoryHeaps[i].flags & VK_MEMORY_HEAP_DEVICE_LOCAL_BIT)) continue;
+        *usage += budgets[i].usage;
+        *budget += budgets[i].budget;
+    }
+}
+
+void vulkan_memory_dump_json(vulkan_context* ctx, const char* path) {
+    vulkan_memory_tracker* tracker = ctx->memory;
+    cJSON* root = cJSON_CreateObject();
+    cJSON_AddNumberToObject(root, "frame", tracker->frameIndex);
+    cJSON_AddNumberToObject(root, "current", (double)tracker->current);
+    cJSON_AddNumberToObject(root, "peak", (double)tracker->peak);
+
+    cJSON* categories = cJSON_AddObjectToObject(root, "categories");
+    for (u32 i = 0; i < MEMORY_CATEGORY_COUNT; i++) {
+        cJSON* category = cJSON_AddObjectToObject(categories, categoryNames[i]);
+        cJSON_AddNumberToObject(category, "current", (double)tracker->categories[i].current);
+        cJSON_AddNumberToObject(category, "peak", (double)tracker->categories[i].peak);
+        cJSON_AddNumberToObject(category, "allocations", (double)tracker->categories[i].numAllocations);
+        cJSON_AddNumberToObject(category, "totalAllocations", (double)tracker->categories[i].totalAllocations);
+    }
+
+    const VkPhysicalDeviceMemoryProperties* memoryProperties;
+    vmaGetMemoryProperties(ctx->allocator, &memoryProperties);
+    VmaBudget budgets[VK_MAX_MEMORY_HEAPS];
+    vmaGetHeapBudgets(ctx->allocator, budgets);
+
+    cJSON* heaps = cJSON_AddArrayToObject(root, "heaps");
+    for (u32 i = 0; i < memoryProperties->memoryHeapCount; i++) {
+        cJSON* heap = cJSON_CreateObject();
+        cJSON_AddNumberToObject(heap, "size", (double)memoryProperties->memoryHeaps[i].size);
+        cJSON_AddBoolToObject(heap, "deviceLocal", memoryProperties->memoryHeaps[i].flags & VK_MEMORY_HEAP_DEVICE_LOCAL_BIT);
+        cJSON_AddNumberToObject(heap, "usage", (double)budgets[i].usage);
+        cJSON_AddNumberToObject(heap, "budget", (double)budgets[i].budget);
+        cJSON_AddNumberToObject(heap, "blockBytes", (double)budgets[i].statistics.blockBytes);
+        cJSON_AddNumberToObject(heap, "allocationBytes", (double)budgets[i].statistics.allocationBytes);
+        cJSON_AddItemToArray(heaps, heap);
+    }
+
+    char* text = cJSON_Print(root);
+    FILE* file = fopen(path, "w");
+    if (file == NULL) {
+        ERROR("Could not open file: %s", path);
+    } else {
+        fputs(text, file);
+        fclose(file);
+        INFO("Wrote memory report to %s", path);
+    }
+
+    cJSON_free(text);
+    cJSON_Delete(root);
+}
\ No newline at end of file
@@ -0,0 +1,53 @@
+#pragma once
+
+#include "core/core.h"
+#include "vulkan/vulkan.h"
+#include "vk_mem_alloc.h"
+
+typedef struct _vulkan_context vulkan_context;
+
+typedef enum {
+    MEMORY_CATEGORY_GEOMETRY,
+    MEMORY_CATEGORY_TEXTURE,
+    MEMORY_CATEGORY_FRAMEGRAPH,
+    MEMORY_CATEGORY_STAGING,
+    MEMORY_CATEGORY_UNIFORM,
+    MEMORY_CATEGORY_COUNT
+} vulkan_memory_category;
+
+typedef struct {
+    u64 current;
+    u64 peak;
+    u64 numAllocations;
+    u64 totalAllocations;
+} vulkan_memory_category_stats;
+
+typedef void(*vulkan_memory_pressure_fn)(vulkan_context* ctx, u32 heapIndex, u64 usage, u64 budget, void* data);
+
+typedef struct {
+    vulkan_context* ctx;
+
+    vulkan_memory_category_stats categories[MEMORY_CATEGORY_COUNT];
+    u64 current;
+    u64 peak;
+
+    u32 frameIndex;
+    float pressureThreshold;
+    vulkan_memory_pressure_fn pressureFn;
+    void* pressureData;
+    bool underPressure[VK_MAX_MEMORY_HEAPS];
+} vulkan_memory_tracker;
+
+vulkan_memory_tracker* vulkan_memory_tracker_create(vulkan_context* ctx);
+void vulkan_memory_tracker_destroy(vulkan_memory_tracker* tracker);
+
+const char* vulkan_memory_category_name(vulkan_memory_category category);
+u64 vulkan_memory_get_allocation_size(vulkan_context* ctx, VmaAllocation allocation);
+
+void vulkan_memory_track_allocation(vulkan_context* ctx, vulkan_memory_category category, VmaAllocation allocation);
+void vulkan_memory_track_free(vulkan_context* ctx, vulkan_memory_category category, VmaAllocation allocation);
+
+void vulkan_memory_set_pressure_callback(vulkan_context* ctx, float threshold, vulkan_memory_pressure_fn fn, void* data);
+void vulkan_memory_new_frame(vulkan_context* ctx);
+void vulkan_memory_get_device_budget(vulkan_context* ctx, u64* usage, u64* budget);
+void vulkan_memory_dump_json(vulkan_context* ctx, const char* path);
\ No newline at end of file
@@ -16,6 +16,17 @@ vulkan_physical_device* get_all(vulkan_instance* instance, VkSurfaceKHR surface,
         vkGetPhysicalDeviceProperties(physicalDevices[i].physical, &physicalDevices[i].properties);
         vkGetPhysicalDeviceFeatures(physicalDevices[i].physical, &physicalDevices[i].features);
 
+        VkPhysicalDeviceFeatures2 features2;
+        CLEAR_MEMORY(&features2);
+        features2.sType = VK_STRUCTURE_TYPE_PHYSICAL_DEVICE_FEATURES_2;
+        features2.pNext = &physicalDevices[i].features12;
+        physicalDevices[i].features12.sType = VK_STRUCTURE_TYPE_PHYSICAL_DEVICE_VULKAN_1_2_FEATURES;
+        physicalDevices[i].features12.pNext = &physicalDevices[i].features13;
+        physicalDevices[i].features13.sType = VK_STRUCTURE_TYPE_PHYSICAL_DEVICE_VULKAN_1_3_FEATURES;
+        vkGetPhysicalDeviceFeatures2(physicalDevices[i].physical, &features2);
+        physicalDevices[i].features12.pNext = NULL; // The struct gets copied out of this array so it mustn't point into it
+        physicalDevices[i].features13.pNext = NULL;
+
         // Get queue info
         u32 numQueueFamilies;
         vkGetPhysicalDeviceQueueFamilyProperties(physicalDevices[i].physical, &numQueueFamilies, NULL);
@@ -27,6 +38,12 @@ vulkan_physical_device* get_all(vulkan_instance* instance, VkSurfaceKHR surface,
                 physicalDevices[i].queues.graphicsIndex = j;
             }
 
+            bool dedicatedCompute = (queueFamilies[j].queueFlags & VK_QUEUE_COMPUTE_BIT) && !(queueFamilies[j].queueFlags & VK_QUEUE_GRAPHICS_BIT);
+            if (!physicalDevices[i].queues.asyncCompute && dedicatedCompute) {
+                physicalDevices[i].queues.asyncCompute = true;
+                physicalDevices[i].queues.computeIndex = j;
+            }
+
             VkBool32 presentSupport;
             vkGetPhysicalDeviceSurfaceSupportKHR(physicalDevices[i].physical, j, surface, &presentSupport);
             if (!(physicalDevices[i].queues.found & VK_QUEUE_PRESENT_BIT) && presentSupport) {
@@ -34,6 +51,13 @@ vulkan_physical_device* get_all(vulkan_instance* instance, VkSurfaceKHR surface,
                 physicalDevices[i].queues.presentIndex = j;
             }
         }
+        if (!physicalDevices[i].queues.asyncCompute) {
+            physicalDevices[i].queues.computeIndex = physicalDevices[i].queues.graphicsIndex;
+        }
+        if (numQueueFamilies > 0) {
+            physicalDevices[i].queues.graphicsTimestampBits = queueFamilies[physicalDevices[i].queues.graphicsIndex].timestampValidBits;
+            physicalDevices[i].queues.computeTimestampBits = queueFamilies[physicalDevices[i].queues.computeIndex].timestampValidBits;
+        }
         free(queueFamilies);
 
         // Get swapchain info
@@ -78,6 +102,7 @@ bool has_extensions(vulkan_physical_device* physical, u32 numExtensions, const c
             }
         }
         if (!found) {
+            free(availableExtensions);
             return false;
         }
     }
@@ -90,9 +115,25 @@ bool supports_swapchain(vulkan_physical_device* physical) {
     return physical->swapchain_details.numFormats != 0 && physical->swapchain_details.numModes != 0;
 }
 
+bool supports_bindless(vulkan_physical_device* physical) {
+    VkPhysicalDeviceVulkan12Features* features = &physical->features12;
+    return features->descriptorIndexing &&
+            features->runtimeDescriptorArray &&
+            features->descriptorBindingPartiallyBound &&
+            features->descriptorBindingSampledImageUpdateAfterBind &&
+            features->descriptorBindingStorageBufferUpdateAfterBind &&
+            features->descriptorBindingUpdateUnusedWhilePending &&
+            features->shaderSampledImageArrayNonUniformIndexing &&
+            physical->features.shaderStorageBufferArrayDynamicIndexing;
+}
+
 bool is_suitable(vulkan_physical_device* physical, u32 numExtensions, const char** extensions) {
     bool queuesComplete = physical->queues.found == (VK_QUEUE_GRAPHICS_BIT | VK_QUEUE_PRESENT_BIT);
     return queuesComplete && 
+            physical->properties.apiVersion >= VK_API_VERSION_1_3 && // Extended dynamic state is core from 1.3
+            supports_bindless(physical) && 
+            physical->features13.synchronization2 && // The framegraph's barriers
+            physical->features12.timelineSemaphore && // and its cross queue waits
             has_extensions(physical, numExtensions, extensions) && 
             supports_swapchain(physical) && 
             physical->features.samplerAnisotropy && 
@@ -125,4 +166,12 @@ void vulkan_physical_device_destroy(vulkan_physical_device* physical) {
     free(physical->swapchain_details.formats);
     free(physical->swapchain_details.modes);
     free(physical);
+}
+
+bool vulkan_physical_device_has_extension(vulkan_physical_device* physical, const char* extension) {
+    return has_extensions(physical, 1, &extension);
+}
+
+bool vulkan_physical_device_supports_indirect_count(vulkan_physical_device* physical) {
+    return physical->features12.drawIndirectCount && physical->features.multiDrawIndirect && physical->features.drawIndirectFirstInstance;
 }
\ No newline at end of file
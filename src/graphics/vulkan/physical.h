@@ -9,6 +9,12 @@ typedef struct {
     u32 found;
     u32 graphicsIndex;
     u32 presentIndex;
+    // A family with compute but no graphics when there is one, which runs alongside the graphics queue, otherwise the graphics family
+    u32 computeIndex;
+    bool asyncCompute;
+    // Zero when the family can't write timestamps
+    u32 graphicsTimestampBits;
+    u32 computeTimestampBits;
 } vulkan_physical_device_queues;
 
 typedef struct {
@@ -23,6 +29,8 @@ typedef struct {
     VkPhysicalDevice physical;
     VkPhysicalDeviceProperties properties;
     VkPhysicalDeviceFeatures features;
+    VkPhysicalDeviceVulkan12Features features12;
+    VkPhysicalDeviceVulkan13Features features13;
     VkSampleCountFlagBits maxSamples;
 
     vulkan_physical_device_queues queues;
@@ -32,3 +40,7 @@ typedef struct {
 vulkan_physical_device* vulkan_physical_device_create(vulkan_instance* instance, VkSurfaceKHR surface, u32 numExtensions, const char** extensions);
 void vulkan_physical_device_destroy(vulkan_physical_device* physical);
 
+bool vulkan_physical_device_has_extension(vulkan_physical_device* physical, const char* extension);
+// Whether vkCmdDrawIndexedIndirectCount can issue more than one draw with its own firstInstance, which GPU driven rendering relies on
+bool vulkan_physical_device_supports_indirect_count(vulkan_physical_device* physical);
+
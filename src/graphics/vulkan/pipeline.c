@@ -1,6 +1,9 @@
 #include "pipeline.h"
 
 #include "vertex.h"
+#include "pipelinecache.h"
+#include "core/hash.h"
+#include "core/timer.h"
 
 typedef struct {
     vulkan_vertex_info vertexInfo;
@@ -33,35 +36,40 @@ VkPipelineInputAssemblyStateCreateInfo get_input_assembly(vulkan_pipeline_config
     return inputAssembly;
 }
 
-typedef struct {
-    VkViewport viewport;
-    VkRect2D scissor;
-    VkPipelineViewportStateCreateInfo state;
-} vulkan_pipeline_viewport_info;
+VkPipelineViewportStateCreateInfo get_viewport_state(vulkan_pipeline_config* config) {
+    // Viewport and scissor are always dynamic so pipelines don't depend on the target resolution
+    VkPipelineViewportStateCreateInfo viewportState;
+    CLEAR_MEMORY(&viewportState);
 
-vulkan_pipeline_viewport_info* get_viewport_info(vulkan_pipeline_config* config) {
-    vulkan_pipeline_viewport_info* viewportInfo = malloc(sizeof(vulkan_pipeline_viewport_info));
-    CLEAR_MEMORY(viewportInfo);
+    viewportState.sType = VK_STRUCTURE_TYPE_PIPELINE_VIEWPORT_STATE_CREATE_INFO;
+    viewportState.viewportCount = 1;
+    viewportState.scissorCount = 1;
 
-    viewportInfo->viewport.x = 0.0f;
-    viewportInfo->viewport.y = 0.0f;
-    viewportInfo->viewport.width = (float)config->width;
-    viewportInfo->viewport.height = (float)config->height;
-    viewportInfo->viewport.minDepth = 0.0f;
-    viewportInfo->viewport.maxDepth = 1.0f;
-
-    viewportInfo->scissor.offset.x = 0;
-    viewportInfo->scissor.offset.y = 0;
-    viewportInfo->scissor.extent.width = config->width;
-    viewportInfo->scissor.extent.height = config->height;
+    return viewportState;
+}
 
-    viewportInfo->state.sType = VK_STRUCTURE_TYPE_PIPELINE_VIEWPORT_STATE_CREATE_INFO;
-    viewportInfo->state.viewportCount = 1;
-    viewportInfo->state.pViewports = &viewportInfo->viewport;
-    viewportInfo->state.scissorCount = 1;
-    viewportInfo->state.pScissors = &viewportInfo->scissor;
+typedef struct {
+    u32 numStates;
+    VkDynamicState states[6];
+    VkPipelineDynamicStateCreateInfo info;
+} vulkan_pipeline_dynamic_info;
+
+void get_dynamic_state(vulkan_pipeline_config* config, vulkan_pipeline_dynamic_info* dynamicInfo) {
+    CLEAR_MEMORY(dynamicInfo);
+    dynamicInfo->states[dynamicInfo->numStates++] = VK_DYNAMIC_STATE_VIEWPORT;
+    dynamicInfo->states[dynamicInfo->numStates++] = VK_DYNAMIC_STATE_SCISSOR;
+    if (config->dynamicState & PIPELINE_DYNAMIC_CULL_MODE) {
+        dynamicInfo->states[dynamicInfo->numStates++] = VK_DYNAMIC_STATE_CULL_MODE;
+    }
+    if (config->dynamicState & PIPELINE_DYNAMIC_DEPTH) {
+        dynamicInfo->states[dynamicInfo->numStates++] = VK_DYNAMIC_STATE_DEPTH_TEST_ENABLE;
+        dynamicInfo->states[dynamicInfo->numStates++] = VK_DYNAMIC_STATE_DEPTH_WRITE_ENABLE;
+        dynamicInfo->states[dynamicInfo->numStates++] = VK_DYNAMIC_STATE_DEPTH_COMPARE_OP;
+    }
 
-    return viewportInfo;
+    dynamicInfo->info.sType = VK_STRUCTURE_TYPE_PIPELINE_DYNAMIC_STATE_CREATE_INFO;
+    dynamicInfo->info.dynamicStateCount = dynamicInfo->numStates;
+    dynamicInfo->info.pDynamicStates = dynamicInfo->states;
 }
 
 VkPipelineRasterizationStateCreateInfo get_rasterization(vulkan_pipeline_config* config) {
@@ -81,7 +89,6 @@ VkPipelineRasterizationStateCreateInfo get_rasterization(vulkan_pipeline_config*
 }
 
 VkPipelineMultisampleStateCreateInfo get_multisampling(vulkan_pipeline_config* config) {
-    VkSubpassDescription* subpass = &config->renderpass->subpasses[config->subpass];
     VkSampleCountFlagBits samples = config->samples;
     
     VkPipelineMultisampleStateCreateInfo multisampling;
@@ -120,7 +127,42 @@ VkPipelineColorBlendStateCreateInfo get_blending(vulkan_pipeline_config* config)
     return blending;
 }
 
+u64 hash_pipeline_layout_config(vulkan_pipeline_layout_config* config) {
+    // Set layouts are deduplicated, so their handles identify them
+    u64 hash = hash_u64(config->numSetLayouts, HASH_SEED);
+    for (u32 i = 0; i < config->numSetLayouts; i++) {
+        hash = hash_u64((u64)(uintptr_t)config->setLayouts[i], hash);
+    }
+    hash = hash_u64(config->numPushConstantRanges, hash);
+    for (u32 i = 0; i < config->numPushConstantRanges; i++) {
+        hash = hash_u64(config->pushConstantRanges[i].stageFlags, hash);
+        hash = hash_u64(config->pushConstantRanges[i].offset, hash);
+        hash = hash_u64(config->pushConstantRanges[i].size, hash);
+    }
+    return hash;
+}
+
+bool pipeline_layout_config_equal(vulkan_pipeline_layout* layout, vulkan_pipeline_layout_config* config) {
+    if (layout->numSetLayouts != config->numSetLayouts || layout->numPushConstantRanges != config->numPushConstantRanges) return false;
+    for (u32 i = 0; i < config->numSetLayouts; i++) {
+        if (layout->setLayouts[i] != config->setLayouts[i]) return false;
+    }
+    for (u32 i = 0; i < config->numPushConstantRanges; i++) {
+        if (layout->pushConstantRanges[i].stageFlags != config->pushConstantRanges[i].stageFlags ||
+            layout->pushConstantRanges[i].offset != config->pushConstantRanges[i].offset ||
+            layout->pushConstantRanges[i].size != config->pushConstantRanges[i].size) return false;
+    }
+    return true;
+}
+
 vulkan_pipeline_layout* vulkan_pipeline_layout_create(vulkan_device* device, vulkan_pipeline_layout_config* config) {
+    u64 hash = hash_pipeline_layout_config(config);
+    vulkan_pipeline_layout* cached = hashmap_get(device->pipelineLayoutCache, hash);
+    if (cached != NULL && pipeline_layout_config_equal(cached, config)) {
+        cached->refCount++;
+        return cached;
+    }
+
     VkPipelineLayoutCreateInfo createInfo;
     CLEAR_MEMORY(&createInfo);
 
@@ -133,71 +175,165 @@ vulkan_pipeline_layout* vulkan_pipeline_layout_create(vulkan_device* device, vul
     createInfo.sType = VK_STRUCTURE_TYPE_PIPELINE_LAYOUT_CREATE_INFO;
     createInfo.setLayoutCount = config->numSetLayouts;
     createInfo.pSetLayouts = setLayouts;
+    createInfo.pushConstantRangeCount = config->numPushConstantRanges;
+    createInfo.pPushConstantRanges = config->pushConstantRanges;
     
     vulkan_pipeline_layout* layout = malloc(sizeof(vulkan_pipeline_layout));
     CLEAR_MEMORY(layout);
     layout->device = device;
+    layout->hash = hash;
+    layout->refCount = 1;
 
     VkResult result = vkCreatePipelineLayout(device->device, &createInfo, NULL, &layout->layout);
     if (result != VK_SUCCESS) {
         FATAL("Vulkan pipeline layout creation failed with error code: %d", result);
     }
+    free(setLayouts);
+
+    // Keep the set layouts alive for as long as anything can still bind sets against this layout
+    layout->numSetLayouts = config->numSetLayouts;
+    layout->setLayouts = malloc(sizeof(vulkan_descriptor_set_layout*) * config->numSetLayouts);
+    for (u32 i = 0; i < config->numSetLayouts; i++) {
+        layout->setLayouts[i] = config->setLayouts[i];
+        layout->setLayouts[i]->refCount++;
+    }
+    layout->numPushConstantRanges = config->numPushConstantRanges;
+    layout->pushConstantRanges = malloc(sizeof(VkPushConstantRange) * config->numPushConstantRanges);
+    memcpy(layout->pushConstantRanges, config->pushConstantRanges, sizeof(VkPushConstantRange) * config->numPushConstantRanges);
+
+    if (cached == NULL) {
+        hashmap_set(device->pipelineLayoutCache, hash, layout);
+    }
 
     return layout;
 }
 
 void vulkan_pipeline_layout_destroy(vulkan_pipeline_layout* layout) {
+    if (--layout->refCount != 0) return;
+    if (hashmap_get(layout->device->pipelineLayoutCache, layout->hash) == layout) {
+        hashmap_remove(layout->device->pipelineLayoutCache, layout->hash);
+    }
+
     vkDestroyPipelineLayout(layout->device->device, layout->layout, NULL);
+    for (u32 i = 0; i < layout->numSetLayouts; i++) {
+        vulkan_descriptor_set_layout_destroy(layout->setLayouts[i]);
+    }
+    free(layout->setLayouts);
+    free(layout->pushConstantRanges);
     free(layout);
 }
 
+bool vulkan_pipeline_validate(vulkan_pipeline_config* config) {
+    vulkan_vertex_info vertexInfo = vulkan_vertex_get_info();
+    vulkan_shader_reflection* vertex = &config->vertexShader->reflection;
+    vulkan_shader_reflection* fragment = &config->fragmentShader->reflection;
+
+    return vulkan_reflect_validate_vertex_input(vertex, &vertexInfo) &&
+        vulkan_reflect_validate_interface(vertex, fragment) &&
+        vulkan_reflect_validate_specialization(vertex, fragment, config->specialization) &&
+        vulkan_reflect_validate_layout(vertex, config->numSetLayouts, config->setLayouts, config->numPushConstantRanges, config->pushConstantRanges) &&
+        vulkan_reflect_validate_layout(fragment, config->numSetLayouts, config->setLayouts, config->numPushConstantRanges, config->pushConstantRanges);
+}
+
 vulkan_pipeline* vulkan_pipeline_create(vulkan_device* device, vulkan_pipeline_config* config) {
+    if (!vulkan_pipeline_validate(config)) return NULL;
+
+    vulkan_pipeline_layout_config layoutConfig;
+    CLEAR_MEMORY(&layoutConfig);
+    layoutConfig.numSetLayouts = config->numSetLayouts;
+    layoutConfig.setLayouts = config->setLayouts;
+    layoutConfig.numPushConstantRanges = config->numPushConstantRanges;
+    layoutConfig.pushConstantRanges = config->pushConstantRanges;
+
+    return vulkan_pipeline_create_with_layout(device, config, vulkan_pipeline_layout_create(device, &layoutConfig));
+}
+
+vulkan_pipeline* vulkan_pipeline_create_with_layout(vulkan_device* device, vulkan_pipeline_config* config, vulkan_pipeline_layout* layout) {
     VkPipelineShaderStageCreateInfo shaderStages[2];
     shaderStages[0] = vulkan_shader_get_stage_info(config->vertexShader);
     shaderStages[1] = vulkan_shader_get_stage_info(config->fragmentShader);
+    shaderStages[0].pSpecializationInfo = config->specialization;
+    shaderStages[1].pSpecializationInfo = config->specialization;
     vulkan_pipeline_vertex_info* vertexInfo = get_vertex_input(config);
     VkPipelineInputAssemblyStateCreateInfo inputAssembly = get_input_assembly(config);
-    vulkan_pipeline_viewport_info* viewportInfo = get_viewport_info(config);
+    VkPipelineViewportStateCreateInfo viewportState = get_viewport_state(config);
     VkPipelineRasterizationStateCreateInfo rasterizer = get_rasterization(config);
     VkPipelineMultisampleStateCreateInfo multisampling = get_multisampling(config);
     VkPipelineDepthStencilStateCreateInfo depthStencil = get_depth_stencil(config);
     VkPipelineColorBlendStateCreateInfo blending = get_blending(config);
-    VkSubpassDescription subpass = config->renderpass->subpasses[config->subpass];
+    vulkan_pipeline_dynamic_info dynamicInfo;
+    get_dynamic_state(config, &dynamicInfo);
+
+    VkPipelineRenderingCreateInfo renderingInfo;
+    CLEAR_MEMORY(&renderingInfo);
+    renderingInfo.sType = VK_STRUCTURE_TYPE_PIPELINE_RENDERING_CREATE_INFO;
+    renderingInfo.colorAttachmentCount = config->rendering.numColorFormats;
+    renderingInfo.pColorAttachmentFormats = config->rendering.colorFormats;
+    renderingInfo.depthAttachmentFormat = config->rendering.depthFormat;
+    bool depthBuffered = config->renderpass != NULL
+        ? config->renderpass->subpasses[config->subpass].pDepthStencilAttachment != NULL
+        : config->rendering.depthFormat != VK_FORMAT_UNDEFINED;
 
-    vulkan_pipeline_layout_config layoutConfig;
-    CLEAR_MEMORY(&layoutConfig);
-    layoutConfig.numSetLayouts = config->numSetLayouts;
-    layoutConfig.setLayouts = config->setLayouts;
-    vulkan_pipeline_layout* layout = vulkan_pipeline_layout_create(device, &layoutConfig);
-    
     VkGraphicsPipelineCreateInfo  createInfo;
     CLEAR_MEMORY(&createInfo);
 
     createInfo.sType = VK_STRUCTURE_TYPE_GRAPHICS_PIPELINE_CREATE_INFO;
+    createInfo.pNext = config->renderpass == NULL ? &renderingInfo : NULL;
     createInfo.stageCount = 2;
     createInfo.pStages = shaderStages;
     createInfo.pVertexInputState = &vertexInfo->vertexInputInfo;
     createInfo.pInputAssemblyState = &inputAssembly;
-    createInfo.pViewportState = &viewportInfo->state;
+    createInfo.pViewportState = &viewportState;
     createInfo.pRasterizationState = &rasterizer;
     createInfo.pMultisampleState = &multisampling;
-    createInfo.pDepthStencilState = subpass.pDepthStencilAttachment != NULL ? &depthStencil : NULL;
+    createInfo.pDepthStencilState = depthBuffered ? &depthStencil : NULL;
     createInfo.pColorBlendState = &blending;
-    createInfo.pDynamicState = NULL;
+    createInfo.pDynamicState = &dynamicInfo.info;
     createInfo.layout = layout->layout;
-    createInfo.renderPass = config->renderpass->renderpass;
+    createInfo.renderPass = config->renderpass != NULL ? config->renderpass->renderpass : VK_NULL_HANDLE;
     createInfo.subpass = config->subpass;
 
     vulkan_pipeline* pipeline = malloc(sizeof(vulkan_pipeline));
     pipeline->device = device;
     pipeline->layout = layout;
-    VkResult result = vkCreateGraphicsPipelines(device->device, VK_NULL_HANDLE, 1, &createInfo, NULL, &pipeline->pipeline);
+    double start = timer_now();
+    VkResult result = vkCreateGraphicsPipelines(device->device, device->pipelineCache->cache, 1, &createInfo, NULL, &pipeline->pipeline);
     if (result != VK_SUCCESS) {
         FATAL("Vulkan pipeline creation failed with error code: %d", result);
     }
+    vulkan_pipeline_cache_record_creation(device->pipelineCache, timer_now() - start);
 
     free(vertexInfo);
-    free(viewportInfo);
+
+    return pipeline;
+}
+
+vulkan_pipeline* vulkan_compute_pipeline_create(vulkan_device* device, vulkan_shader* shader, vulkan_pipeline_layout_config* layoutConfig) {
+    if (shader->type != COMPUTE) {
+        FATAL("Compute pipelines need a compute shader, got stage %d", shader->type);
+        return NULL;
+    }
+
+    if (!vulkan_reflect_validate_layout(&shader->reflection, layoutConfig->numSetLayouts, layoutConfig->setLayouts, layoutConfig->numPushConstantRanges, layoutConfig->pushConstantRanges)) {
+        return NULL;
+    }
+    vulkan_pipeline_layout* layout = vulkan_pipeline_layout_create(device, layoutConfig);
+
+    VkComputePipelineCreateInfo createInfo;
+    CLEAR_MEMORY(&createInfo);
+    createInfo.sType = VK_STRUCTURE_TYPE_COMPUTE_PIPELINE_CREATE_INFO;
+    createInfo.stage = vulkan_shader_get_stage_info(shader);
+    createInfo.layout = layout->layout;
+
+    vulkan_pipeline* pipeline = malloc(sizeof(vulkan_pipeline));
+    pipeline->device = device;
+    pipeline->layout = layout;
+    double start = timer_now();
+    VkResult result = vkCreateComputePipelines(device->device, device->pipelineCache->cache, 1, &createInfo, NULL, &pipeline->pipeline);
+    if (result != VK_SUCCESS) {
+        FATAL("Vulkan compute pipeline creation failed with error code: %d", result);
+    }
+    vulkan_pipeline_cache_record_creation(device->pipelineCache, timer_now() - start);
 
     return pipeline;
 }
@@ -215,3 +351,131 @@ VkPipelineColorBlendAttachmentState vulkan_get_default_blending() {
     blending.blendEnable = VK_FALSE;
     return blending;
 }
+
+
+u32 append_attachment_references(u32* key, u32 size, u32 numReferences, const VkAttachmentReference* references) {
+    if (key != NULL) key[size] = numReferences;
+    size++;
+    for (u32 i = 0; i < numReferences; i++) {
+        if (key != NULL) key[size] = references[i].attachment;
+        size++;
+    }
+    return size;
+}
+
+u32 vulkan_pipeline_get_renderpass_key(vulkan_pipeline_config* config, u32* key) {
+    vulkan_renderpass* renderpass = config->renderpass;
+    u32 size = 0;
+    if (renderpass == NULL) return size;
+
+    if (key != NULL) key[size] = renderpass->numAttachments;
+    size++;
+    for (u32 i = 0; i < renderpass->numAttachments; i++) {
+        if (key != NULL) {
+            key[size] = renderpass->attachments[i].format;
+            key[size + 1] = renderpass->attachments[i].samples;
+        }
+        size += 2;
+    }
+    VkSubpassDescription* subpass = &renderpass->subpasses[config->subpass];
+    if (key != NULL) key[size] = config->subpass;
+    size++;
+    size = append_attachment_references(key, size, subpass->inputAttachmentCount, subpass->pInputAttachments);
+    size = append_attachment_references(key, size, subpass->colorAttachmentCount, subpass->pColorAttachments);
+    size = append_attachment_references(key, size, subpass->pResolveAttachments != NULL ? subpass->colorAttachmentCount : 0, subpass->pResolveAttachments);
+    size = append_attachment_references(key, size, subpass->pDepthStencilAttachment != NULL ? 1 : 0, subpass->pDepthStencilAttachment);
+    return size;
+}
+
+u64 vulkan_pipeline_config_hash(vulkan_pipeline_config* config) {
+    u64 hash = hash_u64(config->vertexShader->hash, HASH_SEED);
+    hash = hash_u64(config->fragmentShader->hash, hash);
+
+    vulkan_vertex_info vertexInfo = vulkan_vertex_get_info();
+    hash = hash_u64(vertexInfo.numAttributes, hash);
+    for (u32 i = 0; i < vertexInfo.numAttributes; i++) {
+        hash = hash_u64(vertexInfo.attributes[i].location, hash);
+        hash = hash_u64(vertexInfo.attributes[i].binding, hash);
+        hash = hash_u64(vertexInfo.attributes[i].format, hash);
+        hash = hash_u64(vertexInfo.attributes[i].offset, hash);
+        hash = hash_u64(vertexInfo.bindings[i].binding, hash);
+        hash = hash_u64(vertexInfo.bindings[i].stride, hash);
+        hash = hash_u64(vertexInfo.bindings[i].inputRate, hash);
+    }
+
+    hash = hash_u64(config->dynamicState, hash);
+    hash = hash_u64(config->rasterizerCullMode, hash);
+    hash = hash_u64(config->samples, hash);
+
+    // Set layouts are deduplicated so their handles identify them
+    hash = hash_u64(config->numSetLayouts, hash);
+    for (u32 i = 0; i < config->numSetLayouts; i++) {
+        hash = hash_u64((u64)(uintptr_t)config->setLayouts[i], hash);
+    }
+    hash = hash_u64(config->numPushConstantRanges, hash);
+    for (u32 i = 0; i < config->numPushConstantRanges; i++) {
+        hash = hash_u64(config->pushConstantRanges[i].stageFlags, hash);
+        hash = hash_u64(config->pushConstantRanges[i].offset, hash);
+        hash = hash_u64(config->pushConstantRanges[i].size, hash);
+    }
+
+    hash = hash_u64(config->numBlendingAttachments, hash);
+    for (u32 i = 0; i < config->numBlendingAttachments; i++) {
+        VkPipelineColorBlendAttachmentState* blend = &config->blendingAttachments[i];
+        hash = hash_u64(blend->blendEnable, hash);
+        hash = hash_u64(blend->srcColorBlendFactor, hash);
+        hash = hash_u64(blend->dstColorBlendFactor, hash);
+        hash = hash_u64(blend->colorBlendOp, hash);
+        hash = hash_u64(blend->srcAlphaBlendFactor, hash);
+        hash = hash_u64(blend->dstAlphaBlendFactor, hash);
+        hash = hash_u64(blend->alphaBlendOp, hash);
+        hash = hash_u64(blend->colorWriteMask, hash);
+    }
+
+    // With dynamic rendering only the formats matter, the sample count is hashed above
+    hash = hash_u64(config->renderpass != NULL, hash);
+    if (config->renderpass != NULL) {
+        u32 keySize = vulkan_pipeline_get_renderpass_key(config, NULL);
+        u32* key = malloc(sizeof(u32) * keySize);
+        vulkan_pipeline_get_renderpass_key(config, key);
+        hash = hash_bytes(key, sizeof(u32) * keySize, hash);
+        free(key);
+    } else {
+        hash = hash_u64(config->rendering.numColorFormats, hash);
+        for (u32 i = 0; i < config->rendering.numColorFormats; i++) {
+            hash = hash_u64(config->rendering.colorFormats[i], hash);
+        }
+        hash = hash_u64(config->rendering.depthFormat, hash);
+    }
+
+    if (config->specialization != NULL) {
+        VkSpecializationInfo* specialization = config->specialization;
+        hash = hash_u64(specialization->mapEntryCount, hash);
+        for (u32 i = 0; i < specialization->mapEntryCount; i++) {
+            hash = hash_u64(specialization->pMapEntries[i].constantID, hash);
+            hash = hash_u64(specialization->pMapEntries[i].offset, hash);
+            hash = hash_u64(specialization->pMapEntries[i].size, hash);
+        }
+        hash = hash_bytes(specialization->pData, specialization->dataSize, hash);
+    }
+
+    return hash;
+}
+
+void vulkan_pipeline_set_viewport(VkCommandBuffer cmd, u32 width, u32 height) {
+    VkViewport viewport;
+    viewport.x = 0.0f;
+    viewport.y = 0.0f;
+    viewport.width = (float)width;
+    viewport.height = (float)height;
+    viewport.minDepth = 0.0f;
+    viewport.maxDepth = 1.0f;
+    vkCmdSetViewport(cmd, 0, 1, &viewport);
+
+    VkRect2D scissor;
+    scissor.offset.x = 0;
+    scissor.offset.y = 0;
+    scissor.extent.width = width;
+    scissor.extent.height = height;
+    vkCmdSetScissor(cmd, 0, 1, &scissor);
+}
\ No newline at end of file
@@ -8,14 +8,24 @@
 #include "renderpass.h"
 #include "descriptor.h"
 
+// Shared through the device's cache like set layouts, each one holds a reference on its set layouts
 typedef struct {
     VkPipelineLayout layout;
     vulkan_device* device;
+
+    u32 numSetLayouts;
+    vulkan_descriptor_set_layout** setLayouts;
+    u32 numPushConstantRanges;
+    VkPushConstantRange* pushConstantRanges;
+    u64 hash;
+    u32 refCount;
 } vulkan_pipeline_layout;
 
 typedef struct {
     u32 numSetLayouts;
     vulkan_descriptor_set_layout** setLayouts;
+    u32 numPushConstantRanges;
+    VkPushConstantRange* pushConstantRanges;
 } vulkan_pipeline_layout_config;
 
 vulkan_pipeline_layout* vulkan_pipeline_layout_create(vulkan_device* device, vulkan_pipeline_layout_config* config);
@@ -27,27 +37,58 @@ typedef struct {
     vulkan_pipeline_layout* layout;
 } vulkan_pipeline;
 
+// Viewport and scissor are always dynamic, these opt in to more dynamic state set by whoever records the draws
+typedef enum {
+    PIPELINE_DYNAMIC_CULL_MODE = 1,
+    PIPELINE_DYNAMIC_DEPTH = 2 // Depth test, depth write and compare op
+} vulkan_pipeline_dynamic_state;
+
+// What a pipeline drawn with dynamic rendering renders to, instead of a renderpass and subpass
+typedef struct {
+    u32 numColorFormats;
+    VkFormat* colorFormats;
+    VkFormat depthFormat; // VK_FORMAT_UNDEFINED without a depth attachment
+} vulkan_rendering_formats;
+
 typedef struct {
     vulkan_shader* vertexShader;
     vulkan_shader* fragmentShader;
 
-    u32 width;
-    u32 height;
-
+    // NULL to draw with dynamic rendering, the pipeline is then built against the rendering formats
     u32 subpass;
     vulkan_renderpass* renderpass;
+    vulkan_rendering_formats rendering;
     
     u32 numSetLayouts;
     vulkan_descriptor_set_layout** setLayouts;
+    u32 numPushConstantRanges;
+    VkPushConstantRange* pushConstantRanges;
 
     u32 numBlendingAttachments;
     VkPipelineColorBlendAttachmentState* blendingAttachments;
 
     VkCullModeFlags rasterizerCullMode;
     VkSampleCountFlags samples;
+    u32 dynamicState;
+
+    // Applied to both stages, NULL for none
+    VkSpecializationInfo* specialization;
 } vulkan_pipeline_config;
 
+// Checks the shaders' reflection against the vertex layout, each other and the pipeline layout, logging the first mismatch
+bool vulkan_pipeline_validate(vulkan_pipeline_config* config);
+// NULL if the config fails validation
 vulkan_pipeline* vulkan_pipeline_create(vulkan_device* device, vulkan_pipeline_config* config);
+// Takes over one reference to the layout, which lets the layout be resolved on the calling thread and the pipeline built elsewhere
+vulkan_pipeline* vulkan_pipeline_create_with_layout(vulkan_device* device, vulkan_pipeline_config* config, vulkan_pipeline_layout* layout);
+u64 vulkan_pipeline_config_hash(vulkan_pipeline_config* config);
+// Render pass compatibility only depends on attachment formats and sample counts and on how the subpass references them,
+// flattened so it outlives the render pass. Returns the size and fills key if it isn't NULL, empty without a render pass
+u32 vulkan_pipeline_get_renderpass_key(vulkan_pipeline_config* config, u32* key);
+// Compute pipelines are built directly rather than through the PSO cache, there are few of them and they have no render state
+vulkan_pipeline* vulkan_compute_pipeline_create(vulkan_device* device, vulkan_shader* shader, vulkan_pipeline_layout_config* layoutConfig);
 void vulkan_pipeline_destroy(vulkan_pipeline* pipeline);
 
-VkPipelineColorBlendAttachmentState vulkan_get_default_blending();
\ No newline at end of file
+VkPipelineColorBlendAttachmentState vulkan_get_default_blending();
+
+void vulkan_pipeline_set_viewport(VkCommandBuffer cmd, u32 width, u32 height);
\ No newline at end of file
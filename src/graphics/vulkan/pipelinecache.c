@@ -0,0 +1,132 @@
+#include "pipelinecache.h"
+
+#ifdef _WIN32
+#include <windows.h>
+#endif
+
+u8* read_pipeline_cache_file(const char* path, u64* size) {
+    FILE* file = fopen(path, "rb");
+    if (file == NULL) return NULL;
+
+    fseek(file, 0, SEEK_END);
+    long length = ftell(file);
+    fseek(file, 0, SEEK_SET);
+    if (length <= 0) {
+        fclose(file);
+        return NULL;
+    }
+
+    u8* data = malloc(length);
+    *size = fread(data, 1, length, file);
+    fclose(file);
+
+    return data;
+}
+
+bool pipeline_cache_data_valid(vulkan_device* device, u8* data, u64 size) {
+    VkPipelineCacheHeaderVersionOne header;
+    if (size < sizeof(header)) return false;
+    memcpy(&header, data, sizeof(header));
+
+    // Data from another driver or GPU is at best ignored and at worst crashes the driver, so only reuse an exact match
+    VkPhysicalDeviceProperties* properties = &device->physical->properties;
+    return header.headerSize >= sizeof(header) &&
+        header.headerVersion == VK_PIPELINE_CACHE_HEADER_VERSION_ONE &&
+        header.vendorID == properties->vendorID &&
+        header.deviceID == properties->deviceID &&
+        memcmp(header.pipelineCacheUUID, properties->pipelineCacheUUID, VK_UUID_SIZE) == 0;
+}
+
+vulkan_pipeline_cache* vulkan_pipeline_cache_create(vulkan_device* device, const char* path) {
+    vulkan_pipeline_cache* cache = malloc(sizeof(vulkan_pipeline_cache));
+    CLEAR_MEMORY(cache);
+    cache->device = device;
+    cache->path = path;
+    cache->statsLock = mutex_create();
+
+    u64 size = 0;
+    u8* data = read_pipeline_cache_file(path, &size);
+    if (data != NULL && !pipeline_cache_data_valid(device, data, size)) {
+        WARN("Ignoring pipeline cache %s as it was created by a different driver or device", path);
+        free(data);
+        data = NULL;
+    }
+    cache->warm = data != NULL;
+
+    VkPipelineCacheCreateInfo createInfo;
+    CLEAR_MEMORY(&createInfo);
+    createInfo.sType = VK_STRUCTURE_TYPE_PIPELINE_CACHE_CREATE_INFO;
+    createInfo.initialDataSize = cache->warm ? size : 0;
+    createInfo.pInitialData = data;
+
+    VkResult result = vkCreatePipelineCache(device->device, &createInfo, NULL, &cache->cache);
+    if (result != VK_SUCCESS) {
+        FATAL("Vulkan pipeline cache creation failed with error code: %d", result);
+    }
+    free(data);
+
+    if (cache->warm) {
+        INFO("Loaded pipeline cache from %s (%llu bytes)", path, (unsigned long long)size);
+    }
+
+    return cache;
+}
+
+void vulkan_pipeline_cache_destroy(vulkan_pipeline_cache* cache) {
+    if (cache->numPipelines != 0) {
+        INFO("Created %d pipelines in %.2fms from a %s pipeline cache (%.2fms per pipeline)", cache->numPipelines, cache->creationTime * 1000.0,
+            cache->warm ? "warm" : "cold", cache->creationTime * 1000.0 / cache->numPipelines);
+    }
+
+    vulkan_pipeline_cache_save(cache);
+    vkDestroyPipelineCache(cache->device->device, cache->cache, NULL);
+    mutex_destroy(cache->statsLock);
+    free(cache);
+}
+
+void vulkan_pipeline_cache_save(vulkan_pipeline_cache* cache) {
+    size_t size;
+    VkResult sizeResult = vkGetPipelineCacheData(cache->device->device, cache->cache, &size, NULL);
+    if (sizeResult != VK_SUCCESS) {
+        FATAL("Vulkan pipeline cache data query failed with error code: %d", sizeResult);
+    }
+
+    u8* data = malloc(size);
+    VkResult dataResult = vkGetPipelineCacheData(cache->device->device, cache->cache, &size, data);
+    if (dataResult != VK_SUCCESS && dataResult != VK_INCOMPLETE) {
+        FATAL("Vulkan pipeline cache data retrieval failed with error code: %d", dataResult);
+    }
+
+    // Write next to the old file and swap it in so a crash mid-write never leaves a truncated cache behind
+    u64 tempPathLength = strlen(cache->path) + 5;
+    char* tempPath = malloc(tempPathLength);
+    snprintf(tempPath, tempPathLength, "%s.tmp", cache->path);
+
+    FILE* file = fopen(tempPath, "wb");
+    if (file == NULL) {
+        ERROR("Could not open file: %s", tempPath);
+    } else {
+        bool written = fwrite(data, 1, size, file) == size;
+        written = fclose(file) == 0 && written;
+
+#ifdef _WIN32
+        bool replaced = written && MoveFileExA(tempPath, cache->path, MOVEFILE_REPLACE_EXISTING | MOVEFILE_WRITE_THROUGH);
+#else
+        bool replaced = written && rename(tempPath, cache->path) == 0;
+#endif
+        if (!replaced) {
+            ERROR("Could not write pipeline cache to %s", cache->path);
+            remove(tempPath);
+        }
+    }
+
+    free(tempPath);
+    free(data);
+}
+
+void vulkan_pipeline_cache_record_creation(vulkan_pipeline_cache* cache, double seconds) {
+    mutex_lock(cache->statsLock);
+    cache->numPipelines++;
+    cache->creationTime += seconds;
+    mutex_unlock(cache->statsLock);
+}
\ No newline at end of file
@@ -0,0 +1,26 @@
+#pragma once
+
+#include "core/core.h"
+#include "vulkan/vulkan.h"
+
+#include "core/thread.h"
+
+#include "device.h"
+
+typedef struct _vulkan_pipeline_cache {
+    VkPipelineCache cache;
+    vulkan_device* device;
+    const char* path;
+
+    // Whether the cache was seeded from disk, so the timings below describe a warm or a cold start
+    bool warm;
+    mutex* statsLock; // Pipelines get created on worker threads too
+    u32 numPipelines;
+    double creationTime;
+} vulkan_pipeline_cache;
+
+vulkan_pipeline_cache* vulkan_pipeline_cache_create(vulkan_device* device, const char* path);
+void vulkan_pipeline_cache_destroy(vulkan_pipeline_cache* cache);
+
+void vulkan_pipeline_cache_save(vulkan_pipeline_cache* cache);
+void vulkan_pipeline_cache_record_creation(vulkan_pipeline_cache* cache, double seconds);
\ No newline at end of file
@@ -0,0 +1,239 @@
+#include "pso.h"
+
+#include "core/timer.h"
+
+void* pso_copy_array(const void* data, u64 size) {
+    if (data == NULL || size == 0) return NULL;
+    void* copy = malloc(size);
+    memcpy(copy, data, size);
+    return copy;
+}
+
+void pso_copy_config(vulkan_pipeline_config* dst, vulkan_pipeline_config* src) {
+    *dst = *src;
+    dst->setLayouts = pso_copy_array(src->setLayouts, sizeof(vulkan_descriptor_set_layout*) * src->numSetLayouts);
+    dst->pushConstantRanges = pso_copy_array(src->pushConstantRanges, sizeof(VkPushConstantRange) * src->numPushConstantRanges);
+    dst->blendingAttachments = pso_copy_array(src->blendingAttachments, sizeof(VkPipelineColorBlendAttachmentState) * src->numBlendingAttachments);
+    dst->rendering.colorFormats = pso_copy_array(src->rendering.colorFormats, sizeof(VkFormat) * src->rendering.numColorFormats);
+
+    if (src->specialization != NULL) {
+        dst->specialization = pso_copy_array(src->specialization, sizeof(VkSpecializationInfo));
+        dst->specialization->pMapEntries = pso_copy_array(src->specialization->pMapEntries, sizeof(VkSpecializationMapEntry) * src->specialization->mapEntryCount);
+        dst->specialization->pData = pso_copy_array(src->specialization->pData, src->specialization->dataSize);
+    }
+}
+
+void pso_free_config(vulkan_pipeline_config* config) {
+    free(config->setLayouts);
+    free(config->pushConstantRanges);
+    free(config->blendingAttachments);
+    free(config->rendering.colorFormats);
+
+    if (config->specialization != NULL) {
+        free((void*)config->specialization->pMapEntries);
+        free((void*)config->specialization->pData);
+        free(config->specialization);
+    }
+}
+
+bool pipeline_config_equal(vulkan_pso* pso, vulkan_pipeline_config* config) {
+    vulkan_pipeline_config* cached = &pso->config;
+    if (cached->vertexShader != config->vertexShader || pso->vertexHash != config->vertexShader->hash) return false;
+    if (cached->fragmentShader != config->fragmentShader || pso->fragmentHash != config->fragmentShader->hash) return false;
+    if (cached->dynamicState != config->dynamicState || cached->rasterizerCullMode != config->rasterizerCullMode || cached->samples != config->samples) return false;
+
+    if (cached->numSetLayouts != config->numSetLayouts || cached->numPushConstantRanges != config->numPushConstantRanges) return false;
+    for (u32 i = 0; i < config->numSetLayouts; i++) {
+        if (cached->setLayouts[i] != config->setLayouts[i]) return false;
+    }
+    for (u32 i = 0; i < config->numPushConstantRanges; i++) {
+        if (cached->pushConstantRanges[i].stageFlags != config->pushConstantRanges[i].stageFlags ||
+            cached->pushConstantRanges[i].offset != config->pushConstantRanges[i].offset ||
+            cached->pushConstantRanges[i].size != config->pushConstantRanges[i].size) return false;
+    }
+
+    if (cached->numBlendingAttachments != config->numBlendingAttachments) return false;
+    if (config->numBlendingAttachments > 0 && memcmp(cached->blendingAttachments, config->blendingAttachments, sizeof(VkPipelineColorBlendAttachmentState) * config->numBlendingAttachments) != 0) return false;
+
+    if ((cached->renderpass == NULL) != (config->renderpass == NULL)) return false;
+    if (config->renderpass != NULL) {
+        u32 keySize = vulkan_pipeline_get_renderpass_key(config, NULL);
+        if (keySize != pso->renderpassKeySize) return false;
+        u32* key = malloc(sizeof(u32) * keySize);
+        vulkan_pipeline_get_renderpass_key(config, key);
+        bool equal = memcmp(key, pso->renderpassKey, sizeof(u32) * keySize) == 0;
+        free(key);
+        if (!equal) return false;
+    } else {
+        if (cached->rendering.numColorFormats != config->rendering.numColorFormats || cached->rendering.depthFormat != config->rendering.depthFormat) return false;
+        for (u32 i = 0; i < config->rendering.numColorFormats; i++) {
+            if (cached->rendering.colorFormats[i] != config->rendering.colorFormats[i]) return false;
+        }
+    }
+
+    if ((cached->specialization == NULL) != (config->specialization == NULL)) return false;
+    if (config->specialization != NULL) {
+        VkSpecializationInfo* a = cached->specialization;
+        VkSpecializationInfo* b = config->specialization;
+        if (a->mapEntryCount != b->mapEntryCount || a->dataSize != b->dataSize) return false;
+        for (u32 i = 0; i < b->mapEntryCount; i++) {
+            if (a->pMapEntries[i].constantID != b->pMapEntries[i].constantID ||
+                a->pMapEntries[i].offset != b->pMapEntries[i].offset ||
+                a->pMapEntries[i].size != b->pMapEntries[i].size) return false;
+        }
+        if (b->dataSize > 0 && memcmp(a->pData, b->pData, b->dataSize) != 0) return false;
+    }
+    return true;
+}
+
+void pso_destroy(vulkan_pso* pso) {
+    vulkan_pipeline_destroy(pso->pipeline);
+    pso_free_config(&pso->config);
+    free(pso->renderpassKey);
+    free(pso);
+}
+
+void pso_compile(void* data) {
+    vulkan_pso* pso = (vulkan_pso*)data;
+
+    double start = timer_now();
+    pso->pipeline = vulkan_pipeline_create_with_layout(pso->cache->device, &pso->config, pso->layout);
+    pso->compileTime = timer_now() - start;
+
+    atomic_store_i32(&pso->state, PSO_STATE_READY);
+    atomic_add_i32(&pso->cache->numPending, -1);
+}
+
+vulkan_pso_cache* vulkan_pso_cache_create(vulkan_device* device, job_pool* jobs) {
+    vulkan_pso_cache* cache = malloc(sizeof(vulkan_pso_cache));
+    CLEAR_MEMORY(cache);
+    cache->device = device;
+    cache->jobs = jobs;
+    cache->psos = hashmap_create(0);
+    cache->uncached = malloc(0);
+
+    return cache;
+}
+
+void vulkan_pso_cache_destroy(vulkan_pso_cache* cache) {
+    vulkan_pso_cache_wait(cache);
+    vulkan_pso_cache_stats_log(cache);
+
+    u32 iterator = 0;
+    void* value;
+    while (hashmap_next(cache->psos, &iterator, NULL, &value)) {
+        pso_destroy((vulkan_pso*)value);
+    }
+    hashmap_destroy(cache->psos);
+    for (u32 i = 0; i < cache->numUncached; i++) {
+        pso_destroy(cache->uncached[i]);
+    }
+    free(cache->uncached);
+    free(cache);
+}
+
+vulkan_pso* vulkan_pso_cache_request(vulkan_pso_cache* cache, vulkan_pipeline_config* config) {
+    cache->stats.requests++;
+
+    u64 hash = vulkan_pipeline_config_hash(config);
+    vulkan_pso* cached = hashmap_get(cache->psos, hash);
+    if (cached != NULL && pipeline_config_equal(cached, config)) {
+        cache->stats.hits++;
+        return cached;
+    }
+    for (u32 i = 0; i < cache->numUncached; i++) {
+        if (cache->uncached[i]->hash == hash && pipeline_config_equal(cache->uncached[i], config)) {
+            cache->stats.hits++;
+            return cache->uncached[i];
+        }
+    }
+
+    // Rejected here on the calling thread, so a bad shader never reaches the driver
+    if (!vulkan_pipeline_validate(config)) return NULL;
+
+    vulkan_pso* pso = malloc(sizeof(vulkan_pso));
+    CLEAR_MEMORY(pso);
+    pso->cache = cache;
+    pso->hash = hash;
+    pso->state = PSO_STATE_PENDING;
+    pso_copy_config(&pso->config, config);
+    pso->vertexHash = config->vertexShader->hash;
+    pso->fragmentHash = config->fragmentShader->hash;
+    pso->renderpassKeySize = vulkan_pipeline_get_renderpass_key(config, NULL);
+    pso->renderpassKey = malloc(sizeof(u32) * pso->renderpassKeySize);
+    vulkan_pipeline_get_renderpass_key(config, pso->renderpassKey);
+
+    // The layout caches aren't thread safe, so the layout is resolved here and handed to the worker
+    vulkan_pipeline_layout_config layoutConfig;
+    CLEAR_MEMORY(&layoutConfig);
+    layoutConfig.numSetLayouts = config->numSetLayouts;
+    layoutConfig.setLayouts = config->setLayouts;
+    layoutConfig.numPushConstantRanges = config->numPushConstantRanges;
+    layoutConfig.pushConstantRanges = config->pushConstantRanges;
+    pso->layout = vulkan_pipeline_layout_create(cache->device, &layoutConfig);
+
+    // On the off chance of a hash collision the new pipeline is compiled but stays out of the map
+    if (cached == NULL) {
+        hashmap_set(cache->psos, hash, pso);
+    } else {
+        cache->uncached = realloc(cache->uncached, sizeof(vulkan_pso*) * (cache->numUncached + 1));
+        cache->uncached[cache->numUncached++] = pso;
+    }
+    cache->stats.compiles++;
+    atomic_add_i32(&cache->numPending, 1);
+    job_pool_submit(cache->jobs, pso_compile, pso);
+
+    return pso;
+}
+
+vulkan_pso* vulkan_pso_cache_request_blocking(vulkan_pso_cache* cache, vulkan_pipeline_config* config) {
+    vulkan_pso* pso = vulkan_pso_cache_request(cache, config);
+    if (pso != NULL && !vulkan_pso_is_ready(pso)) {
+        vulkan_pso_cache_wait(cache);
+    }
+    return pso;
+}
+
+void vulkan_pso_cache_wait(vulkan_pso_cache* cache) {
+    if (atomic_load_i32(&cache->numPending) != 0) {
+        job_pool_wait(cache->jobs);
+    }
+}
+
+bool vulkan_pso_is_ready(vulkan_pso* pso) {
+    return atomic_load_i32(&pso->state) == PSO_STATE_READY;
+}
+
+vulkan_pipeline* vulkan_pso_cache_get(vulkan_pso_cache* cache, vulkan_pso* pso, vulkan_pso* fallback) {
+    if (vulkan_pso_is_ready(pso)) {
+        return pso->pipeline;
+    }
+
+    if (fallback != NULL && vulkan_pso_is_ready(fallback)) {
+        cache->stats.fallbackDraws++;
+        return fallback->pipeline;
+    }
+
+    cache->stats.skippedDraws++;
+    return NULL;
+}
+
+void vulkan_pso_cache_stats_log(vulkan_pso_cache* cache) {
+    // Compile times are only read once nothing is pending, so the workers are done writing them
+    double compileTime = 0.0;
+    u32 iterator = 0;
+    void* value;
+    while (hashmap_next(cache->psos, &iterator, NULL, &value)) {
+        vulkan_pso* pso = (vulkan_pso*)value;
+        if (vulkan_pso_is_ready(pso)) compileTime += pso->compileTime;
+    }
+    for (u32 i = 0; i < cache->numUncached; i++) {
+        if (vulkan_pso_is_ready(cache->uncached[i])) compileTime += cache->uncached[i]->compileTime;
+    }
+    cache->stats.compileTime = compileTime;
+
+    vulkan_pso_cache_stats* stats = &cache->stats;
+    INFO("Pipeline states: %llu requests, %llu hits, %llu compiled in %.2fms, %llu draws used a fallback, %llu draws skipped",
+        (unsigned long long)stats->requests, (unsigned long long)stats->hits, (unsigned long long)stats->compiles, stats->compileTime * 1000.0,
+        (unsigned long long)stats->fallbackDraws, (unsigned long long)stats->skippedDraws);
+}
\ No newline at end of file
@@ -0,0 +1,69 @@
+#pragma once
+
+#include "core/core.h"
+#include "core/hashmap.h"
+#include "core/thread.h"
+#include "core/jobs.h"
+#include "vulkan/vulkan.h"
+
+#include "device.h"
+#include "pipeline.h"
+
+typedef enum {
+    PSO_STATE_PENDING,
+    PSO_STATE_READY
+} vulkan_pso_state;
+
+typedef struct _vulkan_pso_cache vulkan_pso_cache;
+
+// Shaders and the render pass referenced by the config must outlive the compile, everything else is copied
+typedef struct {
+    vulkan_pso_cache* cache;
+    u64 hash;
+    volatile i32 state;
+
+    vulkan_pipeline_config config;
+    // Shaders reload in place and render passes get recreated, so what they were when requested is kept to check cache hits against
+    u64 vertexHash;
+    u64 fragmentHash;
+    u32 renderpassKeySize;
+    u32* renderpassKey;
+    vulkan_pipeline_layout* layout;
+    vulkan_pipeline* pipeline;
+    double compileTime;
+} vulkan_pso;
+
+typedef struct {
+    u64 requests;
+    u64 hits;
+    u64 compiles;
+    u64 skippedDraws;
+    u64 fallbackDraws;
+    double compileTime;
+} vulkan_pso_cache_stats;
+
+typedef struct _vulkan_pso_cache {
+    vulkan_device* device;
+    job_pool* jobs;
+
+    hashmap* psos;
+    u32 numUncached;
+    vulkan_pso** uncached; // Lost a hash collision, so they stay out of the map but are still owned by the cache
+    volatile i32 numPending;
+    vulkan_pso_cache_stats stats;
+} vulkan_pso_cache;
+
+vulkan_pso_cache* vulkan_pso_cache_create(vulkan_device* device, job_pool* jobs);
+void vulkan_pso_cache_destroy(vulkan_pso_cache* cache);
+
+// Returns straight away, the pipeline is compiled on a worker thread if it isn't cached yet. NULL if the config fails validation
+vulkan_pso* vulkan_pso_cache_request(vulkan_pso_cache* cache, vulkan_pipeline_config* config);
+// For pipelines that must exist before the first frame, such as fallbacks
+vulkan_pso* vulkan_pso_cache_request_blocking(vulkan_pso_cache* cache, vulkan_pipeline_config* config);
+void vulkan_pso_cache_wait(vulkan_pso_cache* cache);
+
+bool vulkan_pso_is_ready(vulkan_pso* pso);
+// The pipeline to draw with this frame: the requested one if it's ready, otherwise the fallback, otherwise NULL to skip the draw
+vulkan_pipeline* vulkan_pso_cache_get(vulkan_pso_cache* cache, vulkan_pso* pso, vulkan_pso* fallback);
+
+void vulkan_pso_cache_stats_log(vulkan_pso_cache* cache);
\ No newline at end of file
@@ -0,0 +1,574 @@
+#include "reflect.h"
+
+#define SPIRV_MAGIC 0x07230203
+#define SPIRV_HEADER_WORDS 5
+
+// The handful of opcodes, decorations and enums the reflector cares about, from the SPIR-V specification
+#define SPV_OP_ENTRY_POINT 15
+#define SPV_OP_TYPE_INT 21
+#define SPV_OP_TYPE_FLOAT 22
+#define SPV_OP_TYPE_VECTOR 23
+#define SPV_OP_TYPE_MATRIX 24
+#define SPV_OP_TYPE_IMAGE 25
+#define SPV_OP_TYPE_SAMPLER 26
+#define SPV_OP_TYPE_SAMPLED_IMAGE 27
+#define SPV_OP_TYPE_ARRAY 28
+#define SPV_OP_TYPE_RUNTIME_ARRAY 29
+#define SPV_OP_TYPE_STRUCT 30
+#define SPV_OP_TYPE_POINTER 32
+#define SPV_OP_CONSTANT 43
+#define SPV_OP_VARIABLE 59
+#define SPV_OP_DECORATE 71
+#define SPV_OP_MEMBER_DECORATE 72
+#define SPV_OP_TYPE_ACCELERATION_STRUCTURE 5341
+
+#define SPV_DECORATION_SPEC_ID 1
+#define SPV_DECORATION_BLOCK 2
+#define SPV_DECORATION_BUFFER_BLOCK 3
+#define SPV_DECORATION_ARRAY_STRIDE 6
+#define SPV_DECORATION_MATRIX_STRIDE 7
+#define SPV_DECORATION_BUILT_IN 11
+#define SPV_DECORATION_LOCATION 30
+#define SPV_DECORATION_BINDING 33
+#define SPV_DECORATION_DESCRIPTOR_SET 34
+#define SPV_DECORATION_OFFSET 35
+
+#define SPV_STORAGE_UNIFORM_CONSTANT 0
+#define SPV_STORAGE_INPUT 1
+#define SPV_STORAGE_UNIFORM 2
+#define SPV_STORAGE_OUTPUT 3
+#define SPV_STORAGE_PUSH_CONSTANT 9
+#define SPV_STORAGE_STORAGE_BUFFER 12
+
+#define SPV_DIM_BUFFER 5
+#define SPV_DIM_SUBPASS_DATA 6
+
+typedef struct {
+    u32 opcode;
+    const u32* words; // The defining instruction, operands start at words[1]
+    u32 numWords;
+
+    u32 set;
+    u32 binding;
+    u32 location;
+    u32 arrayStride;
+    bool hasSet;
+    bool hasBinding;
+    bool hasLocation;
+    bool builtIn;
+    bool block;
+    bool bufferBlock;
+
+    u32 numMemberOffsets;
+    u32* memberOffsets;
+    u32 numMemberMatrixStrides;
+    u32* memberMatrixStrides;
+} reflect_id;
+
+void reflect_set_member(u32** values, u32* numValues, u32 member, u32 value) {
+    if (member >= *numValues) {
+        *values = realloc(*values, sizeof(u32) * (member + 1));
+        memset(*values + *numValues, 0, sizeof(u32) * (member + 1 - *numValues));
+        *numValues = member + 1;
+    }
+    (*values)[member] = value;
+}
+
+reflect_id* reflect_get(reflect_id* ids, u32 bound, u32 id) {
+    if (id >= bound || ids[id].words == NULL) return NULL;
+    return &ids[id];
+}
+
+VkShaderStageFlags reflect_execution_model_stage(u32 model) {
+    switch (model) {
+        case(0) : return VK_SHADER_STAGE_VERTEX_BIT;
+        case(1) : return VK_SHADER_STAGE_TESSELLATION_CONTROL_BIT;
+        case(2) : return VK_SHADER_STAGE_TESSELLATION_EVALUATION_BIT;
+        case(3) : return VK_SHADER_STAGE_GEOMETRY_BIT;
+        case(4) : return VK_SHADER_STAGE_FRAGMENT_BIT;
+        case(5) : return VK_SHADER_STAGE_COMPUTE_BIT;
+    }
+    return 0;
+}
+
+// Scalars and vectors only, anything wider takes several locations and isn't checked against vertex attributes
+VkFormat reflect_format(reflect_id* ids, u32 bound, u32 typeId) {
+    reflect_id* type = reflect_get(ids, bound, typeId);
+    if (type == NULL) return VK_FORMAT_UNDEFINED;
+
+    u32 components = 1;
+    if (type->opcode == SPV_OP_TYPE_VECTOR) {
+        components = type->words[3];
+        type = reflect_get(ids, bound, type->words[2]);
+        if (type == NULL) return VK_FORMAT_UNDEFINED;
+    }
+    if (components < 1 || components > 4 || type->words[2] != 32) return VK_FORMAT_UNDEFINED;
+
+    VkFormat floats[4] = { VK_FORMAT_R32_SFLOAT, VK_FORMAT_R32G32_SFLOAT, VK_FORMAT_R32G32B32_SFLOAT, VK_FORMAT_R32G32B32A32_SFLOAT };
+    VkFormat sints[4] = { VK_FORMAT_R32_SINT, VK_FORMAT_R32G32_SINT, VK_FORMAT_R32G32B32_SINT, VK_FORMAT_R32G32B32A32_SINT };
+    VkFormat uints[4] = { VK_FORMAT_R32_UINT, VK_FORMAT_R32G32_UINT, VK_FORMAT_R32G32B32_UINT, VK_FORMAT_R32G32B32A32_UINT };
+    if (type->opcode == SPV_OP_TYPE_FLOAT) return floats[components - 1];
+    if (type->opcode == SPV_OP_TYPE_INT) return type->words[3] ? sints[components - 1] : uints[components - 1];
+    return VK_FORMAT_UNDEFINED;
+}
+
+u32 reflect_type_size(reflect_id* ids, u32 bound, u32 typeId, u32 matrixStride) {
+    reflect_id* type = reflect_get(ids, bound, typeId);
+    if (type == NULL) return 0;
+
+    switch (type->opcode) {
+        case(SPV_OP_TYPE_INT) :
+        case(SPV_OP_TYPE_FLOAT) : return type->words[2] / 8;
+        case(SPV_OP_TYPE_VECTOR) : return type->words[3] * reflect_type_size(ids, bound, type->words[2], 0);
+        case(SPV_OP_TYPE_MATRIX) : {
+            u32 columnSize = matrixStride ? matrixStride : reflect_type_size(ids, bound, type->words[2], 0);
+            return type->words[3] * columnSize;
+        }
+        case(SPV_OP_TYPE_ARRAY) : {
+            reflect_id* length = reflect_get(ids, bound, type->words[3]);
+            u32 count = length && length->opcode == SPV_OP_CONSTANT ? length->words[3] : 0;
+            u32 stride = type->arrayStride ? type->arrayStride : reflect_type_size(ids, bound, type->words[2], matrixStride);
+            return count * stride;
+        }
+        case(SPV_OP_TYPE_STRUCT) : {
+            u32 size = 0;
+            for (u32 i = 0; i + 2 < type->numWords; i++) {
+                u32 offset = i < type->numMemberOffsets ? type->memberOffsets[i] : 0;
+                u32 stride = i < type->numMemberMatrixStrides ? type->memberMatrixStrides[i] : 0;
+                u32 end = offset + reflect_type_size(ids, bound, type->words[2 + i], stride);
+                if (end > size) size = end;
+            }
+            return size;
+        }
+    }
+    return 0;
+}
+
+bool reflect_descriptor_type(reflect_id* ids, u32 bound, u32 storageClass, reflect_id* type, VkDescriptorType* descriptorType) {
+    if (storageClass == SPV_STORAGE_STORAGE_BUFFER) {
+        *descriptorType = VK_DESCRIPTOR_TYPE_STORAGE_BUFFER;
+        return true;
+    }
+    if (storageClass == SPV_STORAGE_UNIFORM) {
+        // Before SPIR-V 1.3 storage buffers were uniforms decorated as buffer blocks
+        *descriptorType = type->bufferBlock ? VK_DESCRIPTOR_TYPE_STORAGE_BUFFER : VK_DESCRIPTOR_TYPE_UNIFORM_BUFFER;
+        return true;
+    }
+    if (storageClass != SPV_STORAGE_UNIFORM_CONSTANT) return false;
+
+    switch (type->opcode) {
+        case(SPV_OP_TYPE_SAMPLER) : *descriptorType = VK_DESCRIPTOR_TYPE_SAMPLER; return true;
+        case(SPV_OP_TYPE_ACCELERATION_STRUCTURE) : *descriptorType = VK_DESCRIPTOR_TYPE_ACCELERATION_STRUCTURE_KHR; return true;
+        case(SPV_OP_TYPE_SAMPLED_IMAGE) : {
+            reflect_id* image = reflect_get(ids, bound, type->words[2]);
+            bool isBuffer = image && image->words[3] == SPV_DIM_BUFFER;
+            *descriptorType = isBuffer ? VK_DESCRIPTOR_TYPE_UNIFORM_TEXEL_BUFFER : VK_DESCRIPTOR_TYPE_COMBINED_IMAGE_SAMPLER;
+            return true;
+        }
+        case(SPV_OP_TYPE_IMAGE) : {
+            u32 dim = type->words[3];
+            bool storage = type->words[7] == 2;
+            if (dim == SPV_DIM_SUBPASS_DATA) *descriptorType = VK_DESCRIPTOR_TYPE_INPUT_ATTACHMENT;
+            else if (dim == SPV_DIM_BUFFER) *descriptorType = storage ? VK_DESCRIPTOR_TYPE_STORAGE_TEXEL_BUFFER : VK_DESCRIPTOR_TYPE_UNIFORM_TEXEL_BUFFER;
+            else *descriptorType = storage ? VK_DESCRIPTOR_TYPE_STORAGE_IMAGE : VK_DESCRIPTOR_TYPE_SAMPLED_IMAGE;
+            return true;
+        }
+    }
+    return false;
+}
+
+void reflect_add_binding(vulkan_shader_reflection* reflection, vulkan_reflect_binding* binding) {
+    reflection->numBindings++;
+    reflection->bindings = realloc(reflection->bindings, sizeof(vulkan_reflect_binding) * reflection->numBindings);
+    reflection->bindings[reflection->numBindings - 1] = *binding;
+}
+
+void reflect_add_interface_variable(u32* numVariables, vulkan_reflect_interface_variable** variables, u32 location, VkFormat format) {
+    (*numVariables)++;
+    *variables = realloc(*variables, sizeof(vulkan_reflect_interface_variable) * *numVariables);
+    (*variables)[*numVariables - 1].location = location;
+    (*variables)[*numVariables - 1].format = format;
+}
+
+bool reflect_variable(vulkan_shader_reflection* reflection, reflect_id* ids, u32 bound, reflect_id* variable) {
+    u32 storageClass = variable->words[3];
+    reflect_id* pointer = reflect_get(ids, bound, variable->words[1]);
+    if (pointer == NULL || pointer->opcode != SPV_OP_TYPE_POINTER) return false;
+    reflect_id* type = reflect_get(ids, bound, pointer->words[3]);
+    if (type == NULL) return false;
+
+    if (storageClass == SPV_STORAGE_INPUT || storageClass == SPV_STORAGE_OUTPUT) {
+        if (variable->builtIn || type->builtIn || !variable->hasLocation) return true;
+        VkFormat format = reflect_format(ids, bound, pointer->words[3]);
+        if (storageClass == SPV_STORAGE_INPUT) {
+            reflect_add_interface_variable(&reflection->numInputs, &reflection->inputs, variable->location, format);
+        } else {
+            reflect_add_interface_variable(&reflection->numOutputs, &reflection->outputs, variable->location, format);
+        }
+        return true;
+    }
+
+    if (storageClass == SPV_STORAGE_PUSH_CONSTANT) {
+        u32 start = UINT32_MAX;
+        for (u32 i = 0; i < type->numMemberOffsets; i++) {
+            if (type->memberOffsets[i] < start) start = type->memberOffsets[i];
+        }
+        if (start == UINT32_MAX) start = 0;
+
+        reflection->hasPushConstants = true;
+        reflection->pushConstants.stageFlags = reflection->stages;
+        reflection->pushConstants.offset = start;
+        reflection->pushConstants.size = reflect_type_size(ids, bound, pointer->words[3], 0) - start;
+        return true;
+    }
+
+    if (!variable->hasSet || !variable->hasBinding) return true;
+
+    vulkan_reflect_binding binding;
+    CLEAR_MEMORY(&binding);
+    binding.set = variable->set;
+    binding.binding = variable->binding;
+    binding.stages = reflection->stages;
+    binding.count = 1;
+
+    if (type->opcode == SPV_OP_TYPE_ARRAY) {
+        reflect_id* length = reflect_get(ids, bound, type->words[3]);
+        if (length == NULL || length->opcode != SPV_OP_CONSTANT) return false;
+        binding.count = length->words[3];
+        type = reflect_get(ids, bound, type->words[2]);
+    } else if (type->opcode == SPV_OP_TYPE_RUNTIME_ARRAY) {
+        binding.count = 0;
+        type = reflect_get(ids, bound, type->words[2]);
+    }
+    if (type == NULL || !reflect_descriptor_type(ids, bound, storageClass, type, &binding.type)) return false;
+
+    reflect_add_binding(reflection, &binding);
+    return true;
+}
+
+bool vulkan_reflect_spirv(const u32* code, u64 size, vulkan_shader_reflection* reflection) {
+    CLEAR_MEMORY(reflection);
+    u64 numWords = size / sizeof(u32);
+    if (numWords < SPIRV_HEADER_WORDS || code[0] != SPIRV_MAGIC) return false;
+
+    u32 bound = code[3];
+    reflect_id* ids = malloc(sizeof(reflect_id) * bound);
+    CLEAR_MEMORY_ARRAY(ids, bound);
+
+    // First pass records every type, variable, constant and decoration by id
+    bool valid = true;
+    u64 numVariables = 0;
+    for (u64 i = SPIRV_HEADER_WORDS; i < numWords;) {
+        u32 opcode = code[i] & 0xFFFF;
+        u32 count = code[i] >> 16;
+        if (count == 0 || i + count > numWords) {
+            valid = false;
+            break;
+        }
+        const u32* words = &code[i];
+
+        switch (opcode) {
+            case(SPV_OP_ENTRY_POINT) : {
+                if (reflection->stages == 0 && count > 1) reflection->stages = reflect_execution_model_stage(words[1]);
+                break;
+            }
+            case(SPV_OP_TYPE_INT) :
+            case(SPV_OP_TYPE_FLOAT) :
+            case(SPV_OP_TYPE_VECTOR) :
+            case(SPV_OP_TYPE_MATRIX) :
+            case(SPV_OP_TYPE_IMAGE) :
+            case(SPV_OP_TYPE_SAMPLER) :
+            case(SPV_OP_TYPE_SAMPLED_IMAGE) :
+            case(SPV_OP_TYPE_ARRAY) :
+            case(SPV_OP_TYPE_RUNTIME_ARRAY) :
+            case(SPV_OP_TYPE_STRUCT) :
+            case(SPV_OP_TYPE_POINTER) :
+            case(SPV_OP_TYPE_ACCELERATION_STRUCTURE) : {
+                if (count < 2 || words[1] >= bound) {
+                    valid = false;
+                    break;
+                }
+                ids[words[1]].opcode = opcode;
+                ids[words[1]].words = words;
+                ids[words[1]].numWords = count;
+                break;
+            }
+            case(SPV_OP_CONSTANT) :
+            case(SPV_OP_VARIABLE) : {
+                if (count < 4 || words[2] >= bound) {
+                    valid = false;
+                    break;
+                }
+                ids[words[2]].opcode = opcode;
+                ids[words[2]].words = words;
+                ids[words[2]].numWords = count;
+                if (opcode == SPV_OP_VARIABLE) numVariables++;
+                break;
+            }
+            case(SPV_OP_DECORATE) : {
+                if (count < 3 || words[1] >= bound) {
+                    valid = false;
+                    break;
+                }
+                reflect_id* target = &ids[words[1]];
+                u32 value = count > 3 ? words[3] : 0;
+                switch (words[2]) {
+                    case(SPV_DECORATION_SPEC_ID) : {
+                        reflection->specConstants = realloc(reflection->specConstants, sizeof(u32) * (reflection->numSpecConstants + 1));
+                        reflection->specConstants[reflection->numSpecConstants++] = value;
+                        break;
+                    }
+                    case(SPV_DECORATION_BLOCK) : target->block = true; break;
+                    case(SPV_DECORATION_BUFFER_BLOCK) : target->bufferBlock = true; break;
+                    case(SPV_DECORATION_ARRAY_STRIDE) : target->arrayStride = value; break;
+                    case(SPV_DECORATION_BUILT_IN) : target->builtIn = true; break;
+                    case(SPV_DECORATION_LOCATION) : target->location = value; target->hasLocation = true; break;
+                    case(SPV_DECORATION_BINDING) : target->binding = value; target->hasBinding = true; break;
+                    case(SPV_DECORATION_DESCRIPTOR_SET) : target->set = value; target->hasSet = true; break;
+                }
+                break;
+            }
+            case(SPV_OP_MEMBER_DECORATE) : {
+                if (count < 4 || words[1] >= bound) {
+                    valid = false;
+                    break;
+                }
+                reflect_id* target = &ids[words[1]];
+                u32 value = count > 4 ? words[4] : 0;
+                if (words[3] == SPV_DECORATION_OFFSET) reflect_set_member(&target->memberOffsets, &target->numMemberOffsets, words[2], value);
+                if (words[3] == SPV_DECORATION_MATRIX_STRIDE) reflect_set_member(&target->memberMatrixStrides, &target->numMemberMatrixStrides, words[2], value);
+                if (words[3] == SPV_DECORATION_BUILT_IN) target->builtIn = true; // Marks gl_PerVertex so it's skipped as an interface block
+                break;
+            }
+        }
+
+        if (!valid) break;
+        i += count;
+    }
+
+    // Second pass turns the module scope variables into bindings, push constants and interface variables
+    for (u32 i = 0; valid && i < bound; i++) {
+        if (ids[i].opcode == SPV_OP_VARIABLE && !reflect_variable(reflection, ids, bound, &ids[i])) {
+            valid = false;
+        }
+    }
+
+    for (u32 i = 0; i < bound; i++) {
+        free(ids[i].memberOffsets);
+        free(ids[i].memberMatrixStrides);
+    }
+    free(ids);
+
+    if (!valid || reflection->stages == 0) {
+        vulkan_reflect_free(reflection);
+        return false;
+    }
+    return true;
+}
+
+void vulkan_reflect_free(vulkan_shader_reflection* reflection) {
+    free(reflection->bindings);
+    free(reflection->inputs);
+    free(reflection->outputs);
+    free(reflection->specConstants);
+    CLEAR_MEMORY(reflection);
+}
+
+vulkan_reflect_binding* reflect_find_binding(vulkan_shader_reflection* reflection, u32 set, u32 binding) {
+    for (u32 i = 0; i < reflection->numBindings; i++) {
+        if (reflection->bindings[i].set == set && reflection->bindings[i].binding == binding) return &reflection->bindings[i];
+    }
+    return NULL;
+}
+
+bool vulkan_reflect_merge(vulkan_shader_reflection* merged, vulkan_shader_reflection* stage) {
+    for (u32 i = 0; i < stage->numBindings; i++) {
+        vulkan_reflect_binding* binding = &stage->bindings[i];
+        vulkan_reflect_binding* existing = reflect_find_binding(merged, binding->set, binding->binding);
+        if (existing == NULL) {
+            reflect_add_binding(merged, binding);
+            continue;
+        }
+
+        if (existing->type != binding->type || existing->count != binding->count) {
+            FATAL("Shader stages disagree on set %d binding %d (type %d with %d descriptors against type %d with %d descriptors)",
+                binding->set, binding->binding, existing->type, existing->count, binding->type, binding->count);
+            return false;
+        }
+        existing->stages |= binding->stages;
+    }
+
+    if (stage->hasPushConstants) {
+        if (!merged->hasPushConstants) {
+            merged->hasPushConstants = true;
+            merged->pushConstants = stage->pushConstants;
+        } else {
+            u32 start = merged->pushConstants.offset < stage->pushConstants.offset ? merged->pushConstants.offset : stage->pushConstants.offset;
+            u32 mergedEnd = merged->pushConstants.offset + merged->pushConstants.size;
+            u32 stageEnd = stage->pushConstants.offset + stage->pushConstants.size;
+            merged->pushConstants.offset = start;
+            merged->pushConstants.size = (mergedEnd > stageEnd ? mergedEnd : stageEnd) - start;
+            merged->pushConstants.stageFlags |= stage->pushConstants.stageFlags;
+        }
+    }
+
+    merged->stages |= stage->stages;
+    return true;
+}
+
+u32 vulkan_reflect_get_num_sets(vulkan_shader_reflection* reflection) {
+    u32 numSets = 0;
+    for (u32 i = 0; i < reflection->numBindings; i++) {
+        if (reflection->bindings[i].set + 1 > numSets) numSets = reflection->bindings[i].set + 1;
+    }
+    return numSets;
+}
+
+vulkan_descriptor_set_layout* vulkan_reflect_build_set_layout(vulkan_shader_reflection* reflection, u32 set, vulkan_device* device) {
+    vulkan_descriptor_set_layout_builder* builder = vulkan_descriptor_set_layout_builder_create();
+
+    // Added in binding order so layouts reflected from different shaders land on the same cache entry
+    u32 previous = 0;
+    bool first = true;
+    while (true) {
+        vulkan_reflect_binding* next = NULL;
+        for (u32 i = 0; i < reflection->numBindings; i++) {
+            vulkan_reflect_binding* binding = &reflection->bindings[i];
+            if (binding->set != set || (!first && binding->binding <= previous)) continue;
+            if (next == NULL || binding->binding < next->binding) next = binding;
+        }
+        if (next == NULL) break;
+
+        if (next->count == 0) {
+            FATAL("Set %d binding %d is a runtime array, its layout has to be given explicitly", set, next->binding);
+        }
+        vulkan_descriptor_set_layout_builder_add_binding(builder, next->binding, next->type, next->count, next->stages);
+        previous = next->binding;
+        first = false;
+    }
+
+    return vulkan_descriptor_set_layout_builder_build(builder, device);
+}
+
+bool vulkan_reflect_validate_layout(vulkan_shader_reflection* reflection, u32 numSetLayouts, vulkan_descriptor_set_layout** setLayouts, u32 numPushConstantRanges, VkPushConstantRange* pushConstantRanges) {
+    for (u32 i = 0; i < reflection->numBindings; i++) {
+        vulkan_reflect_binding* binding = &reflection->bindings[i];
+        if (binding->set >= numSetLayouts) {
+            FATAL("Shader uses set %d but the pipeline layout only has %d sets", binding->set, numSetLayouts);
+            return false;
+        }
+
+        VkDescriptorSetLayoutBinding* layoutBinding = NULL;
+        vulkan_descriptor_set_layout* layout = setLayouts[binding->set];
+        for (u32 j = 0; j < layout->numBindings; j++) {
+            if (layout->bindings[j].binding == binding->binding) layoutBinding = &layout->bindings[j];
+        }
+
+        if (layoutBinding == NULL) {
+            FATAL("Shader uses set %d binding %d which isn't in the pipeline layout", binding->set, binding->binding);
+            return false;
+        }
+        if (layoutBinding->descriptorType != binding->type) {
+            FATAL("Set %d binding %d is type %d in the shader but type %d in the pipeline layout", binding->set, binding->binding, binding->type, layoutBinding->descriptorType);
+            return false;
+        }
+        if (layoutBinding->descriptorCount < binding->count) {
+            FATAL("Set %d binding %d needs %d descriptors but the pipeline layout has %d", binding->set, binding->binding, binding->count, layoutBinding->descriptorCount);
+            return false;
+        }
+        if ((layoutBinding->stageFlags & binding->stages) != binding->stages) {
+            FATAL("Set %d binding %d isn't visible to shader stage %d", binding->set, binding->binding, binding->stages);
+            return false;
+        }
+    }
+
+    if (reflection->hasPushConstants) {
+        u32 start = reflection->pushConstants.offset;
+        u32 end = start + reflection->pushConstants.size;
+        bool covered = false;
+        for (u32 i = 0; i < numPushConstantRanges; i++) {
+            VkPushConstantRange* range = &pushConstantRanges[i];
+            if ((range->stageFlags & reflection->stages) && range->offset <= start && range->offset + range->size >= end) covered = true;
+        }
+        if (!covered) {
+            FATAL("Shader push constants %d to %d aren't covered by a push constant range for stage %d", start, end, reflection->stages);
+            return false;
+        }
+    }
+
+    return true;
+}
+
+// Vertex attributes only have to agree on the numeric type, missing components are filled in by the input assembler
+u32 reflect_format_class(VkFormat format) {
+    switch (format) {
+        case(VK_FORMAT_R32_SINT) :
+        case(VK_FORMAT_R32G32_SINT) :
+        case(VK_FORMAT_R32G32B32_SINT) :
+        case(VK_FORMAT_R32G32B32A32_SINT) : return 1;
+        case(VK_FORMAT_R32_UINT) :
+        case(VK_FORMAT_R32G32_UINT) :
+        case(VK_FORMAT_R32G32B32_UINT) :
+        case(VK_FORMAT_R32G32B32A32_UINT) : return 2;
+        default : return 0;
+    }
+}
+
+bool vulkan_reflect_validate_vertex_input(vulkan_shader_reflection* reflection, vulkan_vertex_info* vertexInfo) {
+    for (u32 i = 0; i < reflection->numInputs; i++) {
+        vulkan_reflect_interface_variable* input = &reflection->inputs[i];
+        VkVertexInputAttributeDescription* attribute = NULL;
+        for (u32 j = 0; j < vertexInfo->numAttributes; j++) {
+            if (vertexInfo->attributes[j].location == input->location) attribute = &vertexInfo->attributes[j];
+        }
+
+        if (attribute == NULL) {
+            FATAL("Vertex shader reads location %d but no vertex attribute provides it", input->location);
+            return false;
+        }
+        if (input->format != VK_FORMAT_UNDEFINED && reflect_format_class(input->format) != reflect_format_class(attribute->format)) {
+            FATAL("Vertex shader input at location %d has format %d but the attribute is format %d", input->location, input->format, attribute->format);
+            return false;
+        }
+    }
+    return true;
+}
+
+bool vulkan_reflect_validate_interface(vulkan_shader_reflection* producer, vulkan_shader_reflection* consumer) {
+    for (u32 i = 0; i < consumer->numInputs; i++) {
+        vulkan_reflect_interface_variable* input = &consumer->inputs[i];
+        vulkan_reflect_interface_variable* output = NULL;
+        for (u32 j = 0; j < producer->numOutputs; j++) {
+            if (producer->outputs[j].location == input->location) output = &producer->outputs[j];
+        }
+
+        if (output == NULL) {
+            FATAL("Shader stage %d reads location %d which stage %d never writes", consumer->stages, input->location, producer->stages);
+            return false;
+        }
+        if (output->format != input->format) {
+            FATAL("Location %d is format %d in stage %d but format %d in stage %d", input->location, output->format, producer->stages, input->format, consumer->stages);
+            return false;
+        }
+    }
+    return true;
+}
+
+bool reflect_has_spec_constant(vulkan_shader_reflection* reflection, u32 id) {
+    for (u32 i = 0; i < reflection->numSpecConstants; i++) {
+        if (reflection->specConstants[i] == id) return true;
+    }
+    return false;
+}
+
+bool vulkan_reflect_validate_specialization(vulkan_shader_reflection* vertex, vulkan_shader_reflection* fragment, VkSpecializationInfo* specialization) {
+    if (specialization == NULL) return true;
+    for (u32 i = 0; i < specialization->mapEntryCount; i++) {
+        u32 id = specialization->pMapEntries[i].constantID;
+        if (!reflect_has_spec_constant(vertex, id) && !reflect_has_spec_constant(fragment, id)) {
+            FATAL("Specialization constant %d isn't declared by either shader, the modules may be out of date with their source", id);
+            return false;
+        }
+    }
+    return true;
+}
\ No newline at end of file
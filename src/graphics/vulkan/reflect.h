@@ -0,0 +1,57 @@
+#pragma once
+
+#include "core/core.h"
+#include "vulkan/vulkan.h"
+
+#include "device.h"
+#include "descriptor.h"
+#include "vertex.h"
+
+typedef struct {
+    u32 set;
+    u32 binding;
+    VkDescriptorType type;
+    u32 count; // 0 for runtime sized arrays
+    VkShaderStageFlags stages;
+} vulkan_reflect_binding;
+
+typedef struct {
+    u32 location;
+    VkFormat format;
+} vulkan_reflect_interface_variable;
+
+// Everything a pipeline needs to agree with, pulled straight out of the SPIR-V
+typedef struct {
+    VkShaderStageFlags stages;
+
+    u32 numBindings;
+    vulkan_reflect_binding* bindings;
+
+    bool hasPushConstants;
+    VkPushConstantRange pushConstants;
+
+    u32 numInputs;
+    vulkan_reflect_interface_variable* inputs;
+    u32 numOutputs;
+    vulkan_reflect_interface_variable* outputs;
+
+    u32 numSpecConstants;
+    u32* specConstants; // constant_id of every specialization constant
+} vulkan_shader_reflection;
+
+// Returns false for anything that isn't well formed SPIR-V, the reflection is left empty in that case
+bool vulkan_reflect_spirv(const u32* code, u64 size, vulkan_shader_reflection* reflection);
+void vulkan_reflect_free(vulkan_shader_reflection* reflection);
+
+// Adds the stage's bindings to the merged reflection, fails if both declare the same binding differently
+bool vulkan_reflect_merge(vulkan_shader_reflection* merged, vulkan_shader_reflection* stage);
+u32 vulkan_reflect_get_num_sets(vulkan_shader_reflection* reflection);
+// Only the stages that actually use each binding end up in its stage mask
+vulkan_descriptor_set_layout* vulkan_reflect_build_set_layout(vulkan_shader_reflection* reflection, u32 set, vulkan_device* device);
+
+// These log what is wrong and return false rather than letting the pipeline fault on the GPU
+bool vulkan_reflect_validate_layout(vulkan_shader_reflection* reflection, u32 numSetLayouts, vulkan_descriptor_set_layout** setLayouts, u32 numPushConstantRanges, VkPushConstantRange* pushConstantRanges);
+bool vulkan_reflect_validate_vertex_input(vulkan_shader_reflection* reflection, vulkan_vertex_info* vertexInfo);
+bool vulkan_reflect_validate_interface(vulkan_shader_reflection* producer, vulkan_shader_reflection* consumer);
+// Every constant the specialization sets has to exist in one of the stages, otherwise it's silently ignored
+bool vulkan_reflect_validate_specialization(vulkan_shader_reflection* vertex, vulkan_shader_reflection* fragment, VkSpecializationInfo* specialization);
\ No newline at end of file
@@ -62,13 +62,15 @@ void vulkan_renderpass_builder_add_subpass(vulkan_renderpass_builder* builder, v
 vulkan_renderpass* vulkan_renderpass_builder_build(vulkan_renderpass_builder* builder, vulkan_device* device) {
     VkSubpassDependency* dependencies = malloc(sizeof(VkSubpassDependency) * (builder->numSubpasses - 1));
     CLEAR_MEMORY_ARRAY(dependencies, builder->numSubpasses - 1);
+    // Each subpass only waits on the attachment writes of the one before it, and only for the pixels it touches
     for (u32 i = 0; i < (builder->numSubpasses - 1); i++) {
         dependencies[i].srcSubpass = i;
         dependencies[i].dstSubpass = i + 1;
-        dependencies[i].srcStageMask = VK_PIPELINE_STAGE_BOTTOM_OF_PIPE_BIT;
-        dependencies[i].srcAccessMask = 0;
-        dependencies[i].dstStageMask = VK_PIPELINE_STAGE_TOP_OF_PIPE_BIT;
-        dependencies[i].dstAccessMask = 0;
+        dependencies[i].srcStageMask = VK_PIPELINE_STAGE_COLOR_ATTACHMENT_OUTPUT_BIT | VK_PIPELINE_STAGE_LATE_FRAGMENT_TESTS_BIT;
+        dependencies[i].srcAccessMask = VK_ACCESS_COLOR_ATTACHMENT_WRITE_BIT | VK_ACCESS_DEPTH_STENCIL_ATTACHMENT_WRITE_BIT;
+        dependencies[i].dstStageMask = VK_PIPELINE_STAGE_FRAGMENT_SHADER_BIT | VK_PIPELINE_STAGE_EARLY_FRAGMENT_TESTS_BIT | VK_PIPELINE_STAGE_COLOR_ATTACHMENT_OUTPUT_BIT;
+        dependencies[i].dstAccessMask = VK_ACCESS_INPUT_ATTACHMENT_READ_BIT | VK_ACCESS_COLOR_ATTACHMENT_READ_BIT | VK_ACCESS_COLOR_ATTACHMENT_WRITE_BIT | VK_ACCESS_DEPTH_STENCIL_ATTACHMENT_READ_BIT | VK_ACCESS_DEPTH_STENCIL_ATTACHMENT_WRITE_BIT;
+        dependencies[i].dependencyFlags = VK_DEPENDENCY_BY_REGION_BIT;
     }
     
     VkRenderPassCreateInfo createInfo;
@@ -159,7 +161,23 @@ void vulkan_framebuffer_destroy(vulkan_framebuffer* framebuffer) {
     free(framebuffer);
 }
 
-void vulkan_renderpass_bind(VkCommandBuffer cmd, vulkan_renderpass* renderpass, vulkan_framebuffer* framebuffer) {
+VkClearValue vulkan_renderpass_get_clear_value(VkFormat format) {
+    VkClearValue clearValue;
+    CLEAR_MEMORY(&clearValue);
+
+    if (format == VK_FORMAT_R32G32B32A32_SFLOAT) {
+        float clearValueData[4] = { 0.0f, 0.0f, 0.0f, 1.0f };
+        memcpy(clearValue.color.float32, clearValueData, sizeof(float) * 4);
+    } else if (format == VK_FORMAT_D32_SFLOAT) {
+        clearValue.depthStencil.depth = 1.0f;
+    } else if (format == VK_FORMAT_R16_SFLOAT) { // Special rule for the the reveal buffer (need a way of specifying this)
+        clearValue.color.float32[0] = 1.0f;
+    }
+
+    return clearValue;
+}
+
+void vulkan_renderpass_bind(VkCommandBuffer cmd, vulkan_renderpass* renderpass, vulkan_framebuffer* framebuffer, VkSubpassContents contents) {
     VkRenderPassBeginInfo renderInfo;
     CLEAR_MEMORY(&renderInfo);
 
@@ -178,23 +196,14 @@ void vulkan_renderpass_bind(VkCommandBuffer cmd, vulkan_renderpass* renderpass,
         if (attachment->loadOp == VK_ATTACHMENT_LOAD_OP_CLEAR) {
             numClearValues++;
             clearValues = realloc(clearValues, sizeof(VkClearValue) * (i + 1));
-            CLEAR_MEMORY(&clearValues[i]);
-
-            if (attachment->format == VK_FORMAT_R32G32B32A32_SFLOAT) {
-                float clearValueData[4] = { 0.0f, 0.0f, 0.0f, 1.0f };
-                memcpy(clearValues[i].color.float32, clearValueData, sizeof(float) * 4);
-            } else if (attachment->format == VK_FORMAT_D32_SFLOAT) {
-                clearValues[i].depthStencil.depth = 1.0f;
-            } else if (attachment->format == VK_FORMAT_R16_SFLOAT) { // Special rule for the the reveal buffer (need a way of specifying this)
-                clearValues[i].color.float32[0] = 1.0f;
-            }
+            clearValues[i] = vulkan_renderpass_get_clear_value(attachment->format);
         }
     }
 
     renderInfo.clearValueCount = numClearValues;
     renderInfo.pClearValues = clearValues;
 
-    vkCmdBeginRenderPass(cmd, &renderInfo, VK_SUBPASS_CONTENTS_INLINE);
+    vkCmdBeginRenderPass(cmd, &renderInfo, contents);
     free(clearValues);
 }
 
@@ -57,7 +57,9 @@ typedef struct {
 vulkan_framebuffer* vulkan_framebuffer_create(vulkan_device* device, vulkan_renderpass* renderpass, u32 numImages, vulkan_image** images);
 void vulkan_framebuffer_destroy(vulkan_framebuffer* framebuffer);
 
-void vulkan_renderpass_bind(VkCommandBuffer cmd, vulkan_renderpass* renderpass, vulkan_framebuffer* framebuffer);
+// What attachments of the format are cleared to on load, for render passes and dynamic rendering alike
+VkClearValue vulkan_renderpass_get_clear_value(VkFormat format);
+void vulkan_renderpass_bind(VkCommandBuffer cmd, vulkan_renderpass* renderpass, vulkan_framebuffer* framebuffer, VkSubpassContents contents);
 
 VkAttachmentDescription vulkan_renderpass_get_default_color_attachment(VkFormat format, VkSampleCountFlagBits samples);
 VkAttachmentDescription vulkan_renderpass_get_default_depth_attachment(VkSampleCountFlagBits samples);
@@ -1,19 +1,28 @@
 #include "shader.h"
 
-vulkan_shader* vulkan_shader_load_from_file(vulkan_device* device, const char* path, vulkan_shader_type type) {
+#include "core/hash.h"
+
+char* read_shader_file(const char* path, u64* size) {
     FILE* shaderFile = fopen(path, "rb");
-    if (shaderFile == NULL) {
-        FATAL("Could not open file: %s", path);
-    }
+    if (shaderFile == NULL) return NULL;
 
     fseek(shaderFile, 0L, SEEK_END);
-    u64 shaderFileSize = ftell(shaderFile);
+    *size = ftell(shaderFile);
     fseek(shaderFile, 0L, SEEK_SET);
 
-    char* shaderCode = malloc(shaderFileSize);
-    fread(shaderCode, shaderFileSize, 1, shaderFile);
+    char* shaderCode = malloc(*size);
+    u64 numRead = fread(shaderCode, 1, *size, shaderFile);
     fclose(shaderFile);
 
+    // SPIR-V is a stream of words, anything else is a file that is still being written
+    if (numRead != *size || *size == 0 || *size % sizeof(u32) != 0) {
+        free(shaderCode);
+        return NULL;
+    }
+    return shaderCode;
+}
+
+VkResult create_shader_module(vulkan_device* device, char* shaderCode, u64 shaderFileSize, VkShaderModule* module) {
     VkShaderModuleCreateInfo createInfo;
     CLEAR_MEMORY(&createInfo);
 
@@ -21,20 +30,91 @@ vulkan_shader* vulkan_shader_load_from_file(vulkan_device* device, const char* p
     createInfo.codeSize = shaderFileSize;
     createInfo.pCode = (u32*)shaderCode;
 
+    return vkCreateShaderModule(device->device, &createInfo, NULL, module);
+}
+
+bool reflect_shader_code(const char* path, vulkan_shader_type type, char* shaderCode, u64 shaderFileSize, vulkan_shader_reflection* reflection) {
+    if (!vulkan_reflect_spirv((u32*)shaderCode, shaderFileSize, reflection)) {
+        FATAL("%s isn't valid SPIR-V", path);
+        return false;
+    }
+    if (reflection->stages != (VkShaderStageFlags)type) {
+        FATAL("%s is a shader for stage %d but was loaded as stage %d", path, reflection->stages, type);
+        vulkan_reflect_free(reflection);
+        return false;
+    }
+    return true;
+}
+
+vulkan_shader* vulkan_shader_load_from_file(vulkan_device* device, const char* path, vulkan_shader_type type) {
+    u64 shaderFileSize;
+    char* shaderCode = read_shader_file(path, &shaderFileSize);
+    if (shaderCode == NULL) {
+        FATAL("Could not open file: %s", path);
+        return NULL;
+    }
+
     vulkan_shader* shader = malloc(sizeof(vulkan_shader));
     shader->device = device;
     shader->type = type;
-    VkResult result = vkCreateShaderModule(device->device, &createInfo, NULL, &shader->module);
+    shader->hash = hash_bytes(shaderCode, shaderFileSize, hash_u64(type, HASH_SEED));
+    if (!reflect_shader_code(path, type, shaderCode, shaderFileSize, &shader->reflection)) {
+        free(shaderCode);
+        free(shader);
+        return NULL;
+    }
+    VkResult result = create_shader_module(device, shaderCode, shaderFileSize, &shader->module);
+    free(shaderCode);
     if (result != VK_SUCCESS) {
         FATAL("Vulkan shader module creation failed with error code %d", result);
+        vulkan_reflect_free(&shader->reflection);
+        free(shader);
+        return NULL;
     }
-    free(shaderCode);
 
     return shader;
 }
 
+bool vulkan_shader_reload(vulkan_shader* shader, const char* path) {
+    u64 shaderFileSize;
+    char* shaderCode = read_shader_file(path, &shaderFileSize);
+    if (shaderCode == NULL) {
+        WARN("Could not reload shader %s, keeping the old module", path);
+        return false;
+    }
+
+    u64 hash = hash_bytes(shaderCode, shaderFileSize, hash_u64(shader->type, HASH_SEED));
+    if (hash == shader->hash) {
+        free(shaderCode);
+        return false;
+    }
+
+    vulkan_shader_reflection reflection;
+    if (!reflect_shader_code(path, shader->type, shaderCode, shaderFileSize, &reflection)) {
+        free(shaderCode);
+        return false;
+    }
+
+    VkShaderModule module;
+    VkResult result = create_shader_module(shader->device, shaderCode, shaderFileSize, &module);
+    free(shaderCode);
+    if (result != VK_SUCCESS) {
+        WARN("Vulkan shader module creation failed for %s with error code %d, keeping the old module", path, result);
+        vulkan_reflect_free(&reflection);
+        return false;
+    }
+
+    vkDestroyShaderModule(shader->device->device, shader->module, NULL);
+    vulkan_reflect_free(&shader->reflection);
+    shader->module = module;
+    shader->hash = hash;
+    shader->reflection = reflection;
+    return true;
+}
+
 void vulkan_shader_destroy(vulkan_shader* shader) {
     vkDestroyShaderModule(shader->device->device, shader->module, NULL);
+    vulkan_reflect_free(&shader->reflection);
     free(shader);
 }
 
@@ -4,19 +4,26 @@
 #include "vulkan/vulkan.h"
 
 #include "device.h"
+#include "reflect.h"
 
 typedef enum {
     VERTEX = VK_SHADER_STAGE_VERTEX_BIT,
-    FRAGMENT = VK_SHADER_STAGE_FRAGMENT_BIT
+    FRAGMENT = VK_SHADER_STAGE_FRAGMENT_BIT,
+    COMPUTE = VK_SHADER_STAGE_COMPUTE_BIT
 } vulkan_shader_type;
 
 typedef struct {
     vulkan_device* device;
     VkShaderModule module;
     vulkan_shader_type type;
+    u64 hash; // Of the SPIR-V and stage, so pipeline keys stay valid if the module handle gets reused
+    vulkan_shader_reflection reflection;
 } vulkan_shader;
 
+// NULL if the file is missing or isn't a valid module for the stage
 vulkan_shader* vulkan_shader_load_from_file(vulkan_device* device, const char* path, vulkan_shader_type type);
+// Swaps in a new module if the file changed and is valid, nothing may be compiling with the old module while this runs
+bool vulkan_shader_reload(vulkan_shader* shader, const char* path);
 void vulkan_shader_destroy(vulkan_shader* shader);
 
 VkPipelineShaderStageCreateInfo vulkan_shader_get_stage_info(vulkan_shader* shader);
@@ -0,0 +1,188 @@
+#include "shaderlibrary.h"
+
+#include "core/hash.h"
+#include "core/timer.h"
+
+#include <sys/stat.h>
+
+#ifdef __linux__
+#include <sys/inotify.h>
+#include <unistd.h>
+#include <errno.h>
+#endif
+
+const char* shader_library_file_name(const char* path) {
+    const char* name = path;
+    for (const char* c = path; *c != '\0'; c++) {
+        if (*c == '/' || *c == '\\') name = c + 1;
+    }
+    return name;
+}
+
+i64 shader_library_modified_time(const char* path) {
+    struct stat info;
+    if (stat(path, &info) != 0) return 0;
+    return (i64)info.st_mtime;
+}
+
+// Modules are built next to their source as <source>.spv, layouts are reflected from the module so one the build missed would silently disagree with the GLSL
+void shader_library_check_source(const char* path) {
+    u64 pathLength = strlen(path);
+    if (pathLength <= 4 || strcmp(path + pathLength - 4, ".spv") != 0) return;
+
+    char* source = malloc(pathLength - 3);
+    memcpy(source, path, pathLength - 4);
+    source[pathLength - 4] = '\0';
+    i64 sourceTime = shader_library_modified_time(source);
+    if (sourceTime > shader_library_modified_time(path)) {
+        WARN("Shader %s is older than its source %s, rebuild the shaders target", path, source);
+    }
+    free(source);
+}
+
+void shader_library_watch(vulkan_shader_library* library, vulkan_shader_library_entry* entry) {
+    entry->watch = -1;
+    entry->modifiedTime = shader_library_modified_time(entry->path);
+
+#ifdef __linux__
+    if (library->watcher < 0) return;
+
+    // Watching the directory rather than the file keeps working when tools replace the file instead of writing into it
+    const char* name = shader_library_file_name(entry->path);
+    u64 directoryLength = name - entry->path;
+    char* directory = malloc(directoryLength + 2);
+    if (directoryLength == 0) {
+        strcpy(directory, ".");
+    } else {
+        memcpy(directory, entry->path, directoryLength);
+        directory[directoryLength] = '\0';
+    }
+
+    entry->watch = inotify_add_watch(library->watcher, directory, IN_CLOSE_WRITE | IN_MOVED_TO);
+    if (entry->watch < 0) {
+        WARN("Could not watch %s for shader changes, %s will not hot reload", directory, entry->path);
+    }
+    free(directory);
+#endif
+}
+
+vulkan_shader_library* vulkan_shader_library_create(vulkan_device* device, vulkan_pso_cache* psos) {
+    vulkan_shader_library* library = malloc(sizeof(vulkan_shader_library));
+    CLEAR_MEMORY(library);
+    library->device = device;
+    library->psos = psos;
+    library->shaders = hashmap_create(0);
+    library->entries = malloc(0);
+    library->watcher = -1;
+
+#ifdef __linux__
+    library->watcher = inotify_init1(IN_NONBLOCK | IN_CLOEXEC);
+    if (library->watcher < 0) {
+        WARN("inotify is unavailable, falling back to polling shader files");
+    }
+#endif
+
+    return library;
+}
+
+void vulkan_shader_library_destroy(vulkan_shader_library* library) {
+#ifdef __linux__
+    if (library->watcher >= 0) {
+        close(library->watcher);
+    }
+#endif
+
+    for (u32 i = 0; i < library->numEntries; i++) {
+        vulkan_shader_destroy(library->entries[i]->shader);
+        free(library->entries[i]->path);
+        free(library->entries[i]);
+    }
+    free(library->entries);
+    hashmap_destroy(library->shaders);
+    free(library);
+}
+
+vulkan_shader* vulkan_shader_library_load(vulkan_shader_library* library, const char* path, vulkan_shader_type type) {
+    u64 key = hash_string(path, hash_u64(type, HASH_SEED));
+    vulkan_shader_library_entry* entry = hashmap_get(library->shaders, key);
+    if (entry != NULL && entry->shader->type == type && strcmp(entry->path, path) == 0) {
+        return entry->shader;
+    }
+
+    shader_library_check_source(path);
+    vulkan_shader* shader = vulkan_shader_load_from_file(library->device, path, type);
+    if (shader == NULL) return NULL; // Not cached, so a later load can pick the file up once it's built
+
+    entry = malloc(sizeof(vulkan_shader_library_entry));
+    CLEAR_MEMORY(entry);
+    entry->path = malloc(strlen(path) + 1);
+    strcpy(entry->path, path);
+    entry->shader = shader;
+    shader_library_watch(library, entry);
+
+    hashmap_set(library->shaders, key, entry);
+    library->numEntries++;
+    library->entries = realloc(library->entries, sizeof(vulkan_shader_library_entry*) * library->numEntries);
+    library->entries[library->numEntries - 1] = entry;
+
+    return entry->shader;
+}
+
+void vulkan_shader_library_set_reload_callback(vulkan_shader_library* library, vulkan_shader_reload_callback callback, void* data) {
+    library->reloadCallback = callback;
+    library->reloadData = data;
+}
+
+void shader_library_reload(vulkan_shader_library* library, vulkan_shader_library_entry* entry) {
+    // A pipeline compiling on a worker may still be reading the old module
+    vulkan_pso_cache_wait(library->psos);
+    if (!vulkan_shader_reload(entry->shader, entry->path)) return;
+
+    INFO("Reloaded shader %s", entry->path);
+    if (library->reloadCallback) {
+        library->reloadCallback(entry->shader, library->reloadData);
+    }
+}
+
+void vulkan_shader_library_poll(vulkan_shader_library* library) {
+#ifdef __linux__
+    if (library->watcher >= 0) {
+        char events[4096] __attribute__((aligned(__alignof__(struct inotify_event))));
+        while (true) {
+            ssize_t numBytes = read(library->watcher, events, sizeof(events));
+            if (numBytes <= 0) {
+                if (numBytes < 0 && errno != EAGAIN) {
+                    WARN("Reading shader file events failed with errno %d", errno);
+                }
+                break;
+            }
+
+            for (char* ptr = events; ptr < events + numBytes; ptr += sizeof(struct inotify_event) + ((struct inotify_event*)ptr)->len) {
+                struct inotify_event* event = (struct inotify_event*)ptr;
+                if (event->len == 0) continue;
+
+                for (u32 i = 0; i < library->numEntries; i++) {
+                    vulkan_shader_library_entry* entry = library->entries[i];
+                    if (entry->watch == event->wd && strcmp(shader_library_file_name(entry->path), event->name) == 0) {
+                        shader_library_reload(library, entry);
+                    }
+                }
+            }
+        }
+        return;
+    }
+#endif
+
+    double now = timer_now();
+    if (now - library->lastPoll < SHADER_LIBRARY_POLL_INTERVAL) return;
+    library->lastPoll = now;
+
+    for (u32 i = 0; i < library->numEntries; i++) {
+        vulkan_shader_library_entry* entry = library->entries[i];
+        i64 modifiedTime = shader_library_modified_time(entry->path);
+        if (modifiedTime != 0 && modifiedTime != entry->modifiedTime) {
+            entry->modifiedTime = modifiedTime;
+            shader_library_reload(library, entry);
+        }
+    }
+}
\ No newline at end of file
@@ -0,0 +1,48 @@
+#pragma once
+
+#include "core/core.h"
+#include "core/hashmap.h"
+#include "vulkan/vulkan.h"
+
+#include "device.h"
+#include "shader.h"
+#include "pso.h"
+
+// How often file modification times are checked on platforms without inotify
+#define SHADER_LIBRARY_POLL_INTERVAL 0.5
+
+typedef void (*vulkan_shader_reload_callback)(vulkan_shader* shader, void* data);
+
+typedef struct {
+    char* path;
+    vulkan_shader* shader;
+    i32 watch;
+    i64 modifiedTime;
+} vulkan_shader_library_entry;
+
+// Loads every module once and owns it until the library is destroyed, so handles can be shared freely
+typedef struct _vulkan_shader_library {
+    vulkan_device* device;
+    vulkan_pso_cache* psos;
+
+    hashmap* shaders;
+    u32 numEntries;
+    vulkan_shader_library_entry** entries;
+
+    i32 watcher; // inotify descriptor, -1 when falling back to polling
+    double lastPoll;
+
+    vulkan_shader_reload_callback reloadCallback;
+    void* reloadData;
+} vulkan_shader_library;
+
+vulkan_shader_library* vulkan_shader_library_create(vulkan_device* device, vulkan_pso_cache* psos);
+void vulkan_shader_library_destroy(vulkan_shader_library* library);
+
+// NULL if the shader couldn't be loaded
+vulkan_shader* vulkan_shader_library_load(vulkan_shader_library* library, const char* path, vulkan_shader_type type);
+
+// Called once a changed module has been swapped in, so whoever built pipelines with it can request them again
+void vulkan_shader_library_set_reload_callback(vulkan_shader_library* library, vulkan_shader_reload_callback callback, void* data);
+// Cheap enough to call every frame, only touches the disk when a watched file changed
+void vulkan_shader_library_poll(vulkan_shader_library* library);
\ No newline at end of file